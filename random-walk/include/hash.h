@@ -0,0 +1,24 @@
+/**
+ * @file hash.h
+ * @brief 64-bitový FNV-1a haš pre kľúče a kontrolné súčty súborov.
+ *
+ * Používa ho cache výsledkov, checkpointy aj denník behov - haš sa ukladá
+ * do súborov, takže sa nesmie zmeniť bez zmeny ich formátu.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/** Počiatočná hodnota FNV-1a. */
+#define FNV_OFFSET 14695981039346656037ULL
+
+/**
+ * @brief 64-bitový FNV-1a haš.
+ *
+ * @param h Počiatočná hodnota (FNV_OFFSET, alebo haš predošlého bloku na pokračovanie).
+ * @param data Dáta.
+ * @param len Dĺžka dát.
+ * @return Haš.
+ */
+uint64_t fnv1a(uint64_t h, const void* data, size_t len);
@@ -0,0 +1,109 @@
+/**
+ * @file hist.h
+ * @brief Log-lineárny histogram počtu krokov (rozloženie košov a kvantily).
+ *
+ * Hodnoty pod 2 * STEP_HIST_SUB majú vlastný kôš, každý vyšší interval
+ * [2^e, 2^(e+1)) sa delí na STEP_HIST_SUB rovnako širokých košov. Hodnota
+ * z koša sa tak od skutočnej líši najviac o 1/STEP_HIST_SUB relatívne, a to
+ * v celom rozsahu uint32_t pri pevnom počte košov. Histogramy sa zlučujú
+ * obyčajným sčítaním počtov. Rovnaké rozloženie používa server (results_t)
+ * aj klient (MSG_STEP_HIST). Funkcie s príponou _bits pracujú s iným počtom
+ * bitov presnosti (hrubší histogram v zázname runlog.h); histogram s menej
+ * bitmi vznikne z jemnejšieho sčítaním košov cez hist_index_bits(hist_low(i)).
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Počet košov histogramu s bits bitmi presnosti.
+ *
+ * @param bits Bity presnosti (1..16).
+ * @return Počet košov pre celý rozsah uint32_t.
+ */
+static inline uint32_t hist_buckets_bits(uint32_t bits) {
+    return (32u - bits + 1u) << bits;
+}
+
+/**
+ * @brief Index koša pre hodnotu pri bits bitoch presnosti.
+ *
+ * @param v Hodnota (počet krokov).
+ * @param bits Bity presnosti (1..16).
+ * @return Index koša (< hist_buckets_bits(bits)).
+ */
+static inline uint32_t hist_index_bits(uint32_t v, uint32_t bits) {
+    if (v < (2u << bits)) return v;
+    uint32_t shift = (uint32_t)(31 - __builtin_clz(v)) - bits;
+    return (shift << bits) + (v >> shift);
+}
+
+/**
+ * @brief Index koša pre hodnotu.
+ *
+ * @param v Hodnota (počet krokov).
+ * @return Index koša (< STEP_HIST_BUCKETS).
+ */
+static inline uint32_t hist_index(uint32_t v) {
+    return hist_index_bits(v, STEP_HIST_SUB_BITS);
+}
+
+/**
+ * @brief Dolná hranica koša pri bits bitoch presnosti.
+ *
+ * @param i Index koša.
+ * @param bits Bity presnosti.
+ * @return Najmenšia hodnota v koši.
+ */
+uint32_t hist_low_bits(uint32_t i, uint32_t bits);
+
+/**
+ * @brief Horná hranica koša pri bits bitoch presnosti.
+ *
+ * @param i Index koša.
+ * @param bits Bity presnosti.
+ * @return Najväčšia hodnota v koši.
+ */
+uint32_t hist_high_bits(uint32_t i, uint32_t bits);
+
+/**
+ * @brief Kvantil z počtov v košoch pri bits bitoch presnosti (ako hist_quantile).
+ *
+ * @param counts Počty v košoch.
+ * @param n_buckets Počet košov.
+ * @param bits Bity presnosti.
+ * @param q Kvantil v intervale [0, 1].
+ * @return Hodnota kvantilu, alebo 0 pri prázdnom histograme.
+ */
+uint32_t hist_quantile_bits(const uint32_t* counts, uint32_t n_buckets, uint32_t bits, double q);
+
+/**
+ * @brief Najmenšia hodnota, ktorá padne do koša.
+ *
+ * @param i Index koša (< STEP_HIST_BUCKETS).
+ * @return Dolná hranica koša.
+ */
+uint32_t hist_low(uint32_t i);
+
+/**
+ * @brief Najväčšia hodnota, ktorá padne do koša.
+ *
+ * @param i Index koša (< STEP_HIST_BUCKETS).
+ * @return Horná hranica koša.
+ */
+uint32_t hist_high(uint32_t i);
+
+/**
+ * @brief Kvantil z počtov v košoch.
+ *
+ * Vráti hornú hranicu koša, v ktorom leží hodnota s poradím ceil(q * n),
+ * kde n je súčet počtov - pod ňou je teda aspoň podiel q hodnôt.
+ *
+ * @param counts Počty v košoch 0..n_buckets-1.
+ * @param n_buckets Počet košov (<= STEP_HIST_BUCKETS).
+ * @param q Kvantil v intervale [0, 1] (napr. 0.99).
+ * @return Hodnota kvantilu, alebo 0 pri prázdnom histograme.
+ */
+uint32_t hist_quantile(const uint32_t* counts, uint32_t n_buckets, double q);
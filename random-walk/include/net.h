@@ -6,6 +6,16 @@
 #include <string.h>      // memset()
 #include <stdio.h>       // snprintf()
 #include <errno.h>       // errno, EINTR
+#include <sys/uio.h>     // struct iovec
+
+/**
+ * @brief Politika odosielania pre jedno spojenie (volí sa pri pripojení).
+ */
+typedef enum {
+    NET_POLICY_LATENCY    = 0, /**< TCP_NODELAY: každá správa odchádza hneď (interaktívne, živé stavy) */
+    NET_POLICY_THROUGHPUT = 1  /**< TCP_CORK: jadro skladá plné segmenty, odoslanie vynúti net_flush() */
+} net_policy_t;
+
 /**
  * @brief Vytvorí TCP serverový socket a začne počúvať na zadanom porte.
  *
@@ -27,12 +37,13 @@ int net_listen(uint16_t port, int backlog);
  * ako neblokujúci).
  *
  * @param listen_fd File descriptor počúvajúceho socketu.
+ * @param policy Politika odosielania nového spojenia (net_policy_t).
  * @return File descriptor nového socketu pre komunikáciu s klientom
  *         pri úspechu, -1 pri chybe.
  *
  * @note Volajúci je zodpovedný za zatvorenie vráteného socketu.
  */
-int net_accept(int listen_fd);
+int net_accept(int listen_fd, int policy);
 
 /**
  * @brief Pripojí sa na TCP server na zadanej adrese a porte.
@@ -41,11 +52,35 @@ int net_accept(int listen_fd);
  *
  * @param host IP adresa alebo názov hostiteľa (napr. "127.0.0.1").
  * @param port Číslo portu servera (v host byte order).
+ * @param policy Politika odosielania spojenia (net_policy_t).
  * @return File descriptor pripojeného socketu pri úspechu, -1 pri chybe.
  *
  * @note Volajúci je zodpovedný za zatvorenie socketu pomocou close(fd).
  */
-int net_connect(const char* host, uint16_t port);
+int net_connect(const char* host, uint16_t port, int policy);
+
+/**
+ * @brief Nastaví politiku odosielania na pripojenom sockete.
+ *
+ * NET_POLICY_LATENCY zapne TCP_NODELAY (vypne Nagle) a vypne TCP_CORK.
+ * NET_POLICY_THROUGHPUT zapne TCP_CORK: malé zápisy sa skladajú do plných
+ * segmentov, kým ich net_flush() (alebo jadro po ~200 ms) neodošle.
+ *
+ * @param fd File descriptor pripojeného socketu.
+ * @param policy Politika (net_policy_t).
+ * @return 0 pri úspechu, -1 pri chybe setsockopt().
+ */
+int net_set_policy(int fd, int policy);
+
+/**
+ * @brief Odošle dáta zadržané cez TCP_CORK a socket znovu zazátkuje.
+ *
+ * Pri NET_POLICY_LATENCY netreba volať (nič sa nezadržiava).
+ *
+ * @param fd File descriptor pripojeného socketu.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int net_flush(int fd);
 
 /**
  * @brief Pošle presne zadaný počet bajtov cez socket.
@@ -60,6 +95,45 @@ int net_connect(const char* host, uint16_t port);
  */
 int net_send_all(int fd, const void* buf, size_t len);
 
+/**
+ * @brief Pošle všetky bajty z viacerých bufferov jedným volaním sendmsg().
+ *
+ * Hlavička a payload tak odídu v jednom systémovom volaní (a pri Nagle
+ * nevznikne malý samostatný segment s hlavičkou). Pri čiastočnom odoslaní
+ * sa posunie v poli iov a pokračuje; pole sa pritom mení.
+ *
+ * @param fd File descriptor pripojeného socketu.
+ * @param iov Pole bufferov (obsah sa počas odosielania upravuje).
+ * @param iovcnt Počet bufferov.
+ * @return 0 pri úspechu (všetky dáta odoslané), -1 pri chybe.
+ */
+int net_sendv_all(int fd, struct iovec* iov, int iovcnt);
+
+/**
+ * @brief Prepne socket do neblokujúceho režimu (O_NONBLOCK).
+ *
+ * Používa sa pre počúvajúci socket v epoll slučke - accept() potom pri
+ * prázdnej fronte pripojení vráti -1 s EAGAIN namiesto čakania.
+ *
+ * @param fd File descriptor socketu.
+ * @return 0 pri úspechu, -1 pri chybe fcntl().
+ */
+int net_set_nonblocking(int fd);
+
+/**
+ * @brief Prečíta zo socketu, čo je práve k dispozícii, bez čakania.
+ *
+ * Používa MSG_DONTWAIT, takže socket môže ostať blokujúci pre zápisy
+ * z iných vlákien a čítanie v epoll slučke pritom nikdy nečaká.
+ *
+ * @param fd File descriptor pripojeného socketu.
+ * @param buf Buffer pre prijaté dáta.
+ * @param len Kapacita bufferu (> 0).
+ * @return Počet prijatých bajtov (> 0), 0 ak teraz nie je čo čítať,
+ *         -1 pri chybe alebo ukončení spojenia.
+ */
+int net_recv_some(int fd, void* buf, size_t len);
+
 /**
  * @brief Prijme presne zadaný počet bajtov zo socketu.
  *
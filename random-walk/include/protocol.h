@@ -21,9 +21,94 @@ typedef enum {
     MSG_START = 3,       /**< Klient -> Server: Parametre simulácie */
     MSG_STATE = 4,       /**< Server -> Klient: Aktuálny stav simulácie */
     MSG_DONE  = 5,       /**< Server -> Klient: Koniec simulácie */
-    MSG_QUIT  = 6        /**< Klient -> Server: Ukončiť server */
+    MSG_QUIT  = 6,       /**< Klient -> Server: Ukončiť server */
+
+    MSG_EXACT_PMF = 7,     /**< Server -> Klient: Úsek presného rozdelenia P(zásah v kroku t) */
+    MSG_EXACT_SUMMARY = 8, /**< Server -> Klient: Súhrn presného výpočtu (pred MSG_DONE) */
+    MSG_GRID_INFO = 9,     /**< Server -> Klient: Rozmery mriežky výsledkov pre všetky štarty */
+    MSG_GRID_CELLS = 10,   /**< Server -> Klient: Úsek mriežky výsledkov pre všetky štarty */
+
+    MSG_STATE_BATCH = 11,  /**< Server -> Klient: Viac po sebe idúcich stavov v jednej správe */
+    MSG_SESSION = 12,      /**< Klient -> Server: Požadované nastavenia spojenia (po HELLO_ACK) */
+    MSG_SESSION_ACK = 13,  /**< Server -> Klient: Nastavenia spojenia, ktoré server prijal */
+
+    MSG_TRAJ_INFO = 14,    /**< Server -> Klient: Parametre na rekonštrukciu trajektórií (pred MSG_TRAJ) */
+    MSG_TRAJ = 15,         /**< Server -> Klient: Úseky trajektórií (zakódované smery krokov) */
+    MSG_RING_STATUS = 16,  /**< Server -> Klient: Obsadenosť frontov odosielania (raz za sekundu a na konci behu) */
+
+    MSG_SUBSCRIBE = 17,    /**< Klient -> Server: Sledovať priebeh behov inej relácie */
+    MSG_SUBSCRIBE_ACK = 18, /**< Server -> Klient: Sledovaná relácia (0 = odmietnuté) */
+
+    MSG_RESULT = 19,       /**< Server -> Klient: Súhrn behu Monte Carlo (msg_result_t, pred MSG_DONE) */
+    MSG_STEP_HIST = 20,    /**< Server -> Klient: Histogram krokov úspešných replikácií (za MSG_RESULT) */
+    MSG_RESULT_PARTIAL = 21, /**< Server -> Klient: Priebežný súhrn behu Monte Carlo (msg_result_t, ak si ho klient vyžiadal) */
+    MSG_TRAJ_FILE = 22,    /**< Server -> Klient: Trajektórie behu sú zapísané v súbore (msg_traj_file_t, pred MSG_RESULT) */
+
+    MSG_RESUME = 23,       /**< Klient -> Server: Ako MSG_START (msg_start_t), ale pokračovať z posledného checkpointu behu */
+
+    MSG_SWEEP = 24,        /**< Klient -> Server: Beh Monte Carlo pre každý bod mriežky parametrov (msg_sweep_t) */
+    MSG_SWEEP_POINT = 25   /**< Server -> Klient: Výsledok jedného bodu MSG_SWEEP (msg_sweep_point_t, v poradí dokončenia) */
 } msg_type_t;
 
+/**
+ * @brief Režimy časovania krokov simulácie (msg_start_t.pacing).
+ *
+ * Časovanie ovplyvňuje iba rýchlosť simulácie, nie jej výsledok - pri rovnakom
+ * seede dávajú všetky režimy identické výsledky.
+ */
+typedef enum {
+    PACE_LIVE     = 0,   /**< Živé demo: pevná 100 ms pauza po každom kroku */
+    PACE_UNPACED  = 1,   /**< Turbo: bez pauzy, maximálna priepustnosť */
+    PACE_FIXED_HZ = 2    /**< Pevná frekvencia rate_hz krokov/s (absolútne deadliny, bez driftu) */
+} pace_mode_t;
+
+/**
+ * @brief Čo server posiela počas behu (msg_start_t.stream).
+ */
+typedef enum {
+    STREAM_STATES = 0,   /**< MSG_STATE po každom kroku (živé zobrazenie) */
+    STREAM_NONE   = 1,   /**< Žiadne stavy, len koniec behu (umožní dávkové SIMD jadro) */
+    STREAM_TRAJ   = 2    /**< Trajektórie: smery krokov po 2 bitoch (alebo menej), klient si dopočíta pozície */
+} stream_mode_t;
+
+/**
+ * @brief Správanie chodca na okraji sveta (msg_start_t.boundary).
+ */
+typedef enum {
+    BOUND_TORUS   = 0,   /**< Torus: krok cez okraj vedie na opačnú stranu */
+    BOUND_REFLECT = 1,   /**< Odraz: krok cez okraj sa zrkadlí späť dovnútra (-1 -> 1) */
+    BOUND_ABSORB  = 2    /**< Pohltenie: krok cez okraj ukončí replikáciu ako neúspech */
+} boundary_mode_t;
+
+/**
+ * @brief Spôsob výpočtu výsledkov (msg_start_t.method).
+ */
+typedef enum {
+    METHOD_MONTE_CARLO = 0, /**< Replikácie náhodnej prechádzky (odhad) */
+    METHOD_EXACT       = 1, /**< Presné rozdelenie šírením pravdepodobnosti po bunkách */
+    METHOD_ALL_STARTS  = 2  /**< Presná P(zásah) a stredný počet krokov pre každý štart naraz */
+} method_t;
+
+/**
+ * @brief Veličina, ktorej presnosť určuje počet replikácií (msg_start_t.target).
+ *
+ * Server počíta replikácie po blokoch a po každom bloku skontroluje polšírku
+ * 95 % intervalu spoľahlivosti; keď klesne na target_hw, beh skončí.
+ */
+typedef enum {
+    TARGET_NONE       = 0, /**< Bez cieľa: presne reps replikácií */
+    TARGET_SUCCESS    = 1, /**< Podiel replikácií, ktoré dosiahli (0,0) (target_hw ako podiel, napr. 0.01) */
+    TARGET_MEAN_STEPS = 2  /**< Priemerný počet krokov úspešných replikácií (target_hw v krokoch) */
+} target_metric_t;
+
+/**
+ * @brief Jednotka pevnej rádovej čiarky pre pravdepodobnosti smerov.
+ *
+ * Pravdepodobnosť q znamená q / PROB_ONE; súčet štyroch smerov musí byť
+ * presne PROB_ONE. Mocnina dvoch umožňuje vzorkovať smer bez zaujatosti modula.
+ */
+#define PROB_ONE 65536u
+
 /**
  * @brief Hlavička správy v binárnom protokole.
  *
@@ -59,8 +144,282 @@ typedef struct __attribute__((packed)) {
     uint8_t  p_down;     /**< Pravdepodobnosť pohybu dole (%) */
     uint8_t  p_left;     /**< Pravdepodobnosť pohybu doľava (%) */
     uint8_t  p_right;    /**< Pravdepodobnosť pohybu doprava (%) */
+
+    uint8_t  pacing;     /**< Režim časovania krokov (pace_mode_t) */
+    uint32_t rate_hz;    /**< Frekvencia krokov pre PACE_FIXED_HZ (kroky/s) */
+    uint16_t threads;    /**< Počet simulačných vlákien (0 = podľa počtu jadier) */
+
+    /** Jemné pravdepodobnosti smerov v jednotkách 1/PROB_ONE (UP, DOWN, LEFT, RIGHT).
+     *  Ak sú všetky 0, server ich odvodí z percent p_up..p_right. */
+    uint32_t prob_q[4];
+
+    uint8_t  stream;     /**< Čo posielať počas behu (stream_mode_t) */
+    uint8_t  boundary;   /**< Správanie na okraji sveta (boundary_mode_t) */
+    uint8_t  method;     /**< Spôsob výpočtu (method_t); pri METHOD_EXACT sa reps a seed ignorujú */
+
+    uint8_t  target;     /**< Cieľ presnosti (target_metric_t); s cieľom je reps iba horná hranica */
+    double   target_hw;  /**< Požadovaná polšírka 95 % intervalu spoľahlivosti zvolenej veličiny */
+
+    uint8_t  record;     /**< 1 = server zapíše trajektórie všetkých replikácií do súboru (Monte Carlo, --data-dir) */
 } msg_start_t;
 
+/** Najväčší počet stavov v jednej správe MSG_STATE_BATCH. */
+#define STATE_BATCH_MAX 512u
+
+/** Predvolený interval odoslania neúplnej dávky stavov (ms). */
+#define STATE_FLUSH_MS_DEFAULT 50u
+
+/** Najdlhší povolený interval odoslania neúplnej dávky stavov (ms). */
+#define STATE_FLUSH_MS_MAX 1000u
+
+/** Najvyššia povolená hodnota msg_session_t.max_fps. */
+#define SESSION_FPS_MAX 1000u
+
+/** Najkratší povolený interval priebežných súhrnov (msg_session_t.snap_ms). */
+#define SESSION_SNAP_MS_MIN 10u
+
+/**
+ * @brief Nastavenia spojenia (MSG_SESSION, MSG_SESSION_ACK).
+ *
+ * Klient pošle požadované hodnoty, server ich obmedzí na povolený rozsah
+ * a vráti tie, ktoré bude naozaj používať. max_fps a decimate sa týkajú
+ * iba stavov (STREAM_STATES); simulácia aj tak prebehne po každom kroku. Bez MSG_SESSION platí
+ * batch_max = 1 (každý stav ako samostatná MSG_STATE) a NET_POLICY_LATENCY.
+ * snap_reps a snap_ms zapnú priebežné súhrny behu (MSG_RESULT_PARTIAL) - súhrn
+ * príde, keď nastane ktorákoľvek z podmienok; 0 a 0 = žiadne súhrny.
+ */
+typedef struct __attribute__((packed)) {
+    uint16_t batch_max;  /**< Najviac stavov v jednej MSG_STATE_BATCH (1 = posielať MSG_STATE) */
+    uint16_t flush_ms;   /**< Najdlhšie zdržanie neúplnej dávky v ms (0 = predvolené) */
+    uint8_t net_policy;  /**< Politika odosielania server -> klient (net_policy_t) */
+    uint16_t max_fps;    /**< Najviac stavov za sekundu (0 = bez obmedzenia); konce replikácií idú vždy */
+    uint16_t decimate;   /**< Posielať iba každý decimate-ty krok (0 a 1 = každý); konce replikácií idú vždy */
+    uint8_t ring_policy; /**< Čo robiť pri plnom fronte odosielania (ring_policy_t) */
+    uint32_t snap_reps;  /**< Priebežný súhrn po každých snap_reps replikáciách (0 = nie) */
+    uint32_t snap_ms;    /**< Priebežný súhrn najneskôr po snap_ms ms (0 = nie, inak aspoň SESSION_SNAP_MS_MIN) */
+} msg_session_t;
+
+/**
+ * @brief Žiadosť o sledovanie relácie (MSG_SUBSCRIBE, MSG_SUBSCRIBE_ACK).
+ *
+ * Pozorovateľ dostáva priebeh (stavy, trajektórie, výsledky presného výpočtu)
+ * a MSG_DONE všetkých behov sledovanej relácie v tvare, aký vyjednal jej
+ * vlastník (MSG_SESSION). Sám už START ani MSG_SESSION posielať nemôže.
+ * Ak nestíha čítať, server mu zahodí najstaršie dáta priebehu.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t session;    /**< Číslo relácie (0 = najnovšia s bežiacim behom); v ACK sledovaná, 0 = odmietnuté */
+} msg_subscribe_t;
+
+/**
+ * @brief Správanie simulácie pri plnom fronte odosielania (msg_session_t.ring_policy).
+ *
+ * Každé simulačné vlákno vkladá správy do vlastného frontu, ktorý vyprázdňuje
+ * samostatné odosielacie vlákno. Ak klient nestíha čítať, front sa zaplní.
+ */
+typedef enum {
+    RING_BLOCK       = 0, /**< Simulácia počká na miesto (bezstratové, pomalý klient ju brzdí) */
+    RING_DROP_OLDEST = 1, /**< Najstaršia neodoslaná správa sa prepíše novou */
+    RING_COALESCE    = 2  /**< Kým je front plný, novšia správa nahradí jednu čakajúcu (platí najnovšia) */
+} ring_policy_t;
+
+/**
+ * @brief Obsadenosť frontov odosielania (MSG_RING_STATUS).
+ *
+ * Počítadlá sú súčty cez všetky fronty behu od jeho začiatku.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t rings;      /**< Počet frontov (= simulačných vlákien) */
+    uint32_t slots;      /**< Kapacita jedného frontu v správach */
+    uint32_t used;       /**< Aktuálny počet správ vo všetkých frontoch */
+    uint32_t peak;       /**< Najväčšia obsadenosť jedného frontu */
+    uint64_t dropped;    /**< Prepísané správy (RING_DROP_OLDEST) */
+    uint64_t coalesced;  /**< Nahradené správy (RING_COALESCE) */
+    uint64_t waits;      /**< Koľkokrát simulácia čakala na miesto (RING_BLOCK) */
+} msg_ring_status_t;
+
+/**
+ * @brief Dávka po sebe idúcich stavov jedného vlákna (MSG_STATE_BATCH).
+ *
+ * Posiela sa iba count a count stavov (dĺžka payloadu je 4 + 20 * count
+ * bajtov). Stavy v jednej dávke sú v poradí krokov; dávky z rôznych
+ * simulačných vlákien sa môžu prekladať.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t count;      /**< Počet stavov v správe (1..STATE_BATCH_MAX) */
+    msg_state_t st[STATE_BATCH_MAX]; /**< Stavy v poradí krokov */
+} msg_state_batch_t;
+
+/** Najväčší počet hodnôt P(zásah v kroku t) v jednej správe MSG_EXACT_PMF. */
+#define EXACT_PMF_CHUNK 1024u
+
+/**
+ * @brief Úsek presného rozdelenia času zásahu (MSG_EXACT_PMF).
+ *
+ * Posiela sa iba hlavička a count hodnôt (dĺžka payloadu je
+ * 8 + 8 * count bajtov). Hodnoty sú double v poradí bajtov servera.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t t_first;    /**< Krok prvej hodnoty (1-based) */
+    uint32_t count;      /**< Počet hodnôt v správe (<= EXACT_PMF_CHUNK) */
+    double p[EXACT_PMF_CHUNK]; /**< p[i] = P(prvý zásah (0,0) presne v kroku t_first + i) */
+} msg_exact_pmf_t;
+
+/**
+ * @brief Súhrn presného výpočtu (MSG_EXACT_SUMMARY).
+ *
+ * Obsahuje tie isté veličiny, ktoré results_t odhaduje z replikácií,
+ * ale ako presné pravdepodobnosti.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t k_max;      /**< Maximálny počet krokov */
+    uint32_t steps_done; /**< Počet spočítaných krokov (< k_max ak bol výpočet prerušený) */
+    double p_success;    /**< P(zásah (0,0) do k_max krokov) */
+    double mean_steps;   /**< Stredný počet krokov podmienene úspechom */
+    double bins[4];      /**< P(zásah v 0-20, 21-50, 51-100, 101+ krokoch) */
+} msg_exact_summary_t;
+
+/** Najväčší počet buniek v jednej správe MSG_GRID_CELLS. */
+#define GRID_CHUNK 4096u
+
+/**
+ * @brief Rozmery mriežky výsledkov pre všetky štarty (MSG_GRID_INFO).
+ *
+ * Posiela sa pred prvou správou MSG_GRID_CELLS.
+ */
+typedef struct __attribute__((packed)) {
+    int32_t width;       /**< Šírka sveta */
+    int32_t height;      /**< Výška sveta */
+    uint32_t k_max;      /**< Maximálny počet krokov */
+    uint32_t steps_done; /**< Počet spočítaných krokov (< k_max ak bol výpočet prerušený) */
+} msg_grid_info_t;
+
+/**
+ * @brief Úsek mriežky výsledkov pre všetky štarty (MSG_GRID_CELLS).
+ *
+ * Bunky sú v poradí riadkov (index y * width + x). Kvôli veľkosti sa
+ * posielajú ako float: najprv count hodnôt P(zásah do k_max krokov),
+ * hneď za nimi count stredných počtov krokov (podmienene úspechom).
+ * Dĺžka payloadu je 8 + 8 * count bajtov.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t first;      /**< Index prvej bunky */
+    uint32_t count;      /**< Počet buniek (<= GRID_CHUNK) */
+    float v[2 * GRID_CHUNK]; /**< v[0..count) = P, v[count..2*count) = stredný počet krokov */
+} msg_grid_cells_t;
+
+/** Najviac krokov v jednom úseku trajektórie (úsek začína absolútnou pozíciou). */
+#define TRAJ_SEG_STEPS 4096u
+
+/** Najviac bajtov zakódovaných smerov v jednom úseku (2 bity na krok). */
+#define TRAJ_SEG_BYTES_MAX (TRAJ_SEG_STEPS / 4u)
+
+/** Najväčšia dĺžka payloadu MSG_TRAJ v bajtoch. */
+#define TRAJ_FRAME_MAX 16384u
+
+/**
+ * @brief Kódovanie smerov v úseku trajektórie (msg_traj_seg_t.codec).
+ */
+typedef enum {
+    TRAJ_CODEC_RAW  = 0, /**< 2 bity na krok, 4 kroky v bajte od najnižších bitov */
+    TRAJ_CODEC_RANS = 1  /**< rANS s pravdepodobnosťami smerov z MSG_TRAJ_INFO */
+} traj_codec_t;
+
+/** Príznak úseku: replikácia týmto úsekom skončila. */
+#define TRAJ_SEG_LAST 1u
+
+/**
+ * @brief Parametre potrebné na rekonštrukciu trajektórií (MSG_TRAJ_INFO).
+ *
+ * Server ho pošle na začiatku behu so stream = STREAM_TRAJ.
+ */
+typedef struct __attribute__((packed)) {
+    int32_t width;       /**< Šírka sveta */
+    int32_t height;      /**< Výška sveta */
+    uint32_t reps;       /**< Celkový počet replikácií */
+    uint32_t prob_q[4];  /**< Pravdepodobnosti smerov v 1/PROB_ONE (model pre TRAJ_CODEC_RANS) */
+    uint8_t boundary;    /**< Režim okraja (boundary_mode_t) */
+} msg_traj_info_t;
+
+/**
+ * @brief Hlavička jedného úseku trajektórie v MSG_TRAJ.
+ *
+ * Payload MSG_TRAJ je postupnosť úsekov, každý je hlavička a hneď za ňou
+ * nbytes bajtov zakódovaných smerov. Úsek nesie absolútnu pozíciu pred
+ * svojím prvým krokom, takže slúži zároveň ako kľúčový snímok - klient
+ * nepotrebuje nič z predchádzajúcich úsekov. Úseky jednej replikácie idú
+ * v poradí krokov; úseky rôznych replikácií sa môžu prekladať.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t rep;        /**< Číslo replikácie (1..reps) */
+    uint32_t step_first; /**< Číslo prvého kroku úseku (1-based) */
+    int32_t x, y;        /**< Pozícia pred krokom step_first */
+    uint16_t count;      /**< Počet krokov v úseku (1..TRAJ_SEG_STEPS) */
+    uint8_t codec;       /**< Kódovanie smerov (traj_codec_t) */
+    uint8_t flags;       /**< TRAJ_SEG_LAST ak replikácia úsekom skončila */
+    uint16_t nbytes;     /**< Počet bajtov zakódovaných smerov za hlavičkou */
+} msg_traj_seg_t;
+
+/** Najdlhšia cesta k súboru v msg_traj_file_t (vrátane nuly). */
+#define TRAJ_FILE_PATH_MAX 256u
+
+/**
+ * @brief Súbor so zaznamenanými trajektóriami behu (MSG_TRAJ_FILE).
+ *
+ * Cesta je na stroji servera; súbor sa dá prehrať bez servera
+ * (client --replay).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t reps;       /**< Počet zapísaných replikácií */
+    uint64_t bytes;      /**< Veľkosť súboru */
+    char path[TRAJ_FILE_PATH_MAX]; /**< Cesta k súboru (ukončená nulou) */
+} msg_traj_file_t;
+
+/** Bity presnosti histogramu krokov: 2^bits košov na každú mocninu dvoch (chyba <= 1/128). */
+#define STEP_HIST_SUB_BITS 7u
+
+/** Počet košov na každú mocninu dvoch. */
+#define STEP_HIST_SUB (1u << STEP_HIST_SUB_BITS)
+
+/** Počet košov histogramu krokov pre celý rozsah uint32_t (rozloženie v hist.h). */
+#define STEP_HIST_BUCKETS ((32u - STEP_HIST_SUB_BITS + 1u) * STEP_HIST_SUB)
+
+/**
+ * @brief Histogram krokov úspešných replikácií (MSG_STEP_HIST).
+ *
+ * Posiela sa iba hlavička a count košov od indexu 0 (za posledným neprázdnym
+ * sú samé nuly); dĺžka payloadu je 8 + 4 * count bajtov. Klient z neho
+ * spočíta ľubovoľný kvantil cez hist_quantile().
+ */
+typedef struct __attribute__((packed)) {
+    uint8_t sub_bits;    /**< STEP_HIST_SUB_BITS servera (klient s inou hodnotou histogram ignoruje) */
+    uint8_t reserved[3]; /**< Nuly */
+    uint32_t count;      /**< Počet košov v správe (<= STEP_HIST_BUCKETS) */
+    uint32_t c[STEP_HIST_BUCKETS]; /**< Počty replikácií v košoch */
+} msg_step_hist_t;
+
+/**
+ * @brief Centrálne momenty jednej veličiny v MSG_RESULT.
+ *
+ * Sú to priamo súčty mocnín odchýlok (nie rozptyl ani šikmosť), aby sa dali
+ * výsledky viacerých behov zlúčiť párovými vzorcami bez straty presnosti.
+ * Rozptyl = m2 / (n - 1), šikmosť = sqrt(n) * m3 / m2^1.5,
+ * nadbytočná špicatosť = n * m4 / m2^2 - 3.
+ */
+typedef struct __attribute__((packed)) {
+    uint64_t n;          /**< Počet hodnôt */
+    double mean;         /**< Priemer */
+    double m2;           /**< Súčet (x - mean)^2 */
+    double m3;           /**< Súčet (x - mean)^3 */
+    double m4;           /**< Súčet (x - mean)^4 */
+} msg_moments_t;
+
+/**
+ * @brief Súhrn behu Monte Carlo (MSG_RESULT, MSG_RESULT_PARTIAL).
+ *
+ * V priebežnom súhrne je reps_total plánovaný počet replikácií a
+ * success_count + fail_count počet doteraz dokončených.
+ */
 typedef struct __attribute__((packed)) {
     uint32_t reps_total;
 
@@ -75,6 +434,13 @@ typedef struct __attribute__((packed)) {
     // 0: 0-20, 1: 21-50, 2: 51-100, 3: 101+
     uint32_t bins[4];
 
+    // kvantily krokov úspešných replikácií z histogramu (relatívna chyba <= 1/STEP_HIST_SUB)
+    uint32_t p50, p90, p99, p999;
+
+    // momenty krokov úspešných replikácií a indikátora úspechu (všetky replikácie)
+    msg_moments_t steps;
+    msg_moments_t success;
+
     // voliteľné – echo vstupných parametrov (na obhajobu super)
     int32_t  width;
     int32_t  height;
@@ -82,11 +448,153 @@ typedef struct __attribute__((packed)) {
     uint8_t  p_up, p_down, p_left, p_right;
 } msg_result_t;
 
+/** Najviac hodnôt v zozname jednej osi MSG_SWEEP. */
+#define SWEEP_LIST_MAX 16u
+
+/** Najviac hodnôt jednej osi MSG_SWEEP (rozsah aj zoznam). */
+#define SWEEP_AXIS_MAX 1024u
+
+/** Najviac bodov jedného MSG_SWEEP (po vynechaní neplatných percent). */
+#define SWEEP_POINTS_MAX 65536u
+
+/**
+ * @brief Osi mriežky MSG_SWEEP (index do msg_sweep_t.axis).
+ *
+ * Percento RIGHT sa neprechádza, dopočíta sa do 100 - bod, v ktorom
+ * UP + DOWN + LEFT presiahne 100, sa vynechá.
+ */
+typedef enum {
+    SWEEP_WIDTH = 0,     /**< Šírka sveta */
+    SWEEP_HEIGHT = 1,    /**< Výška sveta */
+    SWEEP_K_MAX = 2,     /**< Maximálny počet krokov */
+    SWEEP_P_UP = 3,      /**< Percento hore */
+    SWEEP_P_DOWN = 4,    /**< Percento dole */
+    SWEEP_P_LEFT = 5,    /**< Percento vľavo */
+    SWEEP_AXES = 6       /**< Počet osí */
+} sweep_axis_t;
+
+/**
+ * @brief Hodnoty jednej osi MSG_SWEEP: zoznam, alebo rozsah first..last po step.
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t first;      /**< Prvá hodnota rozsahu */
+    uint32_t last;       /**< Posledná hodnota rozsahu (vrátane, ak na ňu step trafí) */
+    uint32_t step;       /**< Krok rozsahu (0 = iba first) */
+    uint8_t count;       /**< > 0: použiť list[0..count) namiesto rozsahu */
+    uint32_t list[SWEEP_LIST_MAX]; /**< Zoznam hodnôt */
+} msg_sweep_axis_t;
+
+/**
+ * @brief Prechod mriežkou parametrov (MSG_SWEEP).
+ *
+ * Server zostaví všetky kombinácie hodnôt osí (posledná os sa mení
+ * najrýchlejšie), každý bod spočíta ako beh Monte Carlo s reps replikáciami
+ * bez živého výstupu a pošle MSG_SWEEP_POINT, hneď ako bod dobehne; po
+ * poslednom bode MSG_DONE. Body bežia súbežne na všetkých vláknach servera.
+ *
+ * Pri crn = 1 (common random numbers) dostane replikácia r v každom bode
+ * rovnaký náhodný prúd, takže rozdiel dvoch bodov má oveľa menší rozptyl
+ * než pri nezávislých prúdoch (crn = 0, každý bod má vlastný seed).
+ */
+typedef struct __attribute__((packed)) {
+    msg_sweep_axis_t axis[SWEEP_AXES]; /**< Osi (sweep_axis_t) */
+    uint32_t reps;       /**< Počet replikácií v každom bode */
+    uint32_t seed;       /**< Seed (0 = použiť čas, spoločný pre celý prechod) */
+    uint8_t boundary;    /**< Správanie na okraji sveta (boundary_mode_t) */
+    uint8_t crn;         /**< 1 = spoločné náhodné prúdy pre všetky body */
+} msg_sweep_t;
+
+/**
+ * @brief Výsledok jedného bodu prechodu (MSG_SWEEP_POINT).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t index;      /**< Poradie bodu v mriežke (0-based) */
+    uint32_t total;      /**< Počet bodov prechodu */
+    int32_t width;       /**< Šírka sveta */
+    int32_t height;      /**< Výška sveta */
+    uint32_t k_max;      /**< Maximálny počet krokov */
+    uint8_t p_up, p_down, p_left, p_right; /**< Percentá smerov */
+    uint32_t seed;       /**< Seed bodu (pri crn rovnaký pre všetky body) */
+    uint8_t cached;      /**< 1 ak výsledok prišiel z cache */
+    msg_result_t result; /**< Súhrn bodu */
+} msg_sweep_point_t;
+
+/** Kapacita bufferu inkrementálneho parsera (hlavička + najväčší prijímaný payload). */
+#define PROTO_PARSER_BYTES 1024u
+
+/**
+ * @brief Inkrementálny parser správ pre neblokujúce čítanie.
+ *
+ * Bajty sa do neho dopĺňajú po kúskoch, ako prídu (proto_parser_space /
+ * proto_parser_commit), a proto_parser_next() z nich vyberá celé správy.
+ * Neúplná správa čaká v bufferi na ďalšie bajty, takže pomalý klient
+ * nikoho neblokuje.
+ */
+typedef struct {
+    unsigned char buf[PROTO_PARSER_BYTES]; /**< Prijaté, zatiaľ nespracované bajty */
+    uint32_t have;           /**< Počet platných bajtov v buf */
+    uint32_t off;            /**< Začiatok prvej nespracovanej správy v buf */
+} proto_parser_t;
+
+/**
+ * @brief Inicializuje prázdny parser.
+ *
+ * @param p Parser.
+ */
+void proto_parser_init(proto_parser_t* p);
+
+/**
+ * @brief Vráti miesto, kam sa majú zapísať ďalšie prijaté bajty.
+ *
+ * Spracované správy zo začiatku bufferu sa pritom odsunú.
+ *
+ * @param p Parser.
+ * @param room Výstup: počet voľných bajtov (0 ak je buffer plný).
+ * @return Ukazovateľ na voľné miesto v bufferi.
+ */
+void* proto_parser_space(proto_parser_t* p, uint32_t* room);
+
+/**
+ * @brief Potvrdí n bajtov zapísaných na miesto z proto_parser_space().
+ *
+ * @param p Parser.
+ * @param n Počet zapísaných bajtov.
+ */
+void proto_parser_commit(proto_parser_t* p, uint32_t n);
+
+/**
+ * @brief Vyberie ďalšiu celú správu z parsera.
+ *
+ * Payload ostáva v bufferi parsera a je platný do ďalšieho volania
+ * proto_parser_space(); môže byť nezarovnaný, preto ho treba kopírovať
+ * do štruktúry cez memcpy().
+ *
+ * @param p Parser.
+ * @param out_type Výstup: typ správy.
+ * @param out_payload Výstup: ukazovateľ na payload.
+ * @param out_len Výstup: dĺžka payloadu.
+ * @return 1 ak je k dispozícii správa, 0 ak treba ďalšie bajty,
+ *         -1 ak správa presahuje PROTO_PARSER_BYTES (chyba protokolu).
+ */
+int proto_parser_next(proto_parser_t* p, msg_type_t* out_type, const void** out_payload, uint32_t* out_len);
+
+/**
+ * @brief Prevedie percentá smerov na pevnú rádovú čiarku (1/PROB_ONE).
+ *
+ * Používa metódu najväčších zvyškov, takže súčet výsledku je presne PROB_ONE
+ * a smer s 0 % dostane vždy 0.
+ *
+ * @param pct Percentá pre UP, DOWN, LEFT, RIGHT (môžu byť desatinné).
+ * @param q Výstupné pravdepodobnosti v jednotkách 1/PROB_ONE.
+ * @return 0 pri úspechu, -1 ak je niektoré percento záporné alebo súčet nie je 100.
+ */
+int proto_probs_from_percents(const double pct[4], uint32_t q[4]);
+
 /**
  * @brief Odošle správu cez socket.
  *
  * Funkcia vytvorí hlavičku správy, prevedie hodnoty do network byte order
- * a odošle hlavičku aj payload.
+ * a odošle hlavičku aj payload jedným systémovým volaním.
  *
  * @param fd File descriptor socketu.
  * @param type Typ správy.
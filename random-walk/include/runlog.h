@@ -0,0 +1,215 @@
+/**
+ * @file runlog.h
+ * @brief Denník dokončených behov: binárny súbor záznamov pevnej veľkosti a index.
+ *
+ * Server každý dokončený beh Monte Carlo pripíše na koniec súboru runs.log
+ * (záznam runlog_record_t: parametre, výsledky, hrubý histogram, časy) a do
+ * runs.idx pridá malý indexový záznam (haš konfigurácie, čas, číslo záznamu).
+ * Oba súbory majú hlavičku s počtom platných záznamov, ktorý sa zvýši až po
+ * zápise záznamu, takže čitateľ nikdy nevidí rozpísaný záznam. Čitateľ
+ * (bin/rwquery) súbory iba namapuje a číta záznamy priamo z mapy - nič sa
+ * nekopíruje ani neparsuje. Index je zoradený podľa času (záznamy pribúdajú
+ * v poradí dokončenia), takže časový rozsah sa nájde binárnym vyhľadaním
+ * a dotaz na jednu konfiguráciu prejde iba 24-bajtové položky indexu.
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Meno súboru záznamov v dátovom priečinku servera. */
+#define RUNLOG_FILE "runs.log"
+
+/** Meno súboru indexu v dátovom priečinku servera. */
+#define RUNLOG_INDEX_FILE "runs.idx"
+
+/** Verzia formátu; súbor s inou verziou sa nepoužije (história sa nemaže). */
+#define RUNLOG_FORMAT 1u
+
+/** Veľkosť hlavičky súborov (záznamy začínajú za ňou). */
+#define RUNLOG_HEADER_BYTES 64u
+
+/** O koľko záznamov sa súbor zväčší, keď sa zaplní. */
+#define RUNLOG_GROW 1024u
+
+/** Bity presnosti histogramu v zázname (relatívna chyba <= 1/16). */
+#define RUNLOG_HIST_SUB_BITS 4u
+
+/** Počet košov histogramu v zázname. */
+#define RUNLOG_HIST_BUCKETS ((32u - RUNLOG_HIST_SUB_BITS + 1u) << RUNLOG_HIST_SUB_BITS)
+
+/** Príznak záznamu: výsledok prišiel z cache (nepočítal sa). */
+#define RUNLOG_CACHED 1u
+
+/**
+ * @brief Hlavička runs.log aj runs.idx.
+ */
+typedef struct __attribute__((packed)) {
+    char magic[8];           /**< "RWRUNLOG" alebo "RWRUNIDX" */
+    uint32_t format;         /**< RUNLOG_FORMAT */
+    uint32_t entry_bytes;    /**< Veľkosť jedného záznamu */
+    uint64_t count;          /**< Počet platných záznamov */
+    uint8_t reserved[RUNLOG_HEADER_BYTES - 24]; /**< Nuly */
+} runlog_header_t;
+
+/**
+ * @brief Konfigurácia sveta - časť parametrov, podľa ktorej sa indexuje.
+ *
+ * Bez seedu a počtu replikácií, aby sa dali nájsť všetky behy "toho istého
+ * pokusu". Pravdepodobnosti sú v 1/PROB_ONE ako v sim_job_t.
+ */
+typedef struct __attribute__((packed)) {
+    int32_t width;           /**< Šírka sveta */
+    int32_t height;          /**< Výška sveta */
+    uint32_t k_max;          /**< Maximálny počet krokov */
+    uint32_t prob_q[4];      /**< Pravdepodobnosti UP, DOWN, LEFT, RIGHT */
+    uint8_t boundary;        /**< Režim okraja (boundary_mode_t) */
+    uint8_t reserved[3];     /**< Nuly */
+} runlog_config_t;
+
+/**
+ * @brief Jeden dokončený beh (pevná veľkosť RUNLOG_RECORD_BYTES).
+ */
+typedef struct __attribute__((packed)) {
+    runlog_config_t cfg;     /**< Konfigurácia (kľúč indexu) */
+    uint32_t reps;           /**< Požadovaný počet replikácií */
+    uint32_t seed;           /**< Použitý seed */
+    uint8_t target;          /**< Cieľ presnosti (target_metric_t) */
+    uint8_t stream;          /**< Režim výstupu (stream_mode_t) */
+    uint8_t flags;           /**< RUNLOG_CACHED */
+    uint8_t reserved0;       /**< Nula */
+    uint32_t threads;        /**< Počet shardov */
+    double target_hw;        /**< Požadovaná polšírka (pri cieli) */
+
+    int64_t t_start_ns;      /**< Začiatok behu (CLOCK_REALTIME, ns od epochy) */
+    int64_t t_end_ns;        /**< Koniec behu (CLOCK_REALTIME, ns od epochy); kľúč časového indexu */
+    int64_t duration_ns;     /**< Trvanie behu (CLOCK_MONOTONIC) */
+    uint32_t session;        /**< Číslo relácie na serveri */
+
+    uint32_t reps_done;      /**< Dokončené replikácie */
+    uint32_t success_count;  /**< Úspešné replikácie */
+    uint32_t fail_count;     /**< Neúspešné replikácie */
+    uint32_t min_steps;      /**< Min krokov úspešných (0 bez úspechu) */
+    uint32_t max_steps;      /**< Max krokov úspešných */
+    uint64_t sum_steps_success; /**< Súčet krokov úspešných */
+    msg_moments_t steps;     /**< Momenty krokov úspešných */
+    msg_moments_t success;   /**< Momenty indikátora úspechu */
+    uint32_t p50, p90, p99, p999; /**< Kvantily krokov z jemného histogramu */
+
+    uint32_t hist[RUNLOG_HIST_BUCKETS]; /**< Hrubý histogram krokov (hist_index_bits s RUNLOG_HIST_SUB_BITS) */
+    uint8_t reserved[48];    /**< Nuly (rezerva, zarovnanie na 64 B) */
+} runlog_record_t;
+
+/** Veľkosť záznamu v bajtoch. */
+#define RUNLOG_RECORD_BYTES 2112u
+
+_Static_assert(sizeof(runlog_record_t) == RUNLOG_RECORD_BYTES, "runlog_record_t layout changed");
+
+/**
+ * @brief Položka indexu (runs.idx).
+ */
+typedef struct __attribute__((packed)) {
+    uint64_t cfg_hash;       /**< runlog_config_hash(záznam.cfg) */
+    int64_t t_end_ns;        /**< Čas konca behu (ako v zázname) */
+    uint64_t record;         /**< Index záznamu v runs.log */
+} runlog_index_t;
+
+/**
+ * @brief Namapované súbory na čítanie.
+ */
+typedef struct {
+    const unsigned char* log_map;  /**< Namapovaný runs.log */
+    size_t log_size;               /**< Veľkosť mapy runs.log */
+    const unsigned char* idx_map;  /**< Namapovaný runs.idx */
+    size_t idx_size;               /**< Veľkosť mapy runs.idx */
+    uint64_t count;                /**< Počet záznamov, ktoré sú v oboch súboroch platné */
+} runlog_view_t;
+
+typedef struct runlog runlog_t;
+
+/**
+ * @brief Haš konfigurácie (FNV-1a cez bajty runlog_config_t).
+ *
+ * @param cfg Konfigurácia (reserved musia byť nuly).
+ * @return Haš.
+ */
+uint64_t runlog_config_hash(const runlog_config_t* cfg);
+
+/**
+ * @brief Otvorí denník na zápis (založí súbory, ak neexistujú).
+ *
+ * Súbory sa zamknú (flock), aby do nich nepísali dva servery. Ak index
+ * po páde zaostáva za záznamami, dopočíta sa zo záznamov.
+ *
+ * @param dir Dátový priečinok.
+ * @return Denník, alebo NULL pri chybe (server potom beží bez denníka).
+ */
+runlog_t* runlog_open(const char* dir);
+
+/**
+ * @brief Pripíše záznam a jeho položku indexu.
+ *
+ * Volajúci vyplní záznam okrem t_end_ns, ten sa nastaví tu (pod zámkom),
+ * aby index ostal zoradený podľa času.
+ *
+ * @param l Denník.
+ * @param rec Záznam.
+ * @return 0 pri úspechu, -1 pri chybe zápisu.
+ */
+int runlog_append(runlog_t* l, runlog_record_t* rec);
+
+/**
+ * @brief Zapíše zmeny na disk a zatvorí denník.
+ *
+ * @param l Denník (môže byť NULL).
+ */
+void runlog_close(runlog_t* l);
+
+/**
+ * @brief Namapuje denník na čítanie (len na čítanie, bez zámku).
+ *
+ * @param dir Dátový priečinok.
+ * @param v Výstup.
+ * @return 0 pri úspechu, -1 ak súbory chýbajú alebo majú iný formát.
+ */
+int runlog_map(const char* dir, runlog_view_t* v);
+
+/**
+ * @brief Zruší mapovanie z runlog_map().
+ *
+ * @param v Namapovaný denník.
+ */
+void runlog_unmap(runlog_view_t* v);
+
+/**
+ * @brief Záznam číslo i (bez kopírovania, priamo z mapy).
+ *
+ * @param v Namapovaný denník.
+ * @param i Index záznamu (< v->count).
+ * @return Ukazovateľ do mapy.
+ */
+static inline const runlog_record_t* runlog_record(const runlog_view_t* v, uint64_t i) {
+    return (const runlog_record_t*)(v->log_map + RUNLOG_HEADER_BYTES + i * RUNLOG_RECORD_BYTES);
+}
+
+/**
+ * @brief Položka indexu číslo i (bez kopírovania, priamo z mapy).
+ *
+ * @param v Namapovaný denník.
+ * @param i Index položky (< v->count).
+ * @return Ukazovateľ do mapy.
+ */
+static inline const runlog_index_t* runlog_index(const runlog_view_t* v, uint64_t i) {
+    return (const runlog_index_t*)(v->idx_map + RUNLOG_HEADER_BYTES + i * sizeof(runlog_index_t));
+}
+
+/**
+ * @brief Prvá položka indexu s časom >= t (binárne vyhľadanie).
+ *
+ * @param v Namapovaný denník.
+ * @param t Čas v ns od epochy.
+ * @return Index položky (v->count ak taká nie je).
+ */
+uint64_t runlog_find_time(const runlog_view_t* v, int64_t t);
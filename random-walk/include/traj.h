@@ -0,0 +1,44 @@
+/**
+ * @file traj.h
+ * @brief Kódovanie smerov krokov v trajektórii (MSG_TRAJ).
+ *
+ * Krok nesie iba jeden zo štyroch smerov, takže na neho stačia 2 bity
+ * namiesto 20-bajtového msg_state_t. Pri nerovnomerných pravdepodobnostiach
+ * smerov vie rANS s presne známym modelom (prob_q zo START) ísť pod 2 bity
+ * na krok; úsek sa zakóduje tak, čo vyjde kratšie.
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Zakóduje smery jedného úseku trajektórie.
+ *
+ * Skúsi rANS s modelom q a ak nie je kratší než 2 bity na krok (napr. pri
+ * rovnomerných pravdepodobnostiach), použije TRAJ_CODEC_RAW.
+ *
+ * @param dirs Smery krokov (0=UP, 1=DOWN, 2=LEFT, 3=RIGHT).
+ * @param count Počet krokov (1..TRAJ_SEG_STEPS).
+ * @param q Pravdepodobnosti smerov v 1/PROB_ONE (súčet PROB_ONE).
+ * @param out Výstupný buffer s kapacitou aspoň TRAJ_SEG_BYTES_MAX bajtov.
+ * @param codec Výstup: použité kódovanie (traj_codec_t).
+ * @return Počet zapísaných bajtov.
+ */
+uint32_t traj_encode(const uint8_t* dirs, uint32_t count, const uint32_t q[4],
+                     uint8_t* out, uint8_t* codec);
+
+/**
+ * @brief Dekóduje smery jedného úseku trajektórie.
+ *
+ * @param data Zakódované smery.
+ * @param nbytes Počet bajtov v data.
+ * @param codec Kódovanie (traj_codec_t).
+ * @param count Počet krokov (1..TRAJ_SEG_STEPS).
+ * @param q Pravdepodobnosti smerov v 1/PROB_ONE (rovnaké ako pri kódovaní).
+ * @param dirs Výstup: count smerov.
+ * @return 0 pri úspechu, -1 pri poškodených alebo nekonzistentných dátach.
+ */
+int traj_decode(const uint8_t* data, uint32_t nbytes, uint8_t codec, uint32_t count,
+                const uint32_t q[4], uint8_t* dirs);
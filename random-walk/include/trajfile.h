@@ -0,0 +1,143 @@
+/**
+ * @file trajfile.h
+ * @brief Súbor so zaznamenanými trajektóriami behu (zapisuje server, prehráva klient).
+ *
+ * Súbor má hlavičku s parametrami rekonštrukcie (msg_traj_info_t, k_max,
+ * seed), za ňou záznamy replikácií v poradí dokončenia a na konci index.
+ * Záznam replikácie je hlavička trajfile_rep_t a za ňou úseky trajektórie
+ * v tom istom tvare ako payload MSG_TRAJ (msg_traj_seg_t + zakódované smery),
+ * takže klient ich prehrá tým istým kódom ako živý prenos. Index je pole
+ * reps posunov (uint64_t) podľa čísla replikácie - replikácia sa nájde bez
+ * prechádzania súboru. Ak server skončil skôr, než index zapísal, čitateľ
+ * si ho zostaví prechodom cez záznamy.
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Podpriečinok dátového priečinka servera so súbormi trajektórií. */
+#define TRAJFILE_DIR "traj"
+
+/** Prípona súborov trajektórií. */
+#define TRAJFILE_EXT ".rwt"
+
+/** Verzia formátu. */
+#define TRAJFILE_FORMAT 1u
+
+/** Veľkosť hlavičky (prvý záznam začína za ňou). */
+#define TRAJFILE_HEADER_BYTES 128u
+
+/**
+ * @brief Ako replikácia skončila (trajfile_rep_t.outcome).
+ */
+typedef enum {
+    TRAJFILE_TIMEOUT  = 0,   /**< Vyčerpala k_max krokov */
+    TRAJFILE_HIT      = 1,   /**< Dosiahla (0,0) */
+    TRAJFILE_ABSORBED = 2    /**< Opustila svet (BOUND_ABSORB) */
+} trajfile_outcome_t;
+
+/**
+ * @brief Hlavička súboru.
+ */
+typedef struct __attribute__((packed)) {
+    char magic[8];           /**< "RWTRAJF\0" */
+    uint32_t format;         /**< TRAJFILE_FORMAT */
+    uint32_t header_bytes;   /**< TRAJFILE_HEADER_BYTES */
+    msg_traj_info_t info;    /**< Parametre rekonštrukcie (ako MSG_TRAJ_INFO) */
+    uint32_t k_max;          /**< Maximálny počet krokov */
+    uint32_t seed;           /**< Seed behu */
+    uint32_t reps_written;   /**< Počet zapísaných replikácií (platí s indexom) */
+    uint64_t index_offset;   /**< Posun indexu (0 = súbor nebol uzavretý) */
+    uint8_t reserved[TRAJFILE_HEADER_BYTES - 65]; /**< Nuly */
+} trajfile_header_t;
+
+_Static_assert(sizeof(trajfile_header_t) == TRAJFILE_HEADER_BYTES, "trajfile_header_t layout changed");
+
+/**
+ * @brief Hlavička záznamu jednej replikácie (za ňou bytes bajtov úsekov).
+ */
+typedef struct __attribute__((packed)) {
+    uint32_t rep;            /**< Číslo replikácie (1..reps) */
+    uint32_t steps;          /**< Počet krokov replikácie */
+    int32_t x0, y0;          /**< Štartová pozícia */
+    uint8_t outcome;         /**< trajfile_outcome_t */
+    uint8_t reserved[3];     /**< Nuly */
+    uint32_t bytes;          /**< Dĺžka úsekov za hlavičkou */
+} trajfile_rep_t;
+
+typedef struct trajfile trajfile_t;
+
+/**
+ * @brief Súbor namapovaný na čítanie.
+ */
+typedef struct {
+    const unsigned char* map; /**< Celý súbor */
+    size_t size;             /**< Veľkosť mapy */
+    trajfile_header_t hdr;   /**< Kópia hlavičky */
+    const unsigned char* index; /**< Pole info.reps posunov (v mape alebo v owned) */
+    uint64_t* owned;         /**< Index zostavený prechodom (ak v súbore nie je) */
+} trajfile_view_t;
+
+/**
+ * @brief Založí súbor trajektórií pre jeden beh.
+ *
+ * @param path Cesta k súboru (prepíše sa).
+ * @param info Parametre rekonštrukcie.
+ * @param k_max Maximálny počet krokov.
+ * @param seed Seed behu.
+ * @return Súbor, alebo NULL pri chybe (chyba je vypísaná).
+ */
+trajfile_t* trajfile_create(const char* path, const msg_traj_info_t* info, uint32_t k_max, uint32_t seed);
+
+/**
+ * @brief Zapíše jednu dokončenú replikáciu.
+ *
+ * Bezpečné volať súbežne z viacerých shardov (každý s inými replikáciami):
+ * miesto v súbore sa rezervuje atomicky a zapíše sa jedným pwritev().
+ *
+ * @param f Súbor.
+ * @param rep Hlavička replikácie (rep.bytes = len).
+ * @param segs Úseky trajektórie.
+ * @param len Dĺžka úsekov.
+ * @return 0 pri úspechu, -1 pri chybe zápisu (súbor sa potom označí ako chybný).
+ */
+int trajfile_append(trajfile_t* f, const trajfile_rep_t* rep, const void* segs, uint32_t len);
+
+/**
+ * @brief Zapíše index a hlavičku a zatvorí súbor.
+ *
+ * @param f Súbor (môže byť NULL).
+ * @param reps Výstup: počet zapísaných replikácií (môže byť NULL).
+ * @param bytes Výstup: veľkosť súboru (môže byť NULL).
+ * @return 0 pri úspechu, -1 ak niektorý zápis zlyhal.
+ */
+int trajfile_close(trajfile_t* f, uint32_t* reps, uint64_t* bytes);
+
+/**
+ * @brief Namapuje súbor trajektórií na čítanie.
+ *
+ * @param path Cesta k súboru.
+ * @param v Výstup.
+ * @return 0 pri úspechu, -1 ak súbor chýba alebo je poškodený.
+ */
+int trajfile_map(const char* path, trajfile_view_t* v);
+
+/**
+ * @brief Zruší mapovanie z trajfile_map().
+ *
+ * @param v Namapovaný súbor.
+ */
+void trajfile_unmap(trajfile_view_t* v);
+
+/**
+ * @brief Nájde záznam replikácie cez index.
+ *
+ * @param v Namapovaný súbor.
+ * @param rep Číslo replikácie (1..info.reps).
+ * @param segs Výstup: úseky za hlavičkou (priamo v mape).
+ * @return Hlavička záznamu (priamo v mape), alebo NULL ak replikácia nie je zapísaná.
+ */
+const trajfile_rep_t* trajfile_find(const trajfile_view_t* v, uint32_t rep, const uint8_t** segs);
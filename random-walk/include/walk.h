@@ -0,0 +1,67 @@
+/**
+ * @file walk.h
+ * @brief Pravidlo pohybu chodca spoločné pre server a klienta.
+ *
+ * Server podľa neho simuluje kroky, klient ním zo smerov v trajektórii
+ * (MSG_TRAJ) rekonštruuje pozície - oba musia počítať presne rovnako.
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Ošetrí súradnicu po kroku o ±1 podľa režimu okraja.
+ *
+ * Keďže sa súradnica mení len o jedna, stačí porovnanie a výber namiesto
+ * všeobecného %. Režim je pri volaní z vygenerovaných variantov krokovej
+ * funkcie konštanta, takže kompilátor ponechá iba jednu vetvu.
+ *
+ * - BOUND_TORUS: -1 -> maxv-1, maxv -> 0
+ * - BOUND_REFLECT: -1 -> 1, maxv -> maxv-2 (zrkadlenie, maxv >= 2)
+ * - BOUND_ABSORB: pozícia ostane na okraji a vráti sa príznak pohltenia
+ *
+ * @param v Súradnica po kroku (v rozsahu [-1, maxv]).
+ * @param old Súradnica pred krokom.
+ * @param maxv Rozmer sveta v danej osi.
+ * @param mode Režim okraja (boundary_mode_t).
+ * @param absorbed Výstup: nastaví sa na 1, ak chodec opustil svet (BOUND_ABSORB).
+ * @return Súradnica v rozsahu [0, maxv).
+ */
+static inline __attribute__((always_inline))
+int32_t sim_bound_fix(int32_t v, int32_t old, int32_t maxv, int mode, int* absorbed) {
+    int lo = v < 0;
+    int hi = v == maxv;
+    if (mode == BOUND_TORUS) {
+        v = lo ? maxv - 1 : v;
+        return hi ? 0 : v;
+    }
+    if (mode == BOUND_REFLECT) {
+        v = lo ? 1 : v;
+        return hi ? maxv - 2 : v;
+    }
+    *absorbed |= lo | hi;
+    return (lo | hi) ? old : v;
+}
+
+/**
+ * @brief Posunie chodca o jeden krok v smere d a ošetrí okraje.
+ *
+ * @param x Ukazovateľ na x-ovú súradnicu.
+ * @param y Ukazovateľ na y-ovú súradnicu.
+ * @param d Smer 0=UP, 1=DOWN, 2=LEFT, 3=RIGHT.
+ * @param w Šírka sveta.
+ * @param h Výška sveta.
+ * @param mode Režim okraja (boundary_mode_t).
+ * @return 1 ak chodec opustil svet (len BOUND_ABSORB), inak 0.
+ */
+static inline __attribute__((always_inline))
+int sim_move(int32_t* x, int32_t* y, int d, int32_t w, int32_t h, int mode) {
+    int absorbed = 0;
+    int32_t nx = *x + (d == 3) - (d == 2);
+    int32_t ny = *y + (d == 1) - (d == 0);
+    *x = sim_bound_fix(nx, *x, w, mode, &absorbed);
+    *y = sim_bound_fix(ny, *y, h, mode, &absorbed);
+    return absorbed;
+}
@@ -0,0 +1,365 @@
+/**
+ * @file main.c
+ * @brief rwcheck - kontrola, že výsledok behu nezávisí od jadra ani počtu vlákien.
+ *
+ * Beh s pevným seedom musí dať rovnaký results_t pri každom dávkovom jadre
+ * (RW_KERNEL = scalar, sse41, predvolené) aj pri každom počte shardov - na tom
+ * stojí cache aj pokračovanie z checkpointu. Program spustí pevné behy pre
+ * každý režim okraja cez ten istý pool a sim_submit ako server a porovná
+ * zlúčené výsledky so skalárnym jadrom na jednom vlákne. Pri každom jadre
+ * navyše porovná celú správu MSG_RESULT (bajty z results_to_msg) behu na
+ * jednom vlákne s behmi na N vláknach - to je to, čo klient naozaj dostane.
+ * Nakoniec beh zastaví v polovici, uloží checkpoint cez ckpt_save, dopočíta
+ * ho cez sim_job_t.resume a porovná s neprerušeným behom.
+ * Spúšťa ho make check.
+ */
+
+#include "cache.h"
+#include "checkpoint.h"
+#include "kernel.h"
+#include "pool.h"
+#include "protocol.h"
+#include "results.h"
+#include "simulation.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/** Vlákna poolu (viac než shardov v najmenšom behu, aby sa shardy prekrývali). */
+#define CHECK_POOL_THREADS 4u
+
+/**
+ * @brief Parametre jedného kontrolného behu (bez jadra, okraja a vlákien).
+ */
+typedef struct {
+    int32_t width, height;   /**< Rozmery sveta */
+    uint32_t k_max;          /**< Maximálny počet krokov */
+    uint32_t reps;           /**< Počet replikácií */
+    uint32_t seed;           /**< Seed */
+    double pct[4];           /**< Percentá UP, DOWN, LEFT, RIGHT */
+    uint8_t target;          /**< Cieľ presnosti (target_metric_t) */
+    double target_hw;        /**< Požadovaná polšírka pri cieli */
+} check_case_t;
+
+/** Kontrolné behy: symetrický, nesymetrický (okraje sa líšia), s nepárnym počtom
+ *  replikácií a s cieľom presnosti (počet replikácií sa určí po blokoch). */
+static const check_case_t CASES[] = {
+    { 11, 9, 200, 20000, 7u, { 25, 25, 25, 25 }, TARGET_NONE, 0.0 },
+    { 17, 5, 1000, 6000, 12345u, { 10, 40, 35, 15 }, TARGET_NONE, 0.0 },
+    { 3, 64, 300, 4099, 0xdeadbeefu, { 30, 20, 25, 25 }, TARGET_NONE, 0.0 },
+    { 9, 9, 150, 100000, 99u, { 25, 25, 25, 25 }, TARGET_SUCCESS, 0.01 },
+};
+
+/** Behy na pokračovanie z checkpointu - dosť dlhé, aby sa dali zastaviť v polovici. */
+static const check_case_t RESUME_CASES[] = {
+    { 64, 64, 20000, 3000, 2024u, { 25, 25, 25, 25 }, TARGET_NONE, 0.0 },
+    { 64, 64, 20000, 3000, 2025u, { 30, 20, 25, 25 }, TARGET_SUCCESS, 0.005 },
+};
+
+/** Počet shardov pri behoch na pokračovanie. */
+#define CHECK_RESUME_THREADS 3u
+
+/** Jadrá v poradí RW_KERNEL (NULL = bez premennej, automatická voľba). */
+static const char* const KERNELS[] = { "scalar", "sse41", NULL };
+
+/** Počty shardov. */
+static const uint32_t THREADS[] = { 1u, 2u, 3u, 8u };
+
+/**
+ * @brief Čakanie na done callback behu.
+ */
+typedef struct {
+    pthread_mutex_t mtx;     /**< Chráni done */
+    pthread_cond_t cv;       /**< Signál pri done */
+    int done;                /**< 1 po dokončení behu */
+} check_wait_t;
+
+/**
+ * @brief Callback po dokončení behu (vlákno poolu).
+ *
+ * @param arg Ukazovateľ na check_wait_t.
+ */
+static void check_done(void* arg) {
+    check_wait_t* w = (check_wait_t*)arg;
+    pthread_mutex_lock(&w->mtx);
+    w->done = 1;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->mtx);
+}
+
+/**
+ * @brief Checkpointy zastavovaného behu.
+ */
+typedef struct {
+    sim_job_t* job;          /**< Beh */
+    const char* path;        /**< Súbor checkpointu */
+    cache_key_t key;         /**< Kľúč behu */
+    int saved;               /**< Počet úspešne zapísaných checkpointov */
+} check_ckpt_t;
+
+/**
+ * @brief Callback checkpointu: zapíše ho a po prvých dokončených replikáciách beh zastaví.
+ *
+ * Posledný checkpoint po zastavení zapíše simulácia sama - z neho sa pokračuje.
+ *
+ * @param arg Ukazovateľ na check_ckpt_t.
+ * @param ck Stav behu.
+ */
+static void check_checkpoint(void* arg, const sim_checkpoint_t* ck) {
+    check_ckpt_t* cc = (check_ckpt_t*)arg;
+    if (ckpt_save(cc->path, &cc->key, ck) == 0) cc->saved++;
+
+    uint64_t done = 0;
+    for (uint32_t i = 0; i < ck->n; i++) {
+        done += (uint64_t)ck->shards[i].results.success_count + ck->shards[i].results.fail_count;
+    }
+    if (done > 0) atomic_store(&cc->job->stop, 1);
+    sim_ckpt_written(cc->job);
+}
+
+/**
+ * @brief Pripraví beh ako server (dávkové jadro, bez výstupu).
+ *
+ * @param job Výstupný popis behu.
+ * @param c Parametre behu.
+ * @param boundary Režim okraja.
+ * @param threads Počet shardov.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int check_job(sim_job_t* job, const check_case_t* c, uint8_t boundary, uint32_t threads) {
+    memset(job, 0, sizeof(*job));
+    job->width = c->width;
+    job->height = c->height;
+    job->k_max = c->k_max;
+    job->reps = c->reps;
+    job->seed = c->seed;
+    job->pacing = PACE_UNPACED;
+    job->threads = threads;
+    job->boundary = boundary;
+    job->method = METHOD_MONTE_CARLO;
+    job->stream = STREAM_NONE;
+    job->target = c->target;
+    job->target_hw = c->target_hw;
+    job->quiet = 1;
+    atomic_init(&job->stop, 0);
+    atomic_init(&job->frame_next, 0);
+    return proto_probs_from_percents(c->pct, job->prob_q);
+}
+
+/**
+ * @brief Spustí pripravený beh a počká na neho.
+ *
+ * @param pool Pool vlákien.
+ * @param job Beh z check_job().
+ * @param c Parametre behu.
+ * @param out Výstupné výsledky.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int check_submit(pool_t* pool, sim_job_t* job, const check_case_t* c, results_t* out) {
+    results_reset(out);
+    results_set_params(out, c->width, c->height, c->k_max, (uint8_t)c->pct[0], (uint8_t)c->pct[1],
+                       (uint8_t)c->pct[2], (uint8_t)c->pct[3], c->reps);
+
+    check_wait_t w;
+    pthread_mutex_init(&w.mtx, NULL);
+    pthread_cond_init(&w.cv, NULL);
+    w.done = 0;
+    int rc = sim_submit(pool, job, out, check_done, &w);
+    if (rc == 0) {
+        pthread_mutex_lock(&w.mtx);
+        while (!w.done) pthread_cond_wait(&w.cv, &w.mtx);
+        pthread_mutex_unlock(&w.mtx);
+    }
+    pthread_cond_destroy(&w.cv);
+    pthread_mutex_destroy(&w.mtx);
+    return rc;
+}
+
+/**
+ * @brief Spustí jeden beh ako server a počká na neho.
+ *
+ * @param pool Pool vlákien.
+ * @param c Parametre behu.
+ * @param boundary Režim okraja.
+ * @param threads Počet shardov.
+ * @param out Výstupné výsledky.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int check_run(pool_t* pool, const check_case_t* c, uint8_t boundary, uint32_t threads, results_t* out) {
+    sim_job_t job;
+    if (check_job(&job, c, boundary, threads) != 0) return -1;
+    return check_submit(pool, &job, c, out);
+}
+
+/**
+ * @brief Porovná momenty.
+ *
+ * @return 1 ak sú rovnaké.
+ */
+static int moments_equal(const moments_t* a, const moments_t* b) {
+    return a->n == b->n && a->s1 == b->s1 && a->s2 == b->s2 && a->s3 == b->s3 &&
+           a->s4 == b->s4 && a->s4_hi == b->s4_hi;
+}
+
+/**
+ * @brief Porovná dva zlúčené výsledky po poliach (výplň struct sa neporovnáva).
+ *
+ * @param a Prvé výsledky.
+ * @param b Druhé výsledky.
+ * @return NULL ak sú rovnaké, inak meno prvého rozdielneho poľa.
+ */
+static const char* results_diff(const results_t* a, const results_t* b) {
+    if (a->reps_total != b->reps_total) return "reps_total";
+    if (a->success_count != b->success_count) return "success_count";
+    if (a->fail_count != b->fail_count) return "fail_count";
+    if (a->sum_steps_success != b->sum_steps_success) return "sum_steps_success";
+    if (!moments_equal(&a->steps, &b->steps)) return "steps";
+    if (!moments_equal(&a->success, &b->success)) return "success";
+    if (a->min_steps != b->min_steps) return "min_steps";
+    if (a->max_steps != b->max_steps) return "max_steps";
+    if (memcmp(a->bins, b->bins, sizeof(a->bins)) != 0) return "bins";
+    if (memcmp(a->hist, b->hist, sizeof(a->hist)) != 0) return "hist";
+    return NULL;
+}
+
+/**
+ * @brief Porovná správy MSG_RESULT dvoch behov bajt po bajte.
+ *
+ * @param a Prvé výsledky.
+ * @param b Druhé výsledky.
+ * @return 1 ak sú správy rovnaké.
+ */
+static int result_msg_equal(const results_t* a, const results_t* b) {
+    msg_result_t ma;
+    msg_result_t mb;
+    results_to_msg(a, &ma);
+    results_to_msg(b, &mb);
+    return memcmp(&ma, &mb, sizeof(ma)) == 0;
+}
+
+/**
+ * @brief Zastaví beh po prvých replikáciách, dopočíta ho z checkpointu na disku
+ *        a porovná s neprerušeným behom.
+ *
+ * @param pool Pool vlákien.
+ * @param c Parametre behu.
+ * @param data_dir Dočasný dátový priečinok pre checkpoint.
+ * @return NULL pri zhode, inak popis rozdielu.
+ */
+static const char* check_resume(pool_t* pool, const check_case_t* c, const char* data_dir) {
+    results_t ref;
+    if (check_run(pool, c, BOUND_TORUS, CHECK_RESUME_THREADS, &ref) != 0) return "run failed";
+
+    sim_job_t job;
+    check_ckpt_t cc;
+    char path[4096];
+    results_t part;
+    if (check_job(&job, c, BOUND_TORUS, CHECK_RESUME_THREADS) != 0) return "run failed";
+    cc.job = &job;
+    cc.path = path;
+    cc.saved = 0;
+    cache_key_from_job(&job, &cc.key);
+    if (ckpt_path(data_dir, &cc.key, path, sizeof(path)) != 0) return "checkpoint path";
+    job.ckpt = check_checkpoint;
+    job.ckpt_arg = &cc;
+    job.ckpt_ms = 0; /* checkpoint na konci každého úseku, kým sa beh nezastaví */
+    if (check_submit(pool, &job, c, &part) != 0) return "run failed";
+    if (cc.saved == 0) return "checkpoint not saved";
+    if (job.reps_done >= ref.reps_total) return "run not stopped part-way";
+
+    sim_checkpoint_t* ck = ckpt_load(path, &cc.key);
+    ckpt_remove(path);
+    if (!ck) return "checkpoint not loaded";
+
+    const char* diff = "run failed";
+    results_t resumed;
+    if (check_job(&job, c, BOUND_TORUS, CHECK_RESUME_THREADS) == 0) {
+        job.resume = ck;
+        if (check_submit(pool, &job, c, &resumed) == 0) {
+            diff = results_diff(&ref, &resumed);
+            if (!diff && !result_msg_equal(&ref, &resumed)) diff = "MSG_RESULT";
+        }
+    }
+    free(ck);
+    return diff;
+}
+
+int main(void) {
+    pool_t* pool = pool_create(CHECK_POOL_THREADS);
+    if (!pool) {
+        fprintf(stderr, "[check] failed to create pool\n");
+        return 1;
+    }
+
+    uint32_t runs = 0;
+    uint32_t failures = 0;
+    for (size_t ci = 0; ci < sizeof(CASES) / sizeof(CASES[0]); ci++) {
+        const check_case_t* c = &CASES[ci];
+        for (uint8_t b = 0; b < BOUND_COUNT; b++) {
+            results_t ref;
+            setenv("RW_KERNEL", "scalar", 1);
+            if (check_run(pool, c, b, 1u, &ref) != 0) {
+                fprintf(stderr, "[check] case %zu boundary %u: run failed\n", ci, (unsigned)b);
+                failures++;
+                continue;
+            }
+
+            for (size_t ki = 0; ki < sizeof(KERNELS) / sizeof(KERNELS[0]); ki++) {
+                const char* kname = NULL;
+                if (KERNELS[ki]) setenv("RW_KERNEL", KERNELS[ki], 1);
+                else unsetenv("RW_KERNEL");
+                (void)kernel_select(b, &kname);
+
+                /* THREADS[0] je 1 - s týmto behom sa porovnajú MSG_RESULT ostatných */
+                results_t one;
+                results_reset(&one);
+                for (size_t ti = 0; ti < sizeof(THREADS) / sizeof(THREADS[0]); ti++) {
+                    results_t r;
+                    runs++;
+                    const char* diff = "run failed";
+                    if (check_run(pool, c, b, THREADS[ti], &r) == 0) {
+                        if (ti == 0) one = r;
+                        diff = results_diff(&ref, &r);
+                        if (!diff && !result_msg_equal(&one, &r)) diff = "MSG_RESULT (vs threads 1)";
+                    }
+                    if (diff) {
+                        printf("[check] FAIL case %zu boundary %u kernel %s threads %u: %s differs\n",
+                               ci, (unsigned)b, kname, (unsigned)THREADS[ti], diff);
+                        failures++;
+                    }
+                }
+                printf("[check] case %zu boundary %u kernel %s: threads 1..%u checked\n", ci, (unsigned)b,
+                       kname, (unsigned)THREADS[sizeof(THREADS) / sizeof(THREADS[0]) - 1]);
+            }
+        }
+    }
+    unsetenv("RW_KERNEL");
+
+    char data_dir[] = "/tmp/rwcheck.XXXXXX";
+    if (!mkdtemp(data_dir)) {
+        perror("[check] mkdtemp");
+        failures++;
+    } else {
+        for (size_t ci = 0; ci < sizeof(RESUME_CASES) / sizeof(RESUME_CASES[0]); ci++) {
+            runs++;
+            const char* diff = check_resume(pool, &RESUME_CASES[ci], data_dir);
+            if (diff) {
+                printf("[check] FAIL resume case %zu: %s\n", ci, diff);
+                failures++;
+            }
+            printf("[check] resume case %zu: stopped, resumed from checkpoint, checked\n", ci);
+        }
+        char dir[4096];
+        snprintf(dir, sizeof(dir), "%s/%s", data_dir, CKPT_DIR);
+        rmdir(dir);
+        rmdir(data_dir);
+    }
+    pool_destroy(pool);
+
+    printf("[check] %u runs, %u failures\n", (unsigned)runs, (unsigned)failures);
+    return failures ? 1 : 0;
+}
@@ -123,14 +123,18 @@ static int spawn_server(uint16_t port) {
 /**
  * @brief Pripojí sa k serveru a vykoná handshake protokol.
  *
- * Pošle MSG_HELLO a očakáva MSG_HELLO_ACK od servera.
+ * Pošle MSG_HELLO a očakáva MSG_HELLO_ACK od servera. Potom vyjedná
+ * dávkovanie stavov a politiku odosielania servera (MSG_SESSION /
+ * MSG_SESSION_ACK). Klient sám posiela len krátke riadiace správy, preto
+ * jeho strana spojenia používa vždy NET_POLICY_LATENCY.
  *
  * @param host IP adresa alebo hostname servera.
  * @param port Číslo portu servera.
+ * @param policy Politika, ktorú má server použiť pri posielaní (net_policy_t).
  * @return File descriptor socketu pri úspechu, -1 pri chybe.
  */
-static int connect_and_handshake(const char* host, uint16_t port) {
-    int fd = net_connect(host, port);
+static int connect_and_handshake(const char* host, uint16_t port, int policy) {
+    int fd = net_connect(host, port, NET_POLICY_LATENCY);
     if (fd < 0) return -1;
 
     const char* hello = "hello-from-client";
@@ -146,6 +150,24 @@ static int connect_and_handshake(const char* host, uint16_t port) {
         return -1;
     }
 
+    msg_session_t ss;
+    ss.batch_max = (uint16_t)CLIENT_BATCH_MAX;
+    ss.flush_ms = (uint16_t)CLIENT_FLUSH_MS;
+    ss.net_policy = (uint8_t)policy;
+    ss.max_fps = (uint16_t)CLIENT_MAX_FPS;
+    ss.decimate = 1;
+    ss.ring_policy = CLIENT_RING_POLICY;
+    ss.snap_reps = 0;
+    ss.snap_ms = CLIENT_SNAP_MS;
+    if (proto_send(fd, MSG_SESSION, &ss, (uint32_t)sizeof(ss)) != 0 ||
+        proto_recv(fd, &t, &ss, (uint32_t)sizeof(ss), &len) != 0 ||
+        t != MSG_SESSION_ACK || len != sizeof(ss)) {
+        close(fd);
+        return -1;
+    }
+    printf("[client] session: batch=%u flush=%ums policy=%s fps=%u\n", (unsigned)ss.batch_max, (unsigned)ss.flush_ms,
+           (ss.net_policy == NET_POLICY_THROUGHPUT) ? "throughput" : "latency", (unsigned)ss.max_fps);
+
     return fd;
 }
 
@@ -164,7 +186,7 @@ int client_connect_only(client_ctx_t* ctx) {
         return 0;
     }
 
-    int fd = connect_and_handshake(ctx->host, ctx->port);
+    int fd = connect_and_handshake(ctx->host, ctx->port, ctx->net_policy);
     if (fd < 0) {
         fprintf(stderr, "[client] connect/handshake failed\n");
         return -1;
@@ -178,28 +200,33 @@ int client_connect_only(client_ctx_t* ctx) {
  * @brief Spustí simuláciu náhodnej prechádzky.
  *
  * Funkcia vykoná nasledujúce kroky:
- * 1. Ak je spawn=1 a nie je pripojený, spustí serverový proces
+ * 1. Ak je spawn=1 a nie je pripojený, pripojí sa k už bežiacemu serveru
+ *    (server obsluhuje viac klientov naraz), inak spustí serverový proces
  * 2. Ak nie je pripojený, pripojí sa k serveru
  * 3. Pošle MSG_START so všetkými parametrami simulácie
  *
  * @param ctx Ukazovateľ na kontext klienta.
  * @param spawn 1 ak má spustiť server ako child proces, 0 inak.
- * @param w Šírka sveta.
- * @param h Výška sveta.
- * @param k Maximálny počet krokov na replikáciu.
- * @param reps Počet replikácií.
- * @param seed Seed pre generátor náhodných čísiel (0 = použiť aktuálny čas).
- * @param p_up Pravdepodobnosť pohybu hore (%).
- * @param p_down Pravdepodobnosť pohybu dole (%).
- * @param p_left Pravdepodobnosť pohybu doľava (%).
- * @param p_right Pravdepodobnosť pohybu doprava (%).
+ * @param params Parametre simulácie (rozmery, K, reps, seed, percentá, časovanie).
  * @return 0 pri úspechu, -1 pri chybe.
  */
-int client_start_simulation(client_ctx_t* ctx, int spawn,
-                            int32_t w, int32_t h,
-                            uint32_t k, uint32_t reps, uint32_t seed,
-                            uint8_t p_up, uint8_t p_down, uint8_t p_left, uint8_t p_right) {
+/**
+ * @brief Zabezpečí spojenie so serverom (prípadne ho spustí).
+ *
+ * @param ctx Ukazovateľ na kontext klienta.
+ * @param spawn 1 ak má spustiť server ako child proces, 0 inak.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int client_ensure_server(client_ctx_t* ctx, int spawn) {
     /* 1) ak treba, spusti server */
+    if (spawn && ctx_get_fd(ctx) < 0) {
+        /* na porte už môže bežať server iného klienta - pridaj sa k nemu */
+        int fd = connect_and_handshake(ctx->host, ctx->port, ctx->net_policy);
+        if (fd >= 0) {
+            ctx_set_fd(ctx, fd);
+            printf("[client] server already running, connected + handshake OK\n");
+        }
+    }
     if (spawn && ctx_get_fd(ctx) < 0) {
         if (spawn_server(ctx->port) != 0) {
             fprintf(stderr, "[client] failed to spawn server\n");
@@ -208,7 +235,7 @@ int client_start_simulation(client_ctx_t* ctx, int spawn,
         /* retry connect kym server nezacne listen */
         int fd = -1;
         for (int i = 0; i < 40; i++) { /* ~4s */
-            fd = connect_and_handshake(ctx->host, ctx->port);
+            fd = connect_and_handshake(ctx->host, ctx->port, ctx->net_policy);
             if (fd >= 0) break;
             sleep_ms(100);
         }
@@ -224,30 +251,82 @@ int client_start_simulation(client_ctx_t* ctx, int spawn,
     if (ctx_get_fd(ctx) < 0) {
         if (client_connect_only(ctx) != 0) return -1;
     }
+    return 0;
+}
+
+/**
+ * @brief Pripojí sa (prípadne spustí server) a pošle MSG_START alebo MSG_RESUME.
+ *
+ * @param ctx Ukazovateľ na kontext klienta.
+ * @param spawn 1 ak má spustiť server ako child proces, 0 inak.
+ * @param params Parametre simulácie.
+ * @param type MSG_START alebo MSG_RESUME.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int client_send_start(client_ctx_t* ctx, int spawn, const msg_start_t* params, msg_type_t type) {
+    if (client_ensure_server(ctx, spawn) != 0) return -1;
 
     /* 3) posli START */
-    msg_start_t s;
-    s.width  = w;
-    s.height = h;
-    s.k_max  = k;
-    s.reps   = reps;
-    s.seed   = seed;
-    s.p_up   = p_up;
-    s.p_down = p_down;
-    s.p_left = p_left;
-    s.p_right = p_right;
+    msg_start_t s = *params;
+    const char* name = (type == MSG_RESUME) ? "RESUME" : "START";
 
     int fd2 = ctx_get_fd(ctx);
-    if (proto_send(fd2, MSG_START, &s, (uint32_t)sizeof(s)) != 0) {
+    if (proto_send(fd2, type, &s, (uint32_t)sizeof(s)) != 0) {
         ctx_set_done(ctx, 0);
-        fprintf(stderr, "[client] failed to send MSG_START\n");
+        fprintf(stderr, "[client] failed to send MSG_%s\n", name);
         ctx_close_fd(ctx);
         return -1;
     }
 
-    printf("[client] START sent (W=%d H=%d K=%u reps=%u seed=%u)\n",
-           s.width, s.height, (unsigned)s.k_max, (unsigned)s.reps, (unsigned)s.seed);
+    printf("[client] %s sent (W=%d H=%d K=%u reps=%u seed=%u pacing=%u)\n",
+           name, s.width, s.height, (unsigned)s.k_max, (unsigned)s.reps, (unsigned)s.seed,
+           (unsigned)s.pacing);
 
+    /* pre neskorší RESUME rovnakého behu */
+    pthread_mutex_lock(&ctx->mtx);
+    ctx->last_start = s;
+    ctx->has_last_start = 1;
+    pthread_mutex_unlock(&ctx->mtx);
+    return 0;
+}
+
+int client_start_simulation(client_ctx_t* ctx, int spawn, const msg_start_t* params) {
+    return client_send_start(ctx, spawn, params, MSG_START);
+}
+
+int client_resume(client_ctx_t* ctx, const msg_start_t* params) {
+    if (params->seed == 0) {
+        printf("[client] RESUME needs a fixed seed (seed 0 runs cannot be resumed)\n");
+        return -1;
+    }
+    return client_send_start(ctx, 1, params, MSG_RESUME);
+}
+
+int client_sweep(client_ctx_t* ctx, const msg_sweep_t* req) {
+    if (client_ensure_server(ctx, 1) != 0) return -1;
+
+    msg_sweep_t sw = *req;
+    if (proto_send(ctx_get_fd(ctx), MSG_SWEEP, &sw, (uint32_t)sizeof(sw)) != 0) {
+        ctx_set_done(ctx, 0);
+        fprintf(stderr, "[client] failed to send MSG_SWEEP\n");
+        ctx_close_fd(ctx);
+        return -1;
+    }
+    printf("[client] SWEEP sent (reps=%u seed=%u crn=%u)\n",
+           (unsigned)sw.reps, (unsigned)sw.seed, (unsigned)sw.crn);
+    return 0;
+}
+
+int client_subscribe(client_ctx_t* ctx, uint32_t session) {
+    if (ctx_get_fd(ctx) < 0 && client_connect_only(ctx) != 0) return -1;
+
+    msg_subscribe_t req;
+    req.session = session;
+    if (proto_send(ctx_get_fd(ctx), MSG_SUBSCRIBE, &req, (uint32_t)sizeof(req)) != 0) {
+        fprintf(stderr, "[client] failed to send MSG_SUBSCRIBE\n");
+        ctx_close_fd(ctx);
+        return -1;
+    }
     return 0;
 }
 
@@ -266,12 +345,119 @@ int client_quit_server_and_close(client_ctx_t* ctx) {
     return 0;
 }
 
+/**
+ * @brief Vypíše mriežku pravdepodobností ako zmenšenú textovú mapu.
+ *
+ * Mapa má najviac 64 x 24 znakov; každý znak zodpovedá bunke v strede
+ * príslušného obdĺžnika a jeho hustota rastie s P(zásah do K krokov).
+ *
+ * @param ctx Ukazovateľ na kontext klienta (s kompletnou mriežkou).
+ */
+static void print_grid_map(const client_ctx_t* ctx) {
+    static const char shades[] = " .:-=+*#%@";
+    const int32_t w = ctx->grid_w, h = ctx->grid_h;
+    int32_t cols = (w < 64) ? w : 64;
+    int32_t rows = (h < 24) ? h : 24;
+
+    size_t center = (size_t)(h / 2) * (size_t)w + (size_t)(w / 2);
+    printf("[client] all starts: %dx%d K=%u, center P=%.6f mean=%.2f\n",
+           w, h, (unsigned)ctx->grid_k, ctx->grid_p[center], ctx->grid_mean[center]);
+
+    for (int32_t r = 0; r < rows; r++) {
+        int32_t y = (int32_t)(((int64_t)r * h + h / 2) / rows);
+        char line[72];
+        for (int32_t c = 0; c < cols; c++) {
+            int32_t x = (int32_t)(((int64_t)c * w + w / 2) / cols);
+            float p = ctx->grid_p[(size_t)y * (size_t)w + (size_t)x];
+            int idx = (int)(p * (float)(sizeof(shades) - 2) + 0.5f);
+            if (idx < 0) idx = 0;
+            if (idx > (int)sizeof(shades) - 2) idx = (int)sizeof(shades) - 2;
+            line[c] = shades[idx];
+        }
+        line[cols] = '\0';
+        printf("  |%s|\n", line);
+    }
+}
+
+/**
+ * @brief Tempo prehrávania trajektórií zo súboru (client --replay).
+ */
+typedef struct {
+    uint32_t rate;           /**< Krokov za sekundu (0 = bez čakania) */
+    struct timespec next;    /**< Čas ďalšieho kroku (CLOCK_MONOTONIC) */
+} replay_pace_t;
+
+/**
+ * @brief Počká na čas ďalšieho kroku (absolútne termíny, bez driftu).
+ *
+ * @param p Tempo prehrávania.
+ */
+static void replay_wait(replay_pace_t* p) {
+    if (p->rate == 0) return;
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &p->next, NULL) == EINTR) {
+    }
+    p->next.tv_nsec += 1000000000L / (long)p->rate;
+    while (p->next.tv_nsec >= 1000000000L) {
+        p->next.tv_sec += 1;
+        p->next.tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief Rekonštruuje a vypíše pozície z payloadu MSG_TRAJ.
+ *
+ * Každý úsek začína absolútnou pozíciou, takže sa spracuje nezávisle od
+ * ostatných: dekódujú sa smery a pozície sa dopočítajú rovnakým pravidlom
+ * pohybu ako na serveri (sim_move). Poškodený úsek ukončí spracovanie rámca.
+ *
+ * @param ctx Ukazovateľ na kontext klienta (s parametrami z MSG_TRAJ_INFO).
+ * @param data Payload MSG_TRAJ (alebo úseky replikácie zo súboru).
+ * @param len Dĺžka payloadu.
+ * @param pace Tempo prehrávania zo súboru (NULL = vypísať hneď).
+ */
+static void replay_traj(client_ctx_t* ctx, const uint8_t* data, uint32_t len, replay_pace_t* pace) {
+    const msg_traj_info_t* ti = &ctx->traj;
+    uint8_t dirs[TRAJ_SEG_STEPS];
+    uint32_t q[4];
+    memcpy(q, ti->prob_q, sizeof(q));
+    uint32_t off = 0;
+
+    ctx->traj_bytes += len;
+    while (off + sizeof(msg_traj_seg_t) <= len) {
+        msg_traj_seg_t seg;
+        memcpy(&seg, data + off, sizeof(seg));
+        off += (uint32_t)sizeof(seg);
+
+        if (seg.nbytes > len - off ||
+            traj_decode(data + off, seg.nbytes, seg.codec, seg.count, q, dirs) != 0) {
+            printf("[client] corrupt trajectory segment (rep=%u)\n", seg.rep);
+            return;
+        }
+        off += seg.nbytes;
+
+        int32_t x = seg.x, y = seg.y;
+        for (uint32_t i = 0; i < seg.count; i++) {
+            (void)sim_move(&x, &y, dirs[i], ti->width, ti->height, ti->boundary);
+            printf("[client] rep=%u/%u step=%u pos=(%d,%d)\n",
+                   seg.rep, ti->reps, seg.step_first + i, x, y);
+            if (pace) replay_wait(pace);
+        }
+        ctx->traj_steps += seg.count;
+    }
+}
+
 /**
  * @brief Vlákno pre príjem správ od servera.
  *
  * Toto vlákno beží po celú dobu života klienta a:
- * - Prijíma správy MSG_STATE (stav simulácie) a vypisuje ich
+ * - Prijíma správy MSG_STATE a MSG_STATE_BATCH (stavy simulácie) a vypisuje ich
+ * - Prijíma trajektórie (MSG_TRAJ_INFO, MSG_TRAJ) a vypisuje z nich pozície
+ * - Prijíma cestu k súboru so zaznamenanými trajektóriami (MSG_TRAJ_FILE)
+ * - Prijíma obsadenosť frontov odosielania servera (MSG_RING_STATUS)
+ * - Prijíma výsledok presného výpočtu (MSG_EXACT_PMF, MSG_EXACT_SUMMARY)
+ *   a mriežku pre všetky štarty (MSG_GRID_INFO, MSG_GRID_CELLS)
  * - Prijíma správu MSG_DONE (koniec simulácie)
+ * - Prijíma odpoveď na sledovanie inej relácie (MSG_SUBSCRIBE_ACK)
  * - Deteguje odpojenie servera
  *
  * @param arg Ukazovateľ na client_ctx_t štruktúru.
@@ -290,19 +476,164 @@ void* recv_thread(void* arg) {
         msg_type_t t;
         uint32_t len = 0;
 
-        /* najvacsi payload co cakame = msg_state_t */
-        msg_state_t st;
-
-        if (proto_recv(fd, &t, &st, (uint32_t)sizeof(st), &len) != 0) {
+        /* buffer pre najväčší payload, aký server posiela */
+        union {
+            msg_state_t st;
+            msg_state_batch_t sb;
+            msg_traj_info_t ti;
+            msg_ring_status_t rs;
+            uint8_t traj[TRAJ_FRAME_MAX];
+            msg_exact_pmf_t pmf;
+            msg_exact_summary_t sum;
+            msg_grid_info_t gi;
+            msg_grid_cells_t gc;
+            msg_subscribe_t sub;
+            msg_result_t res;
+            msg_step_hist_t hist;
+            msg_traj_file_t tf;
+            msg_sweep_point_t sp;
+        } m;
+
+        if (proto_recv(fd, &t, &m, (uint32_t)sizeof(m), &len) != 0) {
             printf("[client] disconnected from server\n");
             ctx_close_fd(ctx);
             continue; // klient zije dalej, vrat sa do menu
         }
 
-        if (t == MSG_STATE && len == sizeof(st)) {
+        if (t == MSG_STATE && len == sizeof(m.st)) {
             printf("[client] rep=%u/%u step=%u pos=(%d,%d)\n",
-                   st.rep, st.reps_total, st.step, st.x, st.y);
+                   m.st.rep, m.st.reps_total, m.st.step, m.st.x, m.st.y);
+        } else if (t == MSG_STATE_BATCH && len >= sizeof(m.sb) - sizeof(m.sb.st)) {
+            uint32_t count = m.sb.count;
+            if (count <= STATE_BATCH_MAX &&
+                len == sizeof(m.sb) - sizeof(m.sb.st) + count * sizeof(m.sb.st[0])) {
+                for (uint32_t i = 0; i < count; i++) {
+                    const msg_state_t* st = &m.sb.st[i];
+                    printf("[client] rep=%u/%u step=%u pos=(%d,%d)\n",
+                           st->rep, st->reps_total, st->step, st->x, st->y);
+                }
+            }
+        } else if (t == MSG_TRAJ_INFO && len == sizeof(m.ti)) {
+            ctx->traj = m.ti;
+            ctx->traj_steps = 0;
+            ctx->traj_bytes = 0;
+        } else if (t == MSG_TRAJ) {
+            replay_traj(ctx, m.traj, len, NULL);
+        } else if (t == MSG_TRAJ_FILE && len == sizeof(m.tf)) {
+            m.tf.path[TRAJ_FILE_PATH_MAX - 1] = '\0';
+            printf("[client] %u trajectories saved on server: %s (%.1f kB)\n",
+                   m.tf.reps, m.tf.path, (double)m.tf.bytes / 1024.0);
+            printf("[client] replay: ./bin/client --replay %s\n", m.tf.path);
+        } else if (t == MSG_SUBSCRIBE_ACK && len == sizeof(m.sub)) {
+            if (m.sub.session != 0) printf("[client] watching session %u\n", (unsigned)m.sub.session);
+            else printf("[client] subscribe refused (no such session or busy)\n");
+        } else if (t == MSG_RESULT && len == sizeof(m.res)) {
+            uint32_t reps = m.res.reps_total;
+            uint32_t ok = m.res.success_count;
+            printf("[client] result: reached (0,0) in %u/%u reps (%.1f%%)\n", ok, reps,
+                   reps ? 100.0 * (double)ok / (double)reps : 0.0);
+            if (ok > 0) {
+                printf("[client] result: steps avg=%.2f min=%u max=%u p50=%u p90=%u p99=%u p99.9=%u\n",
+                       (double)m.res.sum_steps_success / (double)ok, m.res.min_steps, m.res.max_steps,
+                       m.res.p50, m.res.p90, m.res.p99, m.res.p999);
+            }
+            msg_moments_t ms = m.res.steps;
+            msg_moments_t mp = m.res.success;
+            if (ms.n > 1) {
+                double sd = sqrt(ms.m2 / (double)(ms.n - 1));
+                printf("[client] result: steps sd=%.2f mean 95%% CI=[%.2f, %.2f]\n", sd,
+                       ms.mean - 1.96 * sd / sqrt((double)ms.n), ms.mean + 1.96 * sd / sqrt((double)ms.n));
+            }
+            if (mp.n > 1) {
+                printf("[client] result: success rate %.4f +- %.4f (95%% CI)\n", mp.mean,
+                       1.96 * sqrt(mp.m2 / (double)(mp.n - 1) / (double)mp.n));
+            }
+        } else if (t == MSG_SWEEP_POINT && len == sizeof(m.sp)) {
+            msg_result_t r = m.sp.result;
+            msg_moments_t mp = r.success;
+            double p_hw = (mp.n > 1) ? 1.96 * sqrt(mp.m2 / (double)(mp.n - 1) / (double)mp.n) : 0.0;
+            double avg = r.success_count ? (double)r.sum_steps_success / (double)r.success_count : 0.0;
+            printf("[client] sweep %u/%u: W=%d H=%d K=%u U=%u D=%u L=%u R=%u -> success %.4f +- %.4f, steps avg=%.2f%s\n",
+                   m.sp.index + 1u, m.sp.total, m.sp.width, m.sp.height, m.sp.k_max,
+                   m.sp.p_up, m.sp.p_down, m.sp.p_left, m.sp.p_right, mp.mean, p_hw, avg,
+                   m.sp.cached ? " (cache)" : "");
+        } else if (t == MSG_RESULT_PARTIAL && len == sizeof(m.res)) {
+            msg_moments_t ms = m.res.steps;
+            msg_moments_t mp = m.res.success;
+            double p_hw = (mp.n > 1) ? 1.96 * sqrt(mp.m2 / (double)(mp.n - 1) / (double)mp.n) : 0.0;
+            double s_hw = (ms.n > 1) ? 1.96 * sqrt(ms.m2 / (double)(ms.n - 1) / (double)ms.n) : 0.0;
+            printf("[client] progress: %llu/%u reps, success %.4f +- %.4f, mean steps %.2f +- %.2f\n",
+                   (unsigned long long)mp.n, m.res.reps_total, mp.mean, p_hw, ms.mean, s_hw);
+        } else if (t == MSG_STEP_HIST && len >= sizeof(m.hist) - sizeof(m.hist.c)) {
+            uint32_t count = m.hist.count;
+            if (m.hist.sub_bits == STEP_HIST_SUB_BITS && count <= STEP_HIST_BUCKETS &&
+                len == sizeof(m.hist) - sizeof(m.hist.c) + count * sizeof(uint32_t) && count > 0) {
+                /* kvantily si klient počíta sám, server nedrží kroky jednotlivých replikácií */
+                memcpy(ctx->step_hist, m.hist.c, count * sizeof(uint32_t));
+                ctx->step_hist_n = count;
+                printf("[client] step histogram: %u buckets, p75=%u p95=%u p99.99=%u\n", count,
+                       hist_quantile(ctx->step_hist, count, 0.75), hist_quantile(ctx->step_hist, count, 0.95),
+                       hist_quantile(ctx->step_hist, count, 0.9999));
+            }
+        } else if (t == MSG_RING_STATUS && len == sizeof(m.rs)) {
+            ctx->ring = m.rs;
+            ctx->has_ring = 1;
+        } else if (t == MSG_EXACT_PMF && len >= sizeof(m.pmf) - sizeof(m.pmf.p)) {
+            uint32_t count = (len - (uint32_t)(sizeof(m.pmf) - sizeof(m.pmf.p))) / (uint32_t)sizeof(double);
+            if (m.pmf.t_first == 1) {
+                ctx->exact_received = 0;
+                ctx->exact_peak_t = 0;
+                ctx->exact_peak_p = 0.0;
+            }
+            for (uint32_t i = 0; i < count && i < m.pmf.count; i++) {
+                if (m.pmf.p[i] > ctx->exact_peak_p) {
+                    ctx->exact_peak_p = m.pmf.p[i];
+                    ctx->exact_peak_t = m.pmf.t_first + i;
+                }
+            }
+            ctx->exact_received += count;
+        } else if (t == MSG_EXACT_SUMMARY && len == sizeof(m.sum)) {
+            printf("[client] exact: P(reach (0,0) within K=%u)=%.9f mean steps=%.4f (steps=%u, %u values)\n",
+                   m.sum.k_max, m.sum.p_success, m.sum.mean_steps, m.sum.steps_done, ctx->exact_received);
+            printf("[client] exact: most likely hit at step %u (p=%.9f)\n",
+                   ctx->exact_peak_t, ctx->exact_peak_p);
+            printf("[client] exact: bins 0-20=%.6f 21-50=%.6f 51-100=%.6f 101+=%.6f\n",
+                   m.sum.bins[0], m.sum.bins[1], m.sum.bins[2], m.sum.bins[3]);
+        } else if (t == MSG_GRID_INFO && len == sizeof(m.gi)) {
+            size_t cells = (size_t)m.gi.width * (size_t)m.gi.height;
+            free(ctx->grid_p);
+            free(ctx->grid_mean);
+            ctx->grid_p = calloc(cells, sizeof(float));
+            ctx->grid_mean = calloc(cells, sizeof(float));
+            ctx->grid_w = (ctx->grid_p && ctx->grid_mean) ? m.gi.width : 0;
+            ctx->grid_h = (ctx->grid_p && ctx->grid_mean) ? m.gi.height : 0;
+            ctx->grid_k = m.gi.k_max;
+            ctx->grid_received = 0;
+        } else if (t == MSG_GRID_CELLS && len >= sizeof(m.gc) - sizeof(m.gc.v)) {
+            uint32_t count = m.gc.count;
+            size_t cells = (size_t)ctx->grid_w * (size_t)ctx->grid_h;
+            if (count <= GRID_CHUNK && len == sizeof(m.gc) - sizeof(m.gc.v) + 2u * count * sizeof(float) &&
+                (size_t)m.gc.first + count <= cells) {
+                memcpy(&ctx->grid_p[m.gc.first], &m.gc.v[0], count * sizeof(float));
+                memcpy(&ctx->grid_mean[m.gc.first], &m.gc.v[count], count * sizeof(float));
+                ctx->grid_received += count;
+                if (ctx->grid_received == cells) print_grid_map(ctx);
+            }
         } else if (t == MSG_DONE) {
+            if (ctx->traj_steps > 0) {
+                printf("[client] trajectory: %llu steps in %llu bytes (%.3f bits/step)\n",
+                       (unsigned long long)ctx->traj_steps, (unsigned long long)ctx->traj_bytes,
+                       8.0 * (double)ctx->traj_bytes / (double)ctx->traj_steps);
+                ctx->traj_steps = 0;
+                ctx->traj_bytes = 0;
+            }
+            if (ctx->has_ring) {
+                printf("[client] server send rings: peak %u/%u, dropped %llu, coalesced %llu, waits %llu\n",
+                       (unsigned)ctx->ring.peak, (unsigned)ctx->ring.slots,
+                       (unsigned long long)ctx->ring.dropped, (unsigned long long)ctx->ring.coalesced,
+                       (unsigned long long)ctx->ring.waits);
+                ctx->has_ring = 0;
+            }
             printf("[client] simulation finished (MSG_DONE)\n");
             /* server moze zostat bezat alebo zatvorit session; my len informujeme */
             ctx_set_done(ctx, 1);
@@ -345,4 +676,48 @@ void* input_thread(void* arg) {
     }
 
     return NULL;
-}
\ No newline at end of file
+}
+int client_replay(const char* path, uint32_t rep, uint32_t rate) {
+    trajfile_view_t v;
+    if (trajfile_map(path, &v) != 0) {
+        printf("[client] cannot read trajectory file %s\n", path);
+        return -1;
+    }
+
+    client_ctx_t ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.traj = v.hdr.info;
+    const msg_traj_info_t* ti = &ctx.traj;
+    printf("[client] replay %s: %dx%d K=%u seed=%u boundary=%u, %u/%u reps recorded%s\n",
+           path, (int)ti->width, (int)ti->height, (unsigned)v.hdr.k_max, (unsigned)v.hdr.seed,
+           (unsigned)ti->boundary, (unsigned)v.hdr.reps_written, (unsigned)ti->reps,
+           v.owned ? " (no index, scanned)" : "");
+    if (rep > ti->reps) {
+        printf("[client] no replication %u (file has 1..%u)\n", (unsigned)rep, (unsigned)ti->reps);
+        trajfile_unmap(&v);
+        return -1;
+    }
+
+    replay_pace_t pace;
+    pace.rate = rate;
+    clock_gettime(CLOCK_MONOTONIC, &pace.next);
+
+    uint32_t first = rep ? rep : 1u;
+    uint32_t last = rep ? rep : ti->reps;
+    uint32_t played = 0, hits = 0;
+    for (uint32_t r = first; r <= last && r != 0; r++) {
+        const uint8_t* segs = NULL;
+        const trajfile_rep_t* h = trajfile_find(&v, r, &segs);
+        if (!h) continue; /* nezapísaná (zastavený beh, cieľ presnosti) */
+        replay_traj(&ctx, segs, h->bytes, &pace);
+        played++;
+        if (h->outcome == TRAJFILE_HIT) hits++;
+    }
+
+    printf("[client] replay: %u reps, reached (0,0) in %u, %llu steps from %llu bytes (%.3f bits/step)\n",
+           (unsigned)played, (unsigned)hits, (unsigned long long)ctx.traj_steps,
+           (unsigned long long)ctx.traj_bytes,
+           ctx.traj_steps ? 8.0 * (double)ctx.traj_bytes / (double)ctx.traj_steps : 0.0);
+    trajfile_unmap(&v);
+    return 0;
+}
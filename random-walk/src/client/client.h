@@ -10,19 +10,40 @@
  */
 
 #pragma once
+#include "hist.h"
 #include "net.h"
 #include "protocol.h"
+#include "traj.h"
+#include "trajfile.h"
+#include "walk.h"
 
 #include <errno.h>
+#include <math.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <time.h>
 #include <unistd.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 
+/** Počet stavov v jednej dávke, ktorý klient žiada od servera (MSG_SESSION). */
+#define CLIENT_BATCH_MAX 256u
+
+/** Najdlhšie zdržanie neúplnej dávky stavov, ktoré klient žiada (ms). */
+#define CLIENT_FLUSH_MS 50u
+
+/** Najviac vypísaných stavov za sekundu (živý pohľad; konce replikácií idú vždy). */
+#define CLIENT_MAX_FPS 30u
+
+/** Správanie frontu odosielania servera pri pomalom príjme (ring_policy_t). */
+#define CLIENT_RING_POLICY RING_BLOCK
+
+/** Interval priebežných súhrnov dlhého behu, ktorý klient žiada (ms, 0 = žiadne). */
+#define CLIENT_SNAP_MS 1000u
+
 /**
  * @brief Kontext klienta uchovávajúci stav spojenia a vlákien.
  */
@@ -34,8 +55,35 @@ typedef struct {
 
     const char* host;        /**< IP adresa alebo hostname servera */
     uint16_t port;           /**< Číslo portu servera */
+    int net_policy;          /**< Politika odosielania, ktorú žiada od servera (net_policy_t) */
 
     int simulation_done;     /**< Príznak ukončenia simulácie (1 = prišlo MSG_DONE) */
+
+    /* presný výpočet (METHOD_EXACT) - mení ho iba recv_thread */
+    uint32_t exact_received; /**< Počet prijatých hodnôt P(zásah v kroku t) */
+    uint32_t exact_peak_t;   /**< Krok s najväčšou pravdepodobnosťou zásahu */
+    double exact_peak_p;     /**< Pravdepodobnosť zásahu v kroku exact_peak_t */
+
+    /* mriežka pre všetky štarty (METHOD_ALL_STARTS) - mení ju iba recv_thread */
+    int32_t grid_w, grid_h;  /**< Rozmery mriežky z MSG_GRID_INFO */
+    uint32_t grid_k;         /**< k_max výpočtu */
+    uint32_t grid_received;  /**< Počet prijatých buniek */
+    float* grid_p;           /**< P(zásah do K krokov) pre každý štart */
+    float* grid_mean;        /**< Stredný počet krokov pre každý štart */
+
+    /* histogram krokov posledného behu Monte Carlo (MSG_STEP_HIST) - mení ho iba recv_thread */
+    uint32_t step_hist[STEP_HIST_BUCKETS]; /**< Počty v košoch (rozloženie v hist.h) */
+    uint32_t step_hist_n;    /**< Počet platných košov (0 = zatiaľ žiadny histogram) */
+
+    /* trajektórie (STREAM_TRAJ) - mení ich iba recv_thread */
+    msg_traj_info_t traj;    /**< Parametre rekonštrukcie z MSG_TRAJ_INFO */
+    uint64_t traj_steps;     /**< Počet zrekonštruovaných krokov */
+    uint64_t traj_bytes;     /**< Počet prijatých bajtov payloadu MSG_TRAJ */
+    msg_ring_status_t ring;  /**< Posledná obsadenosť frontov servera (MSG_RING_STATUS) */
+    int has_ring;            /**< 1 ak od posledného MSG_DONE prišlo MSG_RING_STATUS */
+
+    msg_start_t last_start;  /**< Parametre posledného START/RESUME (pre ďalší RESUME) */
+    int has_last_start;      /**< 1 ak last_start platí */
 } client_ctx_t;
 
 /**
@@ -67,21 +115,59 @@ int client_connect_only(client_ctx_t* ctx);
  *
  * @param ctx Ukazovateľ na kontext klienta.
  * @param spawn 1 ak má spustiť server ako child proces, 0 inak.
- * @param w Šírka sveta.
- * @param h Výška sveta.
- * @param k Maximálny počet krokov na replikáciu.
- * @param reps Počet replikácií.
- * @param seed Seed pre generátor náhodných čísel (0 = použiť aktuálny čas).
- * @param p_up Pravdepodobnosť pohybu hore (%).
- * @param p_down Pravdepodobnosť pohybu dole (%).
- * @param p_left Pravdepodobnosť pohybu doľava (%).
- * @param p_right Pravdepodobnosť pohybu doprava (%).
+ * @param params Parametre simulácie (posielajú sa v MSG_START bez zmeny).
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int client_start_simulation(client_ctx_t* ctx, int spawn, const msg_start_t* params);
+
+/**
+ * @brief Pokračuje v prerušenej simulácii z checkpointu na serveri (MSG_RESUME).
+ *
+ * Parametre musia byť rovnaké ako pri pôvodnom START (s pevným seedom);
+ * server podľa nich nájde checkpoint. Ak ho nemá, beh začne od začiatku.
+ *
+ * @param ctx Ukazovateľ na kontext klienta.
+ * @param params Parametre pôvodnej simulácie.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int client_resume(client_ctx_t* ctx, const msg_start_t* params);
+
+/**
+ * @brief Pošle prechod mriežkou parametrov (MSG_SWEEP).
+ *
+ * Ak klient nie je pripojený, pripojí sa (prípadne spustí server).
+ * Výsledky bodov (MSG_SWEEP_POINT) vypisuje recv_thread, ako prichádzajú.
+ *
+ * @param ctx Ukazovateľ na kontext klienta.
+ * @param req Osi mriežky a spoločné parametre bodov.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int client_sweep(client_ctx_t* ctx, const msg_sweep_t* req);
+
+/**
+ * @brief Začne sledovať behy inej relácie na serveri (MSG_SUBSCRIBE).
+ *
+ * Ak klient nie je pripojený, najprv sa pripojí. Odpoveď (MSG_SUBSCRIBE_ACK)
+ * a priebeh sledovaných behov vypisuje recv_thread.
+ *
+ * @param ctx Ukazovateľ na kontext klienta.
+ * @param session Číslo relácie (0 = najnovšia s bežiacim behom).
  * @return 0 pri úspechu, -1 pri chybe.
  */
-int client_start_simulation(client_ctx_t* ctx, int spawn,
-                            int32_t w, int32_t h,
-                            uint32_t k, uint32_t reps, uint32_t seed,
-                            uint8_t p_up, uint8_t p_down, uint8_t p_left, uint8_t p_right);
+int client_subscribe(client_ctx_t* ctx, uint32_t session);
+
+/**
+ * @brief Prehrá trajektórie zo súboru (bez servera).
+ *
+ * Replikácie sa vypisujú v poradí čísel (nájdu sa cez index súboru) rovnako
+ * ako pri živom prenose trajektórií.
+ *
+ * @param path Súbor trajektórií (MSG_TRAJ_FILE).
+ * @param rep Iba táto replikácia (0 = všetky).
+ * @param rate Krokov za sekundu (0 = bez čakania).
+ * @return 0 pri úspechu, -1 ak sa súbor nedá prečítať.
+ */
+int client_replay(const char* path, uint32_t rep, uint32_t rate);
 
 /**
  * @brief Pošle serveru príkaz na ukončenie a zatvorí spojenie.
@@ -17,25 +17,107 @@
 #include <string.h>
 #include <unistd.h>
 
+/**
+ * @brief Prečíta parametre simulácie z menu.
+ *
+ * @param s Výstupné parametre pre MSG_START/MSG_RESUME.
+ */
+static void read_start_params(msg_start_t* s) {
+    int w = menu_read_int("Sirka W", 2, 2000, 10);
+    int h = menu_read_int("Vyska H", 2, 2000, 10);
+    unsigned k = menu_read_uint("Max kroky K", 1, 1000000, 200);
+    unsigned r = menu_read_uint("Replikacie R", 1, 1000000, 5);
+    unsigned seed = menu_read_uint("Seed (0=auto)", 0, 0xFFFFFFFFu, 0);
+
+    memset(s, 0, sizeof(*s));
+    s->width = (int32_t)w;
+    s->height = (int32_t)h;
+    s->k_max = (uint32_t)k;
+    s->reps = (uint32_t)r;
+    s->seed = (uint32_t)seed;
+    uint32_t q[4];
+    uint8_t pct[4];
+    menu_read_dir_probs(q, pct);
+    memcpy(s->prob_q, q, sizeof(q));
+    s->p_up = pct[0];
+    s->p_down = pct[1];
+    s->p_left = pct[2];
+    s->p_right = pct[3];
+
+    uint8_t pacing;
+    uint32_t rate_hz;
+    menu_read_pacing(&pacing, &rate_hz);
+    s->pacing = pacing;
+    s->rate_hz = rate_hz;
+    s->threads = (uint16_t)menu_read_uint("Vlakna simulacie (0=auto)", 0, 256, 1);
+    s->stream = (uint8_t)menu_read_uint("Stavy (0=kazdy krok, 1=len vysledok, 2=trajektoria)", 0, 2, 0);
+    s->boundary = (uint8_t)menu_read_uint("Okraj (0=torus, 1=odraz, 2=pohltenie)", 0, 2, 0);
+    s->method = (uint8_t)menu_read_uint("Vypocet (0=Monte Carlo, 1=presny, 2=vsetky starty)", 0, 2, 0);
+    if (s->method == METHOD_MONTE_CARLO) {
+        s->target = (uint8_t)menu_read_uint("Ciel presnosti (0=presne R, 1=uspesnost, 2=priemer krokov)", 0, 2, 0);
+        if (s->target == TARGET_SUCCESS) {
+            s->target_hw = menu_read_double("Polsirka 95% intervalu uspesnosti", 1e-6, 0.5, 0.01);
+        } else if (s->target == TARGET_MEAN_STEPS) {
+            s->target_hw = menu_read_double("Polsirka 95% intervalu priemeru (kroky)", 1e-3, 1e9, 1.0);
+        }
+        s->record = (uint8_t)menu_read_uint("Zapisat trajektorie do suboru na serveri (0=nie, 1=ano)", 0, 1, 0);
+    }
+}
+
+/**
+ * @brief Prečíta prechod mriežkou parametrov z menu.
+ *
+ * @param sw Výstupná požiadavka MSG_SWEEP.
+ */
+static void read_sweep_params(msg_sweep_t* sw) {
+    memset(sw, 0, sizeof(*sw));
+    menu_read_sweep_axis("Sirka W", 2, 2000, 10, &sw->axis[SWEEP_WIDTH]);
+    menu_read_sweep_axis("Vyska H", 2, 2000, 10, &sw->axis[SWEEP_HEIGHT]);
+    menu_read_sweep_axis("Max kroky K", 1, 1000000, 200, &sw->axis[SWEEP_K_MAX]);
+    menu_read_sweep_axis("Percent hore (UP)", 0, 100, 25, &sw->axis[SWEEP_P_UP]);
+    menu_read_sweep_axis("Percent dole (DOWN)", 0, 100, 25, &sw->axis[SWEEP_P_DOWN]);
+    menu_read_sweep_axis("Percent vlavo (LEFT)", 0, 100, 25, &sw->axis[SWEEP_P_LEFT]);
+    printf("Percent vpravo (RIGHT) = 100 - UP - DOWN - LEFT, body so suctom nad 100 sa vynechaju.\n");
+    sw->reps = menu_read_uint("Replikacie R v kazdom bode", 1, 1000000, 1000);
+    sw->seed = menu_read_uint("Seed (0=auto)", 0, 0xFFFFFFFFu, 0);
+    sw->boundary = (uint8_t)menu_read_uint("Okraj (0=torus, 1=odraz, 2=pohltenie)", 0, 2, 0);
+    sw->crn = (uint8_t)menu_read_uint("Spolocne nahodne cisla pre vsetky body (0=nie, 1=ano)", 0, 1, 1);
+}
+
 /**
  * @brief Vstupný bod klientskej aplikácie.
  *
  * Spracúva argumenty príkazového riadka:
  * - argv[1]: IP adresa alebo hostname servera (predvolené: 127.0.0.1)
  * - argv[2]: Číslo portu servera (predvolené: 5555)
+ * - argv[3]: Politika odosielania servera: "latency" (predvolené) alebo "throughput"
+ *
+ * Alebo --replay FILE [--speed N] [--rep R]: prehrá trajektórie zo súboru
+ * (N krokov za sekundu, 0 = bez čakania; R = iba jedna replikácia) bez servera.
  *
  * Spúšťa vlákno pre príjem správ a hlavnú slučku s menu.
  *
  * @param argc Počet argumentov.
  * @param argv Pole argumentov.
- * @return Vždy vráti 0.
+ * @return 0 pri úspechu, 1 ak sa súbor na prehranie nedá prečítať.
  */
 int main(int argc, char** argv) {
+    if (argc >= 3 && strcmp(argv[1], "--replay") == 0) {
+        uint32_t rate = 0, rep = 0;
+        for (int i = 3; i + 1 < argc; i += 2) {
+            if (strcmp(argv[i], "--speed") == 0) rate = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+            else if (strcmp(argv[i], "--rep") == 0) rep = (uint32_t)strtoul(argv[i + 1], NULL, 10);
+        }
+        return (client_replay(argv[2], rep, rate) == 0) ? 0 : 1;
+    }
+
     const char* host = "127.0.0.1";
     uint16_t port = 5555;
 
     if (argc >= 2) host = argv[1];
     if (argc >= 3) port = (uint16_t)atoi(argv[2]);
+    int policy = NET_POLICY_LATENCY;
+    if (argc >= 4 && strcmp(argv[3], "throughput") == 0) policy = NET_POLICY_THROUGHPUT;
 
     client_ctx_t ctx;
     memset(&ctx, 0, sizeof(ctx));
@@ -44,6 +126,7 @@ int main(int argc, char** argv) {
     ctx.running = 1;
     ctx.host = host;
     ctx.port = port;
+    ctx.net_policy = policy;
 
     pthread_mutex_init(&ctx.mtx, NULL);
 
@@ -66,26 +149,34 @@ int main(int argc, char** argv) {
             // Prázdny vstup (len Enter) - zobraz menu znova
             continue;
         } else if (choice == 1) {
-            int w = menu_read_int("Sirka W", 2, 2000, 10);
-            int h = menu_read_int("Vyska H", 2, 2000, 10);
-            unsigned k = menu_read_uint("Max kroky K", 1, 1000000, 200);
-            unsigned r = menu_read_uint("Replikacie R", 1, 1000000, 5);
-            unsigned seed = menu_read_uint("Seed (0=auto)", 0, 0xFFFFFFFFu, 0);
-
-            uint8_t pu, pd, pl, pr;
-            menu_read_dir_percents(&pu, &pd, &pl, &pr);
+            msg_start_t s;
+            read_start_params(&s);
 
             /* spawn=1 -> vytvor server proces */
-            if (client_start_simulation(&ctx, 1,
-                (int32_t)w, (int32_t)h,
-                (uint32_t)k, (uint32_t)r,
-                (uint32_t)seed, pu, pd, pl, pr) == 0) {
+            if (client_start_simulation(&ctx, 1, &s) == 0) {
                 printf("\n[client] Simulacia spustena, stavy sa zobrazuju nizssie...\n");
                 printf("[client] Pockat kym dobehne, alebo pokracovat v menu.\n\n");
             }
         } else if (choice == 2) {
             (void)client_connect_only(&ctx);
 
+        } else if (choice == 4) {
+            unsigned id = menu_read_uint("Cislo relacie (0=najnovsia bezi)", 0, 0xFFFFFFFFu, 0);
+            (void)client_subscribe(&ctx, (uint32_t)id);
+
+        } else if (choice == 5) {
+            msg_start_t s;
+            int same = ctx.has_last_start &&
+                       menu_read_uint("Pokracovat v poslednej simulacii (1=ano, 0=zadat parametre)", 0, 1, 1);
+            if (same) s = ctx.last_start;
+            else read_start_params(&s);
+            (void)client_resume(&ctx, &s);
+
+        } else if (choice == 6) {
+            msg_sweep_t sw;
+            read_sweep_params(&sw);
+            (void)client_sweep(&ctx, &sw);
+
         } else if (choice == 3) {
             (void)client_quit_server_and_close(&ctx);
             ctx.running = 0;
@@ -99,6 +190,8 @@ int main(int argc, char** argv) {
 
     pthread_mutex_destroy(&ctx.mtx);
     if (ctx.fd >= 0) close(ctx.fd);
+    free(ctx.grid_p);
+    free(ctx.grid_mean);
 
     return 0;
 }
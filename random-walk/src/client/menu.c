@@ -23,10 +23,13 @@ static int read_line(char* buf, size_t cap) {
  * 1 - Spustenie novej simulácie (server + START)
  * 2 - Pripojenie sa k existujúcej simulácii
  * 3 - Ukončenie aplikácie
+ * 4 - Sledovanie behov iného klienta (MSG_SUBSCRIBE)
+ * 5 - Pokračovanie prerušenej simulácie z checkpointu (MSG_RESUME)
+ * 6 - Prechod mriežkou parametrov (MSG_SWEEP)
  *
  * Prázdny vstup (iba Enter) vráti 0 a zobrazí menu znova.
  *
- * @return Číslo zvolenej voľby (0-3) alebo 3 pri EOF.
+ * @return Číslo zvolenej voľby (0-6) alebo 3 pri EOF.
  */
 int menu_read_choice(void) {
     char line[64];
@@ -34,6 +37,9 @@ int menu_read_choice(void) {
     printf("1) Nova simulacia (spawn server + START)\n");
     printf("2) Pripojit sa k simulacii (iba connect)\n");
     printf("3) Koniec\n");
+    printf("4) Sledovat simulaciu ineho klienta\n");
+    printf("5) Pokracovat v prerusenej simulacii (RESUME)\n");
+    printf("6) Prechod mriezkou parametrov (SWEEP)\n");
     printf("Volba: ");
     fflush(stdout);
 
@@ -80,34 +86,67 @@ int menu_read_int(const char* prompt, int minv, int maxv, int def) {
     }
 }
 
+/**
+ * @brief Číta desatinné číslo z vstupu s overením rozsahu.
+ *
+ * Prázdny vstup (Enter) vráti predvolenú hodnotu.
+ *
+ * @param prompt Text výzvy na zobrazenie.
+ * @param minv Minimálna prípustná hodnota (vrátane).
+ * @param maxv Maximálna prípustná hodnota (vrátane).
+ * @param def Predvolená hodnota pri prázdnom vstupe.
+ * @return Prečítaná a overená hodnota.
+ */
+double menu_read_double(const char* prompt, double minv, double maxv, double def) {
+    char line[128];
+    for (;;) {
+        printf("%s [%g..%g] (enter=%g): ", prompt, minv, maxv, def);
+        fflush(stdout);
+
+        if (read_line(line, sizeof(line)) != 0) return def;
+        if (line[0] == 0) return def;
+
+        errno = 0;
+        char* end = NULL;
+        double v = strtod(line, &end);
+        if (errno != 0 || end == line || *end != 0) {
+            printf("Zla hodnota.\n");
+            continue;
+        }
+        if (!(v >= minv && v <= maxv)) {
+            printf("Mimo rozsah.\n");
+            continue;
+        }
+        return v;
+    }
+}
+
 /**
  * @brief Číta pravdepodobnosti pohybu v štyroch smeroch.
  *
- * Opakuje vstup, kým suma všetkých pravdepodobností nebudú 100%.
- * Každý smer sa číta ako hodnota 0-100.
+ * Opakuje vstup, kým suma všetkých pravdepodobností nebude 100%.
+ * Každý smer sa číta ako percento 0-100, aj desatinné (napr. 12.5).
+ * Výsledok sa prevedie na pevnú rádovú čiarku 1/PROB_ONE; celé percentá
+ * sa vrátia zaokrúhlené (len na výpis a spätnú kompatibilitu).
  *
- * @param up Ukazovateľ na výstupnú hodnotu pre pohyb hore (UP).
- * @param down Ukazovateľ na výstupnú hodnotu pre pohyb dole (DOWN).
- * @param left Ukazovateľ na výstupnú hodnotu pre pohyb vľavo (LEFT).
- * @param right Ukazovateľ na výstupnú hodnotu pre pohyb vpravo (RIGHT).
+ * @param q Výstupné pravdepodobnosti UP, DOWN, LEFT, RIGHT v 1/PROB_ONE.
+ * @param pct Výstupné zaokrúhlené percentá UP, DOWN, LEFT, RIGHT.
  */
-void menu_read_dir_percents(uint8_t* up, uint8_t* down, uint8_t* left, uint8_t* right) {
+void menu_read_dir_probs(uint32_t q[4], uint8_t pct[4]) {
     for (;;) {
-        unsigned u = menu_read_uint("Percent hore (UP)", 0, 100, 25);
-        unsigned d = menu_read_uint("Percent dole (DOWN)", 0, 100, 25);
-        unsigned l = menu_read_uint("Percent vlavo (LEFT)", 0, 100, 25);
-        unsigned r = menu_read_uint("Percent vpravo (RIGHT)", 0, 100, 25);
-
-        unsigned sum = u + d + l + r;
-        if (sum != 100) {
-            printf("Chyba: sucet percent musi byt 100 (teraz %u). Skus znova.\n", sum);
+        double p[4];
+        p[0] = menu_read_double("Percent hore (UP)", 0.0, 100.0, 25.0);
+        p[1] = menu_read_double("Percent dole (DOWN)", 0.0, 100.0, 25.0);
+        p[2] = menu_read_double("Percent vlavo (LEFT)", 0.0, 100.0, 25.0);
+        p[3] = menu_read_double("Percent vpravo (RIGHT)", 0.0, 100.0, 25.0);
+
+        if (proto_probs_from_percents(p, q) != 0) {
+            printf("Chyba: sucet percent musi byt 100 (teraz %g). Skus znova.\n",
+                   p[0] + p[1] + p[2] + p[3]);
             continue;
         }
 
-        *up = (uint8_t)u;
-        *down = (uint8_t)d;
-        *left = (uint8_t)l;
-        *right = (uint8_t)r;
+        for (int i = 0; i < 4; i++) pct[i] = (uint8_t)(p[i] + 0.5);
         return;
     }
 }
@@ -149,3 +188,110 @@ unsigned menu_read_uint(const char* prompt, unsigned minv, unsigned maxv, unsign
     }
 }
 
+
+/**
+ * @brief Číta režim časovania krokov simulácie.
+ *
+ * Režimy: 0 = živé demo (100 ms pauza po kroku), 1 = turbo (bez pauzy),
+ * 2 = pevná frekvencia v Hz (vtedy sa pýta aj na frekvenciu).
+ *
+ * @param mode Ukazovateľ na výstupný režim (pace_mode_t).
+ * @param rate_hz Ukazovateľ na výstupnú frekvenciu (0 ak sa nepoužíva).
+ */
+void menu_read_pacing(uint8_t* mode, uint32_t* rate_hz) {
+    unsigned m = menu_read_uint("Tempo (0=live 100ms, 1=turbo, 2=pevne Hz)", 0, 2, 0);
+    *mode = (uint8_t)m;
+    *rate_hz = 0;
+    if (m == 2) {
+        *rate_hz = menu_read_uint("Frekvencia krokov (Hz)", 1, 1000000, 10);
+    }
+}
+
+/**
+ * @brief Prečíta číslo z časti riadka a posunie ukazovateľ za neho.
+ *
+ * @param p Ukazovateľ na aktuálnu pozíciu v riadku.
+ * @param out Výstupná hodnota.
+ * @return 0 pri úspechu, -1 ak tam nie je číslo.
+ */
+static int parse_u32(const char** p, uint32_t* out) {
+    while (**p == ' ') (*p)++;
+    if (**p < '0' || **p > '9') return -1;
+    errno = 0;
+    char* end = NULL;
+    unsigned long v = strtoul(*p, &end, 10);
+    if (errno != 0 || v > 0xFFFFFFFFul) return -1;
+    *p = end;
+    while (**p == ' ') (*p)++;
+    *out = (uint32_t)v;
+    return 0;
+}
+
+/**
+ * @brief Číta hodnoty jednej osi prechodu mriežkou (MSG_SWEEP).
+ *
+ * Zápis: "10" (jedna hodnota), "10..50" alebo "10..50/10" (rozsah s krokom,
+ * predvolene 1), "10,20,40" (zoznam najviac SWEEP_LIST_MAX hodnôt).
+ * Prázdny vstup (Enter) vráti predvolenú hodnotu.
+ *
+ * @param prompt Text výzvy na zobrazenie.
+ * @param minv Minimálna prípustná hodnota (vrátane).
+ * @param maxv Maximálna prípustná hodnota (vrátane).
+ * @param def Predvolená hodnota pri prázdnom vstupe.
+ * @param a Výstupná os.
+ */
+void menu_read_sweep_axis(const char* prompt, uint32_t minv, uint32_t maxv, uint32_t def, msg_sweep_axis_t* a) {
+    char line[256];
+    for (;;) {
+        printf("%s [%u..%u] (napr. 10 | 10..50/10 | 10,20,40; enter=%u): ",
+               prompt, (unsigned)minv, (unsigned)maxv, (unsigned)def);
+        fflush(stdout);
+
+        memset(a, 0, sizeof(*a));
+        a->first = def;
+        if (read_line(line, sizeof(line)) != 0) return;
+        if (line[0] == 0) return;
+
+        const char* p = line;
+        uint32_t v[SWEEP_LIST_MAX];
+        uint32_t n = 0;
+        int ok = (parse_u32(&p, &v[n++]) == 0);
+        uint32_t last = v[0], step = 0;
+        if (ok && p[0] == '.' && p[1] == '.') {
+            p += 2;
+            step = 1;
+            ok = (parse_u32(&p, &last) == 0);
+            if (ok && *p == '/') {
+                p++;
+                ok = (parse_u32(&p, &step) == 0 && step > 0);
+            }
+            ok = ok && last >= v[0] && (last - v[0]) / step < SWEEP_AXIS_MAX;
+        } else {
+            while (ok && *p == ',') {
+                p++;
+                ok = (n < SWEEP_LIST_MAX && parse_u32(&p, &v[n++]) == 0);
+            }
+        }
+        if (!ok || *p != 0) {
+            printf("Zla hodnota.\n");
+            continue;
+        }
+
+        int in_range = (v[0] >= minv && last <= maxv);
+        for (uint32_t i = 0; i < n; i++) in_range = in_range && v[i] >= minv && v[i] <= maxv;
+        if (!in_range) {
+            printf("Mimo rozsah.\n");
+            continue;
+        }
+
+        if (n > 1) {
+            a->count = (uint8_t)n;
+            for (uint32_t i = 0; i < n; i++) a->list[i] = v[i];
+        } else {
+            a->first = v[0];
+            a->last = last;
+            a->step = step;
+        }
+        return;
+    }
+}
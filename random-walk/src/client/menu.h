@@ -13,6 +13,8 @@
 #include <limits.h>
 #include <stdint.h>
 
+#include "protocol.h"
+
 /**
  * @brief Prečíta celočíselnú hodnotu v zadanom rozsahu.
  *
@@ -41,18 +43,48 @@ unsigned menu_read_uint(const char* prompt, unsigned minv, unsigned maxv, unsign
 /**
  * @brief Zobrazí hlavné menu a vráti používateľovu voľbu.
  *
- * @return Číslo zvolenej možnosti (1-3), alebo 3 pri chybe.
+ * @return Číslo zvolenej možnosti (1-4), alebo 3 pri chybe.
  */
 int menu_read_choice(void);
 
 /**
- * @brief Prečíta pravdepodobnosti pohybu v percentách pre všetky smery.
+ * @brief Prečíta desatinné číslo v zadanom rozsahu.
+ *
+ * @param prompt Text výzvy zobrazený používateľovi.
+ * @param minv Minimálna povolená hodnota.
+ * @param maxv Maximálna povolená hodnota.
+ * @param def Predvolená hodnota pri prázdnom vstupe.
+ * @return Prečítaná hodnota v rozsahu [minv, maxv].
+ */
+double menu_read_double(const char* prompt, double minv, double maxv, double def);
+
+/**
+ * @brief Prečíta pravdepodobnosti pohybu v percentách (aj desatinných) pre všetky smery.
  *
  * Funkcia opakuje výzvy, kým používateľ nezadá hodnoty, ktorých súčet je 100.
  *
- * @param up Výstupný parameter pre pravdepodobnosť pohybu hore (%).
- * @param down Výstupný parameter pre pravdepodobnosť pohybu dole (%).
- * @param left Výstupný parameter pre pravdepodobnosť pohybu doľava (%).
- * @param right Výstupný parameter pre pravdepodobnosť pohybu doprava (%).
+ * @param q Výstupné pravdepodobnosti UP, DOWN, LEFT, RIGHT v jednotkách 1/PROB_ONE.
+ * @param pct Výstupné zaokrúhlené percentá UP, DOWN, LEFT, RIGHT (len na výpis).
+ */
+void menu_read_dir_probs(uint32_t q[4], uint8_t pct[4]);
+
+/**
+ * @brief Prečíta režim časovania krokov (live / turbo / pevná frekvencia).
+ *
+ * @param mode Výstupný parameter pre režim (pace_mode_t).
+ * @param rate_hz Výstupný parameter pre frekvenciu v Hz (0 ak nie je pevná).
+ */
+void menu_read_pacing(uint8_t* mode, uint32_t* rate_hz);
+
+/**
+ * @brief Prečíta hodnoty jednej osi prechodu mriežkou (MSG_SWEEP).
+ *
+ * Jedna hodnota, rozsah "first..last/step" alebo zoznam "a,b,c".
+ *
+ * @param prompt Text výzvy zobrazený používateľovi.
+ * @param minv Minimálna povolená hodnota.
+ * @param maxv Maximálna povolená hodnota.
+ * @param def Predvolená hodnota pri prázdnom vstupe.
+ * @param a Výstupná os.
  */
-void menu_read_dir_percents(uint8_t* up, uint8_t* down, uint8_t* left, uint8_t* right);
\ No newline at end of file
+void menu_read_sweep_axis(const char* prompt, uint32_t minv, uint32_t maxv, uint32_t def, msg_sweep_axis_t* a);
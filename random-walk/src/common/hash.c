@@ -0,0 +1,15 @@
+/**
+ * @file hash.c
+ * @brief Implementácia FNV-1a hašu.
+ */
+
+#include "hash.h"
+
+uint64_t fnv1a(uint64_t h, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    for (size_t i = 0; i < len; i++) {
+        h ^= p[i];
+        h *= 1099511628211ULL;
+    }
+    return h;
+}
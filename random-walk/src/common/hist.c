@@ -0,0 +1,51 @@
+/**
+ * @file hist.c
+ * @brief Implementácia rozloženia košov log-lineárneho histogramu.
+ */
+
+#include "hist.h"
+
+#include <math.h>
+
+uint32_t hist_low_bits(uint32_t i, uint32_t bits) {
+    if (i < (2u << bits)) return i;
+    uint32_t shift = (i >> bits) - 1u;
+    return (i - (shift << bits)) << shift;
+}
+
+uint32_t hist_high_bits(uint32_t i, uint32_t bits) {
+    if (i < (2u << bits)) return i;
+    uint32_t shift = (i >> bits) - 1u;
+    /* najvyšší kôš končí presne na UINT32_MAX, súčet nepretečie */
+    return hist_low_bits(i, bits) + ((1u << shift) - 1u);
+}
+
+uint32_t hist_low(uint32_t i) {
+    return hist_low_bits(i, STEP_HIST_SUB_BITS);
+}
+
+uint32_t hist_high(uint32_t i) {
+    return hist_high_bits(i, STEP_HIST_SUB_BITS);
+}
+
+uint32_t hist_quantile_bits(const uint32_t* counts, uint32_t n_buckets, uint32_t bits, double q) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < n_buckets; i++) total += counts[i];
+    if (total == 0) return 0;
+
+    if (q < 0.0) q = 0.0;
+    if (q > 1.0) q = 1.0;
+    uint64_t rank = (uint64_t)ceil(q * (double)total);
+    if (rank == 0) rank = 1;
+
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < n_buckets; i++) {
+        seen += counts[i];
+        if (seen >= rank) return hist_high_bits(i, bits);
+    }
+    return hist_high_bits(n_buckets - 1u, bits);
+}
+
+uint32_t hist_quantile(const uint32_t* counts, uint32_t n_buckets, double q) {
+    return hist_quantile_bits(counts, n_buckets, STEP_HIST_SUB_BITS, q);
+}
@@ -1,5 +1,9 @@
 #include "net.h"
 
+#include <fcntl.h>        // fcntl(), O_NONBLOCK
+#include <netinet/in.h>   // IPPROTO_TCP
+#include <netinet/tcp.h>  // TCP_NODELAY, TCP_CORK
+
 /**
  * @brief Nastaví voľbu SO_REUSEADDR na sockete.
  *
@@ -63,10 +67,14 @@ int net_listen(uint16_t port, int backlog) {
  * Vráti nový file descriptor, cez ktorý sa komunikuje s konkrétnym klientom.
  *
  * @param listen_fd File descriptor počúvajúceho socketu.
+ * @param policy Politika odosielania nového spojenia (net_policy_t).
  * @return File descriptor klientského socketu, alebo -1 pri chybe.
  */
-int net_accept(int listen_fd) {
-    return accept(listen_fd, NULL, NULL);
+int net_accept(int listen_fd, int policy) {
+    int fd = accept(listen_fd, NULL, NULL);
+    // politika nie je kritická - spojenie funguje aj bez nej
+    if (fd >= 0) (void)net_set_policy(fd, policy);
+    return fd;
 }
 
 /**
@@ -83,11 +91,12 @@ int net_accept(int listen_fd) {
  *
  * @param host Názov hostiteľa alebo IP adresa.
  * @param port Port servera (host byte order).
+ * @param policy Politika odosielania spojenia (net_policy_t).
  * @return File descriptor pripojeného socketu, alebo -1 pri chybe.
  *
  * @note Ak getaddrinfo zlyhá, vracia -1. (Neodlišujeme typ chyby, je to OK pre skeleton.)
  */
-int net_connect(const char* host, uint16_t port) {
+int net_connect(const char* host, uint16_t port, int policy) {
     struct addrinfo hints;
     memset(&hints, 0, sizeof(hints));
     hints.ai_family = AF_INET;       // IPv4
@@ -116,9 +125,49 @@ int net_connect(const char* host, uint16_t port) {
     }
 
     freeaddrinfo(res);
+    if (fd >= 0) (void)net_set_policy(fd, policy);
     return fd;
 }
 
+/**
+ * @brief Nastaví politiku odosielania (TCP_NODELAY / TCP_CORK).
+ *
+ * TCP_CORK je špecifický pre Linux; inde sa priepustnosť rieši iba
+ * vypnutím TCP_NODELAY (Nagle skladá malé zápisy).
+ *
+ * @param fd Socket file descriptor.
+ * @param policy Politika (net_policy_t).
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int net_set_policy(int fd, int policy) {
+    int thr = (policy == NET_POLICY_THROUGHPUT) ? 1 : 0;
+    int nodelay = !thr;
+    int rc = 0;
+
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &nodelay, sizeof(nodelay)) != 0) rc = -1;
+#ifdef TCP_CORK
+    if (setsockopt(fd, IPPROTO_TCP, TCP_CORK, &thr, sizeof(thr)) != 0) rc = -1;
+#endif
+    return rc;
+}
+
+/**
+ * @brief Odošle zadržané dáta: TCP_CORK vypne a hneď znovu zapne.
+ *
+ * @param fd Socket file descriptor.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int net_flush(int fd) {
+#ifdef TCP_CORK
+    int off = 0, on = 1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_CORK, &off, sizeof(off)) != 0) return -1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_CORK, &on, sizeof(on)) != 0) return -1;
+#else
+    (void)fd;
+#endif
+    return 0;
+}
+
 /**
  * @brief Pošle presne len bajtov (v prípade potreby opakovane volá send()).
  *
@@ -147,6 +196,86 @@ int net_send_all(int fd, const void* buf, size_t len) {
     return 0;
 }
 
+/**
+ * @brief Pošle všetky bajty z poľa bufferov (opakovane volá sendmsg()).
+ *
+ * Po čiastočnom odoslaní preskočí celé odoslané buffery a posunie začiatok
+ * prvého neodoslaného. EINTR sa ošetruje ako v net_send_all().
+ *
+ * @param fd Socket file descriptor.
+ * @param iov Pole bufferov (mení sa).
+ * @param iovcnt Počet bufferov.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int net_sendv_all(int fd, struct iovec* iov, int iovcnt) {
+    // prázdne buffery na začiatku preskoč (sendmsg by vrátil 0)
+    while (iovcnt > 0 && iov->iov_len == 0) {
+        iov++;
+        iovcnt--;
+    }
+
+    while (iovcnt > 0) {
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)iovcnt;
+
+        ssize_t n = sendmsg(fd, &msg, 0);
+        if (n < 0) {
+            if (errno == EINTR) continue; // prerušené signálom -> skús znovu
+            return -1;
+        }
+        if (n == 0) return -1; // peer zatvoril / nič sa neposlalo
+
+        size_t left = (size_t)n;
+        while (iovcnt > 0 && left >= iov->iov_len) {
+            left -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (unsigned char*)iov->iov_base + left;
+            iov->iov_len -= left;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Nastaví O_NONBLOCK na sockete (zachová ostatné príznaky).
+ *
+ * @param fd Socket file descriptor.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+int net_set_nonblocking(int fd) {
+    int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0) return -1;
+    return fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+/**
+ * @brief Jedno recv() s MSG_DONTWAIT.
+ *
+ * EAGAIN/EWOULDBLOCK znamená, že dáta zatiaľ neprišli (vráti 0), recv() = 0
+ * znamená, že peer ukončil spojenie (vráti -1).
+ *
+ * @param fd Socket file descriptor.
+ * @param buf Buffer pre prijaté dáta.
+ * @param len Kapacita bufferu.
+ * @return Počet prijatých bajtov, 0 ak nie je čo čítať, -1 pri chybe.
+ */
+int net_recv_some(int fd, void* buf, size_t len) {
+    for (;;) {
+        ssize_t n = recv(fd, buf, len, MSG_DONTWAIT);
+        if (n > 0) return (int)n;
+        if (n == 0) return -1; // peer ukončil spojenie
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+        return -1;
+    }
+}
+
 /**
  * @brief Prijme presne len bajtov (v prípade potreby opakovane volá recv()).
  *
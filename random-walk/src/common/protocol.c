@@ -1,5 +1,7 @@
 #include "protocol.h"
 
+#include <math.h>
+
 
 /**
  * @brief Odošle jednu správu protokolu cez socket.
@@ -8,6 +10,9 @@
  *   1) msg_header_t (type + length)
  *   2) payload (len bajtov), ak len > 0
  *
+ * Hlavička aj payload sa odošlú spolu jedným sendmsg() (net_sendv_all),
+ * nie dvoma samostatnými send().
+ *
  * Hodnoty type a length sa posielajú v network byte order, aby to fungovalo
  * konzistentne na rôznych architektúrach.
  *
@@ -23,15 +28,14 @@ int proto_send(int fd, msg_type_t type, const void* payload, uint32_t len) {
     h.type = htonl((uint32_t)type); // host -> network byte order
     h.length = htonl(len);
 
-    // Najprv odošli hlavičku
-    if (net_send_all(fd, &h, sizeof(h)) != 0) return -1;
-
-    // Ak existuje payload, odošli ho
-    if (len > 0 && payload != NULL) {
-        if (net_send_all(fd, payload, len) != 0) return -1;
-    }
+    // Hlavička + payload v jednom volaní
+    struct iovec iov[2];
+    iov[0].iov_base = &h;
+    iov[0].iov_len = sizeof(h);
+    iov[1].iov_base = (void*)payload;
+    iov[1].iov_len = (len > 0 && payload != NULL) ? len : 0;
 
-    return 0;
+    return net_sendv_all(fd, iov, 2);
 }
 
 /**
@@ -76,3 +80,114 @@ int proto_recv(int fd, msg_type_t* out_type, void* payload_buf, uint32_t buf_cap
 
     return 0;
 }
+
+/**
+ * @brief Inicializuje prázdny parser.
+ *
+ * @param p Parser.
+ */
+void proto_parser_init(proto_parser_t* p) {
+    p->have = 0;
+    p->off = 0;
+}
+
+/**
+ * @brief Odsunie spracované bajty a vráti voľné miesto na konci bufferu.
+ *
+ * @param p Parser.
+ * @param room Výstup: počet voľných bajtov.
+ * @return Ukazovateľ na voľné miesto.
+ */
+void* proto_parser_space(proto_parser_t* p, uint32_t* room) {
+    if (p->off > 0) {
+        memmove(p->buf, p->buf + p->off, p->have - p->off);
+        p->have -= p->off;
+        p->off = 0;
+    }
+    *room = PROTO_PARSER_BYTES - p->have;
+    return p->buf + p->have;
+}
+
+/**
+ * @brief Potvrdí n nových bajtov v bufferi.
+ *
+ * @param p Parser.
+ * @param n Počet bajtov.
+ */
+void proto_parser_commit(proto_parser_t* p, uint32_t n) {
+    p->have += n;
+}
+
+/**
+ * @brief Vyberie ďalšiu celú správu (hlavička + payload) z bufferu.
+ *
+ * Dĺžka z hlavičky sa overí hneď, takže správa, ktorá by sa do bufferu
+ * nikdy nezmestila, je chyba ešte pred príchodom payloadu.
+ *
+ * @param p Parser.
+ * @param out_type Výstup: typ správy.
+ * @param out_payload Výstup: ukazovateľ na payload v bufferi.
+ * @param out_len Výstup: dĺžka payloadu.
+ * @return 1 pri celej správe, 0 ak treba ďalšie bajty, -1 pri príliš dlhej správe.
+ */
+int proto_parser_next(proto_parser_t* p, msg_type_t* out_type, const void** out_payload, uint32_t* out_len) {
+    uint32_t avail = p->have - p->off;
+    if (avail < sizeof(msg_header_t)) return 0;
+
+    msg_header_t h;
+    memcpy(&h, p->buf + p->off, sizeof(h));
+    uint32_t len = ntohl(h.length);
+    if (len > PROTO_PARSER_BYTES - sizeof(msg_header_t)) return -1;
+    if (avail < sizeof(msg_header_t) + len) return 0;
+
+    *out_type = (msg_type_t)ntohl(h.type);
+    *out_payload = p->buf + p->off + sizeof(msg_header_t);
+    *out_len = len;
+    p->off += (uint32_t)sizeof(msg_header_t) + len;
+    return 1;
+}
+
+/**
+ * @brief Prevedie percentá smerov na pevnú rádovú čiarku (1/PROB_ONE).
+ *
+ * Každé percento sa prepočíta na presnú hodnotu pct * PROB_ONE / 100, zaokrúhli
+ * nadol a chýbajúce jednotky (najviac 3) dostanú smery s najväčším zvyškom.
+ *
+ * @param pct Percentá pre UP, DOWN, LEFT, RIGHT.
+ * @param q Výstupné pravdepodobnosti v jednotkách 1/PROB_ONE.
+ * @return 0 pri úspechu, -1 pri neplatnom vstupe.
+ */
+int proto_probs_from_percents(const double pct[4], uint32_t q[4]) {
+    double sum = 0.0;
+    for (int i = 0; i < 4; i++) {
+        if (!(pct[i] >= 0.0) || pct[i] > 100.0) return -1;
+        sum += pct[i];
+    }
+    if (fabs(sum - 100.0) > 1e-6) return -1;
+
+    double frac[4];
+    uint32_t total = 0;
+    for (int i = 0; i < 4; i++) {
+        double exact = pct[i] * (double)PROB_ONE / 100.0;
+        double fl = floor(exact + 1e-9);
+        q[i] = (uint32_t)fl;
+        frac[i] = exact - fl;
+        total += q[i];
+    }
+
+    /* rozdeľ zvyšok podľa najväčších desatinných častí */
+    while (total < PROB_ONE) {
+        int best = -1;
+        for (int i = 0; i < 4; i++) {
+            if (pct[i] <= 0.0) continue;
+            if (best < 0 || frac[i] > frac[best]) best = i;
+        }
+        if (best < 0) return -1;
+        q[best]++;
+        frac[best] = -1.0;
+        total++;
+    }
+    if (total != PROB_ONE) return -1;
+
+    return 0;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file runlog.c
+ * @brief Implementácia denníka dokončených behov (zápis aj čítanie cez mmap).
+ */
+
+#include "hash.h"
+#include "runlog.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Magické bajty súboru záznamov. */
+#define RUNLOG_MAGIC "RWRUNLOG"
+
+/** Magické bajty súboru indexu. */
+#define RUNLOG_INDEX_MAGIC "RWRUNIDX"
+
+/**
+ * @brief Jeden súbor denníka otvorený na zápis.
+ */
+typedef struct {
+    int fd;                  /**< Otvorený a zamknutý súbor */
+    unsigned char* map;      /**< Namapovaný celý súbor */
+    size_t size;             /**< Veľkosť súboru (a mapy) */
+    uint32_t entry;          /**< Veľkosť záznamu */
+} rl_file_t;
+
+struct runlog {
+    rl_file_t log;           /**< runs.log */
+    rl_file_t idx;           /**< runs.idx */
+    pthread_mutex_t mtx;     /**< Behy sa dokončujú na rôznych vláknach poolu */
+};
+
+uint64_t runlog_config_hash(const runlog_config_t* cfg) {
+    return fnv1a(FNV_OFFSET, cfg, sizeof(*cfg));
+}
+
+/**
+ * @brief Počet platných záznamov z hlavičky v mape.
+ */
+static uint64_t rl_count(const unsigned char* map) {
+    runlog_header_t h;
+    memcpy(&h, map, sizeof(h));
+    return h.count;
+}
+
+/**
+ * @brief Zapíše počet platných záznamov do hlavičky v mape (po zápise záznamu).
+ */
+static void rl_set_count(unsigned char* map, uint64_t count) {
+    atomic_thread_fence(memory_order_release);
+    memcpy(map + offsetof(runlog_header_t, count), &count, sizeof(count));
+}
+
+/**
+ * @brief Skontroluje hlavičku súboru.
+ *
+ * @return 1 ak sedí magic, formát a veľkosť záznamu.
+ */
+static int rl_header_ok(const unsigned char* map, size_t size, const char* magic, uint32_t entry) {
+    if (size < RUNLOG_HEADER_BYTES) return 0;
+    runlog_header_t h;
+    memcpy(&h, map, sizeof(h));
+    if (memcmp(h.magic, magic, sizeof(h.magic)) != 0) return 0;
+    if (h.format != RUNLOG_FORMAT || h.entry_bytes != entry) return 0;
+    return RUNLOG_HEADER_BYTES + h.count * (uint64_t)entry <= size;
+}
+
+/**
+ * @brief Otvorí súbor denníka na zápis, nový založí s hlavičkou.
+ *
+ * @param f Výstup.
+ * @param path Cesta.
+ * @param magic Magické bajty.
+ * @param entry Veľkosť záznamu.
+ * @return 0 pri úspechu, -1 pri chybe (chyba je vypísaná).
+ */
+static int rl_file_open(rl_file_t* f, const char* path, const char* magic, uint32_t entry) {
+    memset(f, 0, sizeof(*f));
+    f->fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (f->fd < 0) {
+        fprintf(stderr, "[server] runlog: cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (flock(f->fd, LOCK_EX | LOCK_NB) != 0) {
+        fprintf(stderr, "[server] runlog: %s is used by another server\n", path);
+        close(f->fd);
+        return -1;
+    }
+    f->entry = entry;
+
+    struct stat st;
+    if (fstat(f->fd, &st) != 0) st.st_size = 0;
+    if (st.st_size == 0) {
+        runlog_header_t h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, magic, sizeof(h.magic));
+        h.format = RUNLOG_FORMAT;
+        h.entry_bytes = entry;
+        st.st_size = (off_t)(RUNLOG_HEADER_BYTES + (size_t)RUNLOG_GROW * entry);
+        if (ftruncate(f->fd, st.st_size) != 0 || pwrite(f->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h)) {
+            fprintf(stderr, "[server] runlog: cannot initialize %s: %s\n", path, strerror(errno));
+            close(f->fd);
+            return -1;
+        }
+    }
+
+    f->size = (size_t)st.st_size;
+    void* map = mmap(NULL, f->size, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[server] runlog: mmap %s failed: %s\n", path, strerror(errno));
+        close(f->fd);
+        return -1;
+    }
+    f->map = (unsigned char*)map;
+    if (!rl_header_ok(f->map, f->size, magic, entry)) {
+        /* históriu nemažeme - iný formát treba presunúť ručne */
+        fprintf(stderr, "[server] runlog: %s has an unknown format, not logging\n", path);
+        munmap(f->map, f->size);
+        close(f->fd);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Zväčší súbor o RUNLOG_GROW záznamov a znova ho namapuje.
+ *
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int rl_file_grow(rl_file_t* f) {
+    size_t size = f->size + (size_t)RUNLOG_GROW * f->entry;
+    if (ftruncate(f->fd, (off_t)size) != 0) return -1;
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, f->fd, 0);
+    if (map == MAP_FAILED) return -1;
+    munmap(f->map, f->size);
+    f->map = (unsigned char*)map;
+    f->size = size;
+    return 0;
+}
+
+/**
+ * @brief Miesto pre záznam číslo i (súbor sa podľa potreby zväčší).
+ *
+ * @return Ukazovateľ do mapy, alebo NULL pri chybe.
+ */
+static unsigned char* rl_slot(rl_file_t* f, uint64_t i) {
+    while (RUNLOG_HEADER_BYTES + (i + 1u) * (uint64_t)f->entry > f->size) {
+        if (rl_file_grow(f) != 0) return NULL;
+    }
+    return f->map + RUNLOG_HEADER_BYTES + i * (uint64_t)f->entry;
+}
+
+/**
+ * @brief Zatvorí súbor denníka.
+ */
+static void rl_file_close(rl_file_t* f) {
+    msync(f->map, f->size, MS_SYNC);
+    munmap(f->map, f->size);
+    close(f->fd);
+}
+
+/**
+ * @brief Položka indexu pre záznam.
+ */
+static runlog_index_t rl_index_entry(const runlog_record_t* rec, uint64_t i) {
+    runlog_config_t cfg = rec->cfg;
+    runlog_index_t e;
+    e.cfg_hash = runlog_config_hash(&cfg);
+    e.t_end_ns = rec->t_end_ns;
+    e.record = i;
+    return e;
+}
+
+runlog_t* runlog_open(const char* dir) {
+    char path[4096];
+    runlog_t* l = calloc(1, sizeof(*l));
+    if (!l) return NULL;
+
+    if (snprintf(path, sizeof(path), "%s/%s", dir, RUNLOG_FILE) >= (int)sizeof(path) ||
+        rl_file_open(&l->log, path, RUNLOG_MAGIC, RUNLOG_RECORD_BYTES) != 0) {
+        free(l);
+        return NULL;
+    }
+    if (snprintf(path, sizeof(path), "%s/%s", dir, RUNLOG_INDEX_FILE) >= (int)sizeof(path) ||
+        rl_file_open(&l->idx, path, RUNLOG_INDEX_MAGIC, (uint32_t)sizeof(runlog_index_t)) != 0) {
+        rl_file_close(&l->log);
+        free(l);
+        return NULL;
+    }
+    pthread_mutex_init(&l->mtx, NULL);
+
+    /* index sa zapisuje po zázname - po páde môže zaostávať, dopočíta sa */
+    uint64_t n = rl_count(l->log.map);
+    uint64_t ni = rl_count(l->idx.map);
+    if (ni > n) {
+        ni = n;
+        rl_set_count(l->idx.map, n);
+    }
+    for (uint64_t i = ni; i < n; i++) {
+        unsigned char* slot = rl_slot(&l->idx, i);
+        if (!slot) break;
+        runlog_index_t e = rl_index_entry((const runlog_record_t*)(l->log.map + RUNLOG_HEADER_BYTES + i * RUNLOG_RECORD_BYTES), i);
+        memcpy(slot, &e, sizeof(e));
+        rl_set_count(l->idx.map, i + 1u);
+    }
+    if (ni < n) printf("[server] runlog: rebuilt %llu index entries\n", (unsigned long long)(n - ni));
+
+    printf("[server] runlog: %s/%s (%llu runs)\n", dir, RUNLOG_FILE, (unsigned long long)n);
+    return l;
+}
+
+int runlog_append(runlog_t* l, runlog_record_t* rec) {
+    pthread_mutex_lock(&l->mtx);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    int64_t t = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+    /* index je zoradený podľa času - ani posun hodín ho nesmie rozhádzať */
+    uint64_t n = rl_count(l->log.map);
+    if (n > 0) {
+        runlog_index_t last;
+        memcpy(&last, l->idx.map + RUNLOG_HEADER_BYTES + (n - 1u) * sizeof(runlog_index_t), sizeof(last));
+        if (t < last.t_end_ns) t = last.t_end_ns;
+    }
+    rec->t_end_ns = t;
+
+    unsigned char* rs = rl_slot(&l->log, n);
+    unsigned char* is = rl_slot(&l->idx, n);
+    if (!rs || !is) {
+        pthread_mutex_unlock(&l->mtx);
+        return -1;
+    }
+    memcpy(rs, rec, sizeof(*rec));
+    rl_set_count(l->log.map, n + 1u);
+    runlog_index_t e = rl_index_entry(rec, n);
+    memcpy(is, &e, sizeof(e));
+    rl_set_count(l->idx.map, n + 1u);
+    pthread_mutex_unlock(&l->mtx);
+    return 0;
+}
+
+void runlog_close(runlog_t* l) {
+    if (!l) return;
+    rl_file_close(&l->idx);
+    rl_file_close(&l->log);
+    pthread_mutex_destroy(&l->mtx);
+    free(l);
+}
+
+/**
+ * @brief Namapuje jeden súbor len na čítanie a overí hlavičku.
+ *
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int rl_map_read(const char* dir, const char* name, const char* magic, uint32_t entry,
+                       const unsigned char** map, size_t* size) {
+    char path[4096];
+    if (snprintf(path, sizeof(path), "%s/%s", dir, name) >= (int)sizeof(path)) return -1;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < RUNLOG_HEADER_BYTES) {
+        close(fd);
+        return -1;
+    }
+    void* m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd); /* mapa platí aj po zatvorení */
+    if (m == MAP_FAILED) return -1;
+    if (!rl_header_ok((const unsigned char*)m, (size_t)st.st_size, magic, entry)) {
+        munmap(m, (size_t)st.st_size);
+        return -1;
+    }
+    *map = (const unsigned char*)m;
+    *size = (size_t)st.st_size;
+    return 0;
+}
+
+int runlog_map(const char* dir, runlog_view_t* v) {
+    memset(v, 0, sizeof(*v));
+    if (rl_map_read(dir, RUNLOG_FILE, RUNLOG_MAGIC, RUNLOG_RECORD_BYTES, &v->log_map, &v->log_size) != 0) return -1;
+    if (rl_map_read(dir, RUNLOG_INDEX_FILE, RUNLOG_INDEX_MAGIC, (uint32_t)sizeof(runlog_index_t),
+                    &v->idx_map, &v->idx_size) != 0) {
+        munmap((void*)v->log_map, v->log_size);
+        return -1;
+    }
+    /* platné je, čo je v oboch súboroch (index sa zapisuje po zázname) */
+    uint64_t n = rl_count(v->log_map);
+    uint64_t ni = rl_count(v->idx_map);
+    v->count = (ni < n) ? ni : n;
+    return 0;
+}
+
+void runlog_unmap(runlog_view_t* v) {
+    if (v->log_map) munmap((void*)v->log_map, v->log_size);
+    if (v->idx_map) munmap((void*)v->idx_map, v->idx_size);
+    memset(v, 0, sizeof(*v));
+}
+
+uint64_t runlog_find_time(const runlog_view_t* v, int64_t t) {
+    uint64_t lo = 0, hi = v->count;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2u;
+        if (runlog_index(v, mid)->t_end_ns < t) lo = mid + 1u;
+        else hi = mid;
+    }
+    return lo;
+}
@@ -0,0 +1,134 @@
+#include "traj.h"
+
+#include <string.h>
+
+/** Dolná hranica stavu rANS; stav je vždy v [RANS_L, RANS_L << 8). */
+#define RANS_L (1u << 23)
+
+/** Počet bitov škály modelu (PROB_ONE = 1 << RANS_SCALE_BITS). */
+#define RANS_SCALE_BITS 16
+
+/**
+ * @brief Zabalí smery po 2 bitoch (4 kroky v bajte, od najnižších bitov).
+ *
+ * @param dirs Smery krokov.
+ * @param count Počet krokov.
+ * @param out Výstupný buffer.
+ * @return Počet zapísaných bajtov.
+ */
+static uint32_t raw_encode(const uint8_t* dirs, uint32_t count, uint8_t* out) {
+    uint32_t n = (count + 3u) / 4u;
+    memset(out, 0, n);
+    for (uint32_t i = 0; i < count; i++) {
+        out[i >> 2] |= (uint8_t)((dirs[i] & 3u) << (2u * (i & 3u)));
+    }
+    return n;
+}
+
+/**
+ * @brief Zakóduje smery cez rANS (bajtová renormalizácia, škála 1/PROB_ONE).
+ *
+ * rANS kóduje odzadu, preto sa výstup píše od konca pomocného bufferu
+ * a na konci sa presunie na začiatok out. Na začiatku výstupu je konečný
+ * stav kódera (4 bajty little endian), dekóder z neho číta dopredu.
+ *
+ * @param dirs Smery krokov.
+ * @param count Počet krokov.
+ * @param q Pravdepodobnosti smerov v 1/PROB_ONE.
+ * @param out Výstupný buffer (aspoň TRAJ_SEG_BYTES_MAX bajtov).
+ * @param limit Najviac bajtov, ktoré sa oplatí vyprodukovať.
+ * @return Počet bajtov, alebo 0 ak by výstup nebol kratší než limit.
+ */
+static uint32_t rans_encode(const uint8_t* dirs, uint32_t count, const uint32_t q[4],
+                            uint8_t* out, uint32_t limit) {
+    uint8_t tmp[TRAJ_SEG_BYTES_MAX];
+    uint8_t* end = tmp + (limit < sizeof(tmp) ? limit : sizeof(tmp));
+    uint8_t* p = end;
+    uint32_t cum[4];
+
+    cum[0] = 0;
+    for (int d = 1; d < 4; d++) cum[d] = cum[d - 1] + q[d - 1];
+
+    uint32_t x = RANS_L;
+    for (uint32_t i = count; i-- > 0;) {
+        uint32_t d = dirs[i] & 3u;
+        uint32_t f = q[d];
+        if (f == 0) return 0; /* smer mimo modelu */
+
+        uint32_t x_max = ((RANS_L >> RANS_SCALE_BITS) << 8) * f;
+        while (x >= x_max) {
+            if (p == tmp) return 0;
+            *--p = (uint8_t)(x & 0xFFu);
+            x >>= 8;
+        }
+        x = ((x / f) << RANS_SCALE_BITS) + (x % f) + cum[d];
+    }
+
+    if (p - tmp < 4) return 0;
+    p -= 4;
+    p[0] = (uint8_t)(x & 0xFFu);
+    p[1] = (uint8_t)((x >> 8) & 0xFFu);
+    p[2] = (uint8_t)((x >> 16) & 0xFFu);
+    p[3] = (uint8_t)(x >> 24);
+
+    uint32_t n = (uint32_t)(end - p);
+    memcpy(out, p, n);
+    return n;
+}
+
+uint32_t traj_encode(const uint8_t* dirs, uint32_t count, const uint32_t q[4],
+                     uint8_t* out, uint8_t* codec) {
+    uint32_t raw_n = (count + 3u) / 4u;
+
+    /* rANS má zmysel iba ak vyjde kratší než 2 bity na krok */
+    if (raw_n > 1) {
+        uint32_t n = rans_encode(dirs, count, q, out, raw_n - 1u);
+        if (n > 0) {
+            *codec = TRAJ_CODEC_RANS;
+            return n;
+        }
+    }
+
+    *codec = TRAJ_CODEC_RAW;
+    return raw_encode(dirs, count, out);
+}
+
+int traj_decode(const uint8_t* data, uint32_t nbytes, uint8_t codec, uint32_t count,
+                const uint32_t q[4], uint8_t* dirs) {
+    if (count == 0 || count > TRAJ_SEG_STEPS) return -1;
+
+    if (codec == TRAJ_CODEC_RAW) {
+        if (nbytes != (count + 3u) / 4u) return -1;
+        for (uint32_t i = 0; i < count; i++) {
+            dirs[i] = (uint8_t)((data[i >> 2] >> (2u * (i & 3u))) & 3u);
+        }
+        return 0;
+    }
+
+    if (codec != TRAJ_CODEC_RANS || nbytes < 4) return -1;
+
+    uint32_t cum[5];
+    cum[0] = 0;
+    for (int d = 0; d < 4; d++) cum[d + 1] = cum[d] + q[d];
+    if (cum[4] != PROB_ONE) return -1;
+
+    uint32_t x = (uint32_t)data[0] | ((uint32_t)data[1] << 8) |
+                 ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+    uint32_t pos = 4;
+
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t s = x & (PROB_ONE - 1u);
+        uint32_t d = 0;
+        while (d < 3 && s >= cum[d + 1]) d++;
+        dirs[i] = (uint8_t)d;
+
+        x = q[d] * (x >> RANS_SCALE_BITS) + s - cum[d];
+        while (x < RANS_L) {
+            if (pos >= nbytes) return -1;
+            x = (x << 8) | data[pos++];
+        }
+    }
+
+    /* kóder začínal v RANS_L a všetky bajty musia byť spotrebované */
+    return (x == RANS_L && pos == nbytes) ? 0 : -1;
+}
@@ -0,0 +1,214 @@
+/**
+ * @file trajfile.c
+ * @brief Implementácia zápisu a čítania súborov trajektórií.
+ */
+
+#include "trajfile.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+/** Magické bajty súboru. */
+#define TRAJFILE_MAGIC "RWTRAJF"
+
+struct trajfile {
+    int fd;                  /**< Otvorený súbor */
+    atomic_ullong end;       /**< Koniec zapísaných dát (ďalší záznam) */
+    atomic_uint written;     /**< Počet zapísaných replikácií */
+    atomic_int failed;       /**< 1 ak niektorý zápis zlyhal */
+    trajfile_header_t hdr;   /**< Hlavička (zapíše sa pri zatvorení) */
+    uint64_t* index;         /**< Posun záznamu každej replikácie (0 = nezapísaná) */
+};
+
+/**
+ * @brief Zapíše celý buffer na daný posun.
+ *
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int write_at(int fd, const void* buf, size_t len, uint64_t off) {
+    const unsigned char* p = (const unsigned char*)buf;
+    while (len > 0) {
+        ssize_t n = pwrite(fd, p, len, (off_t)off);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+        off += (uint64_t)n;
+    }
+    return 0;
+}
+
+trajfile_t* trajfile_create(const char* path, const msg_traj_info_t* info, uint32_t k_max, uint32_t seed) {
+    trajfile_t* f = calloc(1, sizeof(*f));
+    if (!f) return NULL;
+    f->index = calloc(info->reps > 0 ? info->reps : 1u, sizeof(uint64_t));
+    f->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (!f->index || f->fd < 0) {
+        fprintf(stderr, "[server] traj file: cannot create %s: %s\n", path, strerror(errno));
+        if (f->fd >= 0) close(f->fd);
+        free(f->index);
+        free(f);
+        return NULL;
+    }
+
+    memcpy(f->hdr.magic, TRAJFILE_MAGIC, sizeof(TRAJFILE_MAGIC));
+    f->hdr.format = TRAJFILE_FORMAT;
+    f->hdr.header_bytes = TRAJFILE_HEADER_BYTES;
+    f->hdr.info = *info;
+    f->hdr.k_max = k_max;
+    f->hdr.seed = seed;
+    atomic_init(&f->end, TRAJFILE_HEADER_BYTES);
+    atomic_init(&f->written, 0);
+    atomic_init(&f->failed, 0);
+
+    /* hlavička bez indexu hneď - aj nedokončený súbor sa dá prehrať */
+    if (write_at(f->fd, &f->hdr, sizeof(f->hdr), 0) != 0) atomic_store(&f->failed, 1);
+    return f;
+}
+
+int trajfile_append(trajfile_t* f, const trajfile_rep_t* rep, const void* segs, uint32_t len) {
+    if (rep->rep == 0 || rep->rep > f->hdr.info.reps) return -1;
+    uint64_t total = sizeof(*rep) + (uint64_t)len;
+    uint64_t off = atomic_fetch_add(&f->end, total);
+
+    struct iovec iov[2];
+    iov[0].iov_base = (void*)rep;
+    iov[0].iov_len = sizeof(*rep);
+    iov[1].iov_base = (void*)segs;
+    iov[1].iov_len = len;
+    ssize_t n;
+    do {
+        n = pwritev(f->fd, iov, 2, (off_t)off);
+    } while (n < 0 && errno == EINTR);
+    /* krátky zápis dopíšeme po kúskoch */
+    if (n >= 0 && (uint64_t)n < total) {
+        uint64_t done = (uint64_t)n;
+        if (done < sizeof(*rep)) {
+            if (write_at(f->fd, (const unsigned char*)rep + done, sizeof(*rep) - done, off + done) != 0) n = -1;
+            done = sizeof(*rep);
+        }
+        if (n >= 0 && write_at(f->fd, (const unsigned char*)segs + (done - sizeof(*rep)),
+                               total - done, off + done) != 0) n = -1;
+    }
+    if (n < 0) {
+        atomic_store(&f->failed, 1);
+        return -1;
+    }
+
+    /* každú replikáciu zapisuje jediný shard, index sa číta až po behu */
+    f->index[rep->rep - 1u] = off;
+    atomic_fetch_add(&f->written, 1);
+    return 0;
+}
+
+int trajfile_close(trajfile_t* f, uint32_t* reps, uint64_t* bytes) {
+    if (!f) return 0;
+    /* index zarovnaný na 8 B, aby sa dal čítať priamo z mapy */
+    uint64_t off = (atomic_load(&f->end) + 7u) & ~(uint64_t)7u;
+    uint64_t len = (uint64_t)f->hdr.info.reps * sizeof(uint64_t);
+
+    f->hdr.reps_written = atomic_load(&f->written);
+    f->hdr.index_offset = off;
+    int rc = atomic_load(&f->failed) ? -1 : 0;
+    if (rc == 0 && write_at(f->fd, f->index, (size_t)len, off) != 0) rc = -1;
+    if (rc == 0 && write_at(f->fd, &f->hdr, sizeof(f->hdr), 0) != 0) rc = -1;
+
+    if (reps) *reps = f->hdr.reps_written;
+    if (bytes) *bytes = off + len;
+    close(f->fd);
+    free(f->index);
+    free(f);
+    return rc;
+}
+
+/**
+ * @brief Zostaví index prechodom cez záznamy (súbor bez indexu).
+ *
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int build_index(trajfile_view_t* v) {
+    uint32_t reps = v->hdr.info.reps;
+    v->owned = calloc(reps > 0 ? reps : 1u, sizeof(uint64_t));
+    if (!v->owned) return -1;
+
+    uint64_t off = TRAJFILE_HEADER_BYTES;
+    uint32_t found = 0;
+    while (off + sizeof(trajfile_rep_t) <= v->size) {
+        trajfile_rep_t r;
+        memcpy(&r, v->map + off, sizeof(r));
+        /* za posledným úplným záznamom môžu byť nuly alebo rozpísaný záznam */
+        if (r.rep == 0 || r.rep > reps || r.bytes > v->size - off - sizeof(r)) break;
+        v->owned[r.rep - 1u] = off;
+        found++;
+        off += sizeof(r) + r.bytes;
+    }
+    v->hdr.reps_written = found;
+    v->index = (const unsigned char*)v->owned;
+    return 0;
+}
+
+int trajfile_map(const char* path, trajfile_view_t* v) {
+    memset(v, 0, sizeof(*v));
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < TRAJFILE_HEADER_BYTES) {
+        close(fd);
+        return -1;
+    }
+    void* m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return -1;
+    v->map = (const unsigned char*)m;
+    v->size = (size_t)st.st_size;
+    memcpy(&v->hdr, v->map, sizeof(v->hdr));
+
+    const msg_traj_info_t* ti = &v->hdr.info;
+    int ok = memcmp(v->hdr.magic, TRAJFILE_MAGIC, sizeof(TRAJFILE_MAGIC)) == 0 &&
+             v->hdr.format == TRAJFILE_FORMAT && v->hdr.header_bytes == TRAJFILE_HEADER_BYTES &&
+             ti->width > 0 && ti->height > 0 && ti->reps > 0 &&
+             ti->prob_q[0] + ti->prob_q[1] + ti->prob_q[2] + ti->prob_q[3] == PROB_ONE;
+    if (ok) {
+        uint64_t off = v->hdr.index_offset;
+        uint64_t len = (uint64_t)ti->reps * sizeof(uint64_t);
+        if (off >= TRAJFILE_HEADER_BYTES && off <= v->size && len <= v->size - off) {
+            v->index = v->map + off;
+        } else {
+            ok = (build_index(v) == 0);
+        }
+    }
+    if (!ok) {
+        trajfile_unmap(v);
+        return -1;
+    }
+    return 0;
+}
+
+void trajfile_unmap(trajfile_view_t* v) {
+    if (v->map) munmap((void*)v->map, v->size);
+    free(v->owned);
+    memset(v, 0, sizeof(*v));
+}
+
+const trajfile_rep_t* trajfile_find(const trajfile_view_t* v, uint32_t rep, const uint8_t** segs) {
+    if (rep == 0 || rep > v->hdr.info.reps) return NULL;
+    uint64_t off;
+    memcpy(&off, v->index + (size_t)(rep - 1u) * sizeof(uint64_t), sizeof(off));
+    if (off < TRAJFILE_HEADER_BYTES || off > v->size || sizeof(trajfile_rep_t) > v->size - off) return NULL;
+
+    const trajfile_rep_t* r = (const trajfile_rep_t*)(v->map + off);
+    uint32_t bytes = r->bytes;
+    if (r->rep != rep || bytes > v->size - off - sizeof(*r)) return NULL;
+    *segs = v->map + off + sizeof(*r);
+    return r;
+}
@@ -0,0 +1,268 @@
+/**
+ * @file main.c
+ * @brief rwquery - dotazy nad denníkom dokončených behov servera.
+ *
+ * Denník (runs.log, runs.idx v dátovom priečinku servera) sa iba namapuje
+ * a záznamy sa čítajú priamo z mapy. Pri úplnej konfigurácii (-w -h -k -p)
+ * sa prechádza len index (haš konfigurácie), inak všetky záznamy v časovom
+ * rozsahu. Na konci sa vypíše súhrn zlúčený zo všetkých nájdených behov.
+ */
+
+#include "hist.h"
+#include "protocol.h"
+#include "runlog.h"
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Filter dotazu (-1 / NULL = ľubovoľná hodnota).
+ */
+typedef struct {
+    int64_t width;           /**< Šírka sveta */
+    int64_t height;          /**< Výška sveta */
+    int64_t k_max;           /**< Maximálny počet krokov */
+    int has_probs;           /**< 1 ak sú zadané pravdepodobnosti */
+    uint32_t prob_q[4];      /**< Pravdepodobnosti v 1/PROB_ONE */
+    int64_t boundary;        /**< Režim okraja */
+    int64_t seed;            /**< Seed */
+    int64_t since_ns;        /**< Iba behy skončené od tohto času (0 = všetky) */
+} query_t;
+
+/**
+ * @brief Zlúčený súhrn nájdených behov.
+ */
+typedef struct {
+    uint64_t runs;           /**< Počet behov */
+    uint64_t reps;           /**< Dokončené replikácie */
+    uint64_t success;        /**< Úspešné replikácie */
+    uint64_t n;              /**< Počet krokov v momentoch */
+    double mean;             /**< Priemer krokov úspešných */
+    double m2;               /**< Súčet štvorcov odchýlok krokov */
+    uint64_t hist[RUNLOG_HIST_BUCKETS]; /**< Súčet hrubých histogramov */
+} pooled_t;
+
+/**
+ * @brief Vypíše použitie programu.
+ */
+static void usage(const char* prog) {
+    fprintf(stderr,
+            "usage: %s [--data-dir DIR] [-w W] [-h H] [-k K] [-p U,D,L,R] [-b MODE]\n"
+            "          [--seed N] [--since 7d|12h|30m|45s] [--summary]\n", prog);
+}
+
+/**
+ * @brief Prevedie dĺžku obdobia (napr. "7d", "12h") na nanosekundy.
+ *
+ * @return Nanosekundy, alebo -1 pri neplatnom zápise.
+ */
+static int64_t parse_age(const char* s) {
+    char* end = NULL;
+    double v = strtod(s, &end);
+    if (end == s || v < 0.0) return -1;
+    double mul = 1.0;
+    if (*end == 'd') mul = 86400.0;
+    else if (*end == 'h') mul = 3600.0;
+    else if (*end == 'm') mul = 60.0;
+    else if (*end == 's' || *end == '\0') mul = 1.0;
+    else return -1;
+    if (*end != '\0' && end[1] != '\0') return -1;
+    return (int64_t)(v * mul * 1e9);
+}
+
+/**
+ * @brief Prevedie "U,D,L,R" v percentách na prob_q (ako server pri MSG_START).
+ *
+ * @return 0 pri úspechu, -1 pri neplatnom zápise.
+ */
+static int parse_probs(const char* s, uint32_t q[4]) {
+    double p[4];
+    if (sscanf(s, "%lf,%lf,%lf,%lf", &p[0], &p[1], &p[2], &p[3]) != 4) return -1;
+    if (fabs(p[0] + p[1] + p[2] + p[3] - 100.0) > 1e-9) return -1;
+    return proto_probs_from_percents(p, q);
+}
+
+/**
+ * @brief Zistí, či záznam vyhovuje filtru.
+ */
+static int matches(const query_t* qr, const runlog_record_t* r) {
+    if (qr->width >= 0 && r->cfg.width != qr->width) return 0;
+    if (qr->height >= 0 && r->cfg.height != qr->height) return 0;
+    if (qr->k_max >= 0 && r->cfg.k_max != qr->k_max) return 0;
+    if (qr->boundary >= 0 && r->cfg.boundary != qr->boundary) return 0;
+    if (qr->seed >= 0 && r->seed != qr->seed) return 0;
+    if (qr->has_probs) {
+        for (int i = 0; i < 4; i++) {
+            if (r->cfg.prob_q[i] != qr->prob_q[i]) return 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Pravdepodobnosť v 1/PROB_ONE zaokrúhlená na percentá (len na výpis).
+ */
+static unsigned pct(uint32_t q) {
+    return (unsigned)((q * 100u + PROB_ONE / 2u) / PROB_ONE);
+}
+
+/**
+ * @brief Vypíše jeden beh.
+ */
+static void print_run(const runlog_record_t* r) {
+    char when[32];
+    time_t t = (time_t)(r->t_end_ns / 1000000000LL);
+    struct tm tm;
+    localtime_r(&t, &tm);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", &tm);
+
+    uint32_t done = r->reps_done;
+    double rate = (done > 0) ? 100.0 * (double)r->success_count / (double)done : 0.0;
+    msg_moments_t st = r->steps;
+    printf("%s  %dx%d K=%u p=%u,%u,%u,%u b=%u seed=%u reps=%u  success %.2f%%  mean %.2f  p50 %u p99 %u  %.1f ms%s\n",
+           when, (int)r->cfg.width, (int)r->cfg.height, (unsigned)r->cfg.k_max,
+           pct(r->cfg.prob_q[0]), pct(r->cfg.prob_q[1]), pct(r->cfg.prob_q[2]), pct(r->cfg.prob_q[3]),
+           (unsigned)r->cfg.boundary, (unsigned)r->seed, (unsigned)done, rate, st.mean,
+           (unsigned)r->p50, (unsigned)r->p99, (double)r->duration_ns / 1e6,
+           (r->flags & RUNLOG_CACHED) ? "  (cache)" : "");
+}
+
+/**
+ * @brief Pripočíta beh do zlúčeného súhrnu (momenty Chanovým vzorcom).
+ */
+static void pool_add(pooled_t* p, const runlog_record_t* r) {
+    p->runs++;
+    p->reps += r->reps_done;
+    p->success += r->success_count;
+
+    msg_moments_t m = r->steps;
+    if (m.n > 0) {
+        uint64_t n = p->n + m.n;
+        double d = m.mean - p->mean;
+        p->m2 += m.m2 + d * d * (double)p->n * (double)m.n / (double)n;
+        p->mean += d * (double)m.n / (double)n;
+        p->n = n;
+    }
+    for (uint32_t i = 0; i < RUNLOG_HIST_BUCKETS; i++) p->hist[i] += r->hist[i];
+}
+
+/**
+ * @brief Kvantil zlúčeného histogramu (horná hranica koša, ako hist_quantile).
+ */
+static uint32_t pool_quantile(const pooled_t* p, double q) {
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < RUNLOG_HIST_BUCKETS; i++) total += p->hist[i];
+    if (total == 0) return 0;
+    uint64_t rank = (uint64_t)ceil(q * (double)total);
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < RUNLOG_HIST_BUCKETS; i++) {
+        seen += p->hist[i];
+        if (seen >= rank) return hist_high_bits(i, RUNLOG_HIST_SUB_BITS);
+    }
+    return hist_high_bits(RUNLOG_HIST_BUCKETS - 1u, RUNLOG_HIST_SUB_BITS);
+}
+
+/**
+ * @brief Vstupný bod rwquery.
+ *
+ * @param argc Počet argumentov.
+ * @param argv Pole argumentov.
+ * @return 0 pri úspechu, 1 pri chybe.
+ */
+int main(int argc, char** argv) {
+    const char* dir = ".";
+    int summary_only = 0;
+    query_t qr = { -1, -1, -1, 0, {0, 0, 0, 0}, -1, -1, 0 };
+
+    for (int i = 1; i < argc; i++) {
+        const char* a = argv[i];
+        const char* v = (i + 1 < argc) ? argv[i + 1] : NULL;
+        if (strcmp(a, "--summary") == 0) { summary_only = 1; continue; }
+        if (!v) { usage(argv[0]); return 1; }
+        i++;
+        if (strcmp(a, "--data-dir") == 0) dir = v;
+        else if (strcmp(a, "-w") == 0) qr.width = atoll(v);
+        else if (strcmp(a, "-h") == 0) qr.height = atoll(v);
+        else if (strcmp(a, "-k") == 0) qr.k_max = atoll(v);
+        else if (strcmp(a, "-b") == 0) qr.boundary = atoll(v);
+        else if (strcmp(a, "--seed") == 0) qr.seed = atoll(v);
+        else if (strcmp(a, "-p") == 0) {
+            if (parse_probs(v, qr.prob_q) != 0) {
+                fprintf(stderr, "rwquery: invalid probabilities %s (need U,D,L,R summing to 100)\n", v);
+                return 1;
+            }
+            qr.has_probs = 1;
+        } else if (strcmp(a, "--since") == 0) {
+            int64_t age = parse_age(v);
+            if (age < 0) {
+                fprintf(stderr, "rwquery: invalid age %s\n", v);
+                return 1;
+            }
+            struct timespec now;
+            clock_gettime(CLOCK_REALTIME, &now);
+            qr.since_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec - age;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    runlog_view_t v;
+    if (runlog_map(dir, &v) != 0) {
+        fprintf(stderr, "rwquery: no run log in %s\n", dir);
+        return 1;
+    }
+
+    /* úplná konfigurácia - stačí porovnávať haše v indexe */
+    int by_hash = (qr.width >= 0 && qr.height >= 0 && qr.k_max >= 0 && qr.has_probs);
+    uint64_t hash = 0;
+    if (by_hash) {
+        runlog_config_t cfg;
+        memset(&cfg, 0, sizeof(cfg));
+        cfg.width = (int32_t)qr.width;
+        cfg.height = (int32_t)qr.height;
+        cfg.k_max = (uint32_t)qr.k_max;
+        memcpy(cfg.prob_q, qr.prob_q, sizeof(cfg.prob_q));
+        cfg.boundary = (qr.boundary >= 0) ? (uint8_t)qr.boundary : 0u;
+        if (qr.boundary < 0) qr.boundary = 0;
+        hash = runlog_config_hash(&cfg);
+    }
+
+    pooled_t* pool = calloc(1, sizeof(*pool));
+    if (!pool) {
+        runlog_unmap(&v);
+        return 1;
+    }
+
+    for (uint64_t i = runlog_find_time(&v, qr.since_ns); i < v.count; i++) {
+        const runlog_index_t* e = runlog_index(&v, i);
+        if (by_hash && e->cfg_hash != hash) continue;
+        uint64_t ri = e->record;
+        if (ri >= v.count) continue;
+        const runlog_record_t* r = runlog_record(&v, ri);
+        if (!matches(&qr, r)) continue; /* aj kolízia hašu */
+        if (!summary_only) print_run(r);
+        pool_add(pool, r);
+    }
+
+    printf("--- %llu runs of %llu in log ---\n", (unsigned long long)pool->runs, (unsigned long long)v.count);
+    if (pool->runs > 0) {
+        double rate = (pool->reps > 0) ? (double)pool->success / (double)pool->reps : 0.0;
+        double sd = (pool->n > 1) ? sqrt(pool->m2 / (double)(pool->n - 1u)) : 0.0;
+        printf("Replications: %llu, reached (0,0): %llu (%.3f%%)\n",
+               (unsigned long long)pool->reps, (unsigned long long)pool->success, 100.0 * rate);
+        printf("Steps (successful): mean %.3f, sd %.3f\n", pool->mean, sd);
+        printf("Steps percentiles (1/16 resolution): p50 %u, p90 %u, p99 %u, p99.9 %u\n",
+               (unsigned)pool_quantile(pool, 0.50), (unsigned)pool_quantile(pool, 0.90),
+               (unsigned)pool_quantile(pool, 0.99), (unsigned)pool_quantile(pool, 0.999));
+    }
+
+    free(pool);
+    runlog_unmap(&v);
+    return 0;
+}
@@ -0,0 +1,222 @@
+/**
+ * @file cache.c
+ * @brief Implementácia cache výsledkov v súbore mapovanom do pamäte.
+ */
+
+#include "cache.h"
+#include "hash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+/** Magické bajty na začiatku súboru. */
+#define CACHE_MAGIC "RWCACHE\0"
+
+/** Veľkosť hlavičky v súbore (sloty začínajú za ňou). */
+#define CACHE_HEADER_BYTES 64u
+
+/** Stav slotu: prázdny alebo rozpísaný. */
+#define SLOT_EMPTY 0u
+
+/** Stav slotu: platný záznam. */
+#define SLOT_VALID 1u
+
+/**
+ * @brief Hlavička súboru.
+ */
+typedef struct {
+    char magic[8];           /**< CACHE_MAGIC */
+    uint32_t format;         /**< CACHE_FORMAT */
+    uint32_t slots;          /**< CACHE_SLOTS */
+    uint32_t slot_bytes;     /**< sizeof(cache_slot_t) - zmení sa so zmenou results_t */
+    uint32_t reserved;       /**< Nuly */
+} cache_header_t;
+
+/**
+ * @brief Jeden záznam v súbore.
+ */
+typedef struct {
+    uint32_t state;          /**< SLOT_EMPTY / SLOT_VALID (zapisuje sa ako posledné) */
+    uint32_t reserved;       /**< Nuly */
+    uint64_t hash;           /**< Haš kľúča */
+    uint64_t used;           /**< Čas posledného uloženia alebo zásahu (s od epochy) */
+    uint64_t check;          /**< Kontrolný súčet kľúča a výsledku */
+    cache_key_t key;         /**< Celý kľúč */
+    results_t results;       /**< Uložený výsledok */
+} cache_slot_t;
+
+struct cache {
+    int fd;                  /**< Otvorený a zamknutý súbor */
+    unsigned char* map;      /**< Namapovaný súbor */
+    size_t size;             /**< Veľkosť súboru */
+    cache_slot_t* slots;     /**< Sloty v map */
+    pthread_mutex_t mtx;     /**< Súbežné behy vyhľadávajú a ukladajú z vlákien poolu */
+};
+
+/**
+ * @brief Kontrolný súčet slotu (kľúč + výsledok).
+ *
+ * @param s Slot.
+ * @return Kontrolný súčet.
+ */
+static uint64_t slot_check(const cache_slot_t* s) {
+    uint64_t h = fnv1a(FNV_OFFSET, &s->key, sizeof(s->key));
+    return fnv1a(h, &s->results, sizeof(s->results));
+}
+
+cache_t* cache_open(const char* path) {
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        fprintf(stderr, "[server] cache: cannot open %s: %s\n", path, strerror(errno));
+        return NULL;
+    }
+    if (flock(fd, LOCK_EX | LOCK_NB) != 0) {
+        fprintf(stderr, "[server] cache: %s is used by another server\n", path);
+        close(fd);
+        return NULL;
+    }
+
+    size_t size = CACHE_HEADER_BYTES + (size_t)CACHE_SLOTS * sizeof(cache_slot_t);
+    cache_header_t want;
+    memset(&want, 0, sizeof(want));
+    memcpy(want.magic, CACHE_MAGIC, sizeof(want.magic));
+    want.format = CACHE_FORMAT;
+    want.slots = CACHE_SLOTS;
+    want.slot_bytes = (uint32_t)sizeof(cache_slot_t);
+
+    struct stat st;
+    cache_header_t have;
+    int fresh = fstat(fd, &st) != 0 || (size_t)st.st_size != size ||
+                pread(fd, &have, sizeof(have), 0) != (ssize_t)sizeof(have) ||
+                memcmp(&have, &want, sizeof(want)) != 0;
+    if (fresh) {
+        /* nový alebo nekompatibilný súbor: zahodiť obsah, sloty ostanú riedke nuly */
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)size) != 0 ||
+            pwrite(fd, &want, sizeof(want), 0) != (ssize_t)sizeof(want)) {
+            fprintf(stderr, "[server] cache: cannot initialize %s: %s\n", path, strerror(errno));
+            close(fd);
+            return NULL;
+        }
+    }
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "[server] cache: mmap failed: %s\n", strerror(errno));
+        close(fd);
+        return NULL;
+    }
+
+    cache_t* c = calloc(1, sizeof(*c));
+    if (!c) {
+        munmap(map, size);
+        close(fd);
+        return NULL;
+    }
+    c->fd = fd;
+    c->map = (unsigned char*)map;
+    c->size = size;
+    c->slots = (cache_slot_t*)(c->map + CACHE_HEADER_BYTES);
+    pthread_mutex_init(&c->mtx, NULL);
+
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < CACHE_SLOTS; i++) used += (c->slots[i].state == SLOT_VALID);
+    printf("[server] cache: %s (%u/%u entries%s)\n", path, (unsigned)used, CACHE_SLOTS, fresh ? ", new" : "");
+    return c;
+}
+
+void cache_close(cache_t* c) {
+    if (!c) return;
+    msync(c->map, c->size, MS_SYNC);
+    munmap(c->map, c->size);
+    close(c->fd); /* uvoľní aj flock */
+    pthread_mutex_destroy(&c->mtx);
+    free(c);
+}
+
+void cache_key_from_job(const sim_job_t* job, cache_key_t* key) {
+    memset(key, 0, sizeof(*key));
+    key->engine = SIM_ENGINE_VERSION;
+    key->width = job->width;
+    key->height = job->height;
+    key->k_max = job->k_max;
+    key->reps = job->reps;
+    key->seed = job->seed;
+    memcpy(key->prob_q, job->prob_q, sizeof(key->prob_q));
+    key->boundary = job->boundary;
+    key->target = job->target;
+    key->target_hw = (job->target != TARGET_NONE) ? job->target_hw : 0.0;
+}
+
+/**
+ * @brief Nájde slot s daným kľúčom v okne CACHE_PROBE.
+ *
+ * @param c Cache (volajúci drží mtx).
+ * @param key Kľúč.
+ * @param hash Haš kľúča.
+ * @return Slot, alebo NULL.
+ */
+static cache_slot_t* find_slot(cache_t* c, const cache_key_t* key, uint64_t hash) {
+    for (uint32_t i = 0; i < CACHE_PROBE; i++) {
+        cache_slot_t* s = &c->slots[(hash + i) % CACHE_SLOTS];
+        if (s->state == SLOT_VALID && s->hash == hash && memcmp(&s->key, key, sizeof(*key)) == 0) return s;
+    }
+    return NULL;
+}
+
+int cache_lookup(cache_t* c, const cache_key_t* key, results_t* out) {
+    uint64_t hash = fnv1a(FNV_OFFSET, key, sizeof(*key));
+    pthread_mutex_lock(&c->mtx);
+    cache_slot_t* s = find_slot(c, key, hash);
+    int hit = 0;
+    if (s) {
+        if (slot_check(s) == s->check) {
+            memcpy(out, &s->results, sizeof(*out));
+            s->used = (uint64_t)time(NULL);
+            hit = 1;
+        } else {
+            /* poškodený záznam (napr. pád počas zápisu) sa zahodí */
+            s->state = SLOT_EMPTY;
+        }
+    }
+    pthread_mutex_unlock(&c->mtx);
+    return hit;
+}
+
+void cache_store(cache_t* c, const cache_key_t* key, const results_t* r) {
+    uint64_t hash = fnv1a(FNV_OFFSET, key, sizeof(*key));
+    pthread_mutex_lock(&c->mtx);
+    cache_slot_t* s = find_slot(c, key, hash);
+    if (!s) {
+        /* prázdny slot v okne, inak najdlhšie nepoužitý */
+        for (uint32_t i = 0; i < CACHE_PROBE; i++) {
+            cache_slot_t* t = &c->slots[(hash + i) % CACHE_SLOTS];
+            if (t->state != SLOT_VALID) {
+                s = t;
+                break;
+            }
+            if (!s || t->used < s->used) s = t;
+        }
+    }
+
+    /* platnosť sa zapíše až po celom zázname */
+    s->state = SLOT_EMPTY;
+    atomic_thread_fence(memory_order_release);
+    s->hash = hash;
+    s->used = (uint64_t)time(NULL);
+    memcpy(&s->key, key, sizeof(*key));
+    memcpy(&s->results, r, sizeof(*r));
+    s->check = slot_check(s);
+    atomic_thread_fence(memory_order_release);
+    s->state = SLOT_VALID;
+    pthread_mutex_unlock(&c->mtx);
+}
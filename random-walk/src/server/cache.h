@@ -0,0 +1,102 @@
+/**
+ * @file cache.h
+ * @brief Perzistentná cache výsledkov behov Monte Carlo v súbore mapovanom do pamäte.
+ *
+ * Beh s pevným seedom je deterministický (nezávisí ani od počtu vlákien),
+ * takže rovnaké parametre dajú vždy rovnaký results_t. Cache ho uloží pod
+ * kľúčom z kanonizovaných parametrov a verzie výpočtu; opakovaný START
+ * s rovnakými parametrami sa potom nepočíta znova.
+ *
+ * Súbor je hlavička a pevný počet slotov (hašovacia tabuľka s lineárnym
+ * skúšaním v okne CACHE_PROBE slotov). Slot obsahuje celý kľúč (haš sa
+ * iba porovná ako prvý) a celý results_t vrátane histogramu. Pri plnom okne
+ * sa prepíše najdlhšie nepoužitý slot. Súbor sa mapuje cez mmap, takže
+ * vyhľadanie je len pár porovnaní v pamäti a súbor je riedky - miesto na
+ * disku zaberú iba použité sloty.
+ */
+
+#pragma once
+#include "results.h"
+#include "simulation.h"
+
+#include <stdint.h>
+
+/** Meno súboru cache v dátovom priečinku servera. */
+#define CACHE_FILE "results.cache"
+
+/** Počet slotov v súbore. */
+#define CACHE_SLOTS 1024u
+
+/** Počet slotov, v ktorých sa hľadá kľúč (od slotu daného hašom). */
+#define CACHE_PROBE 8u
+
+/** Verzia formátu súboru; pri inej sa súbor založí nanovo. */
+#define CACHE_FORMAT 2u
+
+/**
+ * @brief Kanonický kľúč behu: iba parametre, ktoré menia výsledok.
+ *
+ * Tempo, počet vlákien ani stream výsledok nemenia, preto v kľúči nie sú.
+ * Pravdepodobnosti sú už prevedené na prob_q, takže percentá aj prob_q
+ * s rovnakým významom dajú rovnaký kľúč. Štruktúra nemá výplň, porovnáva
+ * sa ako bajty.
+ */
+typedef struct {
+    double target_hw;        /**< Požadovaná polšírka (0 bez cieľa) */
+    uint32_t engine;         /**< SIM_ENGINE_VERSION */
+    int32_t width, height;   /**< Rozmery sveta */
+    uint32_t k_max;          /**< Maximálny počet krokov */
+    uint32_t reps;           /**< Počet replikácií (pri cieli horná hranica) */
+    uint32_t seed;           /**< Seed (nikdy 0) */
+    uint32_t prob_q[4];      /**< Pravdepodobnosti smerov v 1/PROB_ONE */
+    uint8_t boundary;        /**< Režim okraja */
+    uint8_t target;          /**< Cieľ presnosti */
+    uint8_t reserved[6];     /**< Nuly */
+} cache_key_t;
+
+typedef struct cache cache_t;
+
+/**
+ * @brief Otvorí (alebo založí) súbor cache a namapuje ho.
+ *
+ * Súbor s inou hlavičkou (formát, počet alebo veľkosť slotov) sa vyprázdni.
+ * Súbor je zamknutý (flock), takže ho nemôžu naraz používať dva servery.
+ *
+ * @param path Cesta k súboru.
+ * @return Cache, alebo NULL pri chybe (server potom beží bez cache).
+ */
+cache_t* cache_open(const char* path);
+
+/**
+ * @brief Zapíše zmeny na disk a zatvorí cache.
+ *
+ * @param c Cache (môže byť NULL).
+ */
+void cache_close(cache_t* c);
+
+/**
+ * @brief Zostaví kľúč z popisu behu Monte Carlo.
+ *
+ * @param job Popis behu (s prob_q a rozhodnutým seedom).
+ * @param key Výstupný kľúč.
+ */
+void cache_key_from_job(const sim_job_t* job, cache_key_t* key);
+
+/**
+ * @brief Vyhľadá výsledok podľa kľúča.
+ *
+ * @param c Cache.
+ * @param key Kľúč.
+ * @param out Výstup: uložený výsledok (pri zásahu).
+ * @return 1 pri zásahu, 0 ak kľúč v cache nie je.
+ */
+int cache_lookup(cache_t* c, const cache_key_t* key, results_t* out);
+
+/**
+ * @brief Uloží výsledok pod kľúč (prepíše starší s rovnakým kľúčom).
+ *
+ * @param c Cache.
+ * @param key Kľúč.
+ * @param r Výsledok dokončeného behu.
+ */
+void cache_store(cache_t* c, const cache_key_t* key, const results_t* r);
@@ -0,0 +1,260 @@
+/**
+ * @file checkpoint.c
+ * @brief Implementácia checkpointov behov Monte Carlo.
+ */
+
+#include "checkpoint.h"
+#include "hash.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/** Magické bajty na začiatku súboru. */
+#define CKPT_MAGIC "RWCKPT\0\0"
+
+/**
+ * @brief Hlavička súboru; za ňou nasleduje sim_checkpoint_t so shardmi.
+ */
+typedef struct {
+    char magic[8];           /**< CKPT_MAGIC */
+    uint32_t format;         /**< CKPT_FORMAT */
+    uint32_t results_bytes;  /**< sizeof(results_t) - zmení sa so zmenou results_t */
+    cache_key_t key;         /**< Kľúč behu */
+    uint32_t n;              /**< Počet shardov */
+    uint32_t reserved;       /**< Nuly */
+    uint64_t check;          /**< Kontrolný súčet hlavičky (s check = 0) a stavu */
+} ckpt_header_t;
+
+/**
+ * @brief Zapisovač checkpointov: jedno vlákno a front požiadaviek.
+ */
+struct ckpt_writer {
+    pthread_t tid;           /**< Vlákno zapisovača */
+    pthread_mutex_t mtx;     /**< Chráni head, tail a quit */
+    pthread_cond_t cv;       /**< Signál pri novej požiadavke alebo quit */
+    ckpt_req_t* head;        /**< Najstaršia čakajúca požiadavka */
+    ckpt_req_t* tail;        /**< Najnovšia čakajúca požiadavka */
+    int quit;                /**< 1 = po vyprázdnení frontu skončiť */
+};
+
+/**
+ * @brief Kontrolný súčet súboru.
+ *
+ * @param hdr Hlavička (check sa neráta).
+ * @param ck Stav behu.
+ * @return Kontrolný súčet.
+ */
+static uint64_t ckpt_check(const ckpt_header_t* hdr, const sim_checkpoint_t* ck) {
+    ckpt_header_t h = *hdr;
+    h.check = 0;
+    uint64_t sum = fnv1a(FNV_OFFSET, &h, sizeof(h));
+    return fnv1a(sum, ck, SIM_CHECKPOINT_BYTES(ck->n));
+}
+
+/**
+ * @brief Overí, že shardy checkpointu súvisle pokrývajú aktuálny blok behu.
+ *
+ * @param ck Stav behu.
+ * @param key Kľúč behu.
+ * @return 1 ak je stav použiteľný, inak 0.
+ */
+static int ckpt_valid(const sim_checkpoint_t* ck, const cache_key_t* key) {
+    if (ck->planned > key->reps) return 0;
+    for (uint32_t i = 0; i < ck->n; i++) {
+        const sim_shard_state_t* sh = &ck->shards[i];
+        if (sh->rep_begin > sh->rep_next || sh->rep_next > sh->rep_end) return 0;
+        if (i > 0 && sh->rep_begin != ck->shards[i - 1].rep_end) return 0;
+        /* s cieľom presnosti má shard v štatistike aj replikácie predchádzajúcich blokov */
+        uint64_t done = (uint64_t)sh->results.success_count + sh->results.fail_count;
+        if (key->target == TARGET_NONE && done != sh->rep_next - sh->rep_begin) return 0;
+    }
+    return ck->shards[ck->n - 1].rep_end == ck->planned;
+}
+
+int ckpt_path(const char* data_dir, const cache_key_t* key, char* out, size_t cap) {
+    char dir[4096];
+    if (snprintf(dir, sizeof(dir), "%s/%s", data_dir, CKPT_DIR) >= (int)sizeof(dir)) return -1;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "[server] checkpoint: cannot create %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    unsigned long long h = (unsigned long long)fnv1a(FNV_OFFSET, key, sizeof(*key));
+    if (snprintf(out, cap, "%s/%016llx%s", dir, h, CKPT_EXT) >= (int)cap) return -1;
+    return 0;
+}
+
+/**
+ * @brief Zapíše celý buffer (pokračuje po čiastočnom zápise).
+ *
+ * @param fd Súbor.
+ * @param data Dáta.
+ * @param len Dĺžka dát.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int write_all(int fd, const void* data, size_t len) {
+    const unsigned char* p = (const unsigned char*)data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+/**
+ * @brief Zapíše na disk priečinok súboru (aby rename prežil pád systému).
+ *
+ * @param path Cesta k súboru.
+ * @return 0 pri úspechu, -1 pri chybe.
+ */
+static int ckpt_sync_dir(const char* path) {
+    char dir[4096];
+    const char* slash = strrchr(path, '/');
+    int len = slash ? (int)(slash - path) : 1;
+    if (len == 0) len = 1; /* súbor priamo v koreni */
+    if (snprintf(dir, sizeof(dir), "%.*s", len, slash ? path : ".") >= (int)sizeof(dir)) return -1;
+
+    int fd = open(dir, O_RDONLY | O_DIRECTORY);
+    int rc = (fd >= 0) ? fsync(fd) : -1;
+    if (rc != 0) fprintf(stderr, "[server] checkpoint: cannot sync %s: %s\n", dir, strerror(errno));
+    if (fd >= 0) close(fd);
+    return rc;
+}
+
+int ckpt_save(const char* path, const cache_key_t* key, const sim_checkpoint_t* ck) {
+    ckpt_header_t hdr;
+    memset(&hdr, 0, sizeof(hdr));
+    memcpy(hdr.magic, CKPT_MAGIC, sizeof(hdr.magic));
+    hdr.format = CKPT_FORMAT;
+    hdr.results_bytes = (uint32_t)sizeof(results_t);
+    hdr.key = *key;
+    hdr.n = ck->n;
+    hdr.check = ckpt_check(&hdr, ck);
+
+    /* dočasný súbor vedľa cieľového, aby bol rename atomický */
+    char tmp[4096];
+    if (snprintf(tmp, sizeof(tmp), "%s.XXXXXX", path) >= (int)sizeof(tmp)) return -1;
+    int fd = mkstemp(tmp);
+    if (fd < 0) {
+        fprintf(stderr, "[server] checkpoint: cannot create %s: %s\n", tmp, strerror(errno));
+        return -1;
+    }
+
+    int rc = write_all(fd, &hdr, sizeof(hdr));
+    if (rc == 0) rc = write_all(fd, ck, SIM_CHECKPOINT_BYTES(ck->n));
+    if (rc == 0) rc = fsync(fd);
+    if (close(fd) != 0) rc = -1;
+    if (rc == 0) rc = rename(tmp, path);
+    if (rc != 0) {
+        fprintf(stderr, "[server] checkpoint: writing %s failed: %s\n", path, strerror(errno));
+        unlink(tmp);
+        return -1;
+    }
+    return ckpt_sync_dir(path);
+}
+
+/**
+ * @brief Vlákno zapisovača - zapisuje požiadavky v poradí zaradenia.
+ *
+ * Skončí až pri quit a prázdnom fronte, takže žiadny zaradený checkpoint
+ * sa nestratí.
+ *
+ * @param arg Ukazovateľ na ckpt_writer_t.
+ * @return NULL pri ukončení.
+ */
+static void* ckpt_writer_main(void* arg) {
+    ckpt_writer_t* w = (ckpt_writer_t*)arg;
+    pthread_mutex_lock(&w->mtx);
+    for (;;) {
+        while (!w->head && !w->quit) pthread_cond_wait(&w->cv, &w->mtx);
+        ckpt_req_t* req = w->head;
+        if (!req) break;
+        w->head = req->next;
+        if (!w->head) w->tail = NULL;
+        pthread_mutex_unlock(&w->mtx);
+
+        (void)ckpt_save(req->path, req->key, req->ck);
+        req->done(req->done_arg);
+
+        pthread_mutex_lock(&w->mtx);
+    }
+    pthread_mutex_unlock(&w->mtx);
+    return NULL;
+}
+
+ckpt_writer_t* ckpt_writer_start(void) {
+    ckpt_writer_t* w = calloc(1, sizeof(*w));
+    if (!w) return NULL;
+    pthread_mutex_init(&w->mtx, NULL);
+    pthread_cond_init(&w->cv, NULL);
+    if (pthread_create(&w->tid, NULL, ckpt_writer_main, w) != 0) {
+        pthread_cond_destroy(&w->cv);
+        pthread_mutex_destroy(&w->mtx);
+        free(w);
+        return NULL;
+    }
+    return w;
+}
+
+void ckpt_writer_submit(ckpt_writer_t* w, ckpt_req_t* req) {
+    req->next = NULL;
+    pthread_mutex_lock(&w->mtx);
+    if (w->tail) w->tail->next = req;
+    else w->head = req;
+    w->tail = req;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->mtx);
+}
+
+void ckpt_writer_stop(ckpt_writer_t* w) {
+    if (!w) return;
+    pthread_mutex_lock(&w->mtx);
+    w->quit = 1;
+    pthread_cond_signal(&w->cv);
+    pthread_mutex_unlock(&w->mtx);
+    pthread_join(w->tid, NULL);
+    pthread_cond_destroy(&w->cv);
+    pthread_mutex_destroy(&w->mtx);
+    free(w);
+}
+
+sim_checkpoint_t* ckpt_load(const char* path, const cache_key_t* key) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    ckpt_header_t hdr;
+    sim_checkpoint_t* ck = NULL;
+    struct stat st;
+    if (fstat(fd, &st) == 0 && pread(fd, &hdr, sizeof(hdr), 0) == (ssize_t)sizeof(hdr) &&
+        memcmp(hdr.magic, CKPT_MAGIC, sizeof(hdr.magic)) == 0 && hdr.format == CKPT_FORMAT &&
+        hdr.results_bytes == (uint32_t)sizeof(results_t) && memcmp(&hdr.key, key, sizeof(*key)) == 0 &&
+        hdr.n >= 1 && hdr.n <= SIM_MAX_THREADS &&
+        (size_t)st.st_size == sizeof(hdr) + SIM_CHECKPOINT_BYTES(hdr.n)) {
+        size_t bytes = SIM_CHECKPOINT_BYTES(hdr.n);
+        ck = malloc(bytes);
+        if (ck && (pread(fd, ck, bytes, (off_t)sizeof(hdr)) != (ssize_t)bytes || ck->n != hdr.n ||
+                   ckpt_check(&hdr, ck) != hdr.check || !ckpt_valid(ck, key))) {
+            free(ck);
+            ck = NULL;
+        }
+    }
+    close(fd);
+    if (!ck) fprintf(stderr, "[server] checkpoint: ignoring invalid %s\n", path);
+    return ck;
+}
+
+void ckpt_remove(const char* path) {
+    if (unlink(path) != 0 && errno != ENOENT) {
+        fprintf(stderr, "[server] checkpoint: cannot remove %s: %s\n", path, strerror(errno));
+    }
+}
@@ -0,0 +1,113 @@
+/**
+ * @file checkpoint.h
+ * @brief Checkpointy dlhých behov Monte Carlo a pokračovanie z nich (MSG_RESUME).
+ *
+ * Beh s pevným seedom občas uloží stav všetkých shardov (sim_checkpoint_t)
+ * do malého súboru v dátovom priečinku. Súbor sa volá podľa haša kľúča
+ * z cache (cache_key_t), takže RESUME s rovnakými parametrami ho nájde aj
+ * po reštarte servera. Zapisuje sa do dočasného súboru, ktorý sa po fsync
+ * premenuje na cieľový (a fsync priečinka) - po páde ostane vždy celý starý
+ * alebo celý nový checkpoint. Zápis robí jedno vlákno servera (ckpt_writer_t),
+ * nie vlákna poolu. Po úplnom dobehnutí behu sa súbor zmaže.
+ */
+
+#pragma once
+#include "cache.h"
+#include "simulation.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/** Podpriečinok dátového priečinka s checkpointmi. */
+#define CKPT_DIR "ckpt"
+
+/** Prípona súborov checkpointov. */
+#define CKPT_EXT ".ckpt"
+
+/** Verzia formátu súboru; checkpoint s inou sa ignoruje. */
+#define CKPT_FORMAT 2u
+
+/** Predvolený interval checkpointov (ms) pre --checkpoint-ms. */
+#define CKPT_MS_DEFAULT 10000u
+
+/**
+ * @brief Zostaví cestu k checkpointu behu (DIR/ckpt/<haš kľúča>.ckpt).
+ *
+ * Priečinok DIR/ckpt sa podľa potreby založí.
+ *
+ * @param data_dir Dátový priečinok servera.
+ * @param key Kľúč behu.
+ * @param out Výstupná cesta.
+ * @param cap Veľkosť out.
+ * @return 0 pri úspechu, -1 pri chybe (priečinok, príliš dlhá cesta).
+ */
+int ckpt_path(const char* data_dir, const cache_key_t* key, char* out, size_t cap);
+
+/**
+ * @brief Požiadavka na zápis checkpointu pre ckpt_writer_submit().
+ *
+ * Patrí volajúcemu (napr. je súčasťou behu) a musí platiť, kým sa nezavolá
+ * done; naraz môže byť zaradená najviac raz.
+ */
+typedef struct ckpt_req {
+    const char* path;        /**< Cesta z ckpt_path() */
+    const cache_key_t* key;  /**< Kľúč behu */
+    const sim_checkpoint_t* ck; /**< Stav behu (nastaví sa pri každom zaradení) */
+    void (*done)(void* arg); /**< Volá ho vlákno zapisovača po zápise (aj neúspešnom) */
+    void* done_arg;          /**< Argument pre done */
+    struct ckpt_req* next;   /**< Ďalšia požiadavka vo fronte (interné) */
+} ckpt_req_t;
+
+/** Vlákno, ktoré zapisuje checkpointy všetkých behov v poradí zaradenia. */
+typedef struct ckpt_writer ckpt_writer_t;
+
+/**
+ * @brief Spustí vlákno zapisovača checkpointov.
+ *
+ * @return Zapisovač, alebo NULL pri chybe.
+ */
+ckpt_writer_t* ckpt_writer_start(void);
+
+/**
+ * @brief Zaradí zápis checkpointu (nečaká na disk).
+ *
+ * @param w Zapisovač.
+ * @param req Požiadavka.
+ */
+void ckpt_writer_submit(ckpt_writer_t* w, ckpt_req_t* req);
+
+/**
+ * @brief Zapíše zaradené checkpointy, ukončí vlákno a uvoľní zapisovač.
+ *
+ * @param w Zapisovač (NULL = nič).
+ */
+void ckpt_writer_stop(ckpt_writer_t* w);
+
+/**
+ * @brief Atomicky zapíše checkpoint (dočasný súbor, fsync, rename, fsync priečinka).
+ *
+ * @param path Cesta z ckpt_path().
+ * @param key Kľúč behu (uloží sa celý a pri načítaní sa porovná).
+ * @param ck Stav behu.
+ * @return 0 pri úspechu, -1 pri chybe (starý checkpoint ostáva).
+ */
+int ckpt_save(const char* path, const cache_key_t* key, const sim_checkpoint_t* ck);
+
+/**
+ * @brief Načíta checkpoint a overí ho voči kľúču behu.
+ *
+ * Súbor s iným kľúčom, formátom, veľkosťou results_t alebo chybným
+ * kontrolným súčtom sa ignoruje.
+ *
+ * @param path Cesta z ckpt_path().
+ * @param key Kľúč behu.
+ * @return Checkpoint (uvoľniť cez free()), alebo NULL ak platný neexistuje.
+ */
+sim_checkpoint_t* ckpt_load(const char* path, const cache_key_t* key);
+
+/**
+ * @brief Zmaže checkpoint (beh dobehol celý).
+ *
+ * @param path Cesta z ckpt_path().
+ */
+void ckpt_remove(const char* path);
@@ -0,0 +1,696 @@
+/**
+ * @file exact.c
+ * @brief Implementácia presného výpočtu šírením pravdepodobnosti po mriežke.
+ *
+ * Jeden krok je 5-bodový stencil: hmotnosť bunky v kroku t+1 je súčet
+ * hmotností susedov v kroku t vážených pravdepodobnosťou kroku smerom k nej.
+ * Vertikálna a vodorovná časť sa rátajú zvlášť, lebo sú nezávislé:
+ * - vertikálne: celé riadky zdroja (y-1, y+1, pri odraze aj okrajový riadok)
+ *   sa prenásobia a sčítajú - súvislá slučka, ktorú kompilátor vektorizuje
+ * - vodorovne: vnútorné stĺpce sú x-1 a x+1, okrajové stĺpce (0, 1, w-2, w-1)
+ *   sa riešia cez predpočítaný zoznam zdrojov podľa režimu okraja
+ *
+ * Režim všetkých štartov (exact_calc_new s all_starts) ide opačným smerom: namiesto
+ * rozdelenia polohy sa iteruje pravdepodobnosť zásahu ako funkcia štartu
+ * (spätná rovnica), takže jeden beh dá výsledok pre všetky bunky naraz.
+ * Oba výpočty zdieľajú to isté paralelné jadro (exact_band_step) - líši sa len
+ * funkcia pre riadok a ošetrenie cieľa.
+ *
+ * Výpočet nemá vlastné vlákna: každý pás riadkov je úloha poolu servera,
+ * ktorá spočíta jeden krok. Posledný pás, ktorý krok dokončí, ošetrí cieľ
+ * a zaradí pásy ďalšieho kroku (ako posledný shard bloku v simulation.c),
+ * takže sa výpočet po každom kroku strieda s úlohami ostatných behov.
+ */
+
+#include "exact.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/**
+ * @brief Zdroje, z ktorých sa jedným krokom v danej osi dá dostať do bunky.
+ *
+ * Najviac 4: sused zľava/zhora, sused sprava/zdola a pri odraze ešte
+ * okrajová bunka, z ktorej sa krok von zrkadlí späť.
+ */
+typedef struct {
+    int32_t src[4];          /**< Index zdrojovej bunky v osi */
+    double c[4];             /**< Pravdepodobnosť prechodu zo zdroja */
+    int n;                   /**< Počet platných zdrojov */
+} axis_src_t;
+
+typedef struct exact_shared exact_shared_t;
+
+/**
+ * @brief Prepočíta úsek [xa, xb) riadku y v kroku t (buf[.][t-1] -> buf[.][t]).
+ */
+typedef void (*exact_row_fn)(const exact_shared_t* sh, uint32_t t, int32_t y, int32_t xa, int32_t xb);
+
+/**
+ * @brief Ošetrí cieľovú bunku (0,0) po kroku t (volá ho vlastník riadku 0).
+ */
+typedef void (*exact_target_fn)(exact_shared_t* sh, uint32_t t);
+
+/** Počet polí, ktoré výpočet naraz prepočítava (spätný výpočet potrebuje 2). */
+#define EXACT_FIELDS 2
+
+/**
+ * @brief Spoločný stav všetkých vlákien presného výpočtu.
+ */
+struct exact_shared {
+    int32_t w, h;            /**< Rozmery sveta */
+    uint32_t k_max;          /**< Počet krokov */
+    double pu, pd, pl, pr;   /**< Pravdepodobnosti UP, DOWN, LEFT, RIGHT */
+    exact_row_fn row;        /**< Prepočet úseku riadku */
+    exact_target_fn target;  /**< Ošetrenie cieľa po kroku */
+
+    /* dopredný výpočet */
+    axis_src_t* vsrc;        /**< Vertikálne zdroje pre každý riadok (h položiek) */
+    axis_src_t* hsrc;        /**< Vodorovné zdroje pre každý stĺpec (w položiek) */
+    double* p_hit;           /**< P(prvý zásah v kroku t) */
+
+    /* spätný výpočet */
+    int32_t* ym;             /**< Riadok po kroku UP z riadku y (-1 = mimo sveta) */
+    int32_t* yp;             /**< Riadok po kroku DOWN z riadku y (-1 = mimo sveta) */
+    int32_t xm[2], xp[2];    /**< Stĺpec po kroku LEFT / RIGHT z okrajov 0 a w-1 */
+    const double* zero_row;  /**< Riadok núl (zdroj pre krok mimo sveta) */
+    double target_raw[EXACT_FIELDS]; /**< Hodnoty cieľa pred prepísaním v poslednom kroku */
+
+    double* buf[EXACT_FIELDS][2]; /**< Pole f v kroku t je v buf[f][t & 1] */
+    atomic_int* stop;        /**< Príznak prerušenia z sim_job_t */
+
+    struct exact_band* bands; /**< Pásy riadkov */
+    uint32_t nbands;         /**< Počet pásov */
+    pool_t* pool;            /**< Pool, v ktorom pásy bežia */
+    sim_done_fn done;        /**< Callback po poslednom kroku */
+    void* done_arg;          /**< Argument pre done */
+    uint32_t t;              /**< Krok, ktorý pásy práve počítajú (mení ho posledný pás) */
+    atomic_uint pending;     /**< Počet pásov, ktoré krok t ešte nedokončili */
+    uint32_t steps_done;     /**< Počet dokončených krokov */
+};
+
+/**
+ * @brief Pás riadkov - jedna úloha poolu v každom kroku.
+ */
+typedef struct exact_band {
+    exact_shared_t* sh;      /**< Spoločný stav */
+    int32_t row_begin;       /**< Prvý riadok pásu (vrátane) */
+    int32_t row_end;         /**< Koniec pásu (bez) */
+} exact_band_t;
+
+/**
+ * @brief Zistí zdroje bunky i v osi dĺžky n.
+ *
+ * Krok "mínus" (UP / LEFT) z bunky i+1 vedie na i, krok "plus" (DOWN / RIGHT)
+ * z bunky i-1 vedie na i. Okraj sa správa ako v sim_bound_fix().
+ *
+ * @param i Index bunky.
+ * @param n Dĺžka osi (>= 2).
+ * @param mode Režim okraja (boundary_mode_t).
+ * @param pm Pravdepodobnosť kroku v smere mínus.
+ * @param pp Pravdepodobnosť kroku v smere plus.
+ * @param s Výstupný zoznam zdrojov.
+ */
+static void axis_sources(int32_t i, int32_t n, int mode, double pm, double pp, axis_src_t* s) {
+    s->n = 0;
+#define AXIS_ADD(j, p) do { s->src[s->n] = (j); s->c[s->n] = (p); s->n++; } while (0)
+    if (i + 1 < n) AXIS_ADD(i + 1, pm);
+    else if (mode == BOUND_TORUS) AXIS_ADD(0, pm);
+
+    if (i - 1 >= 0) AXIS_ADD(i - 1, pp);
+    else if (mode == BOUND_TORUS) AXIS_ADD(n - 1, pp);
+
+    if (mode == BOUND_REFLECT) {
+        if (i == 1) AXIS_ADD(0, pm);       /* z 0 smerom mínus -> -1 -> 1 */
+        if (i == n - 2) AXIS_ADD(n - 1, pp); /* z n-1 smerom plus -> n -> n-2 */
+    }
+#undef AXIS_ADD
+}
+
+/**
+ * @brief Dopredný krok: spočíta úsek [xa, xb) riadku y rozdelenia polohy.
+ *
+ * @param sh Spoločný stav.
+ * @param t Krok (číta sa buf[0][t-1], zapisuje buf[0][t]).
+ * @param y Riadok.
+ * @param xa Prvý stĺpec úseku.
+ * @param xb Koniec úseku (bez).
+ */
+static void forward_row(const exact_shared_t* sh, uint32_t t, int32_t y, int32_t xa, int32_t xb) {
+    const double* cur = sh->buf[0][(t - 1) & 1u];
+    double* dst = sh->buf[0][t & 1u];
+    const int32_t w = sh->w;
+    const axis_src_t* v = &sh->vsrc[y];
+    double* restrict d = dst + (size_t)y * (size_t)w;
+
+    const double* restrict row = cur + (size_t)y * (size_t)w;
+    const double pl = sh->pl, pr = sh->pr;
+    int32_t ia = (xa < 2) ? 2 : xa;
+    int32_t ib = (xb > w - 2) ? w - 2 : xb;
+
+    if (v->n == 2) {
+        /* bežný riadok: oba vertikálne zdroje a vnútro riadku v jednom prechode */
+        const double* restrict s0 = cur + (size_t)v->src[0] * (size_t)w;
+        const double* restrict s1 = cur + (size_t)v->src[1] * (size_t)w;
+        const double c0 = v->c[0], c1 = v->c[1];
+        for (int32_t x = xa; x < ia && x < xb; x++) d[x] = c0 * s0[x] + c1 * s1[x];
+        for (int32_t x = ia; x < ib; x++) {
+            d[x] = c0 * s0[x] + c1 * s1[x] + pl * row[x + 1] + pr * row[x - 1];
+        }
+        for (int32_t x = (ib > xa) ? ib : xa; x < xb; x++) d[x] = c0 * s0[x] + c1 * s1[x];
+    } else {
+        /* vertikálne zdroje; pri h >= 2 má každý riadok aspoň jeden */
+        const double* restrict s0 = cur + (size_t)v->src[0] * (size_t)w;
+        const double c0 = v->c[0];
+        for (int32_t x = xa; x < xb; x++) d[x] = c0 * s0[x];
+        for (int k = 1; k < v->n; k++) {
+            const double* restrict sk = cur + (size_t)v->src[k] * (size_t)w;
+            const double ck = v->c[k];
+            for (int32_t x = xa; x < xb; x++) d[x] += ck * sk[x];
+        }
+
+        /* vodorovne - vnútorné stĺpce [2, w-2) majú vždy len susedov x±1 */
+        for (int32_t x = ia; x < ib; x++) d[x] += pl * row[x + 1] + pr * row[x - 1];
+    }
+
+    /* okrajové stĺpce podľa režimu okraja */
+    int32_t lo_end = (xb < 2) ? xb : 2;
+    int32_t hi_begin = (w - 2 > 2) ? w - 2 : 2;
+    if (hi_begin < xa) hi_begin = xa;
+    for (int32_t x = xa; x < lo_end; x++) {
+        const axis_src_t* hs = &sh->hsrc[x];
+        for (int k = 0; k < hs->n; k++) d[x] += hs->c[k] * row[hs->src[k]];
+    }
+    for (int32_t x = hi_begin; x < xb; x++) {
+        const axis_src_t* hs = &sh->hsrc[x];
+        for (int k = 0; k < hs->n; k++) d[x] += hs->c[k] * row[hs->src[k]];
+    }
+}
+
+/**
+ * @brief Dopredný krok: (0,0) je pohlcujúca - čo do nej pritieklo, je zásah v kroku t.
+ */
+static void forward_target(exact_shared_t* sh, uint32_t t) {
+    double* nxt = sh->buf[0][t & 1u];
+    sh->p_hit[t] = nxt[0];
+    nxt[0] = 0.0;
+}
+
+/**
+ * @brief Hodnota poľa v stĺpci xi riadku (xi = -1 znamená mimo sveta -> 0).
+ */
+static inline double cell_or_zero(const double* row, int32_t xi) {
+    return (xi >= 0) ? row[xi] : 0.0;
+}
+
+/**
+ * @brief Spätný krok: úsek [xa, xb) riadku y pre pravdepodobnosť a kroky.
+ *
+ * Pole A je u(s) = P(zásah do t krokov zo štartu s), pole B je u(s) + m(s),
+ * kde m(s) = E[počet krokov * 1{zásah do t krokov}]. Oba sa rátajú tým istým
+ * stencilom S(F)(s) = súčet p_d * F(cieľ kroku d zo s):
+ * A_t = S(A_{t-1}), B_t = A_t + S(B_{t-1}); v cieli (0,0) sú pred krokom
+ * obe polia prepísané na 1 (zásah hneď po kroku).
+ */
+static void backward_row(const exact_shared_t* sh, uint32_t t, int32_t y, int32_t xa, int32_t xb) {
+    const int32_t w = sh->w;
+    const size_t rw = (size_t)w;
+    const double pu = sh->pu, pd = sh->pd, pl = sh->pl, pr = sh->pr;
+
+    const double* restrict a = sh->buf[0][(t - 1) & 1u];
+    const double* restrict b = sh->buf[1][(t - 1) & 1u];
+    double* restrict na = sh->buf[0][t & 1u] + (size_t)y * rw;
+    double* restrict nb = sh->buf[1][t & 1u] + (size_t)y * rw;
+
+    /* riadky, kam vedie krok hore / dole (mimo sveta -> nulový riadok) */
+    const double* restrict au = (sh->ym[y] >= 0) ? a + (size_t)sh->ym[y] * rw : sh->zero_row;
+    const double* restrict ad = (sh->yp[y] >= 0) ? a + (size_t)sh->yp[y] * rw : sh->zero_row;
+    const double* restrict bu = (sh->ym[y] >= 0) ? b + (size_t)sh->ym[y] * rw : sh->zero_row;
+    const double* restrict bd = (sh->yp[y] >= 0) ? b + (size_t)sh->yp[y] * rw : sh->zero_row;
+    const double* restrict ar = a + (size_t)y * rw;
+    const double* restrict br = b + (size_t)y * rw;
+
+    /* vnútorné stĺpce [1, w-1): vodorovný krok vedie vždy na x±1 */
+    int32_t ia = (xa < 1) ? 1 : xa;
+    int32_t ib = (xb > w - 1) ? w - 1 : xb;
+    for (int32_t x = ia; x < ib; x++) {
+        double va = pu * au[x] + pd * ad[x] + pl * ar[x - 1] + pr * ar[x + 1];
+        double vb = pu * bu[x] + pd * bd[x] + pl * br[x - 1] + pr * br[x + 1];
+        na[x] = va;
+        nb[x] = va + vb;
+    }
+
+    /* okrajové stĺpce 0 a w-1 podľa režimu okraja */
+    for (int e = 0; e < 2; e++) {
+        int32_t x = (e == 0) ? 0 : w - 1;
+        if (x < xa || x >= xb) continue;
+        double va = pu * au[x] + pd * ad[x]
+                  + pl * cell_or_zero(ar, sh->xm[e]) + pr * cell_or_zero(ar, sh->xp[e]);
+        double vb = pu * bu[x] + pd * bd[x]
+                  + pl * cell_or_zero(br, sh->xm[e]) + pr * cell_or_zero(br, sh->xp[e]);
+        na[x] = va;
+        nb[x] = va + vb;
+    }
+}
+
+/**
+ * @brief Spätný krok: zapamätá skutočné hodnoty cieľa a prepíše ich na 1.
+ *
+ * Prepísaná hodnota znamená "krok do (0,0) je zásah"; skutočná hodnota
+ * (návrat do (0,0) zo štartu v (0,0)) sa uchová pre výsledok.
+ */
+static void backward_target(exact_shared_t* sh, uint32_t t) {
+    for (int f = 0; f < EXACT_FIELDS; f++) {
+        double* nxt = sh->buf[f][t & 1u];
+        sh->target_raw[f] = nxt[0];
+        nxt[0] = 1.0;
+    }
+}
+
+/**
+ * @brief Aktuálny čas CLOCK_MONOTONIC v ns.
+ */
+static int64_t exact_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/**
+ * @brief Spočíta krok t v páse riadkov.
+ *
+ * Pás sa prechádza po dlaždiciach stĺpcov (EXACT_TILE) a v dlaždici po
+ * riadkoch, takže tri zdrojové riadky aktuálneho okna ostávajú v L1 cache.
+ *
+ * @param band Pás.
+ * @param t Krok.
+ */
+static void exact_band_step(const exact_band_t* band, uint32_t t) {
+    const exact_shared_t* sh = band->sh;
+    const int32_t w = sh->w;
+    for (int32_t xa = 0; xa < w; xa += EXACT_TILE) {
+        int32_t xb = (xa + EXACT_TILE < w) ? xa + EXACT_TILE : w;
+        for (int32_t y = band->row_begin; y < band->row_end; y++) {
+            sh->row(sh, t, y, xa, xb);
+        }
+    }
+}
+
+/**
+ * @brief Úloha poolu pre pás riadkov: spočíta v ňom krok sh->t.
+ *
+ * Pás, ktorý krok dokončí ako posledný, ošetrí cieľ (všetky riadky kroku
+ * sú už hotové) a buď zavolá done, alebo zaradí ostatné pásy ďalšieho kroku
+ * a sám sa vzdá vlákna. Jediný pás nemá na koho čakať, preto počíta kroky
+ * za sebou, kým neuplynie SIM_SLICE_NS.
+ *
+ * @param arg Ukazovateľ na exact_band_t.
+ * @param wake Nepoužité.
+ * @return pool_status_t.
+ */
+static int exact_band_task(void* arg, struct timespec* wake) {
+    exact_band_t* band = (exact_band_t*)arg;
+    exact_shared_t* sh = band->sh;
+    const int64_t slice_end = exact_now_ns() + SIM_SLICE_NS;
+    (void)wake;
+
+    for (;;) {
+        uint32_t t = sh->t;
+        exact_band_step(band, t);
+        if (atomic_fetch_sub(&sh->pending, 1u) != 1u) return POOL_DONE;
+
+        sh->target(sh, t);
+        sh->steps_done = t;
+        if (t == sh->k_max || atomic_load_explicit(sh->stop, memory_order_relaxed)) {
+            /* done môže výpočet uvoľniť - pás sa ho už nedotkne */
+            sh->done(sh->done_arg);
+            return POOL_DONE;
+        }
+
+        sh->t = t + 1u;
+        atomic_store(&sh->pending, sh->nbands);
+        if (sh->nbands == 1) {
+            if (exact_now_ns() >= slice_end) return POOL_YIELD;
+            continue;
+        }
+        for (uint32_t i = 0; i < sh->nbands; i++) {
+            exact_band_t* other = &sh->bands[i];
+            if (other == band) continue;
+            if (pool_submit(sh->pool, exact_band_task, other) != 0) {
+                /* pás sa nezaradil - spočíta sa tu; tento pás ešte nedorazil, takže nie je posledný */
+                exact_band_step(other, t + 1u);
+                atomic_fetch_sub(&sh->pending, 1u);
+            }
+        }
+        return POOL_YIELD;
+    }
+}
+
+/**
+ * @brief Zistí počet pásov riadkov pre presný výpočet.
+ *
+ * @param requested Požadovaný počet (0 = počet jadier).
+ * @param w Šírka sveta.
+ * @param h Výška sveta (viac pásov než riadkov nemá zmysel).
+ * @return Počet pásov (>= 1).
+ */
+static uint32_t exact_band_count(uint32_t requested, int32_t w, int32_t h) {
+    uint32_t n = sim_resolve_threads(requested, (uint32_t)h);
+    uint64_t cells = (uint64_t)w * (uint64_t)h;
+    uint64_t by_cells = cells / EXACT_MIN_CELLS_PER_BAND;
+    if (by_cells < 1) by_cells = 1;
+    if (n > by_cells) n = (uint32_t)by_cells;
+    return n;
+}
+
+/**
+ * @brief Rozpracovaný presný výpočet.
+ */
+struct exact_calc {
+    exact_shared_t sh;       /**< Spoločný stav pásov */
+    double* zero_row;        /**< Riadok núl pre spätný výpočet */
+    exact_band_t bands[SIM_MAX_THREADS]; /**< Pásy riadkov */
+};
+
+/**
+ * @brief Rozdelí riadky sveta na súvislé pásy.
+ *
+ * @param c Výpočet (rozmery musia byť nastavené).
+ * @param requested Požadovaný počet pásov (0 = počet jadier).
+ */
+static void exact_calc_bands(exact_calc_t* c, uint32_t requested) {
+    exact_shared_t* sh = &c->sh;
+    uint32_t n = exact_band_count(requested, sh->w, sh->h);
+
+    /* prvých (h % n) pásov dostane o riadok viac */
+    uint32_t base = (uint32_t)sh->h / n;
+    uint32_t extra = (uint32_t)sh->h % n;
+    int32_t next = 0;
+    for (uint32_t i = 0; i < n; i++) {
+        exact_band_t* band = &c->bands[i];
+        band->sh = sh;
+        band->row_begin = next;
+        band->row_end = next + (int32_t)(base + (i < extra ? 1u : 0u));
+        next = band->row_end;
+    }
+    sh->bands = c->bands;
+    sh->nbands = n;
+}
+
+/**
+ * @brief Naplní spoločné parametre behu (rozmery, pravdepodobnosti, stop).
+ */
+static void exact_shared_init(exact_shared_t* sh, sim_job_t* job) {
+    const double one = (double)PROB_ONE;
+    memset(sh, 0, sizeof(*sh));
+    sh->w = job->width;
+    sh->h = job->height;
+    sh->k_max = job->k_max;
+    sh->pu = (double)job->prob_q[0] / one;
+    sh->pd = (double)job->prob_q[1] / one;
+    sh->pl = (double)job->prob_q[2] / one;
+    sh->pr = (double)job->prob_q[3] / one;
+    sh->stop = &job->stop;
+}
+
+/**
+ * @brief Pripraví dopredný výpočet: štart v strede sveta.
+ *
+ * @param c Výpočet.
+ * @param job Popis behu.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int forward_setup(exact_calc_t* c, const sim_job_t* job) {
+    exact_shared_t* sh = &c->sh;
+    const int32_t w = sh->w;
+    const int32_t h = sh->h;
+    const size_t cells = (size_t)w * (size_t)h;
+
+    sh->row = forward_row;
+    sh->target = forward_target;
+    sh->vsrc = calloc((size_t)h, sizeof(*sh->vsrc));
+    sh->hsrc = calloc((size_t)w, sizeof(*sh->hsrc));
+    sh->buf[0][0] = calloc(cells, sizeof(double));
+    sh->buf[0][1] = calloc(cells, sizeof(double));
+    sh->p_hit = calloc((size_t)job->k_max + 1u, sizeof(double));
+    if (!sh->vsrc || !sh->hsrc || !sh->buf[0][0] || !sh->buf[0][1] || !sh->p_hit) return -1;
+
+    for (int32_t y = 0; y < h; y++) axis_sources(y, h, job->boundary, sh->pu, sh->pd, &sh->vsrc[y]);
+    for (int32_t x = 0; x < w; x++) axis_sources(x, w, job->boundary, sh->pl, sh->pr, &sh->hsrc[x]);
+
+    /* štart v strede sveta s istotou */
+    sh->buf[0][0][(size_t)(h / 2) * (size_t)w + (size_t)(w / 2)] = 1.0;
+    return 0;
+}
+
+/**
+ * @brief Kam vedie krok z okraja osi (i = 0 alebo n-1) podľa režimu okraja.
+ *
+ * @param i Index v osi.
+ * @param delta Smer kroku (-1 alebo +1).
+ * @param n Dĺžka osi (>= 2).
+ * @param mode Režim okraja (boundary_mode_t).
+ * @return Cieľový index, alebo -1 ak krok vedie mimo sveta (BOUND_ABSORB).
+ */
+static int32_t axis_dest(int32_t i, int32_t delta, int32_t n, int mode) {
+    int absorbed = 0;
+    int32_t v = sim_bound_fix(i + delta, i, n, mode, &absorbed);
+    return absorbed ? -1 : v;
+}
+
+/**
+ * @brief Pripraví spätný výpočet: krok do (0,0) je zásah.
+ *
+ * @param c Výpočet.
+ * @param job Popis behu.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int backward_setup(exact_calc_t* c, const sim_job_t* job) {
+    exact_shared_t* sh = &c->sh;
+    const int32_t w = sh->w;
+    const int32_t h = sh->h;
+    const size_t cells = (size_t)w * (size_t)h;
+
+    sh->row = backward_row;
+    sh->target = backward_target;
+    sh->ym = calloc((size_t)h, sizeof(*sh->ym));
+    sh->yp = calloc((size_t)h, sizeof(*sh->yp));
+    c->zero_row = calloc((size_t)w, sizeof(double));
+    sh->zero_row = c->zero_row;
+    for (int f = 0; f < EXACT_FIELDS; f++) {
+        sh->buf[f][0] = calloc(cells, sizeof(double));
+        sh->buf[f][1] = calloc(cells, sizeof(double));
+    }
+    if (!sh->ym || !sh->yp || !c->zero_row || !sh->buf[0][0] || !sh->buf[0][1] ||
+        !sh->buf[1][0] || !sh->buf[1][1]) return -1;
+
+    for (int32_t y = 0; y < h; y++) {
+        sh->ym[y] = axis_dest(y, -1, h, job->boundary);
+        sh->yp[y] = axis_dest(y, +1, h, job->boundary);
+    }
+    sh->xm[0] = axis_dest(0, -1, w, job->boundary);
+    sh->xp[0] = axis_dest(0, +1, w, job->boundary);
+    sh->xm[1] = axis_dest(w - 1, -1, w, job->boundary);
+    sh->xp[1] = axis_dest(w - 1, +1, w, job->boundary);
+
+    /* krok 0: nikto ešte nezasiahol, ale krok do (0,0) je zásah */
+    sh->buf[0][0][0] = 1.0;
+    sh->buf[1][0][0] = 1.0;
+    return 0;
+}
+
+/**
+ * @brief Uvoľní polia výpočtu.
+ *
+ * @param c Výpočet.
+ */
+static void exact_calc_release(exact_calc_t* c) {
+    exact_shared_t* sh = &c->sh;
+    free(sh->vsrc);
+    free(sh->hsrc);
+    free(sh->p_hit);
+    free(sh->ym);
+    free(sh->yp);
+    free(c->zero_row);
+    for (int f = 0; f < EXACT_FIELDS; f++) {
+        free(sh->buf[f][0]);
+        free(sh->buf[f][1]);
+    }
+    free(c);
+}
+
+exact_calc_t* exact_calc_new(sim_job_t* job, int all_starts) {
+    exact_calc_t* c = calloc(1, sizeof(*c));
+    if (!c) {
+        fprintf(stderr, "[server] exact: out of memory\n");
+        return NULL;
+    }
+    exact_shared_init(&c->sh, job);
+
+    int rc = all_starts ? backward_setup(c, job) : forward_setup(c, job);
+    if (rc != 0) {
+        fprintf(stderr, "[server] exact: out of memory (%dx%d, K=%u)\n",
+                job->width, job->height, (unsigned)job->k_max);
+        exact_calc_release(c);
+        return NULL;
+    }
+    exact_calc_bands(c, job->threads);
+    return c;
+}
+
+int exact_calc_submit(exact_calc_t* c, pool_t* pool, sim_done_fn done, void* done_arg) {
+    exact_shared_t* sh = &c->sh;
+    sh->pool = pool;
+    sh->done = done;
+    sh->done_arg = done_arg;
+    sh->t = 1;
+    atomic_init(&sh->pending, sh->nbands);
+
+    /* od prvého zaradenia výpočet uzavrie posledný pás; pás, ktorý sa nepodarilo
+     * zaradiť, sa spočíta hneď a výpočet skončí po prvom kroku (ako shardy) */
+    for (uint32_t i = 0; i < sh->nbands; i++) {
+        if (pool_submit(pool, exact_band_task, &sh->bands[i]) != 0) {
+            if (i == 0) return -1;
+            fprintf(stderr, "[server] exact: failed to queue row band\n");
+            atomic_store(sh->stop, 1);
+            for (uint32_t j = i; j < sh->nbands; j++) {
+                struct timespec unused;
+                (void)exact_band_task(&sh->bands[j], &unused);
+            }
+            break;
+        }
+    }
+    return 0;
+}
+
+int exact_calc_result(exact_calc_t* c, exact_result_t* out) {
+    exact_shared_t* sh = &c->sh;
+    memset(out, 0, sizeof(*out));
+    out->k_max = sh->k_max;
+    out->steps_done = sh->steps_done;
+
+    double sum = 0.0, sum_t = 0.0;
+    double bins[4] = { 0.0, 0.0, 0.0, 0.0 };
+    for (uint32_t t = 1; t <= sh->steps_done; t++) {
+        double p = sh->p_hit[t];
+        sum += p;
+        sum_t += (double)t * p;
+        int bin = (t <= 20u) ? 0 : (t <= 50u) ? 1 : (t <= 100u) ? 2 : 3;
+        bins[bin] += p;
+    }
+    memcpy(out->bins, bins, sizeof(bins));
+    out->p_success = sum;
+    out->mean_steps = (sum > 0.0) ? sum_t / sum : 0.0;
+
+    const double* fin = sh->buf[0][sh->steps_done & 1u];
+    const size_t cells = (size_t)sh->w * (size_t)sh->h;
+    double rem = 0.0;
+    for (size_t i = 0; i < cells; i++) rem += fin[i];
+    out->p_remaining = rem;
+
+    /* rozdelenie prechádza na výsledok */
+    out->p_hit = sh->p_hit;
+    sh->p_hit = NULL;
+    return 0;
+}
+
+int exact_calc_grid(exact_calc_t* c, exact_grid_t* out) {
+    exact_shared_t* sh = &c->sh;
+    const size_t cells = (size_t)sh->w * (size_t)sh->h;
+    memset(out, 0, sizeof(*out));
+    out->width = sh->w;
+    out->height = sh->h;
+    out->k_max = sh->k_max;
+    out->steps_done = sh->steps_done;
+    out->p = calloc(cells, sizeof(double));
+    out->mean = calloc(cells, sizeof(double));
+    if (!out->p || !out->mean) {
+        fprintf(stderr, "[server] exact: out of memory (%dx%d, K=%u)\n", sh->w, sh->h, (unsigned)sh->k_max);
+        exact_grid_free(out);
+        return -1;
+    }
+
+    const double* fa = sh->buf[0][sh->steps_done & 1u];
+    const double* fb = sh->buf[1][sh->steps_done & 1u];
+    for (size_t i = 0; i < cells; i++) {
+        double u = fa[i];
+        double m = fb[i] - fa[i];
+        if (i == 0) {
+            u = sh->target_raw[0];
+            m = sh->target_raw[1] - sh->target_raw[0];
+        }
+        out->p[i] = u;
+        out->mean[i] = (u > 0.0) ? m / u : 0.0;
+    }
+    return 0;
+}
+
+void exact_calc_free(exact_calc_t* c) {
+    if (!c) return;
+    exact_calc_release(c);
+}
+
+void exact_grid_free(exact_grid_t* g) {
+    if (!g) return;
+    free(g->p);
+    free(g->mean);
+    g->p = NULL;
+    g->mean = NULL;
+}
+
+void exact_grid_print(const sim_job_t* job, const exact_grid_t* g) {
+    if (!job || !g || !g->p) return;
+
+    const size_t cells = (size_t)g->width * (size_t)g->height;
+    size_t best = 0;
+    double sum = 0.0;
+    for (size_t i = 0; i < cells; i++) {
+        sum += g->p[i];
+        if (g->p[i] > g->p[best]) best = i;
+    }
+    size_t center = (size_t)(g->height / 2) * (size_t)g->width + (size_t)(g->width / 2);
+
+    printf("\n=== Exact summary (all starts) ===\n");
+    printf("World: %dx%d, Kmax=%u, steps=%u, boundary=%u\n",
+           (int)g->width, (int)g->height, (unsigned)g->k_max,
+           (unsigned)g->steps_done, (unsigned)job->boundary);
+    printf("Center (%d,%d): P=%.9f mean=%.4f\n", (int)(g->width / 2), (int)(g->height / 2),
+           g->p[center], g->mean[center]);
+    printf("Best start (%d,%d): P=%.9f mean=%.4f\n",
+           (int)(best % (size_t)g->width), (int)(best / (size_t)g->width), g->p[best], g->mean[best]);
+    printf("Average P over all starts: %.9f\n", sum / (double)cells);
+    printf("=====================\n\n");
+}
+
+void exact_result_free(exact_result_t* r) {
+    if (!r) return;
+    free(r->p_hit);
+    r->p_hit = NULL;
+}
+
+void exact_print(const sim_job_t* job, const exact_result_t* r) {
+    if (!job || !r) return;
+
+    printf("\n=== Exact summary ===\n");
+    printf("World: %dx%d, Kmax=%u, steps=%u, boundary=%u\n",
+           (int)job->width, (int)job->height, (unsigned)r->k_max,
+           (unsigned)r->steps_done, (unsigned)job->boundary);
+    printf("Probs: U=%u D=%u L=%u R=%u /%u\n",
+           (unsigned)job->prob_q[0], (unsigned)job->prob_q[1],
+           (unsigned)job->prob_q[2], (unsigned)job->prob_q[3], PROB_ONE);
+
+    printf("P(reach (0,0)): %.9f (%.4f%%)\n", r->p_success, 100.0 * r->p_success);
+    printf("P(still walking): %.9f\n", r->p_remaining);
+
+    if (r->p_success > 0.0) {
+        printf("Steps (successful): mean=%.4f\n", r->mean_steps);
+        printf("Histogram P(successful steps):\n");
+        printf("  0-20 : %.9f\n", r->bins[0]);
+        printf("  21-50: %.9f\n", r->bins[1]);
+        printf("  51-100: %.9f\n", r->bins[2]);
+        printf("  101+ : %.9f\n", r->bins[3]);
+    }
+    printf("=====================\n\n");
+}
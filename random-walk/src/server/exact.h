@@ -0,0 +1,142 @@
+/**
+ * @file exact.h
+ * @brief Presný výpočet rozdelenia času zásahu (0,0) šírením pravdepodobnosti.
+ *
+ * Namiesto vzorkovania replikácií sa po krokoch šíri celé rozdelenie polohy
+ * chodca po bunkách sveta (alebo spätne pravdepodobnosť zásahu pre všetky
+ * štarty naraz). Bunka (0,0) je pohlcujúca: hmotnosť, ktorá do nej
+ * v kroku t pritečie, je presne P(prvý zásah v kroku t). Výsledok nemá
+ * šum Monte Carlo a jeho cena nezávisí od počtu replikácií.
+ */
+
+#pragma once
+#include "pool.h"
+#include "simulation.h"
+
+#include <stdint.h>
+
+/** Šírka dlaždice stĺpcov (v bunkách), aby 3 riadky zdroja ostali v L1. */
+#define EXACT_TILE 512
+
+/** Minimálny počet buniek na pás - pri menšom svete sa nevypláca zaraďovať pásy po každom kroku. */
+#define EXACT_MIN_CELLS_PER_BAND 16384u
+
+/**
+ * @brief Výsledok presného výpočtu.
+ */
+typedef struct {
+    uint32_t k_max;          /**< Maximálny počet krokov */
+    uint32_t steps_done;     /**< Počet spočítaných krokov (menej pri prerušení) */
+    double* p_hit;           /**< p_hit[t] = P(prvý zásah v kroku t), t = 1..k_max (p_hit[0] = 0) */
+    double p_success;        /**< Súčet p_hit = P(zásah do k_max krokov) */
+    double p_remaining;      /**< Hmotnosť, ktorá ostala vo svete (nezasiahla, nebola pohltená okrajom) */
+    double mean_steps;       /**< Stredný počet krokov podmienene úspechom */
+    double bins[4];          /**< P(zásah v 0-20, 21-50, 51-100, 101+ krokoch) */
+} exact_result_t;
+
+/**
+ * @brief Výsledok presného výpočtu pre všetky štartovacie bunky naraz.
+ *
+ * Polia majú width * height prvkov v poradí riadkov (index y * width + x).
+ */
+typedef struct {
+    int32_t width, height;   /**< Rozmery sveta */
+    uint32_t k_max;          /**< Maximálny počet krokov */
+    uint32_t steps_done;     /**< Počet spočítaných krokov (menej pri prerušení) */
+    double* p;               /**< P(zásah (0,0) do k_max krokov) pri štarte v bunke */
+    double* mean;            /**< Stredný počet krokov podmienene úspechom (0 ak P = 0) */
+} exact_grid_t;
+
+/** Rozpracovaný presný výpočet (exact_calc_new). */
+typedef struct exact_calc exact_calc_t;
+
+/**
+ * @brief Pripraví presný výpočet pre beh job.
+ *
+ * Použije rozmery, k_max, pravdepodobnosti (prob_q), režim okraja a počet
+ * vlákien z job (ako počet pásov riadkov); reps a seed sa ignorujú. Výpočet
+ * nespúšťa žiadne vlákna - počíta sa až cez exact_calc_submit().
+ *
+ * - dopredný výpočet: rozdelenie času zásahu zo štartu v strede sveta
+ *   (výsledok cez exact_calc_result)
+ * - all_starts: spätná iterácia u_t(s) = súčet p_d * u_{t-1}(cieľ kroku d zo s),
+ *   kde krok do (0,0) má hodnotu 1. Po k_max krokoch je u(s) presne
+ *   P(zásah do k_max krokov) zo štartu s - pre všetky bunky naraz, s rovnakou
+ *   cenou ako jeden dopredný výpočet (výsledok cez exact_calc_grid)
+ *
+ * @param job Popis behu (musí žiť, kým sa výpočet neuvoľní - číta sa job->stop).
+ * @param all_starts 1 = výpočet pre všetky štarty.
+ * @return Výpočet, alebo NULL pri chybe alokácie.
+ */
+exact_calc_t* exact_calc_new(sim_job_t* job, int all_starts);
+
+/**
+ * @brief Zaradí výpočet do poolu a hneď sa vráti.
+ *
+ * Každý pás riadkov je v každom kroku jedna úloha poolu; pás, ktorý krok
+ * dokončí ako posledný, zaradí ďalší krok. Po poslednom kroku (alebo po
+ * job->stop) vlákno poolu zavolá done(done_arg) - až potom sa smie čítať
+ * výsledok a výpočet uvoľniť.
+ *
+ * @param c Výpočet z exact_calc_new().
+ * @param pool Pool vlákien servera.
+ * @param done Callback po dokončení.
+ * @param done_arg Argument pre done.
+ * @return 0 ak je výpočet zaradený (done sa zavolá), -1 pri chybe alokácie (done sa nezavolá).
+ */
+int exact_calc_submit(exact_calc_t* c, pool_t* pool, sim_done_fn done, void* done_arg);
+
+/**
+ * @brief Výsledok skončeného dopredného výpočtu (p_hit prechádza na výsledok).
+ *
+ * @param c Výpočet (bez all_starts).
+ * @param out Výstup (treba ho uvoľniť cez exact_result_free).
+ * @return 0 pri úspechu.
+ */
+int exact_calc_result(exact_calc_t* c, exact_result_t* out);
+
+/**
+ * @brief Výsledok skončeného výpočtu pre všetky štarty.
+ *
+ * @param c Výpočet (s all_starts).
+ * @param out Výstup (po úspechu ho treba uvoľniť cez exact_grid_free).
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+int exact_calc_grid(exact_calc_t* c, exact_grid_t* out);
+
+/**
+ * @brief Uvoľní výpočet (nezaradený, alebo po done).
+ *
+ * @param c Výpočet (môže byť NULL).
+ */
+void exact_calc_free(exact_calc_t* c);
+
+/**
+ * @brief Uvoľní pamäť výsledku presného výpočtu.
+ *
+ * @param r Ukazovateľ na výsledok.
+ */
+void exact_result_free(exact_result_t* r);
+
+/**
+ * @brief Vypíše súhrn presného výpočtu (formát podobný results_print).
+ *
+ * @param job Popis behu (na echo parametrov).
+ * @param r Výsledok.
+ */
+void exact_print(const sim_job_t* job, const exact_result_t* r);
+
+/**
+ * @brief Uvoľní pamäť výsledku pre všetky štarty.
+ *
+ * @param g Ukazovateľ na výsledok.
+ */
+void exact_grid_free(exact_grid_t* g);
+
+/**
+ * @brief Vypíše súhrn výpočtu pre všetky štarty (stred, najlepší štart, priemer).
+ *
+ * @param job Popis behu.
+ * @param g Výsledok.
+ */
+void exact_grid_print(const sim_job_t* job, const exact_grid_t* g);
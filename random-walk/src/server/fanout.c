@@ -0,0 +1,266 @@
+/**
+ * @file fanout.c
+ * @brief Implementácia rozosielania priebehu pozorovateľom.
+ */
+
+#include "fanout.h"
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+/** Najviac bufferov odoslaných jedným sendmsg(). */
+#define FAN_IOV_MAX 16
+
+fan_buf_t* fan_buf_new(uint32_t len, uint8_t keep) {
+    fan_buf_t* b = malloc(sizeof(*b) + len);
+    if (!b) return NULL;
+    atomic_init(&b->refs, 1);
+    b->len = len;
+    b->keep = keep;
+    return b;
+}
+
+fan_buf_t* fan_buf_msg(msg_type_t type, const void* payload, uint32_t len) {
+    fan_buf_t* b = fan_buf_new((uint32_t)sizeof(msg_header_t) + len, 1);
+    if (!b) return NULL;
+    msg_header_t h;
+    h.type = htonl((uint32_t)type);
+    h.length = htonl(len);
+    memcpy(b->data, &h, sizeof(h));
+    if (len > 0) memcpy(b->data + sizeof(h), payload, len);
+    return b;
+}
+
+void fan_buf_put(fan_buf_t* b) {
+    if (b && atomic_fetch_sub(&b->refs, 1) == 1) free(b);
+}
+
+int fan_sub_init(fan_sub_t* sub, int fd, int grow) {
+    memset(sub, 0, sizeof(*sub));
+    sub->q = malloc(FAN_QUEUE_MAX * sizeof(*sub->q));
+    if (!sub->q) return -1;
+    sub->fd = fd;
+    sub->cap = FAN_QUEUE_MAX;
+    sub->grow = grow;
+    pthread_mutex_init(&sub->mtx, NULL);
+    return 0;
+}
+
+void fan_sub_free(fan_sub_t* sub) {
+    for (uint32_t i = 0; i < sub->count; i++) {
+        fan_buf_put(sub->q[(sub->head + i) % sub->cap]);
+    }
+    sub->count = 0;
+    free(sub->q);
+    sub->q = NULL;
+    pthread_mutex_destroy(&sub->mtx);
+}
+
+/**
+ * @brief Zdvojnásobí kapacitu frontu (buffery ostanú v poradí od indexu 0).
+ *
+ * @param sub Pozorovateľ (volajúci drží mtx).
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int sub_grow(fan_sub_t* sub) {
+    if (sub->cap > UINT32_MAX / 2u) return -1;
+    fan_buf_t** q = malloc((size_t)sub->cap * 2u * sizeof(*q));
+    if (!q) return -1;
+    for (uint32_t i = 0; i < sub->count; i++) q[i] = sub->q[(sub->head + i) % sub->cap];
+    free(sub->q);
+    sub->q = q;
+    sub->head = 0;
+    sub->cap *= 2u;
+    return 0;
+}
+
+/**
+ * @brief Zahodí najstarší buffer priebehu, ktorý sa práve neodosiela.
+ *
+ * Ostatné buffery sa posunú, aby front ostal súvislý a v poradí.
+ *
+ * @param sub Pozorovateľ (volajúci drží mtx).
+ * @return 1 ak sa niečo zahodilo, 0 ak vo fronte nie je čo zahodiť.
+ */
+static int sub_drop_oldest(fan_sub_t* sub) {
+    /* rozposlaný buffer (off > 0) sa dokončí, inak by sa rozbili rámce */
+    for (uint32_t i = (sub->off > 0) ? 1u : 0u; i < sub->count; i++) {
+        fan_buf_t* b = sub->q[(sub->head + i) % sub->cap];
+        if (b->keep) continue;
+
+        for (uint32_t j = i; j + 1 < sub->count; j++) {
+            sub->q[(sub->head + j) % sub->cap] = sub->q[(sub->head + j + 1) % sub->cap];
+        }
+        sub->count--;
+        sub->bytes -= b->len;
+        sub->dropped++;
+        fan_buf_put(b);
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Označí pozorovateľa ako zlyhaného a uzavrie jeho socket.
+ *
+ * @param sub Pozorovateľ (volajúci drží mtx).
+ * @return -1.
+ */
+static int sub_fail(fan_sub_t* sub) {
+    if (!sub->failed) {
+        sub->failed = 1;
+        shutdown(sub->fd, SHUT_RDWR);
+    }
+    return -1;
+}
+
+/**
+ * @brief Pošle z frontu, koľko socket prijme bez čakania.
+ *
+ * @param sub Pozorovateľ (volajúci drží mtx).
+ * @return 0 pri úspechu, -1 pri chybe zápisu.
+ */
+static int sub_flush_locked(fan_sub_t* sub) {
+    while (sub->count > 0) {
+        struct iovec iov[FAN_IOV_MAX];
+        int n = 0;
+        for (uint32_t i = 0; i < sub->count && n < FAN_IOV_MAX; i++, n++) {
+            fan_buf_t* b = sub->q[(sub->head + i) % sub->cap];
+            uint32_t skip = (i == 0) ? sub->off : 0u;
+            iov[n].iov_base = b->data + skip;
+            iov[n].iov_len = b->len - skip;
+        }
+
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_iov = iov;
+        msg.msg_iovlen = (size_t)n;
+        ssize_t sent = sendmsg(sub->fd, &msg, MSG_DONTWAIT | MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EINTR) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) return 0; /* dopošle sa pri EPOLLOUT */
+            return sub_fail(sub);
+        }
+
+        size_t left = (size_t)sent;
+        sub->bytes -= left;
+        while (left > 0) {
+            fan_buf_t* b = sub->q[sub->head];
+            size_t rest = b->len - sub->off;
+            if (left < rest) {
+                sub->off += (uint32_t)left;
+                break;
+            }
+            left -= rest;
+            sub->off = 0;
+            sub->head = (sub->head + 1u) % sub->cap;
+            sub->count--;
+            fan_buf_put(b);
+        }
+    }
+    return 0;
+}
+
+int fan_sub_push(fan_sub_t* sub, fan_buf_t* b) {
+    pthread_mutex_lock(&sub->mtx);
+    if (sub->failed) {
+        pthread_mutex_unlock(&sub->mtx);
+        return -1;
+    }
+
+    /* zahltený pozorovateľ stratí najstaršie dáta priebehu, nie riadiace správy */
+    while (sub->count > 0 &&
+           ((!sub->grow && sub->count == sub->cap) || (!b->keep && sub->bytes + b->len > FAN_QUEUE_BYTES))) {
+        if (!sub_drop_oldest(sub)) break;
+    }
+    if (sub->count == sub->cap && sub->grow && b->keep) (void)sub_grow(sub);
+
+    int rc = 0;
+    if (sub->count == sub->cap) {
+        if (b->keep) rc = sub_fail(sub);
+        else sub->dropped++;
+    } else if (!b->keep && sub->bytes + b->len > FAN_QUEUE_BYTES) {
+        sub->dropped++;
+    } else {
+        atomic_fetch_add(&b->refs, 1);
+        sub->q[(sub->head + sub->count) % sub->cap] = b;
+        sub->count++;
+        sub->bytes += b->len;
+        rc = sub_flush_locked(sub);
+    }
+    pthread_mutex_unlock(&sub->mtx);
+    return rc;
+}
+
+int fan_sub_flush(fan_sub_t* sub) {
+    pthread_mutex_lock(&sub->mtx);
+    int rc = sub->failed ? -1 : sub_flush_locked(sub);
+    pthread_mutex_unlock(&sub->mtx);
+    return rc;
+}
+
+uint64_t fan_sub_bytes(fan_sub_t* sub) {
+    pthread_mutex_lock(&sub->mtx);
+    uint64_t n = sub->bytes;
+    pthread_mutex_unlock(&sub->mtx);
+    return n;
+}
+
+void fan_sub_stop(fan_sub_t* sub) {
+    pthread_mutex_lock(&sub->mtx);
+    sub->failed = 1;
+    pthread_mutex_unlock(&sub->mtx);
+}
+
+void fan_init(fan_t* f) {
+    memset(f, 0, sizeof(*f));
+    pthread_mutex_init(&f->mtx, NULL);
+}
+
+void fan_destroy(fan_t* f) {
+    pthread_mutex_destroy(&f->mtx);
+}
+
+int fan_add(fan_t* f, fan_sub_t* sub) {
+    pthread_mutex_lock(&f->mtx);
+    int rc = -1;
+    if (f->n < FAN_MAX_SUBS) {
+        f->subs[f->n++] = sub;
+        rc = 0;
+    }
+    pthread_mutex_unlock(&f->mtx);
+    return rc;
+}
+
+void fan_remove(fan_t* f, fan_sub_t* sub) {
+    pthread_mutex_lock(&f->mtx);
+    for (uint32_t i = 0; i < f->n; i++) {
+        if (f->subs[i] == sub) {
+            f->subs[i] = f->subs[--f->n];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&f->mtx);
+}
+
+uint32_t fan_count(fan_t* f) {
+    pthread_mutex_lock(&f->mtx);
+    uint32_t n = f->n;
+    pthread_mutex_unlock(&f->mtx);
+    return n;
+}
+
+void fan_publish(fan_t* f, fan_buf_t* b) {
+    pthread_mutex_lock(&f->mtx);
+    for (uint32_t i = 0; i < f->n; i++) (void)fan_sub_push(f->subs[i], b);
+    pthread_mutex_unlock(&f->mtx);
+}
+
+void fan_shutdown(fan_t* f) {
+    pthread_mutex_lock(&f->mtx);
+    for (uint32_t i = 0; i < f->n; i++) shutdown(f->subs[i]->fd, SHUT_RDWR);
+    pthread_mutex_unlock(&f->mtx);
+}
@@ -0,0 +1,202 @@
+/**
+ * @file fanout.h
+ * @brief Rozosielanie priebehu behu viacerým pozorovateľom (MSG_SUBSCRIBE).
+ *
+ * Správy sa zakódujú raz do bufferu s počítadlom referencií (fan_buf_t),
+ * ktorý zdieľajú fronty všetkých pozorovateľov - pre ďalšieho pozorovateľa
+ * sa nič nekopíruje. Každý pozorovateľ (fan_sub_t) má vlastný front a píše
+ * sa doň iba neblokujúco; čo sa nezmestí do socketu, dopošle event slučka
+ * pri EPOLLOUT. Pomalý pozorovateľ tak nebrzdí simuláciu ani ostatných -
+ * pri zahltení stratí najstaršie dáta priebehu.
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+
+/** Najviac neodoslaných bajtov priebehu na jedného pozorovateľa; staršie sa zahodia. */
+#define FAN_QUEUE_BYTES (1024u * 1024u)
+
+/** Najviac bufferov vo fronte jedného pozorovateľa (počiatočná kapacita frontu s grow). */
+#define FAN_QUEUE_MAX 256u
+
+/** Najviac pozorovateľov jednej relácie. */
+#define FAN_MAX_SUBS 32u
+
+/**
+ * @brief Zakódované správy zdieľané frontmi pozorovateľov.
+ */
+typedef struct {
+    atomic_int refs;         /**< Počet referencií (tvorca + fronty) */
+    uint32_t len;            /**< Počet platných bajtov v data */
+    uint8_t keep;            /**< 1 = riadiaca správa (MSG_DONE, výsledky), pri zahltení sa nezahadzuje */
+    unsigned char data[];    /**< Celé správy (hlavička + payload) */
+} fan_buf_t;
+
+/**
+ * @brief Jeden pozorovateľ: socket a front bufferov na odoslanie.
+ */
+typedef struct {
+    int fd;                  /**< Socket pozorovateľa */
+    pthread_mutex_t mtx;     /**< Chráni front (píše vlákno behu aj event slučka) */
+    fan_buf_t** q;           /**< Kruhový front bufferov */
+    uint32_t cap;            /**< Kapacita q */
+    int grow;                /**< 1 = pri plnom fronte sa riadiace správy nezahadzujú, q sa zväčší */
+    uint32_t head;           /**< Index prvého neodoslaného bufferu */
+    uint32_t count;          /**< Počet bufferov vo fronte */
+    uint32_t off;            /**< Odoslané bajty z q[head] */
+    uint64_t bytes;          /**< Neodoslané bajty vo fronte */
+    uint64_t dropped;        /**< Zahodené buffery priebehu */
+    int failed;              /**< 1 = zápis zlyhal alebo pretiekli riadiace správy */
+} fan_sub_t;
+
+/**
+ * @brief Zoznam pozorovateľov jednej relácie.
+ */
+typedef struct {
+    pthread_mutex_t mtx;     /**< Chráni zoznam; drží sa aj počas rozosielania */
+    fan_sub_t* subs[FAN_MAX_SUBS]; /**< Pozorovatelia */
+    uint32_t n;              /**< Počet pozorovateľov */
+} fan_t;
+
+/**
+ * @brief Alokuje prázdny buffer (refs = 1).
+ *
+ * @param len Počet bajtov dát.
+ * @param keep 1 ak sa buffer nesmie zahodiť.
+ * @return Buffer, alebo NULL pri chybe alokácie.
+ */
+fan_buf_t* fan_buf_new(uint32_t len, uint8_t keep);
+
+/**
+ * @brief Zakóduje jednu správu do nového bufferu s keep = 1.
+ *
+ * @param type Typ správy.
+ * @param payload Payload (môže byť NULL pri len = 0).
+ * @param len Dĺžka payloadu.
+ * @return Buffer, alebo NULL pri chybe alokácie.
+ */
+fan_buf_t* fan_buf_msg(msg_type_t type, const void* payload, uint32_t len);
+
+/**
+ * @brief Uvoľní referenciu na buffer; poslednou sa buffer zruší.
+ *
+ * @param b Buffer (môže byť NULL).
+ */
+void fan_buf_put(fan_buf_t* b);
+
+/**
+ * @brief Inicializuje pozorovateľa s prázdnym frontom.
+ *
+ * @param sub Pozorovateľ.
+ * @param fd Socket pozorovateľa.
+ * @param grow 1 = front vlastníka relácie (riadiace správy bez limitu), 0 = pozorovateľ.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+int fan_sub_init(fan_sub_t* sub, int fd, int grow);
+
+/**
+ * @brief Uvoľní buffery vo fronte pozorovateľa (socket nezatvára).
+ *
+ * @param sub Pozorovateľ.
+ */
+void fan_sub_free(fan_sub_t* sub);
+
+/**
+ * @brief Zaradí buffer do frontu pozorovateľa a skúsi ho hneď odoslať.
+ *
+ * Ak by front prekročil FAN_QUEUE_BYTES alebo FAN_QUEUE_MAX, zahodia sa
+ * najstaršie neodosielané buffery priebehu (prípadne aj nový). Ak sa nedá
+ * zaradiť ani riadiaca správa, pozorovateľ zlyhá a jeho socket sa uzavrie
+ * cez shutdown() - event slučka ho potom odpojí. Front s grow sa pre
+ * riadiacu správu zväčší (limit FAN_QUEUE_BYTES platí iba pre priebeh).
+ *
+ * @param sub Pozorovateľ.
+ * @param b Buffer (pridá sa referencia).
+ * @return 0 pri úspechu, -1 ak pozorovateľ zlyhal.
+ */
+int fan_sub_push(fan_sub_t* sub, fan_buf_t* b);
+
+/**
+ * @brief Pošle z frontu, koľko socket prijme bez čakania (pri EPOLLOUT).
+ *
+ * @param sub Pozorovateľ.
+ * @return 0 pri úspechu, -1 ak pozorovateľ zlyhal.
+ */
+int fan_sub_flush(fan_sub_t* sub);
+
+/**
+ * @brief Počet bajtov, ktoré ešte čakajú vo fronte.
+ *
+ * @param sub Pozorovateľ.
+ * @return Neodoslané bajty.
+ */
+uint64_t fan_sub_bytes(fan_sub_t* sub);
+
+/**
+ * @brief Ukončí zápisy do socketu (pred jeho zatvorením); ďalšie push/flush vrátia -1.
+ *
+ * @param sub Pozorovateľ.
+ */
+void fan_sub_stop(fan_sub_t* sub);
+
+/**
+ * @brief Inicializuje prázdny zoznam pozorovateľov.
+ *
+ * @param f Zoznam.
+ */
+void fan_init(fan_t* f);
+
+/**
+ * @brief Zruší zoznam (pozorovatelia v ňom už nie sú).
+ *
+ * @param f Zoznam.
+ */
+void fan_destroy(fan_t* f);
+
+/**
+ * @brief Pridá pozorovateľa.
+ *
+ * @param f Zoznam.
+ * @param sub Pozorovateľ.
+ * @return 0 pri úspechu, -1 ak je zoznam plný.
+ */
+int fan_add(fan_t* f, fan_sub_t* sub);
+
+/**
+ * @brief Odoberie pozorovateľa; po návrate doň už nikto nepíše.
+ *
+ * @param f Zoznam.
+ * @param sub Pozorovateľ.
+ */
+void fan_remove(fan_t* f, fan_sub_t* sub);
+
+/**
+ * @brief Počet pozorovateľov.
+ *
+ * @param f Zoznam.
+ * @return Počet pozorovateľov.
+ */
+uint32_t fan_count(fan_t* f);
+
+/**
+ * @brief Rozošle buffer všetkým pozorovateľom (každý dostane referenciu).
+ *
+ * Nikdy nečaká na socket pozorovateľa.
+ *
+ * @param f Zoznam.
+ * @param b Buffer (referencia volajúceho ostáva jeho).
+ */
+void fan_publish(fan_t* f, fan_buf_t* b);
+
+/**
+ * @brief Uzavrie sockety všetkých pozorovateľov (shutdown), napr. keď relácia skončila.
+ *
+ * Event slučka ich potom odpojí ako pri bežnom odpojení.
+ *
+ * @param f Zoznam.
+ */
+void fan_shutdown(fan_t* f);
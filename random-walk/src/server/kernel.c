@@ -0,0 +1,276 @@
+/**
+ * @file kernel.c
+ * @brief Skalárne a SIMD jadrá chodca pre beh bez živého výstupu.
+ *
+ * SIMD jadro je napísané raz pomocou GCC vektorových typov a skompiluje sa
+ * viackrát s rôznym cieľom (target("avx2"), target("sse4.1")). Výber
+ * správnej verzie sa robí za behu cez __builtin_cpu_supports().
+ */
+
+#include "kernel.h"
+#include "rng.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @brief Spoločné telo skalárneho jadra; mode je v každom variante konštanta.
+ */
+static inline __attribute__((always_inline))
+void kernel_scalar_body(sim_job_t* job, uint32_t rep_begin, uint32_t rep_end, results_t* out, int mode) {
+    for (uint32_t r = rep_begin; r < rep_end; r++) {
+        if (atomic_load_explicit(&job->stop, memory_order_relaxed)) break;
+
+        rng_stream_t rng;
+        rng_stream_init(&rng, job->seed, r, 0);
+
+        int32_t x = job->width / 2;
+        int32_t y = job->height / 2;
+        uint32_t step = 0;
+        int success = 0;
+
+        while (step < job->k_max) {
+            int d = sim_pick_dir(&job->dirs, rng_next_u16(&rng));
+            int absorbed = sim_move(&x, &y, d, job->width, job->height, mode);
+            step++;
+            if (absorbed) break;
+            if (x == 0 && y == 0) {
+                success = 1;
+                break;
+            }
+        }
+
+        results_record_rep(out, step, success);
+    }
+}
+
+/** Vygeneruje skalárne jadro kernel_run_scalar_<name> pre jeden režim okraja. */
+#define KERNEL_SCALAR_VARIANT(name, mode)                                              \
+    static void kernel_run_scalar_##name(sim_job_t* job, uint32_t rep_begin,           \
+                                         uint32_t rep_end, results_t* out) {           \
+        kernel_scalar_body(job, rep_begin, rep_end, out, mode);                        \
+    }
+
+KERNEL_SCALAR_VARIANT(torus, BOUND_TORUS)
+KERNEL_SCALAR_VARIANT(reflect, BOUND_REFLECT)
+KERNEL_SCALAR_VARIANT(absorb, BOUND_ABSORB)
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+
+typedef int32_t v8si __attribute__((vector_size(32)));
+typedef uint32_t v8su __attribute__((vector_size(32)));
+typedef uint64_t v4du __attribute__((vector_size(32)));
+
+/**
+ * @brief 32x32->64 násobenie pre 8 lanes: vráti dolné a horné polovice súčinov.
+ *
+ * Vektor sa interpretuje ako 4 x 64 bitov; párne a nepárne lanes sa násobia
+ * zvlášť (maskovanie dolných 32 bitov kompilátor preloží na pmuludq).
+ */
+#define MULHILO_V8(a, m, hi, lo) do {                                        \
+        const v4du mask_ = { 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu, 0xFFFFFFFFu }; \
+        v4du a_ = (v4du)(a);                                                 \
+        v4du pe_ = (a_ & mask_) * (uint64_t)(m);                             \
+        v4du po_ = (a_ >> 32) * (uint64_t)(m);                               \
+        (lo) = (v8su)((pe_ & mask_) | (po_ << 32));                          \
+        (hi) = (v8su)((pe_ >> 32) | (po_ & ~mask_));                         \
+    } while (0)
+
+/**
+ * @brief Jedno kolo Philox4x32 naraz pre 8 lanes (vektorové c0..c3, skalárny kľúč).
+ */
+#define PHILOX_ROUND_V8(c0, c1, c2, c3, k0, k1) do {                       \
+        v8su hi0_, lo0_, hi1_, lo1_;                                         \
+        MULHILO_V8(c0, PHILOX_M0, hi0_, lo0_);                               \
+        MULHILO_V8(c2, PHILOX_M1, hi1_, lo1_);                               \
+        (c0) = hi1_ ^ (c1) ^ (k0);                                           \
+        (c2) = hi0_ ^ (c3) ^ (k1);                                           \
+        (c1) = lo1_;                                                         \
+        (c3) = lo0_;                                                         \
+    } while (0)
+
+/**
+ * @brief Test, či je niektorý lane masky nenulový.
+ *
+ * @param m Ukazovateľ na masku (-1 / 0 v každom lane).
+ * @return 1 ak je aspoň jeden lane nastavený.
+ */
+static inline __attribute__((always_inline)) int mask_any(const v8si* m) {
+    uint64_t w[4];
+    memcpy(w, m, sizeof(w));
+    return (w[0] | w[1] | w[2] | w[3]) != 0;
+}
+
+/**
+ * @brief Spoločné telo SIMD jadra (inlinuje sa do verzií pre jednotlivé ISA).
+ *
+ * Lanes bežia v "epochách" po 8 krokoch: na začiatku epochy sa voľné lanes
+ * naplnia novými replikáciami a pre všetky lanes sa naraz vygeneruje blok
+ * Philox (8 x 16 bitov = 8 krokov). Keďže nová replikácia začína vždy na
+ * hranici epochy, krok každého lane je v rámci epochy zarovnaný a lane
+ * dostane presne tie isté náhodné bity ako skalárna verzia. Lane, ktorý
+ * dosiahne (0,0), k_max alebo je pohltený okrajom, sa v maske active vypne
+ * a jeho výsledok sa zaznamená; do konca epochy sa už nehýbe. Režim okraja
+ * mode je v každom vygenerovanom variante konštanta.
+ */
+static inline __attribute__((always_inline))
+void kernel_simd_body(sim_job_t* job, uint32_t rep_begin, uint32_t rep_end, results_t* out, int mode) {
+    const sim_dir_table_t* t = &job->dirs;
+    const v8si thresh = { (int32_t)t->thresh[0], (int32_t)t->thresh[1], (int32_t)t->thresh[2], (int32_t)t->thresh[3],
+                          (int32_t)t->thresh[0], (int32_t)t->thresh[1], (int32_t)t->thresh[2], (int32_t)t->thresh[3] };
+    const v8si alias = { (int32_t)t->alias[0], (int32_t)t->alias[1], (int32_t)t->alias[2], (int32_t)t->alias[3],
+                         (int32_t)t->alias[0], (int32_t)t->alias[1], (int32_t)t->alias[2], (int32_t)t->alias[3] };
+
+    const int32_t w = job->width;
+    const int32_t h = job->height;
+    const v8si zero = { 0, 0, 0, 0, 0, 0, 0, 0 };
+    const v8si wv = zero + w;
+    const v8si hv = zero + h;
+    const v8si wm1 = wv - 1;
+    const v8si hm1 = hv - 1;
+    const v8si wm2 = wv - 2;
+    const v8si hm2 = hv - 2;
+    const v8si one = zero + 1;
+    const v8si kv = zero + (int32_t)job->k_max;
+
+    uint32_t key[2];
+    rng_key_from_seed(job->seed, key);
+
+    /* štruktúra polí: jeden vektor na každú veličinu, lane = replikácia */
+    v8si x = zero, y = zero, step = zero, rep = zero, active = zero;
+    uint32_t next_rep = rep_begin;
+
+    for (;;) {
+        int any_active = 0;
+        for (int l = 0; l < KERNEL_LANES; l++) {
+            if (!active[l] && next_rep < rep_end) {
+                rep[l] = (int32_t)next_rep++;
+                x[l] = w / 2;
+                y[l] = h / 2;
+                step[l] = 0;
+                active[l] = -1;
+            }
+            any_active |= active[l];
+        }
+        if (!any_active) break;
+        if (atomic_load_explicit(&job->stop, memory_order_relaxed)) break;
+
+        /* blok Philox pre všetky lanes: počítadlo (step/8, rep, 0, 0) */
+        v8su c0 = (v8su)(step >> 3);
+        v8su c1 = (v8su)rep;
+        v8su c2 = (v8su)zero;
+        v8su c3 = (v8su)zero;
+        uint32_t k0 = key[0], k1 = key[1];
+        for (int round = 0; round < 10; round++) {
+            PHILOX_ROUND_V8(c0, c1, c2, c3, k0, k1);
+            k0 += PHILOX_W0;
+            k1 += PHILOX_W1;
+        }
+        const v8su words[4] = { c0, c1, c2, c3 };
+
+        for (uint32_t j = 0; j < RNG_BLOCK_HALVES; j++) {
+            v8si r = (v8si)((words[j >> 1] >> ((j & 1u) * 16u)) & 0xFFFFu);
+            v8si col = r & 3;
+            v8si u = r >> 2;
+            v8si below = u < __builtin_shuffle(thresh, col);
+            v8si dir = (col & below) | (__builtin_shuffle(alias, col) & ~below);
+
+            /* porovnania dávajú -1/0: LEFT -> dx=-1, RIGHT -> dx=+1, UP -> dy=-1 */
+            v8si nx = x + (((dir == 2) - (dir == 3)) & active);
+            v8si ny = y + (((dir == 0) - (dir == 1)) & active);
+
+            /* okraj: porovnanie a výber, bez % */
+            v8si xlo = nx < zero, xhi = nx == wv;
+            v8si ylo = ny < zero, yhi = ny == hv;
+            v8si gone = zero;
+            if (mode == BOUND_TORUS) {
+                x = (wm1 & xlo) | (nx & ~xlo & ~xhi);
+                y = (hm1 & ylo) | (ny & ~ylo & ~yhi);
+            } else if (mode == BOUND_REFLECT) {
+                x = (one & xlo) | (wm2 & xhi) | (nx & ~(xlo | xhi));
+                y = (one & ylo) | (hm2 & yhi) | (ny & ~(ylo | yhi));
+            } else {
+                gone = xlo | xhi | ylo | yhi;
+                x = (x & gone) | (nx & ~gone);
+                y = (y & gone) | (ny & ~gone);
+            }
+
+            step -= active; /* active je -1 -> +1 krok */
+
+            v8si hit = (x == zero) & (y == zero) & ~gone & active;
+            v8si done = hit | ((gone | (step == kv)) & active);
+            if (mask_any(&done)) {
+                for (int l = 0; l < KERNEL_LANES; l++) {
+                    if (!done[l]) continue;
+                    results_record_rep(out, (uint32_t)step[l], hit[l] != 0);
+                    active[l] = 0;
+                }
+            }
+        }
+    }
+}
+
+/** Vygeneruje SIMD jadro kernel_run_<isa>_<name> pre jednu ISA a jeden režim okraja. */
+#define KERNEL_SIMD_VARIANT(isa, target_isa, name, mode)                               \
+    __attribute__((target(target_isa)))                                                \
+    static void kernel_run_##isa##_##name(sim_job_t* job, uint32_t rep_begin,          \
+                                          uint32_t rep_end, results_t* out) {          \
+        kernel_simd_body(job, rep_begin, rep_end, out, mode);                          \
+    }
+
+KERNEL_SIMD_VARIANT(avx2, "avx2", torus, BOUND_TORUS)
+KERNEL_SIMD_VARIANT(avx2, "avx2", reflect, BOUND_REFLECT)
+KERNEL_SIMD_VARIANT(avx2, "avx2", absorb, BOUND_ABSORB)
+KERNEL_SIMD_VARIANT(sse41, "sse4.1", torus, BOUND_TORUS)
+KERNEL_SIMD_VARIANT(sse41, "sse4.1", reflect, BOUND_REFLECT)
+KERNEL_SIMD_VARIANT(sse41, "sse4.1", absorb, BOUND_ABSORB)
+
+#define KERNEL_HAVE_X86 1
+#endif
+
+sim_kernel_fn kernel_select(uint8_t boundary, const char** name) {
+    /* tabuľky variantov indexované režimom okraja (boundary_mode_t) */
+    static const sim_kernel_fn scalar[BOUND_COUNT] = {
+        kernel_run_scalar_torus, kernel_run_scalar_reflect, kernel_run_scalar_absorb
+    };
+#ifdef KERNEL_HAVE_X86
+    static const sim_kernel_fn avx2[BOUND_COUNT] = {
+        kernel_run_avx2_torus, kernel_run_avx2_reflect, kernel_run_avx2_absorb
+    };
+    static const sim_kernel_fn sse41[BOUND_COUNT] = {
+        kernel_run_sse41_torus, kernel_run_sse41_reflect, kernel_run_sse41_absorb
+    };
+#endif
+
+    if (boundary >= BOUND_COUNT) boundary = BOUND_TORUS;
+
+    const char* force = getenv("RW_KERNEL");
+    const char* chosen = "scalar";
+    sim_kernel_fn fn = scalar[boundary];
+
+#ifdef KERNEL_HAVE_X86
+    __builtin_cpu_init();
+    int has_avx2 = __builtin_cpu_supports("avx2");
+    int has_sse41 = __builtin_cpu_supports("sse4.1");
+
+    /* SSE4.1 nemá 64-bitové násobenie pre 8 lanes ani variabilný shuffle
+     * 32-bitových prvkov, takže vyjde pomalšie než skalárne jadro - použije
+     * sa len na vyžiadanie (RW_KERNEL=sse41) */
+    if (force && strcmp(force, "scalar") == 0) {
+        /* ostane skalárne */
+    } else if (force && strcmp(force, "sse41") == 0) {
+        if (has_sse41) {
+            fn = sse41[boundary];
+            chosen = "sse41";
+        }
+    } else if (has_avx2) {
+        fn = avx2[boundary];
+        chosen = "avx2";
+    }
+#else
+    (void)force;
+#endif
+
+    if (name) *name = chosen;
+    return fn;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file kernel.h
+ * @brief Výpočtové jadrá chodca pre beh bez živého výstupu.
+ *
+ * Keď sa neposielajú stavy po krokoch a beh nie je časovaný, replikácie sa
+ * počítajú v dávkach jadrom, ktoré nemusí po každom kroku volať callback.
+ * K dispozícii je skalárne referenčné jadro a SIMD jadro, ktoré posúva 8
+ * replikácií naraz (pozície v štruktúre polí, jeden lane = jedna replikácia).
+ * SIMD variant sa vyberá za behu podľa CPU (AVX2, SSE4.1), takže tá istá
+ * binárka beží všade. Všetky jadrá dávajú bitovo rovnaké výsledky ako
+ * skalárna slučka v simulation.c.
+ */
+
+#pragma once
+#include "results.h"
+#include "simulation.h"
+
+#include <stdint.h>
+
+/** Počet replikácií, ktoré SIMD jadro posúva naraz. */
+#define KERNEL_LANES 8
+
+/** Počet režimov okraja (boundary_mode_t) - pre každý je vlastný variant jadra. */
+#define BOUND_COUNT 3
+
+/**
+ * @brief Jadro, ktoré odsimuluje replikácie [rep_begin, rep_end) behu job.
+ *
+ * Výsledky pripočíta do out. Zastavenie sa kontroluje cez job->stop.
+ *
+ * @param job Popis behu (rozmery, k_max, seed, alias tabuľka).
+ * @param rep_begin Prvá replikácia (0-based, vrátane).
+ * @param rep_end Koniec rozsahu (0-based, bez).
+ * @param out Štatistika, do ktorej sa zaznamenajú replikácie.
+ */
+typedef void (*sim_kernel_fn)(sim_job_t* job, uint32_t rep_begin, uint32_t rep_end, results_t* out);
+
+/**
+ * @brief Vyberie najlepšie dostupné jadro pre tento procesor a režim okraja.
+ *
+ * Každý režim okraja má vlastný variant jadra vygenerovaný makrom, takže
+ * sa v najhorúcejšej slučke nevetví podľa režimu.
+ *
+ * Automaticky sa volí AVX2, inak skalárne jadro. Premenná prostredia
+ * RW_KERNEL (scalar / sse41 / avx2) vynúti konkrétne jadro, ak ho CPU
+ * podporuje - na porovnávanie ekvivalencie a výkonu.
+ *
+ * @param boundary Režim okraja (boundary_mode_t).
+ * @param name Výstupný názov zvoleného jadra (môže byť NULL).
+ * @return Ukazovateľ na jadro.
+ */
+sim_kernel_fn kernel_select(uint8_t boundary, const char** name);
@@ -5,15 +5,19 @@
  * Spúšťa TCP server pre simuláciu náhodnej prechádzky.
  */
 
+#include "checkpoint.h"
 #include "server.h"
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 
 /**
  * @brief Vstupný bod serverovej aplikácie.
  *
  * Spracúva argumenty príkazového riadka:
- * - argv[1]: Číslo portu (predvolené: 5555)
+ * - Číslo portu (predvolené: 5555)
+ * - --data-dir DIR: priečinok na cache výsledkov (predvolene sa nič neukladá)
+ * - --checkpoint-ms N: interval checkpointov dlhých behov (0 = vypnuté)
  *
  * @param argc Počet argumentov.
  * @param argv Pole argumentov.
@@ -21,6 +25,12 @@
  */
 int main(int argc, char** argv) {
     uint16_t port = 5555;
-    if (argc >= 2) port = (uint16_t)atoi(argv[1]);
-    return server_run(port);
+    const char* data_dir = NULL;
+    uint32_t ckpt_ms = CKPT_MS_DEFAULT;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--data-dir") == 0 && i + 1 < argc) data_dir = argv[++i];
+        else if (strcmp(argv[i], "--checkpoint-ms") == 0 && i + 1 < argc) ckpt_ms = (uint32_t)strtoul(argv[++i], NULL, 10);
+        else port = (uint16_t)atoi(argv[i]);
+    }
+    return server_run(port, data_dir, ckpt_ms);
 }
@@ -0,0 +1,374 @@
+/**
+ * @file pool.c
+ * @brief Implementácia poolu vlákien s kradnutím práce.
+ */
+
+#include "pool.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+
+/** Počiatočná kapacita fronty jedného vlákna (zväčšuje sa podľa potreby). */
+#define POOL_DEQUE_CAP 64u
+
+/**
+ * @brief Jedna úloha v poole.
+ */
+typedef struct {
+    pool_fn fn;              /**< Funkcia úlohy */
+    void* arg;               /**< Argument úlohy */
+    struct timespec wake;    /**< Čas pokračovania pri POOL_SLEEP */
+} pool_task_t;
+
+/**
+ * @brief Fronta úloh jedného vlákna (kruhové pole pod vlastným zámkom).
+ *
+ * Vlastník berie zo začiatku a vracia na koniec, zlodej berie z konca.
+ */
+typedef struct {
+    pthread_mutex_t mtx;     /**< Chráni pole a indexy */
+    pool_task_t** buf;       /**< Kruhové pole úloh */
+    uint32_t cap;            /**< Kapacita buf (mocnina dvoch) */
+    uint32_t head;           /**< Index prvej úlohy */
+    uint32_t count;          /**< Počet úloh */
+} pool_deque_t;
+
+/**
+ * @brief Jedno vlákno poolu.
+ */
+typedef struct {
+    pool_t* pool;            /**< Vlastník */
+    uint32_t id;             /**< Index vlákna */
+    pool_deque_t q;          /**< Vlastná fronta */
+    pthread_t tid;           /**< Vlákno */
+} pool_worker_t;
+
+struct pool {
+    pool_worker_t* workers;  /**< Vlákna */
+    uint32_t n;              /**< Počet vlákien */
+    atomic_uint next;        /**< Rotácia front pri pool_submit() */
+
+    pthread_mutex_t mtx;     /**< Chráni spiace úlohy, čakanie a ukončenie */
+    pthread_cond_t cv;       /**< Budí nečinné vlákna (nová úloha, nový časovač, koniec) */
+    pthread_cond_t idle_cv;  /**< Budí pool_destroy(), keď už nie sú úlohy */
+    atomic_uint queued;      /**< Počet úloh vo frontách (nie spiacich) */
+    uint32_t live;           /**< Počet nedokončených úloh (chráni mtx) */
+    int exiting;             /**< 1 = vlákna majú skončiť */
+
+    pool_task_t** sleep;     /**< Min-halda spiacich úloh podľa wake */
+    uint32_t nsleep;         /**< Počet spiacich úloh */
+    uint32_t sleep_cap;      /**< Kapacita haldy */
+};
+
+/**
+ * @brief Porovná dve časové značky.
+ *
+ * @return 1 ak a < b, inak 0.
+ */
+static int ts_lt(const struct timespec* a, const struct timespec* b) {
+    if (a->tv_sec != b->tv_sec) return a->tv_sec < b->tv_sec;
+    return a->tv_nsec < b->tv_nsec;
+}
+
+/**
+ * @brief Pridá úlohu na koniec fronty.
+ *
+ * @param q Fronta.
+ * @param t Úloha.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int deque_push(pool_deque_t* q, pool_task_t* t) {
+    pthread_mutex_lock(&q->mtx);
+    if (q->count == q->cap) {
+        uint32_t cap = q->cap ? q->cap * 2u : POOL_DEQUE_CAP;
+        pool_task_t** buf = malloc(cap * sizeof(*buf));
+        if (!buf) {
+            pthread_mutex_unlock(&q->mtx);
+            return -1;
+        }
+        for (uint32_t i = 0; i < q->count; i++) buf[i] = q->buf[(q->head + i) & (q->cap - 1u)];
+        free(q->buf);
+        q->buf = buf;
+        q->cap = cap;
+        q->head = 0;
+    }
+    q->buf[(q->head + q->count) & (q->cap - 1u)] = t;
+    q->count++;
+    pthread_mutex_unlock(&q->mtx);
+    return 0;
+}
+
+/**
+ * @brief Vyberie úlohu zo začiatku (vlastník) alebo z konca (zlodej).
+ *
+ * @param q Fronta.
+ * @param steal 1 = z konca.
+ * @return Úloha, alebo NULL ak je fronta prázdna.
+ */
+static pool_task_t* deque_pop(pool_deque_t* q, int steal) {
+    pool_task_t* t = NULL;
+    pthread_mutex_lock(&q->mtx);
+    if (q->count > 0) {
+        if (steal) {
+            t = q->buf[(q->head + q->count - 1u) & (q->cap - 1u)];
+        } else {
+            t = q->buf[q->head];
+            q->head = (q->head + 1u) & (q->cap - 1u);
+        }
+        q->count--;
+    }
+    pthread_mutex_unlock(&q->mtx);
+    return t;
+}
+
+/**
+ * @brief Zaradí úlohu do fronty vlákna a zobudí nečinné vlákno.
+ *
+ * @param p Pool.
+ * @param w Cieľové vlákno.
+ * @param t Úloha.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int pool_enqueue(pool_t* p, pool_worker_t* w, pool_task_t* t) {
+    if (deque_push(&w->q, t) != 0) return -1;
+    atomic_fetch_add(&p->queued, 1);
+    pthread_mutex_lock(&p->mtx);
+    pthread_cond_signal(&p->cv);
+    pthread_mutex_unlock(&p->mtx);
+    return 0;
+}
+
+/**
+ * @brief Vloží spiacu úlohu do haldy (volajúci drží p->mtx).
+ *
+ * @param p Pool.
+ * @param t Úloha s nastaveným wake.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int sleep_push_locked(pool_t* p, pool_task_t* t) {
+    if (p->nsleep == p->sleep_cap) {
+        uint32_t cap = p->sleep_cap ? p->sleep_cap * 2u : POOL_DEQUE_CAP;
+        pool_task_t** h = realloc(p->sleep, cap * sizeof(*h));
+        if (!h) return -1;
+        p->sleep = h;
+        p->sleep_cap = cap;
+    }
+    uint32_t i = p->nsleep++;
+    while (i > 0) {
+        uint32_t parent = (i - 1u) / 2u;
+        if (!ts_lt(&t->wake, &p->sleep[parent]->wake)) break;
+        p->sleep[i] = p->sleep[parent];
+        i = parent;
+    }
+    p->sleep[i] = t;
+    return 0;
+}
+
+/**
+ * @brief Vyberie najskoršiu spiacu úlohu, ak už jej čas nastal (drží p->mtx).
+ *
+ * @param p Pool.
+ * @param now Aktuálny čas.
+ * @return Úloha, alebo NULL.
+ */
+static pool_task_t* sleep_pop_due_locked(pool_t* p, const struct timespec* now) {
+    if (p->nsleep == 0 || ts_lt(now, &p->sleep[0]->wake)) return NULL;
+
+    pool_task_t* top = p->sleep[0];
+    pool_task_t* last = p->sleep[--p->nsleep];
+    uint32_t i = 0;
+    for (;;) {
+        uint32_t c = 2u * i + 1u;
+        if (c >= p->nsleep) break;
+        if (c + 1u < p->nsleep && ts_lt(&p->sleep[c + 1u]->wake, &p->sleep[c]->wake)) c++;
+        if (!ts_lt(&p->sleep[c]->wake, &last->wake)) break;
+        p->sleep[i] = p->sleep[c];
+        i = c;
+    }
+    if (p->nsleep > 0) p->sleep[i] = last;
+    return top;
+}
+
+/**
+ * @brief Nájde ďalšiu úlohu: prebudená spiaca, vlastná fronta, alebo ukradnutá.
+ *
+ * @param w Vlákno poolu.
+ * @return Úloha, alebo NULL ak nie je čo robiť.
+ */
+static pool_task_t* pool_next(pool_worker_t* w) {
+    pool_t* p = w->pool;
+    pool_task_t* t;
+
+    /* spiace úlohy, ktorým nastal čas, majú prednosť - inak by meškali */
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    pthread_mutex_lock(&p->mtx);
+    t = sleep_pop_due_locked(p, &now);
+    pthread_mutex_unlock(&p->mtx);
+    if (t) return t;
+
+    t = deque_pop(&w->q, 0);
+    if (t) {
+        atomic_fetch_sub(&p->queued, 1);
+        return t;
+    }
+
+    for (uint32_t i = 1; i < p->n; i++) {
+        pool_worker_t* v = &p->workers[(w->id + i) % p->n];
+        t = deque_pop(&v->q, 1);
+        if (t) {
+            atomic_fetch_sub(&p->queued, 1);
+            return t;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief Hlavná slučka vlákna poolu.
+ *
+ * @param arg Ukazovateľ na pool_worker_t.
+ * @return NULL pri ukončení.
+ */
+static void* pool_main(void* arg) {
+    pool_worker_t* w = (pool_worker_t*)arg;
+    pool_t* p = w->pool;
+
+    for (;;) {
+        pool_task_t* t = pool_next(w);
+        if (!t) {
+            pthread_mutex_lock(&p->mtx);
+            if (p->exiting) {
+                pthread_mutex_unlock(&p->mtx);
+                break;
+            }
+            /* úloha zaradená po pool_next() by sa tu prejavila v queued */
+            if (atomic_load(&p->queued) == 0) {
+                if (p->nsleep > 0) {
+                    struct timespec until = p->sleep[0]->wake;
+                    (void)pthread_cond_timedwait(&p->cv, &p->mtx, &until);
+                } else {
+                    pthread_cond_wait(&p->cv, &p->mtx);
+                }
+            }
+            pthread_mutex_unlock(&p->mtx);
+            continue;
+        }
+
+        int rc = t->fn(t->arg, &t->wake);
+
+        if (rc == POOL_YIELD && pool_enqueue(p, w, t) == 0) continue;
+        if (rc == POOL_SLEEP) {
+            pthread_mutex_lock(&p->mtx);
+            int ok = (sleep_push_locked(p, t) == 0);
+            /* nečinné vlákna čakajú možno na neskorší časovač */
+            if (ok) pthread_cond_broadcast(&p->cv);
+            pthread_mutex_unlock(&p->mtx);
+            if (ok) continue;
+        }
+        if (rc != POOL_DONE) {
+            /* úlohu sa nepodarilo znovu zaradiť - spusti ju hneď znovu, kým neskončí */
+            while ((rc = t->fn(t->arg, &t->wake)) != POOL_DONE) {
+                if (rc == POOL_SLEEP) {
+                    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t->wake, NULL) == EINTR) {
+                    }
+                }
+            }
+        }
+
+        free(t);
+        pthread_mutex_lock(&p->mtx);
+        if (--p->live == 0) pthread_cond_broadcast(&p->idle_cv);
+        pthread_mutex_unlock(&p->mtx);
+    }
+    return NULL;
+}
+
+pool_t* pool_create(uint32_t threads) {
+    if (threads == 0) threads = 1;
+
+    pool_t* p = calloc(1, sizeof(*p));
+    if (!p) return NULL;
+    p->workers = calloc(threads, sizeof(*p->workers));
+    if (!p->workers) {
+        free(p);
+        return NULL;
+    }
+
+    pthread_condattr_t ca;
+    pthread_condattr_init(&ca);
+    pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+    pthread_cond_init(&p->cv, &ca);
+    pthread_condattr_destroy(&ca);
+    pthread_cond_init(&p->idle_cv, NULL);
+    pthread_mutex_init(&p->mtx, NULL);
+    atomic_init(&p->next, 0);
+    atomic_init(&p->queued, 0);
+
+    for (uint32_t i = 0; i < threads; i++) {
+        p->workers[i].pool = p;
+        p->workers[i].id = i;
+        pthread_mutex_init(&p->workers[i].q.mtx, NULL);
+    }
+    for (uint32_t i = 0; i < threads; i++) {
+        if (pthread_create(&p->workers[i].tid, NULL, pool_main, &p->workers[i]) != 0) break;
+        p->n++;
+    }
+    if (p->n == 0) {
+        pool_destroy(p);
+        return NULL;
+    }
+    return p;
+}
+
+int pool_submit(pool_t* p, pool_fn fn, void* arg) {
+    pool_task_t* t = calloc(1, sizeof(*t));
+    if (!t) return -1;
+    t->fn = fn;
+    t->arg = arg;
+
+    pthread_mutex_lock(&p->mtx);
+    p->live++;
+    pthread_mutex_unlock(&p->mtx);
+
+    uint32_t i = atomic_fetch_add(&p->next, 1) % p->n;
+    if (pool_enqueue(p, &p->workers[i], t) != 0) {
+        pthread_mutex_lock(&p->mtx);
+        if (--p->live == 0) pthread_cond_broadcast(&p->idle_cv);
+        pthread_mutex_unlock(&p->mtx);
+        free(t);
+        return -1;
+    }
+    return 0;
+}
+
+uint32_t pool_threads(const pool_t* p) {
+    return p->n;
+}
+
+void pool_destroy(pool_t* p) {
+    if (!p) return;
+
+    pthread_mutex_lock(&p->mtx);
+    while (p->live > 0) pthread_cond_wait(&p->idle_cv, &p->mtx);
+    p->exiting = 1;
+    pthread_cond_broadcast(&p->cv);
+    pthread_mutex_unlock(&p->mtx);
+
+    for (uint32_t i = 0; i < p->n; i++) pthread_join(p->workers[i].tid, NULL);
+
+    /* workers[] sa inicializoval celý, aj keď sa niektoré vlákna nespustili */
+    for (uint32_t i = 0; i < (p->n ? p->n : 1u); i++) {
+        pthread_mutex_destroy(&p->workers[i].q.mtx);
+        free(p->workers[i].q.buf);
+    }
+    pthread_cond_destroy(&p->cv);
+    pthread_cond_destroy(&p->idle_cv);
+    pthread_mutex_destroy(&p->mtx);
+    free(p->sleep);
+    free(p->workers);
+    free(p);
+}
@@ -0,0 +1,76 @@
+/**
+ * @file pool.h
+ * @brief Pevný pool pracovných vlákien s kradnutím práce (work stealing).
+ *
+ * Úlohou je funkcia, ktorá spraví kus práce a povie, či je hotová, chce
+ * pokračovať neskôr (vzdá sa vlákna v prospech ostatných úloh), alebo
+ * má pokračovať až v zadanom čase (napr. časovaný beh medzi krokmi).
+ * Každé vlákno má vlastnú frontu úloh; vlastnú frontu berie od začiatku
+ * a úlohu, ktorá sa vzdala, zaradí na koniec, takže sa úlohy rôznych behov
+ * pravidelne striedajú. Vlákno bez práce ukradne úlohu z konca cudzej fronty.
+ */
+
+#pragma once
+#include <stdint.h>
+#include <time.h>
+
+/**
+ * @brief Výsledok jedného spustenia úlohy.
+ */
+typedef enum {
+    POOL_DONE  = 0,          /**< Úloha skončila, pool ju zahodí */
+    POOL_YIELD = 1,          /**< Pokračovať hneď, ako príde na rad */
+    POOL_SLEEP = 2           /**< Pokračovať najskôr v čase wake */
+} pool_status_t;
+
+/**
+ * @brief Funkcia úlohy.
+ *
+ * Jedna úloha nikdy nebeží na dvoch vláknach naraz, takže jej stav
+ * netreba zamykať.
+ *
+ * @param arg Argument z pool_submit().
+ * @param wake Výstup pri POOL_SLEEP: absolútny čas pokračovania (CLOCK_MONOTONIC).
+ * @return pool_status_t.
+ */
+typedef int (*pool_fn)(void* arg, struct timespec* wake);
+
+typedef struct pool pool_t;
+
+/**
+ * @brief Vytvorí pool a spustí jeho vlákna.
+ *
+ * @param threads Počet vlákien (aspoň 1).
+ * @return Pool, alebo NULL pri chybe.
+ */
+pool_t* pool_create(uint32_t threads);
+
+/**
+ * @brief Zaradí novú úlohu.
+ *
+ * Úlohy sa rozdeľujú do front vlákien po rade; nerovnováhu vyrovná kradnutie.
+ *
+ * @param p Pool.
+ * @param fn Funkcia úlohy.
+ * @param arg Argument úlohy.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+int pool_submit(pool_t* p, pool_fn fn, void* arg);
+
+/**
+ * @brief Počet vlákien poolu.
+ *
+ * @param p Pool.
+ * @return Počet vlákien.
+ */
+uint32_t pool_threads(const pool_t* p);
+
+/**
+ * @brief Počká na dokončenie všetkých úloh, ukončí vlákna a uvoľní pool.
+ *
+ * Volajúci má úlohy najprv zastaviť (napr. job->stop), inak sa čaká,
+ * kým dobehnú.
+ *
+ * @param p Pool (môže byť NULL).
+ */
+void pool_destroy(pool_t* p);
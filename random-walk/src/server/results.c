@@ -4,10 +4,113 @@
  */
 
 #include "results.h"
+#include "hist.h"
 
+#include <math.h>
 #include <stdio.h>
 #include <string.h>
 
+/**
+ * Pridá jednu hodnotu do momentov (iba celočíselné sčítanie).
+ *
+ * @param m Momenty
+ * @param x Hodnota
+ */
+void moments_add(moments_t* m, uint32_t x) {
+	uint64_t x2 = (uint64_t)x * x;
+	results_u128_t x4 = (results_u128_t)x2 * x2;
+	m->n++;
+	m->s1 += x;
+	m->s2 += x2;
+	m->s3 += (results_u128_t)x2 * x;
+	m->s4 += x4;
+	if (m->s4 < x4) m->s4_hi++;
+}
+
+/**
+ * Zlúči momenty src do dst - súčty sú celé čísla, takže na poradí
+ * zlučovania ani na rozdelení hodnôt medzi shardy nezáleží.
+ *
+ * @param dst Cieľové momenty
+ * @param src Čiastkové momenty
+ */
+void moments_merge(moments_t* dst, const moments_t* src) {
+	dst->n += src->n;
+	dst->s1 += src->s1;
+	dst->s2 += src->s2;
+	dst->s3 += src->s3;
+	dst->s4 += src->s4;
+	dst->s4_hi += src->s4_hi + (dst->s4 < src->s4 ? 1u : 0u);
+}
+
+/**
+ * Odvodí priemer a centrálne súčty mocnín zo súčtov mocnín.
+ *
+ * m2 = (n * s2 - s1^2) / n sa počíta v celých číslach presne (oba súčiny
+ * sú < 2^128). m3 a m4 sa rozvinú okolo priemeru v long double; strata
+ * presnosti odčítaním je rádovo (priemer / sd)^k * 2^-64, pri krokoch
+ * zanedbateľná. Výpočet je deterministický - rovnaké súčty dajú rovnaké bity.
+ *
+ * @param m Momenty
+ * @param out Výstup
+ */
+void moments_central(const moments_t* m, moments_central_t* out) {
+	memset(out, 0, sizeof(*out));
+	out->n = m->n;
+	if (m->n == 0) return;
+
+	long double n = (long double)m->n;
+	long double mu = (long double)m->s1 / n;
+	long double s1 = (long double)m->s1;
+	long double s2 = (long double)m->s2;
+	long double s3 = (long double)m->s3;
+	long double s4 = (long double)m->s4 + (long double)m->s4_hi * 0x1p128L;
+	results_u128_t d2 = (results_u128_t)m->n * m->s2 - (results_u128_t)m->s1 * m->s1;
+
+	out->mean = (double)mu;
+	out->m2 = (double)((long double)d2 / n);
+	out->m3 = (double)(s3 - 3.0L * mu * s2 + 2.0L * mu * mu * s1);
+	out->m4 = (double)(s4 - 4.0L * mu * s3 + 6.0L * mu * mu * s2 - 3.0L * mu * mu * mu * s1);
+}
+
+/**
+ * Výberový rozptyl (delený n - 1), z presného n * s2 - s1^2.
+ *
+ * @param m Momenty
+ * @return Rozptyl, 0 pri menej ako dvoch hodnotách
+ */
+double moments_variance(const moments_t* m) {
+	if (m->n < 2) return 0.0;
+	results_u128_t d2 = (results_u128_t)m->n * m->s2 - (results_u128_t)m->s1 * m->s1;
+	return (double)((long double)d2 / ((long double)m->n * ((long double)m->n - 1.0L)));
+}
+
+/**
+ * Výberová šikmosť g1 = sqrt(n) * m3 / m2^(3/2).
+ *
+ * @param m Momenty
+ * @return Šikmosť, 0 ak je rozptyl nulový
+ */
+double moments_skewness(const moments_t* m) {
+	moments_central_t c;
+	moments_central(m, &c);
+	if (c.n < 2 || c.m2 <= 0.0) return 0.0;
+	return sqrt((double)c.n) * c.m3 / pow(c.m2, 1.5);
+}
+
+/**
+ * Výberová nadbytočná špicatosť g2 = n * m4 / m2^2 - 3.
+ *
+ * @param m Momenty
+ * @return Špicatosť, 0 ak je rozptyl nulový
+ */
+double moments_kurtosis(const moments_t* m) {
+	moments_central_t c;
+	moments_central(m, &c);
+	if (c.n < 2 || c.m2 <= 0.0) return 0.0;
+	return (double)c.n * c.m4 / (c.m2 * c.m2) - 3.0;
+}
+
 /**
  * Resetuje štatistiku simulácie na počiatočný stav.
  * Vynuluje všetky počítadlá a inicializuje min_steps na maximálnu hodnotu.
@@ -80,13 +183,150 @@ void results_record_rep(results_t* r, uint32_t steps, int success) {
 	if (success) {
 		r->success_count++;
 		r->sum_steps_success += steps;
+		moments_add(&r->steps, steps);
 		if (steps < r->min_steps) r->min_steps = steps;
 		if (steps > r->max_steps) r->max_steps = steps;
 		int b = steps_to_bin(steps);
 		if (b >= 0 && b < 4) r->bins[b]++;
+		r->hist[hist_index(steps)]++;
 	} else {
 		r->fail_count++;
 	}
+	moments_add(&r->success, success ? 1u : 0u);
+}
+
+/**
+ * Zlúči čiastkovú štatistiku (shard jedného vlákna) do cieľovej.
+ * Sčíta počítadlá a histogram, min/max zlúči; parametre a reps_total
+ * cieľa ostávajú nezmenené.
+ * 
+ * @param dst Cieľová štatistika
+ * @param src Čiastková štatistika na pripočítanie
+ */
+void results_merge(results_t* dst, const results_t* src) {
+	if (!dst || !src) return;
+	dst->success_count += src->success_count;
+	dst->fail_count += src->fail_count;
+	dst->sum_steps_success += src->sum_steps_success;
+	moments_merge(&dst->steps, &src->steps);
+	moments_merge(&dst->success, &src->success);
+	if (src->min_steps < dst->min_steps) dst->min_steps = src->min_steps;
+	if (src->max_steps > dst->max_steps) dst->max_steps = src->max_steps;
+	for (int i = 0; i < 4; i++) dst->bins[i] += src->bins[i];
+	/* za max_steps sú samé nuly, stačí sčítať po jeho kôš */
+	if (src->success_count > 0) {
+		uint32_t used = hist_index(src->max_steps) + 1u;
+		for (uint32_t i = 0; i < used; i++) dst->hist[i] += src->hist[i];
+	}
+}
+
+/** Kvantil normálneho rozdelenia pre obojstranný 95 % interval. */
+#define RESULTS_Z95 1.959963984540054
+
+/** Najmenej úspešných replikácií, od ktorých sa odhaduje interval priemeru krokov. */
+#define RESULTS_MIN_SUCCESS 30u
+
+/**
+ * Polšírka 95 % intervalu spoľahlivosti zvolenej veličiny.
+ * Podiel úspechov: Agresti-Coull (p = (s + 2) / (n + 4)), takže aj
+ * pri nulovom alebo plnom podiele interval nezmizne predčasne.
+ * Priemer krokov: z * s / sqrt(n) s rozptylom z momentov.
+ *
+ * @param r Štatistika
+ * @param target Veličina (target_metric_t)
+ * @return Polšírka, alebo HUGE_VAL pri nedostatku dát
+ */
+double results_halfwidth(const results_t* r, uint8_t target) {
+	if (!r) return HUGE_VAL;
+	double n = (double)r->success_count + (double)r->fail_count;
+
+	if (target == TARGET_SUCCESS) {
+		if (n == 0.0) return HUGE_VAL;
+		double p = ((double)r->success_count + 2.0) / (n + 4.0);
+		return RESULTS_Z95 * sqrt(p * (1.0 - p) / (n + 4.0));
+	}
+
+	if (target == TARGET_MEAN_STEPS) {
+		if (r->success_count < RESULTS_MIN_SUCCESS) return HUGE_VAL;
+		return RESULTS_Z95 * sqrt(moments_variance(&r->steps) / (double)r->steps.n);
+	}
+
+	return HUGE_VAL;
+}
+
+/**
+ * Kvantil krokov úspešných replikácií z histogramu.
+ * Horná hranica koša sa oreže na skutočné min/max, takže p0 a p100
+ * sú presné.
+ *
+ * @param r Štatistika
+ * @param q Kvantil v intervale [0, 1]
+ * @return Počet krokov, 0 bez úspešných replikácií
+ */
+uint32_t results_percentile(const results_t* r, double q) {
+	if (!r || r->success_count == 0) return 0;
+	uint32_t v = hist_quantile(r->hist, results_hist_used(r), q);
+	if (v < r->min_steps) v = r->min_steps;
+	if (v > r->max_steps) v = r->max_steps;
+	return v;
+}
+
+/**
+ * Počet košov histogramu po posledný neprázdny.
+ * Posledný neprázdny kôš je kôš max_steps.
+ *
+ * @param r Štatistika
+ * @return Počet košov od indexu 0
+ */
+uint32_t results_hist_used(const results_t* r) {
+	if (!r || r->success_count == 0) return 0;
+	return hist_index(r->max_steps) + 1u;
+}
+
+/**
+ * Prepíše momenty do zbalenej podoby pre správu.
+ *
+ * @param m Momenty
+ * @param out Výstup v správe
+ */
+static void moments_to_msg(const moments_t* m, msg_moments_t* out) {
+	moments_central_t c;
+	moments_central(m, &c);
+	out->n = c.n;
+	out->mean = c.mean;
+	out->m2 = c.m2;
+	out->m3 = c.m3;
+	out->m4 = c.m4;
+}
+
+/**
+ * Vyplní správu MSG_RESULT zo štatistiky.
+ *
+ * @param r Štatistika
+ * @param m Výstupná správa
+ */
+void results_to_msg(const results_t* r, msg_result_t* m) {
+	memset(m, 0, sizeof(*m));
+	m->reps_total = r->reps_total;
+	m->success_count = r->success_count;
+	m->fail_count = r->fail_count;
+	m->sum_steps_success = r->sum_steps_success;
+	m->min_steps = (r->success_count > 0) ? r->min_steps : 0u;
+	m->max_steps = r->max_steps;
+	memcpy(m->bins, r->bins, sizeof(m->bins));
+	m->p50 = results_percentile(r, 0.50);
+	m->p90 = results_percentile(r, 0.90);
+	m->p99 = results_percentile(r, 0.99);
+	m->p999 = results_percentile(r, 0.999);
+	moments_to_msg(&r->steps, &m->steps);
+	moments_to_msg(&r->success, &m->success);
+	m->width = r->width;
+	m->height = r->height;
+	m->k_max = r->k_max;
+	m->p_up = r->p_up;
+	m->p_down = r->p_down;
+	m->p_left = r->p_left;
+	m->p_right = r->p_right;
 }
 
 /**
@@ -107,6 +347,11 @@ void results_print(const results_t* r) {
 	printf("Total reps: %u\n", (unsigned)r->reps_total);
 	printf("Reached (0,0): %u (%.1f%%)\n", (unsigned)r->success_count,
 		   r->reps_total ? (100.0 * (double)r->success_count / (double)r->reps_total) : 0.0);
+	if (r->success.n > 0) {
+		double p = (double)r->success.s1 / (double)r->success.n;
+		double hw = RESULTS_Z95 * sqrt(moments_variance(&r->success) / (double)r->success.n);
+		printf("Success rate: %.4f +- %.4f (95%% CI, sd=%.4f)\n", p, hw, sqrt(moments_variance(&r->success)));
+	}
 	printf("Not reached:  %u (%.1f%%)\n", (unsigned)r->fail_count,
 		   r->reps_total ? (100.0 * (double)r->fail_count / (double)r->reps_total) : 0.0);
 
@@ -114,11 +359,19 @@ void results_print(const results_t* r) {
 		double avg = (double)r->sum_steps_success / (double)r->success_count;
 		printf("Steps (successful): avg=%.2f min=%u max=%u\n", avg,
 			   (unsigned)r->min_steps, (unsigned)r->max_steps);
+		double sd = sqrt(moments_variance(&r->steps));
+		double hw = RESULTS_Z95 * sd / sqrt((double)r->steps.n);
+		printf("Steps spread: sd=%.2f skew=%.3f kurt=%.3f mean 95%% CI=[%.2f, %.2f]\n",
+			   sd, moments_skewness(&r->steps), moments_kurtosis(&r->steps), avg - hw, avg + hw);
 		printf("Histogram (successful steps):\n");
 		printf("  0-20 : %u\n", (unsigned)r->bins[0]);
 		printf("  21-50: %u\n", (unsigned)r->bins[1]);
 		printf("  51-100: %u\n", (unsigned)r->bins[2]);
 		printf("  101+ : %u\n", (unsigned)r->bins[3]);
+		printf("Percentiles (successful steps, +-%.1f%%): p50=%u p90=%u p99=%u p99.9=%u\n",
+			   100.0 / (double)STEP_HIST_SUB,
+			   (unsigned)results_percentile(r, 0.50), (unsigned)results_percentile(r, 0.90),
+			   (unsigned)results_percentile(r, 0.99), (unsigned)results_percentile(r, 0.999));
 	} else {
 		printf("No successful replications -> no step stats available.\n");
 	}
@@ -4,8 +4,45 @@
  */
 
 #pragma once
+#include "protocol.h"
+
 #include <stdint.h>
 
+/** 128-bitové celé číslo bez znamienka (rozšírenie GCC, ako vektory v kernel.c). */
+__extension__ typedef unsigned __int128 results_u128_t;
+
+/**
+ * @struct moments_t
+ * @brief Presné súčty mocnín celočíselných hodnôt pre prvé štyri momenty.
+ *
+ * Hodnoty (kroky, indikátor úspechu) sú celé čísla, takže sa sčítavajú
+ * bez zaokrúhlenia: zlúčenie shardov je obyčajné sčítanie a výsledok
+ * nezávisí od počtu shardov, jadra ani poradia replikácií. Centrálne
+ * momenty sa z nich odvodia až pri výstupe (moments_central).
+ * Hodnota aj počet sú < 2^32, preto s1 stačí 64 bitov, s2 a s3 128 bitov
+ * a s4 má navyše horné slovo s prenosmi.
+ */
+typedef struct {
+	uint64_t n;                    /**< Počet hodnôt */
+	uint64_t s1;                   /**< Súčet x */
+	results_u128_t s2;             /**< Súčet x^2 */
+	results_u128_t s3;             /**< Súčet x^3 */
+	results_u128_t s4;             /**< Súčet x^4 (dolných 128 bitov) */
+	uint64_t s4_hi;                /**< Súčet x^4 (horné slovo: počet pretečení s4) */
+} moments_t;
+
+/**
+ * @struct moments_central_t
+ * @brief Priemer a súčty mocnín odchýlok odvodené z moments_t.
+ */
+typedef struct {
+	uint64_t n;                    /**< Počet hodnôt */
+	double   mean;                 /**< Priemer */
+	double   m2;                   /**< Súčet (x - mean)^2 */
+	double   m3;                   /**< Súčet (x - mean)^3 */
+	double   m4;                   /**< Súčet (x - mean)^4 */
+} moments_central_t;
+
 /**
  * @struct results_t
  * @brief Štruktúra na ukladanie štatistických údajov simulácie.
@@ -20,6 +57,8 @@ typedef struct {
 	uint32_t fail_count;           /**< Počet neúspešných replikácií */
 
 	uint64_t sum_steps_success;    /**< Súčet krokov všetkých úspešných replikácií */
+	moments_t steps;               /**< Momenty krokov úspešných replikácií */
+	moments_t success;             /**< Momenty indikátora úspechu (1 = zásah, 0 = nie) všetkých replikácií */
 	uint32_t min_steps;            /**< Minimálny počet krokov medzi úspešnými */
 	uint32_t max_steps;            /**< Maximálny počet krokov medzi úspešnými */
 
@@ -31,6 +70,10 @@ typedef struct {
 	 */
 	uint32_t bins[4];
 
+	/** Log-lineárny histogram krokov úspešných replikácií (rozloženie v hist.h),
+	 *  z ktorého sa počítajú kvantily s relatívnou chybou najviac 1/STEP_HIST_SUB. */
+	uint32_t hist[STEP_HIST_BUCKETS];
+
 	/* Echo parametre (nepovinné, len na tlač) */
 	int32_t  width;                /**< Šírka simulačného sveta */
 	int32_t  height;               /**< Výška simulačného sveta */
@@ -38,6 +81,48 @@ typedef struct {
 	uint8_t  p_up, p_down, p_left, p_right;  /**< Pravdepodobnosti pohybu v percentách */
 } results_t;
 
+/**
+ * @brief Pridá jednu hodnotu do momentov.
+ * @param m Momenty.
+ * @param x Hodnota.
+ */
+void moments_add(moments_t* m, uint32_t x);
+
+/**
+ * @brief Zlúči momenty src do dst (presne, na poradí nezáleží).
+ * @param dst Cieľové momenty.
+ * @param src Čiastkové momenty.
+ */
+void moments_merge(moments_t* dst, const moments_t* src);
+
+/**
+ * @brief Odvodí priemer a centrálne súčty mocnín.
+ * @param m Momenty.
+ * @param out Výstup (nuly pri n = 0).
+ */
+void moments_central(const moments_t* m, moments_central_t* out);
+
+/**
+ * @brief Výberový rozptyl (delený n - 1).
+ * @param m Momenty.
+ * @return Rozptyl, 0 pri menej ako dvoch hodnotách.
+ */
+double moments_variance(const moments_t* m);
+
+/**
+ * @brief Výberová šikmosť g1.
+ * @param m Momenty.
+ * @return Šikmosť, 0 ak je rozptyl nulový.
+ */
+double moments_skewness(const moments_t* m);
+
+/**
+ * @brief Výberová špicatosť g2 (nadbytočná, normálne rozdelenie má 0).
+ * @param m Momenty.
+ * @return Špicatosť, 0 ak je rozptyl nulový.
+ */
+double moments_kurtosis(const moments_t* m);
+
 /**
  * @brief Resetuje štatistiku simulácie na počiatočný stav.
  * @param r Ukazovateľ na štruktúru s výsledkami.
@@ -69,6 +154,47 @@ void results_set_params(results_t* r,
  */
 void results_record_rep(results_t* r, uint32_t steps, int success);
 
+/**
+ * @brief Zlúči čiastkovú štatistiku (napr. shard jedného vlákna) do cieľovej.
+ * @param dst Cieľová štatistika (parametre a reps_total sa nemenia).
+ * @param src Čiastková štatistika na pripočítanie.
+ */
+void results_merge(results_t* dst, const results_t* src);
+
+/**
+ * @brief Polšírka 95 % intervalu spoľahlivosti zvolenej veličiny.
+ *
+ * Pre podiel úspechov sa použije Agrestiho-Coullov interval (rozumný aj pri
+ * podiele blízko 0 alebo 1), pre priemer krokov normálna aproximácia.
+ *
+ * @param r Štatistika.
+ * @param target Veličina (target_metric_t).
+ * @return Polšírka, alebo HUGE_VAL ak je na odhad málo dát.
+ */
+double results_halfwidth(const results_t* r, uint8_t target);
+
+/**
+ * @brief Kvantil krokov úspešných replikácií z histogramu.
+ * @param r Štatistika.
+ * @param q Kvantil v intervale [0, 1] (napr. 0.99).
+ * @return Počet krokov (orezaný na [min_steps, max_steps]), 0 bez úspešných replikácií.
+ */
+uint32_t results_percentile(const results_t* r, double q);
+
+/**
+ * @brief Počet košov histogramu po posledný neprázdny (na odoslanie).
+ * @param r Štatistika.
+ * @return Počet košov od indexu 0.
+ */
+uint32_t results_hist_used(const results_t* r);
+
+/**
+ * @brief Vyplní správu MSG_RESULT zo štatistiky.
+ * @param r Štatistika.
+ * @param m Výstupná správa.
+ */
+void results_to_msg(const results_t* r, msg_result_t* m);
+
 /**
  * @brief Vypisuje podrobný súhrn výsledkov simulácie.
  * @param r Ukazovateľ na štruktúru s výsledkami na výstup.
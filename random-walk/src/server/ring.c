@@ -0,0 +1,200 @@
+/**
+ * @file ring.c
+ * @brief Implementácia SPSC frontu zakódovaných správ.
+ */
+
+#include "ring.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/** Pauza producenta pri RING_BLOCK, kým konzument neuvoľní miesto. */
+#define RING_WAIT_NS 50000L
+
+int ring_init(ring_t* r, uint8_t policy) {
+    memset(r, 0, sizeof(*r));
+    r->slots = calloc(RING_SLOTS, sizeof(ring_slot_t));
+    r->pending = (policy == RING_COALESCE) ? calloc(1, sizeof(ring_slot_t)) : NULL;
+    if (!r->slots || (policy == RING_COALESCE && !r->pending)) {
+        ring_free(r);
+        return -1;
+    }
+    r->policy = policy;
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    atomic_init(&r->dropped, 0);
+    atomic_init(&r->coalesced, 0);
+    atomic_init(&r->waits, 0);
+    atomic_init(&r->peak, 0);
+    for (uint32_t i = 0; i < RING_SLOTS; i++) atomic_init(&r->slots[i].seq, 0);
+    return 0;
+}
+
+void ring_free(ring_t* r) {
+    free(r->slots);
+    free(r->pending);
+    r->slots = NULL;
+    r->pending = NULL;
+}
+
+/**
+ * @brief Zakóduje správu (hlavička v network byte order + payload) do slotu.
+ *
+ * @param s Cieľový slot (iba data a len, seq rieši volajúci).
+ * @param type Typ správy.
+ * @param payload Payload.
+ * @param len Dĺžka payloadu.
+ */
+static void slot_fill(ring_slot_t* s, msg_type_t type, const void* payload, uint32_t len) {
+    msg_header_t h;
+    h.type = htonl((uint32_t)type);
+    h.length = htonl(len);
+    memcpy(s->data, &h, sizeof(h));
+    if (len > 0) memcpy(s->data + sizeof(h), payload, len);
+    s->len = (uint32_t)sizeof(h) + len;
+}
+
+/**
+ * @brief Zapíše správu na pozíciu head a posunie head (producent).
+ *
+ * Pri RING_DROP_OLDEST môže prepísať ešte neprečítaný slot - konzument
+ * to zistí podľa seq.
+ *
+ * @param r Front.
+ * @param src Slot so zakódovanou správou, alebo NULL.
+ * @param type Typ správy (ak src == NULL).
+ * @param payload Payload (ak src == NULL).
+ * @param len Dĺžka payloadu (ak src == NULL).
+ */
+static void ring_write(ring_t* r, const ring_slot_t* src, msg_type_t type, const void* payload, uint32_t len) {
+    unsigned long long h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    ring_slot_t* s = &r->slots[h & (RING_SLOTS - 1u)];
+
+    atomic_store_explicit(&s->seq, 2u * h + 1u, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    if (src) {
+        memcpy(s->data, src->data, src->len);
+        s->len = src->len;
+    } else {
+        slot_fill(s, type, payload, len);
+    }
+    atomic_store_explicit(&s->seq, 2u * h + 2u, memory_order_release);
+    atomic_store_explicit(&r->head, h + 1u, memory_order_release);
+
+    unsigned long long t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    unsigned used = (h + 1u - t > RING_SLOTS) ? RING_SLOTS : (unsigned)(h + 1u - t);
+    if (used > atomic_load_explicit(&r->peak, memory_order_relaxed)) {
+        atomic_store_explicit(&r->peak, used, memory_order_relaxed);
+    }
+}
+
+/**
+ * @brief Zistí, či je vo fronte miesto (producent).
+ *
+ * @param r Front.
+ * @return 1 ak je voľný aspoň jeden slot.
+ */
+static int ring_has_room(ring_t* r) {
+    unsigned long long h = atomic_load_explicit(&r->head, memory_order_relaxed);
+    unsigned long long t = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return h - t < RING_SLOTS;
+}
+
+int ring_push(ring_t* r, msg_type_t type, const void* payload, uint32_t len, atomic_int* stop) {
+    if ((size_t)len + sizeof(msg_header_t) > RING_SLOT_BYTES) return -1;
+
+    if (r->policy == RING_DROP_OLDEST) {
+        ring_write(r, NULL, type, payload, len);
+        return 0;
+    }
+
+    if (r->policy == RING_COALESCE) {
+        /* najprv čakajúca správa, aby sa zachovalo poradie */
+        if (r->has_pending && ring_has_room(r)) {
+            ring_write(r, r->pending, type, NULL, 0);
+            r->has_pending = 0;
+        }
+        if (!r->has_pending && ring_has_room(r)) {
+            ring_write(r, NULL, type, payload, len);
+            return 0;
+        }
+        if (r->has_pending) atomic_fetch_add_explicit(&r->coalesced, 1, memory_order_relaxed);
+        slot_fill(r->pending, type, payload, len);
+        r->has_pending = 1;
+        return 0;
+    }
+
+    /* RING_BLOCK */
+    if (!ring_has_room(r)) {
+        atomic_fetch_add_explicit(&r->waits, 1, memory_order_relaxed);
+        while (!ring_has_room(r)) {
+            if (atomic_load_explicit(stop, memory_order_relaxed)) return -1;
+            nanosleep((const struct timespec[]){{0, RING_WAIT_NS}}, NULL);
+        }
+    }
+    ring_write(r, NULL, type, payload, len);
+    return 0;
+}
+
+void ring_finish(ring_t* r, atomic_int* stop) {
+    if (!r->has_pending) return;
+    while (!ring_has_room(r)) {
+        if (atomic_load_explicit(stop, memory_order_relaxed)) {
+            r->has_pending = 0;
+            return;
+        }
+        nanosleep((const struct timespec[]){{0, RING_WAIT_NS}}, NULL);
+    }
+    ring_write(r, r->pending, MSG_STATE, NULL, 0);
+    r->has_pending = 0;
+}
+
+uint32_t ring_pop(ring_t* r, unsigned char* out, uint32_t cap) {
+    uint32_t n = 0;
+    unsigned long long t = atomic_load_explicit(&r->tail, memory_order_relaxed);
+
+    for (;;) {
+        unsigned long long h = atomic_load_explicit(&r->head, memory_order_acquire);
+        if (t == h) break;
+
+        /* producent nás predbehol o celý front - preskoč prepísané pozície */
+        if (h - t > RING_SLOTS) {
+            atomic_fetch_add_explicit(&r->dropped, h - RING_SLOTS - t, memory_order_relaxed);
+            t = h - RING_SLOTS;
+        }
+
+        ring_slot_t* s = &r->slots[t & (RING_SLOTS - 1u)];
+        unsigned long long want = 2u * t + 2u;
+        unsigned long long s1 = atomic_load_explicit(&s->seq, memory_order_acquire);
+        if (s1 != want) {
+            /* slot už patrí novšej pozícii (prepísaný) */
+            atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+            t++;
+            continue;
+        }
+
+        uint32_t len = s->len;
+        if (len > RING_SLOT_BYTES || n + len > cap) break;
+        memcpy(out + n, s->data, len);
+
+        /* seqlock: ak sa seq počas kopírovania zmenil, kópia je neplatná */
+        atomic_thread_fence(memory_order_acquire);
+        if (atomic_load_explicit(&s->seq, memory_order_relaxed) != want) {
+            atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+            t++;
+            continue;
+        }
+        n += len;
+        t++;
+    }
+
+    atomic_store_explicit(&r->tail, t, memory_order_release);
+    return n;
+}
+
+uint32_t ring_used(ring_t* r) {
+    unsigned long long h = atomic_load_explicit(&r->head, memory_order_acquire);
+    unsigned long long t = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return (h - t > RING_SLOTS) ? RING_SLOTS : (uint32_t)(h - t);
+}
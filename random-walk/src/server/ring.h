@@ -0,0 +1,118 @@
+/**
+ * @file ring.h
+ * @brief Bezzámkový SPSC front zakódovaných správ medzi simuláciou a odosielaním.
+ *
+ * Každé simulačné vlákno je jediným producentom svojho frontu, jediným
+ * konzumentom všetkých frontov je odosielacie vlákno. Správa sa do slotu
+ * vloží už celá zakódovaná (hlavička + payload), takže konzument ju len
+ * skopíruje do veľkého bufferu a pošle jedným zápisom. Pomalý klient tak
+ * simuláciu priamo nebrzdí - čo sa stane pri plnom fronte, určuje
+ * ring_policy_t.
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+
+/** Počet slotov jedného frontu (mocnina dvoch). */
+#define RING_SLOTS 16u
+
+/** Kapacita slotu: hlavička + najväčší payload, ktorý simulácia posiela (MSG_TRAJ). */
+#define RING_SLOT_BYTES (sizeof(msg_header_t) + TRAJ_FRAME_MAX)
+
+/**
+ * @brief Jeden slot frontu.
+ *
+ * seq = 2 * pozícia + 1 počas zápisu, 2 * pozícia + 2 po dokončení. Konzument
+ * podľa neho pozná, či slot medzitým neprepísal producent (RING_DROP_OLDEST).
+ */
+typedef struct {
+    atomic_ullong seq;       /**< Sekvenčné číslo (viď vyššie) */
+    uint32_t len;            /**< Dĺžka správy v data (hlavička + payload) */
+    unsigned char data[RING_SLOT_BYTES]; /**< Zakódovaná správa */
+} ring_slot_t;
+
+/**
+ * @brief SPSC front správ.
+ *
+ * head mení iba producent, tail iba konzument; každé je na vlastnom riadku
+ * cache, aby sa vlákna navzájom nespomaľovali.
+ */
+typedef struct {
+    ring_slot_t* slots;      /**< RING_SLOTS slotov */
+    uint8_t policy;          /**< Správanie pri plnom fronte (ring_policy_t) */
+
+    _Alignas(64) atomic_ullong head; /**< Ďalšia pozícia na zápis (producent) */
+    _Alignas(64) atomic_ullong tail; /**< Ďalšia pozícia na čítanie (konzument) */
+
+    _Alignas(64) atomic_ullong dropped;   /**< Prepísané správy (počíta konzument) */
+    atomic_ullong coalesced; /**< Nahradené čakajúce správy (počíta producent) */
+    atomic_ullong waits;     /**< Čakania producenta na miesto */
+    atomic_uint peak;        /**< Najväčšia obsadenosť (zapisuje producent) */
+
+    ring_slot_t* pending;    /**< Čakajúca správa pri RING_COALESCE (súkromné pre producenta) */
+    int has_pending;         /**< 1 ak pending obsahuje správu */
+} ring_t;
+
+/**
+ * @brief Inicializuje prázdny front.
+ *
+ * @param r Front.
+ * @param policy Správanie pri plnom fronte (ring_policy_t).
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+int ring_init(ring_t* r, uint8_t policy);
+
+/**
+ * @brief Uvoľní pamäť frontu.
+ *
+ * @param r Front.
+ */
+void ring_free(ring_t* r);
+
+/**
+ * @brief Vloží správu do frontu (volá iba producent).
+ *
+ * @param r Front.
+ * @param type Typ správy.
+ * @param payload Payload (môže byť NULL ak len = 0).
+ * @param len Dĺžka payloadu (najviac TRAJ_FRAME_MAX).
+ * @param stop Príznak zastavenia behu - pri RING_BLOCK ukončí čakanie.
+ * @return 0 ak je správa vo fronte (alebo podľa politiky zahodená/nahradená),
+ *         -1 ak sa čakanie prerušilo cez stop alebo je správa príliš veľká.
+ */
+int ring_push(ring_t* r, msg_type_t type, const void* payload, uint32_t len, atomic_int* stop);
+
+/**
+ * @brief Vloží čakajúcu správu (RING_COALESCE) po skončení producenta.
+ *
+ * Volá sa, keď už producent nič iné nevkladá; v prípade potreby počká
+ * na miesto.
+ *
+ * @param r Front.
+ * @param stop Príznak zastavenia behu - ukončí čakanie a správu zahodí.
+ */
+void ring_finish(ring_t* r, atomic_int* stop);
+
+/**
+ * @brief Vyberie z frontu celé správy, kým sa zmestia do out (volá iba konzument).
+ *
+ * Správy, ktoré producent medzitým prepísal (RING_DROP_OLDEST), sa
+ * preskočia a započítajú do dropped.
+ *
+ * @param r Front.
+ * @param out Výstupný buffer.
+ * @param cap Kapacita out (aspoň RING_SLOT_BYTES, inak sa nemusí vybrať nič).
+ * @return Počet skopírovaných bajtov.
+ */
+uint32_t ring_pop(ring_t* r, unsigned char* out, uint32_t cap);
+
+/**
+ * @brief Aktuálny počet správ vo fronte.
+ *
+ * @param r Front.
+ * @return Počet neodoslaných správ (najviac RING_SLOTS).
+ */
+uint32_t ring_used(ring_t* r);
@@ -0,0 +1,134 @@
+/**
+ * @file rng.h
+ * @brief Counter-based generátor náhodných čísel (Philox4x32-10).
+ *
+ * Na rozdiel od rand_r() nemá generátor sekvenčný stav: náhodný blok je čistá
+ * funkcia (kľúč, počítadlo). Kľúč sa odvodí zo seedu a počítadlo tvorí
+ * (blok krokov, číslo replikácie, číslo prúdu). Replikáciu i je tak možné
+ * spočítať na ľubovoľnom vlákne v ľubovoľnom poradí a výsledky sú bitovo
+ * rovnaké pri akomkoľvek počte vlákien.
+ *
+ * Funkcie sú static inline, lebo sa volajú v najhorúcejšej slučke simulácie.
+ */
+
+#pragma once
+#include <stdint.h>
+
+#define PHILOX_M0 0xD2511F53u  /**< Násobiteľ pre slovo 0 */
+#define PHILOX_M1 0xCD9E8D57u  /**< Násobiteľ pre slovo 2 */
+#define PHILOX_W0 0x9E3779B9u  /**< Weyl prírastok kľúča 0 (zlatý rez) */
+#define PHILOX_W1 0xBB67AE85u  /**< Weyl prírastok kľúča 1 (sqrt(3)-1) */
+
+/** Počet 32-bitových náhodných slov z jedného bloku Philox. */
+#define RNG_BLOCK_WORDS 4u
+
+/** Počet 16-bitových polslov (= krokov chodca) z jedného bloku Philox. */
+#define RNG_BLOCK_HALVES 8u
+
+/**
+ * @brief Náhodný prúd jednej replikácie.
+ *
+ * Obsahuje iba kľúč, súradnice počítadla a buffer posledného bloku;
+ * kopírovanie alebo znovuvytvorenie prúdu na inom vlákne dá tie isté čísla.
+ */
+typedef struct {
+    uint32_t key[2];         /**< Kľúč odvodený zo seedu */
+    uint32_t block;          /**< Index nasledujúceho bloku v rámci replikácie */
+    uint32_t rep;            /**< Číslo replikácie (0-based) */
+    uint32_t stream;         /**< Číslo prúdu (rozlíšenie nezávislých behov s rovnakým seedom) */
+    uint32_t buf[RNG_BLOCK_WORDS]; /**< Posledný vygenerovaný blok */
+    uint32_t avail;          /**< Počet ešte nepoužitých 16-bitových polslov v buf */
+} rng_stream_t;
+
+/**
+ * @brief Philox4x32 s 10 kolami: zašifruje počítadlo ctr kľúčom key.
+ *
+ * @param ctr Vstupné počítadlo (4 slová).
+ * @param key Kľúč (2 slová).
+ * @param out Výstupný náhodný blok (4 slová).
+ */
+static inline void philox4x32_10(const uint32_t ctr[4], const uint32_t key[2], uint32_t out[4]) {
+    uint32_t c0 = ctr[0], c1 = ctr[1], c2 = ctr[2], c3 = ctr[3];
+    uint32_t k0 = key[0], k1 = key[1];
+
+    for (int round = 0; round < 10; round++) {
+        uint64_t p0 = (uint64_t)PHILOX_M0 * c0;
+        uint64_t p1 = (uint64_t)PHILOX_M1 * c2;
+        uint32_t n0 = (uint32_t)(p1 >> 32) ^ c1 ^ k0;
+        uint32_t n2 = (uint32_t)(p0 >> 32) ^ c3 ^ k1;
+        c1 = (uint32_t)p1;
+        c3 = (uint32_t)p0;
+        c0 = n0;
+        c2 = n2;
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+
+    out[0] = c0;
+    out[1] = c1;
+    out[2] = c2;
+    out[3] = c3;
+}
+
+/**
+ * @brief Odvodí kľúč Philox zo seedu simulácie.
+ *
+ * Druhé slovo je pevná konštanta ("RWK1"), aby seed 0 nedával nulový kľúč.
+ *
+ * @param seed Seed simulácie.
+ * @param key Výstupný kľúč.
+ */
+static inline void rng_key_from_seed(uint32_t seed, uint32_t key[2]) {
+    key[0] = seed;
+    key[1] = 0x52574B31u;
+}
+
+/**
+ * @brief Pripraví náhodný prúd pre replikáciu rep.
+ *
+ * @param s Ukazovateľ na prúd.
+ * @param seed Seed simulácie.
+ * @param rep Číslo replikácie (0-based).
+ * @param stream Číslo prúdu (0 pre bežný beh).
+ */
+static inline void rng_stream_init(rng_stream_t* s, uint32_t seed, uint32_t rep, uint32_t stream) {
+    rng_key_from_seed(seed, s->key);
+    s->block = 0;
+    s->rep = rep;
+    s->stream = stream;
+    s->avail = 0;
+}
+
+/**
+ * @brief Vyberie j-te 16-bitové polslovo z bloku Philox.
+ *
+ * Polslovo j je dolná (j párne) alebo horná (j nepárne) polovica slova j/2.
+ * Toto mapovanie je súčasťou definície prúdu - skalárne aj SIMD jadro ho
+ * musia dodržať, aby dávali rovnaké trajektórie.
+ *
+ * @param buf Blok 4 slov.
+ * @param j Index polslova (0..7).
+ * @return 16-bitové náhodné číslo.
+ */
+static inline uint32_t rng_block_half(const uint32_t buf[RNG_BLOCK_WORDS], uint32_t j) {
+    return (buf[j >> 1] >> ((j & 1u) * 16u)) & 0xFFFFu;
+}
+
+/**
+ * @brief Vráti ďalšie 16-bitové náhodné číslo z prúdu (jedno na krok).
+ *
+ * Krok s (0-based) replikácie používa blok s/8 s počítadlom
+ * (s/8, rep, stream, 0) a jeho polslovo s%8.
+ *
+ * @param s Ukazovateľ na prúd.
+ * @return Rovnomerne rozdelené číslo 0..65535.
+ */
+static inline uint32_t rng_next_u16(rng_stream_t* s) {
+    if (s->avail == 0) {
+        const uint32_t ctr[4] = { s->block, s->rep, s->stream, 0u };
+        philox4x32_10(ctr, s->key, s->buf);
+        s->block++;
+        s->avail = RNG_BLOCK_HALVES;
+    }
+    return rng_block_half(s->buf, RNG_BLOCK_HALVES - s->avail--);
+}
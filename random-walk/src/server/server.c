@@ -1,458 +1,2348 @@
 #include "server.h"
+#include "cache.h"
+#include "checkpoint.h"
+#include "exact.h"
+#include "fanout.h"
+#include "hist.h"
+#include "pool.h"
 #include "results.h"
+#include "ring.h"
+#include "runlog.h"
+#include "simulation.h"
+#include "sweep.h"
+#include "trajfile.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdatomic.h>
+#include <sys/epoll.h>
+#include <sys/stat.h>
 
 /**
- * @brief Kontext servera uchovávajúci stav spojenia, simulácie a vlákien.
+ * @brief Kontext servera spoločný pre všetky relácie.
  *
- * Táto štruktúra obsahuje všetky potrebné informácie pre serverový proces,
- * vrátane socketov, stavu simulácie, parametrov náhodnej prechádzky a pozície.
- * Prístup k zdieľaným údajom je chránený mutexom.
+ * Simulácie všetkých klientov bežia na jednom pevnom poole vlákien;
+ * samotné relácie (session_t) patria jednotlivým spojeniam.
  */
 typedef struct {
-    int listen_fd;           /**< File descriptor počúvajúceho socketu */
-    int client_fd;           /**< File descriptor klientského socketu (-1 ak žiadny klient) */
-    int running;             /**< Príznak, či server beží (1) alebo sa má ukončiť (0) */
-    int session_active;      /**< Príznak aktívneho klientského spojenia */
-    int sim_running;         /**< Príznak bežiacej simulácie */
-
-    pthread_mutex_t mtx;     /**< Mutex pre ochranu prístupu k zdieľaným údajom */
-
-    int32_t width, height;   /**< Rozmery sveta (šírka × výška) */
-    uint32_t k_max;          /**< Maximálny počet krokov v jednej replikácii */
-    uint32_t reps;           /**< Celkový počet replikácií simulácie */
-    uint32_t seed;           /**< Seed pre generátor náhodných čísiel */
-
-    uint8_t p_up, p_down, p_left, p_right; /**< Pravdepodobnosti pohybu v percentách (súčet = 100) */
-
-    /* stav pre aktuálnu replikáciu */
-    uint32_t cur_rep;        /**< Aktuálna replikácia (1..reps) */
-    uint32_t step;           /**< Aktuálny krok v replikácii */
-    int32_t x, y;            /**< Aktuálna pozícia v mriežke */
-    results_t results;       /**< Štatistiky výsledkov simulácie */
+    pool_t* pool;            /**< Pool vlákien pre simulácie všetkých relácií */
+    pthread_mutex_t mtx;     /**< Chráni next_id, sessions a list */
+    pthread_mutex_t print_mtx; /**< Aby sa súhrny súbežných behov na výstupe nepremiešali */
+    uint32_t next_id;        /**< Číslo ďalšej relácie (len na výpis) */
+    uint32_t sessions;       /**< Počet relácií po handshake */
+    struct session* list;    /**< Relácie s pripojeným klientom, najnovšia prvá (pre MSG_SUBSCRIBE) */
+    cache_t* cache;          /**< Cache výsledkov (NULL = bez dátového priečinka) */
+    runlog_t* runlog;        /**< Denník dokončených behov (NULL = bez dátového priečinka) */
+    const char* data_dir;    /**< Dátový priečinok (NULL = nič sa neukladá) */
+    uint32_t ckpt_ms;        /**< Interval checkpointov behov v ms (0 = bez checkpointov) */
+    ckpt_writer_t* ckpt_writer; /**< Vlákno, ktoré zapisuje checkpointy (NULL = bez checkpointov) */
 } server_ctx_t;
 
+typedef struct run run_t;
+
 /**
- * @brief Thread-safe získanie príznaku running.
+ * @brief Relácia jedného klienta: spojenie, nastavenia a jeho beh.
  *
- * @param ctx Ukazovateľ na kontext servera.
- * @return 1 ak server beží, 0 ak sa má ukončiť.
+ * Vytvorí sa po handshake. Referenciu drží spojenie a každý beh relácie,
+ * takže relácia prežije odpojenie klienta, kým jej beh v poole nedobehne.
+ * fd sa mení iba pod send_mtx aj mtx - stačí držať jeden z nich na čítanie.
+ * Do socketu sa píše iba bez čakania cez front out (vlákna poolu, odosielacie
+ * vlákno aj event slučka); čo sa nezmestí, dopošle event slučka pri EPOLLOUT.
+ * Priebeh behov sa okrem vlastníka rozosiela aj pozorovateľom (fan).
  */
-static int get_running(server_ctx_t* ctx) {
-    int r;
-    pthread_mutex_lock(&ctx->mtx);
-    r = ctx->running;
-    pthread_mutex_unlock(&ctx->mtx);
-    return r;
-}
+typedef struct session {
+    server_ctx_t* srv;       /**< Kontext servera */
+    uint32_t id;             /**< Číslo relácie (len na výpis) */
+    atomic_int refs;         /**< Počet referencií (spojenie + behy) */
+    int fd;                  /**< Socket klienta (-1 po odpojení) */
+
+    pthread_mutex_t mtx;     /**< Chráni nastavenia, run a pending */
+    pthread_mutex_t send_mtx; /**< Chráni fd pri nastavovaní socketu (politika, net_flush) a last_flush */
+    fan_sub_t out;           /**< Front správ pre klienta (riadiace správy sa nezahadzujú) */
+
+    uint32_t batch_max;      /**< Najviac stavov v jednej správe (z MSG_SESSION; 1 = MSG_STATE) */
+    uint32_t flush_ms;       /**< Najdlhšie zdržanie neúplnej dávky stavov v ms */
+    uint8_t net_policy;      /**< Politika odosielania klientovi (net_policy_t, z MSG_SESSION) */
+    uint32_t max_fps;        /**< Najviac stavov za sekundu (0 = bez obmedzenia, z MSG_SESSION) */
+    uint32_t decimate;       /**< Posielať stav iba v každom decimate-tom kroku (z MSG_SESSION) */
+    uint8_t ring_policy;     /**< Správanie pri plnom fronte odosielania (ring_policy_t, z MSG_SESSION) */
+    uint32_t snap_reps;      /**< Priebežný súhrn po snap_reps replikáciách (0 = nie, z MSG_SESSION) */
+    uint32_t snap_ms;        /**< Priebežný súhrn po snap_ms ms (0 = nie, z MSG_SESSION) */
+    struct timespec last_flush; /**< Posledné net_flush() pri NET_POLICY_THROUGHPUT (chráni send_mtx) */
+
+    run_t* run;              /**< Práve bežiaci beh (NULL ak žiadny) */
+    run_t* pending;          /**< START, ktorý čaká na dobehnutie zastaveného behu */
+
+    fan_t fan;               /**< Pozorovatelia behov relácie (MSG_SUBSCRIBE) */
+    struct session* list_prev; /**< Zoznam srv->list */
+    struct session* list_next; /**< Zoznam srv->list */
+} session_t;
+
+/** Veľkosť bufferu odosielacieho vlákna - toľko bajtov správ pošle jedným zápisom. */
+#define SENDER_BUF_BYTES (256u * 1024u)
+
+/** Pauza odosielacieho vlákna, keď sú všetky fronty prázdne (ns). */
+#define SENDER_IDLE_NS 200000L
 
 /**
- * @brief Thread-safe nastavenie príznaku running.
+ * @brief Odosielanie priebehu jedného behu: fronty shardov + vlákno.
  *
- * @param ctx Ukazovateľ na kontext servera.
- * @param value Nová hodnota príznaku (1 = bežiaci, 0 = ukončenie).
+ * Shardy v poole iba vkladajú správy do svojho frontu (emit_state), do
+ * frontu klienta (session_t.out) ich zlučuje výlučne odosielacie vlákno
+ * (sender_main).
  */
-static void set_running(server_ctx_t* ctx, int value) {
-    pthread_mutex_lock(&ctx->mtx);
-    ctx->running = value;
-    pthread_mutex_unlock(&ctx->mtx);
-}
+typedef struct {
+    session_t* s;            /**< Relácia, ktorej klientovi sa posiela */
+    sim_job_t* job;          /**< Beh (na zastavenie, ak klient odpadne) */
+    ring_t* rings;           /**< Front pre každý shard */
+    uint32_t nrings;         /**< Počet frontov */
+    unsigned char* buf;      /**< Buffer na zlúčenie správ do jedného zápisu */
+    atomic_int done;         /**< 1 = producenti skončili, stačí vyprázdniť fronty */
+    int failed;              /**< 1 = zápis zlyhal, ďalšie správy sa zahadzujú */
+    pthread_t tid;           /**< Odosielacie vlákno */
+} sender_t;
+
+/**
+ * @brief Presný výpočet behu (METHOD_EXACT, METHOD_ALL_STARTS) a jeho odosielanie.
+ *
+ * Výpočet beží v pásoch ako úlohy poolu (exact_calc_submit), výsledok potom
+ * po úsekoch posiela úloha exact_task, preto si medzi nimi pamätá, kde je.
+ */
+typedef struct {
+    exact_calc_t* calc;      /**< Rozpracovaný výpočet (NULL pred zaradením a po skončení) */
+    int computed;            /**< 1 = výpočet skončil, posiela sa výsledok */
+    int ok;                  /**< 1 ak je výsledok platný (je čo posielať) */
+    exact_result_t ex;       /**< Výsledok METHOD_EXACT */
+    exact_grid_t grid;       /**< Výsledok METHOD_ALL_STARTS */
+    msg_grid_cells_t* cells; /**< Buffer MSG_GRID_CELLS */
+    uint32_t next;           /**< Ďalší krok (PMF) alebo bunka (mriežka) na odoslanie */
+    int head_sent;           /**< 1 ak MSG_GRID_INFO už odišla */
+    int owner;               /**< 1 kým má zmysel posielať vlastníkovi (je pripojený) */
+} exact_state_t;
+
+/** Koľko bodov prechodu je naraz v poole na jedno vlákno poolu. */
+#define SWEEP_INFLIGHT_PER_THREAD 2u
+
+typedef struct sweep sweep_t;
+
 /**
- * @brief Zabalí celočíselnú hodnotu do rozsahu [0, maxv) s obalovaním.
+ * @brief Slot prechodu: jeden rozpracovaný bod v poole.
  *
- * Implementuje toroidálnu topológiu - hodnoty mimo rozsahu sa zabalia na druhú stranu.
- * Napríklad: wrap_i32(-1, 10) vráti 9, wrap_i32(10, 10) vráti 0.
+ * Po dokončení bodu si slot zoberie ďalší nespracovaný bod, takže v poole
+ * je naraz najviac nslots bodov a ich joby netreba alokovať pre celú mriežku.
+ */
+typedef struct {
+    sweep_t* sw;             /**< Prechod */
+    uint32_t index;          /**< Bod, ktorý slot práve počíta */
+    sim_job_t job;           /**< Beh bodu */
+    results_t results;       /**< Štatistiky bodu */
+} sweep_slot_t;
+
+/**
+ * @brief Prechod mriežkou parametrov (MSG_SWEEP) patriaci jednému behu.
+ */
+struct sweep {
+    struct run* run;         /**< Beh, ktorému prechod patrí */
+    sweep_point_t* points;   /**< Body mriežky */
+    uint32_t total;          /**< Počet bodov */
+    uint32_t reps;           /**< Replikácie v každom bode */
+    uint32_t seed;           /**< Seed prechodu (už rozhodnutý) */
+    uint8_t boundary;        /**< Režim okraja */
+    uint8_t crn;             /**< 1 = spoločné náhodné prúdy */
+    int cacheable;           /**< 1 ak sa body smú hľadať/ukladať v cache (pevný seed) */
+    uint32_t threads;        /**< Shardy jedného bodu */
+
+    pthread_mutex_t mtx;     /**< Chráni všetko nižšie a stop jobov v slotoch */
+    sweep_slot_t* slots;     /**< Sloty (NULL pred sweep_begin) */
+    uint32_t nslots;         /**< Počet slotov */
+    uint32_t next;           /**< Ďalší nespracovaný bod */
+    uint32_t active;         /**< Sloty, ktoré ešte neskončili */
+    uint32_t sent;           /**< Odoslané body */
+    uint32_t cached;         /**< Body z cache */
+};
+
+/**
+ * @brief Jeden beh relácie (od START po MSG_DONE).
+ */
+struct run {
+    session_t* s;            /**< Relácia (beh drží referenciu) */
+    sim_job_t job;           /**< Parametre a riadenie behu */
+    uint8_t stream;          /**< Čo posielať počas behu (stream_mode_t) */
+    uint8_t ring_policy;     /**< Politika frontov odosielania (ring_policy_t) */
+    uint8_t pct[4];          /**< Percentá smerov (len na výpis) */
+    sender_t snd;            /**< Odosielanie priebehu */
+    int has_sender;          /**< 1 ak beží odosielacie vlákno */
+    results_t results;       /**< Štatistiky výsledkov behu */
+    msg_traj_info_t traj_info; /**< MSG_TRAJ_INFO behu (pre neskôr pripojených pozorovateľov) */
+    int traj_sent;           /**< 1 ak už MSG_TRAJ_INFO odišla (chráni s->mtx) */
+    int cacheable;           /**< 1 ak sa výsledok smie hľadať/ukladať v cache (Monte Carlo s pevným seedom) */
+    int cached;              /**< 1 ak výsledok prišiel z cache */
+    int record;              /**< 1 ak klient žiada zápis trajektórií do súboru */
+    char record_path[TRAJ_FILE_PATH_MAX]; /**< Súbor trajektórií (platí pri job.record) */
+    int resume;              /**< 1 ak beh prišiel cez MSG_RESUME (pokračuje z checkpointu) */
+    uint32_t shards;         /**< Počet shardov behu (sim_job_shards, pre denník) */
+    cache_key_t ckpt_key;    /**< Kľúč behu pre checkpoint (platí pri job.ckpt) */
+    char ckpt_path[4096];    /**< Súbor checkpointu (platí pri job.ckpt) */
+    ckpt_req_t ckpt_req;     /**< Požiadavka pre zapisovač (najviac jedna naraz, job.ckpt_busy) */
+    int64_t t_start_ns;      /**< Začiatok behu (CLOCK_REALTIME, pre denník) */
+    struct timespec t0;      /**< Začiatok behu (CLOCK_MONOTONIC, pre denník) */
+    sweep_t* sweep;          /**< Prechod mriežkou (NULL pri START/RESUME) */
+    exact_state_t* exact;    /**< Presný výpočet (NULL pri Monte Carlo) */
+};
+
+static void run_begin(run_t* run);
+
+/**
+ * @brief Pridá referenciu na reláciu.
  *
- * @param v Hodnota na zabalenie.
- * @param maxv Horná hranica rozsahu (exkluzívna).
- * @return Zabalená hodnota v rozsahu [0, maxv), alebo 0 ak maxv <= 0.
+ * @param s Relácia.
  */
-static int wrap_i32(int v, int maxv) {
-    if (maxv <= 0) return 0;
-    v %= maxv;
-    if (v < 0) v += maxv;
-    return v;
+static void session_get(session_t* s) {
+    atomic_fetch_add(&s->refs, 1);
 }
 
 /**
- * @brief Vyberie náhodný smer podľa zadaných pravdepodobností v percentách.
+ * @brief Uvoľní referenciu; poslednou sa relácia zruší.
  *
- * Používa generátor náhodných čísiel rand_r() s pravdepodobnosťami pre každý smer.
- * Pravdepodobnosti sú zadané v percentách a ich súčet by mal byť 100.
+ * @param s Relácia.
+ */
+static void session_put(session_t* s) {
+    if (atomic_fetch_sub(&s->refs, 1) != 1) return;
+    fan_sub_free(&s->out);
+    fan_destroy(&s->fan);
+    pthread_mutex_destroy(&s->send_mtx);
+    pthread_mutex_destroy(&s->mtx);
+    free(s);
+}
+
+/**
+ * @brief Uvoľní beh a jeho referenciu na reláciu.
  *
- * @param rng Ukazovateľ na seed pre generátor náhodných čísiel (rand_r).
- * @param p_up Pravdepodobnosť pohybu hore (%).
- * @param p_down Pravdepodobnosť pohybu dole (%).
- * @param p_left Pravdepodobnosť pohybu doľava (%).
- * @param p_right Pravdepodobnosť pohybu doprava (%).
- * @return 0=UP, 1=DOWN, 2=LEFT, 3=RIGHT
+ * @param run Beh (už nebeží ani nečaká).
  */
-static int pick_dir_percent(uint32_t* rng, uint8_t p_up, uint8_t p_down, uint8_t p_left, uint8_t p_right) {
-    unsigned r = (unsigned)(rand_r(rng) % 100); // 0..99
+static void run_free(run_t* run) {
+    session_t* s = run->s;
+    if (run->sweep) {
+        pthread_mutex_destroy(&run->sweep->mtx);
+        free(run->sweep->slots);
+        free(run->sweep->points);
+        free(run->sweep);
+    }
+    if (run->exact) {
+        exact_calc_free(run->exact->calc);
+        exact_result_free(&run->exact->ex);
+        exact_grid_free(&run->exact->grid);
+        free(run->exact->cells);
+        free(run->exact);
+    }
+    free(run);
+    session_put(s);
+}
 
-    unsigned a = (unsigned)p_up;
-    unsigned b = a + (unsigned)p_down;
-    unsigned c = b + (unsigned)p_left;
-    unsigned d = c + (unsigned)p_right; // malo by byt 100
+/**
+ * @brief Zastaví beh (nový START, odpojenie klienta).
+ *
+ * Prechod mriežkou zastaví aj body, ktoré práve bežia v poole.
+ *
+ * @param run Bežiaci beh (volajúci drží s->mtx).
+ */
+static void run_stop(run_t* run) {
+    atomic_store(&run->job.stop, 1);
+    sweep_t* sw = run->sweep;
+    if (!sw) return;
+    pthread_mutex_lock(&sw->mtx);
+    for (uint32_t i = 0; i < sw->nslots; i++) atomic_store(&sw->slots[i].job.stop, 1);
+    pthread_mutex_unlock(&sw->mtx);
+}
 
-    // pre istotu, keby prišlo niečo zlé (aj keď server to validuje)
-    if (d == 0) return 3;
+/**
+ * @brief Zaradí správu pre klienta relácie do frontu out (nečaká na socket).
+ *
+ * @param s Relácia.
+ * @param type Typ správy.
+ * @param payload Payload.
+ * @param len Dĺžka payloadu.
+ * @return 0 pri úspechu, -1 ak klient nie je pripojený, zápis zlyhal alebo chýba pamäť.
+ */
+static int session_send(session_t* s, msg_type_t type, const void* payload, uint32_t len) {
+    fan_buf_t* b = fan_buf_msg(type, payload, len);
+    if (!b) return -1;
+    int rc = fan_sub_push(&s->out, b);
+    fan_buf_put(b);
+    return rc;
+}
 
-    if (r < a) return 0;      // UP
-    if (r < b) return 1;      // DOWN
-    if (r < c) return 2;      // LEFT
-    return 3;                 // RIGHT
+/**
+ * @brief Hranica dávky: pri NET_POLICY_THROUGHPUT odošle zazátkované dáta.
+ *
+ * Odíde iba to, čo už je v sockete; zvyšok frontu out po dopísaní
+ * vyprázdni session_flush().
+ *
+ * @param s Relácia.
+ */
+static void session_uncork(session_t* s) {
+    pthread_mutex_lock(&s->send_mtx);
+    pthread_mutex_lock(&s->mtx);
+    uint8_t policy = s->net_policy;
+    pthread_mutex_unlock(&s->mtx);
+    if (s->fd >= 0 && policy == NET_POLICY_THROUGHPUT) {
+        (void)net_flush(s->fd);
+        clock_gettime(CLOCK_MONOTONIC, &s->last_flush);
+    }
+    pthread_mutex_unlock(&s->send_mtx);
 }
 
 /**
- * @brief Vykoná jeden krok náhodnej prechádzky podľa konfigurovaných pravdepodobností.
+ * @brief Dopošle front out, koľko socket prijme (event slučka pri EPOLLOUT).
  *
- * Aktualizuje pozíciu (x, y) v kontexte servera o jeden krok v náhodne zvoleném smere.
- * Smer je vybraný podľa pravdepodobností p_up, p_down, p_left, p_right.
- * Pozícia je zabalená pomocou toroidálnej topológie (sveta).
+ * @param s Relácia.
+ * @return 0 pri úspechu, -1 ak zápis zlyhal.
+ */
+static int session_flush(session_t* s) {
+    if (fan_sub_flush(&s->out) != 0) return -1;
+    if (fan_sub_bytes(&s->out) == 0) session_uncork(s);
+    return 0;
+}
+
+/**
+ * @brief Rozošle správu pozorovateľom relácie (zakóduje sa raz pre všetkých).
  *
- * @param ctx Ukazovateľ na kontext servera obsahujúci pozíciu a parametre.
+ * @param s Relácia.
+ * @param type Typ správy.
+ * @param payload Payload.
+ * @param len Dĺžka payloadu.
  */
-static void step_random(server_ctx_t* ctx) {
-    int d = pick_dir_percent(&ctx->seed, ctx->p_up, ctx->p_down, ctx->p_left, ctx->p_right);
+static void session_publish(session_t* s, msg_type_t type, const void* payload, uint32_t len) {
+    if (fan_count(&s->fan) == 0) return;
+    fan_buf_t* b = fan_buf_msg(type, payload, len);
+    if (!b) return;
+    fan_publish(&s->fan, b);
+    fan_buf_put(b);
+}
 
-    int32_t x = ctx->x;
-    int32_t y = ctx->y;
+/**
+ * @brief Určí pravdepodobnosti smerov z MSG_START.
+ *
+ * Ak klient poslal prob_q (jemná pevná rádová čiarka), musia dávať súčet
+ * PROB_ONE. Inak sa použijú celé percentá (súčet 100) a prevedú sa na prob_q.
+ * Percentá pre výpis sa v prvom prípade dopočítajú zaokrúhlením.
+ *
+ * @param s Prijaté parametre.
+ * @param q Výstupné pravdepodobnosti v 1/PROB_ONE.
+ * @param pct Výstupné percentá (len na výpis).
+ * @return 0 pri úspechu, -1 pri neplatných pravdepodobnostiach.
+ */
+static int resolve_start_probs(const msg_start_t* s, uint32_t q[4], uint8_t pct[4]) {
+    uint64_t qsum = 0;
+    for (int i = 0; i < 4; i++) qsum += s->prob_q[i];
+
+    if (qsum != 0) {
+        if (qsum != PROB_ONE) {
+            printf("[server] invalid START prob_q sum=%llu (must be %u)\n",
+                   (unsigned long long)qsum, PROB_ONE);
+            return -1;
+        }
+        for (int i = 0; i < 4; i++) {
+            q[i] = s->prob_q[i];
+            pct[i] = (uint8_t)((q[i] * 100u + PROB_ONE / 2u) / PROB_ONE);
+        }
+        return 0;
+    }
 
-    if (d == 0) y -= 1;        // UP
-    else if (d == 1) y += 1;   // DOWN
-    else if (d == 2) x -= 1;   // LEFT
-    else x += 1;               // RIGHT
+    unsigned psum = (unsigned)s->p_up + (unsigned)s->p_down + (unsigned)s->p_left + (unsigned)s->p_right;
+    if (psum != 100) {
+        printf("[server] invalid START percents sum=%u (must be 100)\n", psum);
+        return -1;
+    }
+    const double p[4] = { s->p_up, s->p_down, s->p_left, s->p_right };
+    if (proto_probs_from_percents(p, q) != 0) return -1;
+    pct[0] = s->p_up;
+    pct[1] = s->p_down;
+    pct[2] = s->p_left;
+    pct[3] = s->p_right;
+    return 0;
+}
 
-    x = wrap_i32(x, ctx->width);
-    y = wrap_i32(y, ctx->height);
+/**
+ * @brief Callback simulácie - zaradí správu s priebehom behu do frontu shardu.
+ *
+ * Správu (MSG_STATE, MSG_STATE_BATCH alebo MSG_TRAJ) pripraví simulácia.
+ * Každý shard má vlastný SPSC front, takže sa tu nič nezamyká; pri plnom
+ * fronte rozhodne politika z MSG_SESSION.
+ *
+ * @param arg Ukazovateľ na sender_t.
+ * @param worker Index shardu.
+ * @param type Typ správy.
+ * @param payload Payload správy.
+ * @param len Dĺžka payloadu v bajtoch.
+ * @return 0 pri úspechu, -1 ak sa beh zastavil počas čakania na miesto.
+ */
+static int emit_state(void* arg, uint32_t worker, msg_type_t type, const void* payload, uint32_t len) {
+    sender_t* snd = (sender_t*)arg;
+    if (worker >= snd->nrings) return -1;
+    return ring_push(&snd->rings[worker], type, payload, len, &snd->job->stop);
+}
 
-    ctx->x = x;
-    ctx->y = y;
+/**
+ * @brief Callback simulácie - zistí, či sa do frontu shardu zmestí ďalší krok.
+ *
+ * Pri RING_BLOCK by plný front zablokoval vlákno poolu; shard sa radšej
+ * odloží a vlákno medzitým počíta iné behy. Ostatné politiky nečakajú nikdy.
+ *
+ * @param arg Ukazovateľ na sender_t.
+ * @param worker Index shardu.
+ * @return 1 ak sú voľné aspoň 2 sloty (alebo politika nečaká), inak 0.
+ */
+static int emit_ready(void* arg, uint32_t worker) {
+    sender_t* snd = (sender_t*)arg;
+    if (worker >= snd->nrings) return 1;
+    ring_t* r = &snd->rings[worker];
+    if (r->policy != RING_BLOCK) return 1;
+    return RING_SLOTS - ring_used(r) >= 2u;
 }
 
 /**
- * @brief Vlákno pre príjem a spracovanie správ od klienta.
+ * @brief Zaradí blok zlúčených správ do frontu klienta (session_t.out).
  *
- * Toto vlákno beží po celú dobu života servera a:
- * - Čaká na správy od pripojeného klienta
- * - Spracováva MSG_START (spustenie simulácie)
- * - Spracováva MSG_QUIT (ukončenie servera)
- * - Zatvára spojenie pri odpojení klienta
+ * Pri NET_POLICY_THROUGHPUT sa zazátkovaný socket vyprázdni najneskôr
+ * po flush_ms, ako dávka.
  *
- * @param arg Ukazovateľ na server_ctx_t štruktúru.
- * @return NULL pri ukončení.
+ * @param s Relácia.
+ * @param buf Zakódované správy.
+ * @param len Počet bajtov.
+ * @return 0 pri úspechu, -1 ak klient nie je pripojený alebo zápis zlyhal.
  */
-static void* net_thread(void* arg) {
-    server_ctx_t* ctx = (server_ctx_t*)arg;
+static int sender_write(session_t* s, const void* buf, uint32_t len) {
+    fan_buf_t* b = fan_buf_new(len, 1);
+    if (!b) return -1;
+    memcpy(b->data, buf, len);
+    int rc = fan_sub_push(&s->out, b);
+    fan_buf_put(b);
+    if (rc != 0) return -1;
+
+    pthread_mutex_lock(&s->send_mtx);
+    pthread_mutex_lock(&s->mtx);
+    int cfd = s->fd;
+    uint8_t policy = s->net_policy;
+    long flush_ns = (long)s->flush_ms * 1000000L;
+    pthread_mutex_unlock(&s->mtx);
+
+    if (cfd >= 0 && policy == NET_POLICY_THROUGHPUT) {
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        long elapsed = (long)(now.tv_sec - s->last_flush.tv_sec) * 1000000000L +
+                       (now.tv_nsec - s->last_flush.tv_nsec);
+        if (elapsed >= flush_ns) {
+            rc = net_flush(cfd);
+            s->last_flush = now;
+        }
+    }
+    pthread_mutex_unlock(&s->send_mtx);
+    return rc;
+}
 
-    unsigned char buf[256];
+/**
+ * @brief Zozbiera obsadenosť frontov a pošle ju klientovi (MSG_RING_STATUS).
+ *
+ * @param snd Odosielanie behu.
+ * @param final 1 pri poslednom hlásení behu (vypíše sa aj na serveri).
+ */
+static void sender_status(sender_t* snd, int final) {
+    msg_ring_status_t st;
+    memset(&st, 0, sizeof(st));
+    st.rings = snd->nrings;
+    st.slots = RING_SLOTS;
+    for (uint32_t i = 0; i < snd->nrings; i++) {
+        ring_t* r = &snd->rings[i];
+        uint32_t peak = atomic_load_explicit(&r->peak, memory_order_relaxed);
+        st.used += ring_used(r);
+        if (peak > st.peak) st.peak = peak;
+        st.dropped += atomic_load_explicit(&r->dropped, memory_order_relaxed);
+        st.coalesced += atomic_load_explicit(&r->coalesced, memory_order_relaxed);
+        st.waits += atomic_load_explicit(&r->waits, memory_order_relaxed);
+    }
 
-    while (get_running(ctx)) {
-        int fd;
-        pthread_mutex_lock(&ctx->mtx);
-        fd = ctx->client_fd;
-        pthread_mutex_unlock(&ctx->mtx);
+    if (!snd->failed) {
+        unsigned char frame[sizeof(msg_header_t) + sizeof(st)];
+        msg_header_t h;
+        h.type = htonl((uint32_t)MSG_RING_STATUS);
+        h.length = htonl((uint32_t)sizeof(st));
+        memcpy(frame, &h, sizeof(h));
+        memcpy(frame + sizeof(h), &st, sizeof(st));
+        if (sender_write(snd->s, frame, (uint32_t)sizeof(frame)) != 0) snd->failed = 1;
+    }
 
-        if (fd < 0) {
-            nanosleep((const struct timespec[]){{0, 100000000}}, NULL); // 100ms
-            continue;
-        }
+    if (final) {
+        printf("[server] session %u: send rings: %u x %u slots, peak %u, dropped %llu, coalesced %llu, waits %llu\n",
+               (unsigned)snd->s->id, (unsigned)st.rings, (unsigned)st.slots, (unsigned)st.peak,
+               (unsigned long long)st.dropped, (unsigned long long)st.coalesced,
+               (unsigned long long)st.waits);
+    }
+}
 
-        msg_type_t type;
-        uint32_t len = 0;
-
-        if (proto_recv(fd, &type, buf, (uint32_t)sizeof(buf), &len) != 0) {
-            fprintf(stderr, "[server] client disconnected\n");
-            pthread_mutex_lock(&ctx->mtx);
-            ctx->session_active = 0;
-            ctx->sim_running = 0;
-            shutdown(ctx->client_fd, SHUT_RDWR);
-            close(ctx->client_fd);
-            ctx->client_fd = -1;
-            pthread_mutex_unlock(&ctx->mtx);
+/**
+ * @brief Odosielacie vlákno - vyprázdňuje fronty shardov veľkými blokmi.
+ *
+ * Z každého frontu vyberie toľko celých správ, koľko sa zmestí do bufferu,
+ * a zaradí ich jedným blokom do frontu klienta. Ak reláciu niekto sleduje,
+ * ten istý blok sa raz skopíruje do zdieľaného bufferu pre všetkých
+ * pozorovateľov. Keď sú fronty prázdne, alebo klient ešte neprečítal
+ * predchádzajúci buffer, chvíľu počká - fronty shardov sa zatiaľ plnia
+ * a pri RING_BLOCK sa shardy odložia. Raz za sekundu pošle klientovi
+ * obsadenosť frontov. Skončí, keď producenti skončili (done) a fronty sú
+ * prázdne; vtedy už na klienta nečaká, aby beh mohol hneď skončiť.
+ *
+ * @param arg Ukazovateľ na sender_t.
+ * @return NULL pri ukončení.
+ */
+static void* sender_main(void* arg) {
+    sender_t* snd = (sender_t*)arg;
+    struct timespec last_status;
+    clock_gettime(CLOCK_MONOTONIC, &last_status);
+
+    for (;;) {
+        int done = atomic_load(&snd->done);
+        if (!done && !snd->failed && fan_sub_bytes(&snd->s->out) >= SENDER_BUF_BYTES) {
+            nanosleep((const struct timespec[]){{0, SENDER_IDLE_NS}}, NULL);
             continue;
         }
+        uint32_t n = 0;
+        for (uint32_t i = 0; i < snd->nrings; i++) {
+            n += ring_pop(&snd->rings[i], snd->buf + n, SENDER_BUF_BYTES - n);
+        }
 
-        if (type == MSG_QUIT) {
-            printf("[server] got MSG_QUIT -> shutdown server\n");
-            set_running(ctx, 0);
-            pthread_mutex_lock(&ctx->mtx);
-            ctx->sim_running = 0;
-            if (ctx->client_fd >= 0) shutdown(ctx->client_fd, SHUT_RDWR);
-            /* Shutdown listen socket aby accept() prestal blokovat */
-            if (ctx->listen_fd >= 0) {
-                shutdown(ctx->listen_fd, SHUT_RDWR);
-                close(ctx->listen_fd);
+        if (n > 0) {
+            if (!snd->failed && sender_write(snd->s, snd->buf, n) != 0) {
+                fprintf(stderr, "[server] failed to send STATE\n");
+                snd->failed = 1;
+                atomic_store(&snd->job->stop, 1);
+            }
+            if (fan_count(&snd->s->fan) > 0) {
+                fan_buf_t* b = fan_buf_new(n, 0);
+                if (b) {
+                    memcpy(b->data, snd->buf, n);
+                    fan_publish(&snd->s->fan, b);
+                    fan_buf_put(b);
+                }
             }
-            pthread_mutex_unlock(&ctx->mtx);
+        } else if (done) {
             break;
+        } else {
+            nanosleep((const struct timespec[]){{0, SENDER_IDLE_NS}}, NULL);
         }
 
-        if (type == MSG_START) {
-            if (len != sizeof(msg_start_t)) {
-                printf("[server] invalid MSG_START len=%u\n", (unsigned)len);
-                continue;
-            }
+        struct timespec now;
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        if (now.tv_sec - last_status.tv_sec >= 1 &&
+            (now.tv_sec - last_status.tv_sec > 1 || now.tv_nsec >= last_status.tv_nsec)) {
+            sender_status(snd, 0);
+            last_status = now;
+        }
+    }
 
-            msg_start_t s;
-            memcpy(&s, buf, sizeof(s));
+    sender_status(snd, 1);
+    return NULL;
+}
 
-            if (s.width < 2 || s.height < 2 || s.k_max == 0 || s.reps == 0) {
-                printf("[server] invalid START params\n");
-                continue;
-            }
+/**
+ * @brief Pripraví fronty pre beh job a spustí odosielacie vlákno.
+ *
+ * Front je jeden na každý shard, ktorý sim_submit() vytvorí (sim_job_shards;
+ * job->resume už musí byť nastavený).
+ *
+ * @param snd Odosielanie behu (výstup).
+ * @param s Relácia.
+ * @param job Beh; nastaví sa mu emit_arg.
+ * @param policy Správanie pri plnom fronte (ring_policy_t).
+ * @return 0 pri úspechu, -1 pri chybe alokácie alebo vytvorenia vlákna.
+ */
+static int sender_start(sender_t* snd, session_t* s, sim_job_t* job, uint8_t policy) {
+    memset(snd, 0, sizeof(*snd));
+    snd->s = s;
+    snd->job = job;
+    snd->nrings = sim_job_shards(job);
+    atomic_init(&snd->done, 0);
+
+    snd->rings = calloc(snd->nrings, sizeof(ring_t));
+    snd->buf = malloc(SENDER_BUF_BYTES);
+    uint32_t ok = 0;
+    if (snd->rings && snd->buf) {
+        for (; ok < snd->nrings; ok++) {
+            if (ring_init(&snd->rings[ok], policy) != 0) break;
+        }
+    }
+    if (ok == snd->nrings && pthread_create(&snd->tid, NULL, sender_main, snd) == 0) {
+        job->emit_arg = snd;
+        return 0;
+    }
 
-            unsigned psum = (unsigned)s.p_up + (unsigned)s.p_down + (unsigned)s.p_left + (unsigned)s.p_right;
-            if (psum != 100) {
-                printf("[server] invalid START percents sum=%u (must be 100)\n", psum);
-                continue;
-            }
+    for (uint32_t i = 0; i < ok; i++) ring_free(&snd->rings[i]);
+    free(snd->rings);
+    free(snd->buf);
+    return -1;
+}
+
+/**
+ * @brief Po skončení shardov vyprázdni fronty a ukončí odosielanie.
+ *
+ * @param snd Odosielanie behu.
+ */
+static void sender_stop(sender_t* snd) {
+    /* producenti už skončili - čakajúce správy (RING_COALESCE) vloží toto vlákno */
+    for (uint32_t i = 0; i < snd->nrings; i++) ring_finish(&snd->rings[i], &snd->job->stop);
+    atomic_store(&snd->done, 1);
+    pthread_join(snd->tid, NULL);
+
+    for (uint32_t i = 0; i < snd->nrings; i++) ring_free(&snd->rings[i]);
+    free(snd->rings);
+    free(snd->buf);
+}
+
+/**
+ * @brief Pošle klientovi MSG_TRAJ_INFO pred prvým úsekom trajektórie.
+ *
+ * Pravdepodobnosti sú tie, ktoré server naozaj použije (po prevode
+ * z percent), takže klient dekóduje rANS s rovnakým modelom. Správa sa
+ * rozošle aj pozorovateľom a ostane v behu pre tých, čo sa pripoja neskôr.
+ *
+ * @param run Beh.
+ */
+static void send_traj_info(run_t* run) {
+    session_t* s = run->s;
+    const sim_job_t* job = &run->job;
+    msg_traj_info_t* info = &run->traj_info;
+    memset(info, 0, sizeof(*info));
+    info->width = job->width;
+    info->height = job->height;
+    info->reps = job->reps;
+    memcpy(info->prob_q, job->prob_q, sizeof(info->prob_q));
+    info->boundary = job->boundary;
+
+    if (session_send(s, MSG_TRAJ_INFO, info, (uint32_t)sizeof(*info)) != 0) {
+        fprintf(stderr, "[server] failed to send TRAJ_INFO\n");
+    }
+
+    /* pod mtx, aby ju nový pozorovateľ nedostal dvakrát ani vôbec */
+    pthread_mutex_lock(&s->mtx);
+    session_publish(s, MSG_TRAJ_INFO, info, (uint32_t)sizeof(*info));
+    run->traj_sent = 1;
+    pthread_mutex_unlock(&s->mtx);
+}
+
+/**
+ * @brief Pošle klientovi a pozorovateľom súhrn behu Monte Carlo.
+ *
+ * MSG_RESULT nesie počty a kvantily krokov, MSG_STEP_HIST celý histogram
+ * krokov (iba po posledný neprázdny kôš), z ktorého si klient spočíta
+ * ďalšie kvantily sám.
+ *
+ * @param run Dokončený beh.
+ */
+static void send_result(run_t* run) {
+    session_t* s = run->s;
+    msg_result_t res;
+    results_to_msg(&run->results, &res);
+
+    msg_step_hist_t* h = malloc(sizeof(*h));
+    uint32_t used = results_hist_used(&run->results);
+    if (h) {
+        memset(h, 0, sizeof(*h) - sizeof(h->c));
+        h->sub_bits = (uint8_t)STEP_HIST_SUB_BITS;
+        h->count = used;
+        memcpy(h->c, run->results.hist, used * sizeof(uint32_t));
+    }
+    uint32_t hlen = (uint32_t)(sizeof(*h) - sizeof(h->c) + used * sizeof(uint32_t));
+
+    int rc = session_send(s, MSG_RESULT, &res, (uint32_t)sizeof(res));
+    session_publish(s, MSG_RESULT, &res, (uint32_t)sizeof(res));
+    if (h) {
+        if (rc == 0) rc = session_send(s, MSG_STEP_HIST, h, hlen);
+        session_publish(s, MSG_STEP_HIST, h, hlen);
+    }
+    if (rc != 0) fprintf(stderr, "[server] failed to send result\n");
+    free(h);
+}
+
+/**
+ * @brief Založí súbor trajektórií behu v DIR/traj (job->record).
+ *
+ * Bez dátového priečinka alebo pri chybe beh pokračuje bez zápisu.
+ *
+ * @param run Beh Monte Carlo.
+ */
+static void record_open(run_t* run) {
+    session_t* s = run->s;
+    sim_job_t* job = &run->job;
+    const char* dir = s->srv->data_dir;
+    if (!dir) {
+        printf("[server] session %u: trajectory recording needs --data-dir, not recording\n", (unsigned)s->id);
+        return;
+    }
+
+    char sub[4096];
+    if (snprintf(sub, sizeof(sub), "%s/%s", dir, TRAJFILE_DIR) >= (int)sizeof(sub) ||
+        (mkdir(sub, 0755) != 0 && errno != EEXIST)) {
+        fprintf(stderr, "[server] cannot create %s/%s, not recording\n", dir, TRAJFILE_DIR);
+        return;
+    }
+
+    char stamp[32];
+    time_t now = time(NULL);
+    struct tm tm;
+    localtime_r(&now, &tm);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", &tm);
+    if (snprintf(run->record_path, sizeof(run->record_path), "%s/%s-s%u-seed%u%s",
+                 sub, stamp, (unsigned)s->id, (unsigned)job->seed, TRAJFILE_EXT) >= (int)sizeof(run->record_path)) {
+        fprintf(stderr, "[server] trajectory file path too long, not recording\n");
+        return;
+    }
+
+    msg_traj_info_t info;
+    memset(&info, 0, sizeof(info));
+    info.width = job->width;
+    info.height = job->height;
+    info.reps = job->reps;
+    memcpy(info.prob_q, job->prob_q, sizeof(info.prob_q));
+    info.boundary = job->boundary;
+    job->record = trajfile_create(run->record_path, &info, job->k_max, job->seed);
+}
+
+/**
+ * @brief Uzavrie súbor trajektórií a pošle klientovi MSG_TRAJ_FILE.
+ *
+ * @param run Beh so založeným súborom (job->record).
+ */
+static void record_close(run_t* run) {
+    session_t* s = run->s;
+    uint32_t reps = 0;
+    uint64_t bytes = 0;
+    int rc = trajfile_close(run->job.record, &reps, &bytes);
+    run->job.record = NULL;
+    if (rc != 0) {
+        fprintf(stderr, "[server] session %u: writing %s failed\n", (unsigned)s->id, run->record_path);
+        return;
+    }
+    printf("[server] session %u: %u trajectories written to %s (%llu bytes)\n",
+           (unsigned)s->id, (unsigned)reps, run->record_path, (unsigned long long)bytes);
+
+    msg_traj_file_t m;
+    memset(&m, 0, sizeof(m));
+    m.reps = reps;
+    m.bytes = bytes;
+    memcpy(m.path, run->record_path, sizeof(m.path));
+    if (session_send(s, MSG_TRAJ_FILE, &m, (uint32_t)sizeof(m)) != 0) {
+        fprintf(stderr, "[server] failed to send TRAJ_FILE\n");
+    }
+    session_publish(s, MSG_TRAJ_FILE, &m, (uint32_t)sizeof(m));
+}
+
+/**
+ * @brief Callback zapisovača: checkpoint behu je na disku, buffer sa vráti simulácii.
+ *
+ * @param arg Ukazovateľ na run_t.
+ */
+static void run_checkpoint_written(void* arg) {
+    run_t* run = (run_t*)arg;
+    sim_ckpt_written(&run->job);
+}
+
+/**
+ * @brief Callback simulácie: odovzdá checkpoint behu zapisovaču servera.
+ *
+ * Vlákno poolu na disk nečaká; simulácia buffer nezmení, kým ho
+ * run_checkpoint_written() nevráti.
+ *
+ * @param arg Ukazovateľ na run_t.
+ * @param ck Stav behu.
+ */
+static void run_checkpoint(void* arg, const sim_checkpoint_t* ck) {
+    run_t* run = (run_t*)arg;
+    run->ckpt_req.ck = ck;
+    ckpt_writer_submit(run->s->srv->ckpt_writer, &run->ckpt_req);
+}
+
+/**
+ * @brief Callback simulácie: zaradí priebežný súhrn (MSG_RESULT_PARTIAL).
+ *
+ * Posiela sa iba msg_result_t (bez histogramu), aby bol súhrn lacný aj
+ * pri krátkom intervale. Volá ho shard pod zámkom súhrnov, preto sa súhrn
+ * iba skopíruje do bufferu a zaradí bez čakania; je to priebeh, takže ho
+ * klient, ktorý nestíha čítať, radšej stratí, než by čakali shardy.
+ *
+ * @param arg Ukazovateľ na run_t.
+ * @param partial Zlúčená štatistika dokončených replikácií.
+ */
+static void send_partial(void* arg, const results_t* partial) {
+    run_t* run = (run_t*)arg;
+    msg_result_t res;
+    results_to_msg(partial, &res);
+    fan_buf_t* b = fan_buf_msg(MSG_RESULT_PARTIAL, &res, (uint32_t)sizeof(res));
+    if (!b) return;
+    b->keep = 0;
+    (void)fan_sub_push(&run->s->out, b);
+    fan_publish(&run->s->fan, b);
+    fan_buf_put(b);
+}
+
+/**
+ * @brief Ukončí beh: pošle MSG_DONE a spustí prípadný čakajúci START.
+ *
+ * @param run Dokončený beh (uvoľní sa).
+ */
+static void run_finish(run_t* run) {
+    session_t* s = run->s;
+
+    (void)session_send(s, MSG_DONE, NULL, 0);
+    /* koniec behu je hranica dávky - nič nesmie ostať v zazátkovanom sockete */
+    session_uncork(s);
+    session_publish(s, MSG_DONE, NULL, 0);
+
+    printf("[server] session %u: simulation finished\n", (unsigned)s->id);
+
+    /* ak medzitým prišiel nový START, spusti ho */
+    pthread_mutex_lock(&s->mtx);
+    run_t* next = s->pending;
+    s->pending = NULL;
+    s->run = next;
+    pthread_mutex_unlock(&s->mtx);
+
+    run_free(run);
+    if (next) run_begin(next);
+}
+
+/**
+ * @brief Odloží úlohu o SIM_BACKOFF_NS, kým klient neprečíta, čo už čaká.
+ *
+ * @param wake Výstup: čas pokračovania.
+ * @return POOL_SLEEP.
+ */
+static int exact_backoff(struct timespec* wake) {
+    clock_gettime(CLOCK_MONOTONIC, wake);
+    wake->tv_nsec += SIM_BACKOFF_NS;
+    if (wake->tv_nsec >= 1000000000L) {
+        wake->tv_sec++;
+        wake->tv_nsec -= 1000000000L;
+    }
+    return POOL_SLEEP;
+}
+
+/**
+ * @brief Zistí, či má odosielanie výsledku presného výpočtu počkať.
+ *
+ * Ako odosielacie vlákno: ďalší úsek sa zaradí, až keď klientovi čaká
+ * menej ako SENDER_BUF_BYTES. Úsek poolu tiež nesmie trvať dlhšie ako
+ * SIM_SLICE_NS.
+ *
+ * @param run Beh s presným výpočtom.
+ * @param slice_end Koniec úseku (CLOCK_MONOTONIC).
+ * @param wake Výstup pri POOL_SLEEP.
+ * @return POOL_DONE ak sa môže posielať ďalej, inak POOL_SLEEP / POOL_YIELD.
+ */
+static int exact_pace(run_t* run, const struct timespec* slice_end, struct timespec* wake) {
+    if (run->exact->owner && fan_sub_bytes(&run->s->out) >= SENDER_BUF_BYTES) return exact_backoff(wake);
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (now.tv_sec > slice_end->tv_sec ||
+        (now.tv_sec == slice_end->tv_sec && now.tv_nsec >= slice_end->tv_nsec)) return POOL_YIELD;
+    return POOL_DONE;
+}
+
+/**
+ * @brief Zaradí časť výsledku presného výpočtu klientovi a pozorovateľom.
+ *
+ * @param run Beh s presným výpočtom.
+ * @param type Typ správy.
+ * @param payload Payload.
+ * @param len Dĺžka payloadu.
+ */
+static void exact_emit(run_t* run, msg_type_t type, const void* payload, uint32_t len) {
+    exact_state_t* es = run->exact;
+    if (es->owner && session_send(run->s, type, payload, len) != 0) {
+        fprintf(stderr, "[server] failed to send exact result\n");
+        es->owner = 0;
+    }
+    session_publish(run->s, type, payload, len);
+}
 
-            pthread_mutex_lock(&ctx->mtx);
-            ctx->width = s.width;
-            ctx->height = s.height;
-            ctx->k_max = s.k_max;
-            ctx->reps = s.reps;
-
-            ctx->p_up = s.p_up;
-            ctx->p_down = s.p_down;
-            ctx->p_left = s.p_left;
-            ctx->p_right = s.p_right;
-
-            if (s.seed == 0) ctx->seed = (uint32_t)time(NULL);
-            else ctx->seed = s.seed;
-
-            ctx->cur_rep = 0;
-            ctx->step = 0;
-            ctx->x = 0;
-            ctx->y = 0;
-
-            ctx->sim_running = 1;
-            /* resetni a nastav parametre pre výsledky */
-            results_reset(&ctx->results);
-            results_set_params(&ctx->results, ctx->width, ctx->height, ctx->k_max,
-                               ctx->p_up, ctx->p_down, ctx->p_left, ctx->p_right,
-                               ctx->reps);
-            pthread_mutex_unlock(&ctx->mtx);
-
-            printf("[server] simulation started (W=%d H=%d K=%u reps=%u seed=%u) percents U=%u D=%u L=%u R=%u\n", 
-                s.width, s.height, (unsigned)s.k_max, (unsigned)s.reps, (unsigned)ctx->seed,
-                (unsigned)s.p_up, (unsigned)s.p_down, (unsigned)s.p_left, (unsigned)s.p_right);
+/**
+ * @brief Pošle rozdelenie presného výpočtu (METHOD_EXACT).
+ *
+ * Rozdelenie P(zásah v kroku t) ide po úsekoch EXACT_PMF_CHUNK hodnôt
+ * (MSG_EXACT_PMF), potom súhrn (MSG_EXACT_SUMMARY). MSG_DONE pošle volajúci.
+ * Pokračuje tam, kde minule skončilo (es->next).
+ *
+ * @param run Beh s presným výpočtom.
+ * @param slice_end Koniec úseku (CLOCK_MONOTONIC).
+ * @param wake Výstup pri POOL_SLEEP.
+ * @return POOL_DONE keď je všetko zaradené, inak POOL_SLEEP / POOL_YIELD.
+ */
+static int exact_send_pmf(run_t* run, const struct timespec* slice_end, struct timespec* wake) {
+    exact_state_t* es = run->exact;
+    const exact_result_t* ex = &es->ex;
+    msg_exact_pmf_t pmf;
+
+    if (es->next == 0) es->next = 1;
+    while (es->next <= ex->steps_done) {
+        int rc = exact_pace(run, slice_end, wake);
+        if (rc != POOL_DONE) return rc;
+        uint32_t t = es->next;
+        uint32_t count = ex->steps_done - t + 1u;
+        if (count > EXACT_PMF_CHUNK) count = EXACT_PMF_CHUNK;
+        pmf.t_first = t;
+        pmf.count = count;
+        memcpy(pmf.p, &ex->p_hit[t], count * sizeof(double));
+        exact_emit(run, MSG_EXACT_PMF, &pmf, (uint32_t)(sizeof(pmf) - sizeof(pmf.p) + count * sizeof(double)));
+        es->next = t + count;
+    }
+
+    msg_exact_summary_t sum;
+    memset(&sum, 0, sizeof(sum));
+    sum.k_max = ex->k_max;
+    sum.steps_done = ex->steps_done;
+    sum.p_success = ex->p_success;
+    sum.mean_steps = ex->mean_steps;
+    memcpy(sum.bins, ex->bins, sizeof(sum.bins));
+    exact_emit(run, MSG_EXACT_SUMMARY, &sum, (uint32_t)sizeof(sum));
+    return POOL_DONE;
+}
+
+/**
+ * @brief Pošle mriežku výsledkov pre všetky štarty (METHOD_ALL_STARTS).
+ *
+ * Najprv MSG_GRID_INFO, potom mriežka po úsekoch GRID_CHUNK buniek
+ * (MSG_GRID_CELLS, hodnoty ako float). MSG_DONE pošle volajúci.
+ * Pokračuje tam, kde minule skončilo (es->next).
+ *
+ * @param run Beh s presným výpočtom.
+ * @param slice_end Koniec úseku (CLOCK_MONOTONIC).
+ * @param wake Výstup pri POOL_SLEEP.
+ * @return POOL_DONE keď je všetko zaradené, inak POOL_SLEEP / POOL_YIELD.
+ */
+static int exact_send_grid(run_t* run, const struct timespec* slice_end, struct timespec* wake) {
+    exact_state_t* es = run->exact;
+    const exact_grid_t* g = &es->grid;
+    msg_grid_cells_t* m = es->cells;
+    uint32_t cells = (uint32_t)g->width * (uint32_t)g->height;
+
+    if (!es->head_sent) {
+        msg_grid_info_t info;
+        info.width = g->width;
+        info.height = g->height;
+        info.k_max = g->k_max;
+        info.steps_done = g->steps_done;
+        exact_emit(run, MSG_GRID_INFO, &info, (uint32_t)sizeof(info));
+        es->head_sent = 1;
+    }
+    while (es->next < cells) {
+        int rc = exact_pace(run, slice_end, wake);
+        if (rc != POOL_DONE) return rc;
+        uint32_t first = es->next;
+        uint32_t count = cells - first;
+        if (count > GRID_CHUNK) count = GRID_CHUNK;
+        m->first = first;
+        m->count = count;
+        for (uint32_t i = 0; i < count; i++) {
+            m->v[i] = (float)g->p[first + i];
+            m->v[count + i] = (float)g->mean[first + i];
         }
+        exact_emit(run, MSG_GRID_CELLS, m, (uint32_t)(sizeof(*m) - sizeof(m->v) + 2u * count * sizeof(float)));
+        es->next = first + count;
     }
+    return POOL_DONE;
+}
 
-    return NULL;
+/**
+ * @brief Po skončení výpočtu vyberie výsledok, vypíše súhrn a uvoľní výpočet.
+ *
+ * @param run Beh s presným výpočtom.
+ */
+static void exact_collect(run_t* run) {
+    session_t* s = run->s;
+    exact_state_t* es = run->exact;
+    const sim_job_t* job = &run->job;
+
+    pthread_mutex_lock(&s->srv->print_mtx);
+    if (job->method == METHOD_EXACT) {
+        es->ok = (exact_calc_result(es->calc, &es->ex) == 0);
+        if (es->ok) exact_print(job, &es->ex);
+    } else if (exact_calc_grid(es->calc, &es->grid) == 0) {
+        exact_grid_print(job, &es->grid);
+        /* ~32 kB na správu - nealokuje sa na zásobníku */
+        es->cells = malloc(sizeof(*es->cells));
+        es->ok = (es->cells != NULL);
+        if (!es->ok) fprintf(stderr, "[server] failed to send result grid\n");
+    }
+    pthread_mutex_unlock(&s->srv->print_mtx);
+    exact_calc_free(es->calc);
+    es->calc = NULL;
+
+    pthread_mutex_lock(&s->mtx);
+    es->owner = (s->fd >= 0);
+    pthread_mutex_unlock(&s->mtx);
 }
 
+static int exact_task(void* arg, struct timespec* wake);
+
 /**
- * @brief Vlákno pre výpočet a vykonávanie simulácie náhodnej prechádzky.
+ * @brief Callback po poslednom kroku presného výpočtu (volá ho vlákno poolu).
  *
- * Vykonáva simuláciu v replikáciách:
- * - Každá replikácia začína na pozícii (width-1, height-1)
- * - Vykoná max k_max krokov alebo skončí pri dosiahnutí (0,0)
- * - Posiela MSG_STATE klientovi po každom kroku
- * - Po dokončení všetkých replikácií pošle MSG_DONE
+ * Vyberie výsledok a znova zaradí exact_task, ktorý ho pošle.
  *
- * @param arg Ukazovateľ na server_ctx_t štruktúru.
- * @return NULL pri ukončení.
+ * @param arg Ukazovateľ na run_t.
+ */
+static void exact_computed(void* arg) {
+    run_t* run = (run_t*)arg;
+    exact_collect(run);
+    run->exact->computed = 1;
+    if (pool_submit(run->s->srv->pool, exact_task, run) != 0) {
+        fprintf(stderr, "[server] failed to queue exact result\n");
+        run_finish(run);
+    }
+}
+
+/**
+ * @brief Úloha poolu pre presný výpočet (METHOD_EXACT, METHOD_ALL_STARTS).
+ *
+ * Prvé spustenie výpočet pripraví a zaradí jeho pásy do poolu
+ * (exact_calc_submit); po poslednom kroku ju exact_computed zaradí znova.
+ * Vtedy ako shard Monte Carlo po úsekoch SIM_SLICE_NS zaraďuje výsledok
+ * klientovi. Ak klient nestíha čítať, úloha sa odloží, takže pomalý klient
+ * nedrží vlákno poolu. Nakoniec pošle MSG_DONE.
+ *
+ * @param arg Ukazovateľ na run_t.
+ * @param wake Výstup pri POOL_SLEEP.
+ * @return pool_status_t.
+ */
+static int exact_task(void* arg, struct timespec* wake) {
+    run_t* run = (run_t*)arg;
+    exact_state_t* es = run->exact;
+
+    if (!es->computed) {
+        es->calc = exact_calc_new(&run->job, run->job.method == METHOD_ALL_STARTS);
+        if (es->calc && exact_calc_submit(es->calc, run->s->srv->pool, exact_computed, run) == 0) {
+            return POOL_DONE;
+        }
+        fprintf(stderr, "[server] exact computation failed\n");
+        exact_calc_free(es->calc);
+        es->calc = NULL;
+        es->computed = 1;
+    }
+
+    if (es->ok) {
+        struct timespec slice_end;
+        clock_gettime(CLOCK_MONOTONIC, &slice_end);
+        slice_end.tv_nsec += SIM_SLICE_NS;
+        if (slice_end.tv_nsec >= 1000000000L) {
+            slice_end.tv_sec++;
+            slice_end.tv_nsec -= 1000000000L;
+        }
+        int rc = (run->job.method == METHOD_EXACT) ? exact_send_pmf(run, &slice_end, wake)
+                                                   : exact_send_grid(run, &slice_end, wake);
+        if (rc != POOL_DONE) return rc;
+    }
+    run_finish(run);
+    return POOL_DONE;
+}
+
+/**
+ * @brief Pripíše dokončený beh Monte Carlo do denníka behov.
+ *
+ * Jemný histogram výsledkov sa zlúči do hrubšieho (RUNLOG_HIST_SUB_BITS),
+ * aby mal záznam pevnú a malú veľkosť.
+ *
+ * @param run Dokončený beh.
+ */
+static void log_run(run_t* run) {
+    const sim_job_t* job = &run->job;
+    const results_t* r = &run->results;
+    runlog_record_t rec;
+    memset(&rec, 0, sizeof(rec));
+
+    rec.cfg.width = job->width;
+    rec.cfg.height = job->height;
+    rec.cfg.k_max = job->k_max;
+    memcpy(rec.cfg.prob_q, job->prob_q, sizeof(rec.cfg.prob_q));
+    rec.cfg.boundary = job->boundary;
+    rec.reps = job->reps;
+    rec.seed = job->seed;
+    rec.target = job->target;
+    rec.stream = run->stream;
+    rec.flags = run->cached ? (uint8_t)RUNLOG_CACHED : 0u;
+    rec.threads = run->shards;
+    rec.target_hw = job->target_hw;
+
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    rec.t_start_ns = run->t_start_ns;
+    rec.duration_ns = (int64_t)(t1.tv_sec - run->t0.tv_sec) * 1000000000LL + (t1.tv_nsec - run->t0.tv_nsec);
+    rec.session = run->s->id;
+
+    msg_result_t m;
+    results_to_msg(r, &m);
+    rec.reps_done = r->success_count + r->fail_count;
+    rec.success_count = m.success_count;
+    rec.fail_count = m.fail_count;
+    rec.min_steps = m.min_steps;
+    rec.max_steps = m.max_steps;
+    rec.sum_steps_success = m.sum_steps_success;
+    rec.steps = m.steps;
+    rec.success = m.success;
+    rec.p50 = m.p50;
+    rec.p90 = m.p90;
+    rec.p99 = m.p99;
+    rec.p999 = m.p999;
+
+    uint32_t coarse[RUNLOG_HIST_BUCKETS] = {0};
+    for (uint32_t i = 0; i < STEP_HIST_BUCKETS; i++) {
+        if (r->hist[i] == 0) continue;
+        coarse[hist_index_bits(hist_low(i), RUNLOG_HIST_SUB_BITS)] += r->hist[i];
+    }
+    memcpy(rec.hist, coarse, sizeof(rec.hist));
+
+    if (runlog_append(run->s->srv->runlog, &rec) != 0) {
+        fprintf(stderr, "[server] session %u: runlog append failed\n", (unsigned)run->s->id);
+    }
+}
+
+/**
+ * @brief Callback po dokončení všetkých shardov behu Monte Carlo.
+ *
+ * Volá ho vlákno poolu: vyprázdni fronty odosielania, vytlačí štatistiky,
+ * pošle ich klientovi (MSG_RESULT, MSG_STEP_HIST) a potom MSG_DONE.
+ *
+ * @param arg Ukazovateľ na run_t.
+ */
+static void run_done(void* arg) {
+    run_t* run = (run_t*)arg;
+    if (run->has_sender) sender_stop(&run->snd);
+
+    const sim_job_t* job = &run->job;
+    pthread_mutex_lock(&run->s->srv->print_mtx);
+    if (job->target != TARGET_NONE) {
+        double hw = results_halfwidth(&run->results, job->target);
+        printf("[server] session %u: target %s half-width %g %s after %u of %u reps (half-width %g)\n",
+               (unsigned)run->s->id, (job->target == TARGET_SUCCESS) ? "success" : "mean-steps",
+               job->target_hw, (hw <= job->target_hw) ? "reached" : "NOT reached",
+               (unsigned)job->reps_done, (unsigned)job->reps, hw);
+    }
+    results_print(&run->results);
+    pthread_mutex_unlock(&run->s->srv->print_mtx);
+
+    /* iba úplný beh - zastavený (nový START, odpojenie) má neúplné výsledky */
+    cache_t* cache = run->s->srv->cache;
+    if (cache && run->cacheable && !run->cached && !atomic_load(&run->job.stop)) {
+        cache_key_t key;
+        cache_key_from_job(job, &key);
+        cache_store(cache, &key, &run->results);
+    }
+
+    if (run->s->srv->runlog && !atomic_load(&run->job.stop)) log_run(run);
+
+    /* úplný beh checkpoint nepotrebuje, zastavený naň nechá posledný */
+    if (run->job.ckpt) {
+        if (!atomic_load(&run->job.stop)) ckpt_remove(run->ckpt_path);
+        else printf("[server] session %u: stopped, checkpoint %s kept for RESUME\n",
+                    (unsigned)run->s->id, run->ckpt_path);
+    }
+
+    if (run->job.record) record_close(run);
+    send_result(run);
+    run_finish(run);
+}
+
+/**
+ * @brief Úloha poolu, ktorá dokončí beh s výsledkom z cache.
+ *
+ * run_done zapisuje do cache a denníka behov, preto nesmie bežať
+ * na vlákne event slučky.
+ *
+ * @param arg Ukazovateľ na run_t.
+ * @param wake Nepoužité.
+ * @return POOL_DONE.
+ */
+static int run_done_task(void* arg, struct timespec* wake) {
+    (void)wake;
+    run_done(arg);
+    return POOL_DONE;
+}
+
+/**
+ * @brief Ukončí prechod po poslednom bode: súhrn na výstup a MSG_DONE.
+ *
+ * @param run Beh s prechodom (uvoľní sa).
+ */
+static void sweep_finish(run_t* run) {
+    sweep_t* sw = run->sweep;
+    struct timespec t1;
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (double)(t1.tv_sec - run->t0.tv_sec) + (double)(t1.tv_nsec - run->t0.tv_nsec) * 1e-9;
+    printf("[server] session %u: sweep %s, %u of %u points (%u from cache) in %.3f s\n",
+           (unsigned)run->s->id, atomic_load(&run->job.stop) ? "stopped" : "finished",
+           (unsigned)sw->sent, (unsigned)sw->total, (unsigned)sw->cached, secs);
+    run_finish(run);
+}
+
+/**
+ * @brief Pošle klientovi a pozorovateľom výsledok bodu (MSG_SWEEP_POINT).
+ *
+ * @param slot Slot s dokončeným bodom.
+ * @param cached 1 ak výsledok prišiel z cache.
+ */
+static void sweep_send_point(sweep_slot_t* slot, int cached) {
+    sweep_t* sw = slot->sw;
+    const sweep_point_t* p = &sw->points[slot->index];
+    msg_sweep_point_t m;
+    msg_result_t res;
+    memset(&m, 0, sizeof(m));
+    m.index = slot->index;
+    m.total = sw->total;
+    m.width = p->width;
+    m.height = p->height;
+    m.k_max = p->k_max;
+    m.p_up = p->pct[0];
+    m.p_down = p->pct[1];
+    m.p_left = p->pct[2];
+    m.p_right = p->pct[3];
+    m.seed = slot->job.seed;
+    m.cached = (uint8_t)cached;
+    results_to_msg(&slot->results, &res);
+    memcpy(&m.result, &res, sizeof(res));
+
+    session_t* s = sw->run->s;
+    (void)session_send(s, MSG_SWEEP_POINT, &m, (uint32_t)sizeof(m));
+    session_publish(s, MSG_SWEEP_POINT, &m, (uint32_t)sizeof(m));
+
+    pthread_mutex_lock(&sw->mtx);
+    sw->sent++;
+    if (cached) sw->cached++;
+    pthread_mutex_unlock(&sw->mtx);
+}
+
+static void sweep_point_done(void* arg);
+
+/**
+ * @brief Pripraví job bodu v slote (volajúci drží sw->mtx).
+ *
+ * Bod je obyčajný beh Monte Carlo bez živého výstupu, takže beží na
+ * dávkovom jadre a jeho kľúč v cache je rovnaký ako pri STARTe s tými
+ * istými parametrami a seedom.
+ *
+ * @param sw Prechod.
+ * @param slot Slot s nastaveným index.
+ * @return 0 pri úspechu, -1 ak percentá nejdú previesť na prob_q.
+ */
+static int sweep_job_init(sweep_t* sw, sweep_slot_t* slot) {
+    const sweep_point_t* p = &sw->points[slot->index];
+    sim_job_t* job = &slot->job;
+    memset(job, 0, sizeof(*job));
+    job->width = p->width;
+    job->height = p->height;
+    job->k_max = p->k_max;
+    job->reps = sw->reps;
+    job->seed = sweep_point_seed(sw->seed, slot->index, sw->crn);
+    job->pacing = PACE_UNPACED;
+    job->threads = sw->threads;
+    job->boundary = sw->boundary;
+    job->method = METHOD_MONTE_CARLO;
+    job->stream = STREAM_NONE;
+    job->target = TARGET_NONE;
+    job->quiet = 1;
+    atomic_init(&job->stop, 0);
+    atomic_init(&job->frame_next, 0);
+
+    double pct[4] = { p->pct[0], p->pct[1], p->pct[2], p->pct[3] };
+    return proto_probs_from_percents(pct, job->prob_q);
+}
+
+/**
+ * @brief Spustí v slote ďalší nespracovaný bod prechodu.
+ *
+ * Body z cache sa pošlú hneď a slot pokračuje ďalším. Keď body dôjdu
+ * (alebo je beh zastavený), slot skončí; posledný slot ukončí prechod.
+ *
+ * @param slot Voľný slot.
  */
-static void* sim_thread(void* arg) {
-    server_ctx_t* ctx = (server_ctx_t*)arg;
-
-    while (get_running(ctx)) {
-        int active, sim;
-        int fd;
-        int32_t w, h;
-        uint32_t kmax, reps;
-
-        pthread_mutex_lock(&ctx->mtx);
-        active = ctx->session_active;
-        sim = ctx->sim_running;
-        fd = ctx->client_fd;
-        w = ctx->width;
-        h = ctx->height;
-        kmax = ctx->k_max;
-        reps = ctx->reps;
-        pthread_mutex_unlock(&ctx->mtx);
-
-        if (!active || !sim || fd < 0) {
-            nanosleep((const struct timespec[]){{0, 100000000}}, NULL); // 100ms
+static void sweep_launch(sweep_slot_t* slot) {
+    sweep_t* sw = slot->sw;
+    run_t* run = sw->run;
+    server_ctx_t* srv = run->s->srv;
+
+    for (;;) {
+        pthread_mutex_lock(&sw->mtx);
+        if (atomic_load(&run->job.stop) || sw->next >= sw->total) {
+            int last = (--sw->active == 0);
+            pthread_mutex_unlock(&sw->mtx);
+            if (last) sweep_finish(run);
+            return;
+        }
+        slot->index = sw->next++;
+        int rc = sweep_job_init(sw, slot);
+        pthread_mutex_unlock(&sw->mtx);
+        if (rc != 0) {
+            fprintf(stderr, "[server] session %u: sweep point %u has invalid probabilities, skipped\n",
+                    (unsigned)run->s->id, (unsigned)slot->index);
             continue;
         }
 
-        /* sprav reps replikacii */
-        for (uint32_t rep = 1; rep <= reps && get_running(ctx); rep++) {
-            pthread_mutex_lock(&ctx->mtx);
-            if (!ctx->sim_running || ctx->client_fd < 0) {
-                pthread_mutex_unlock(&ctx->mtx);
-                break;
+        const sweep_point_t* p = &sw->points[slot->index];
+        sim_job_t* job = &slot->job;
+        results_reset(&slot->results);
+        results_set_params(&slot->results, job->width, job->height, job->k_max,
+                           p->pct[0], p->pct[1], p->pct[2], p->pct[3], job->reps);
+
+        if (srv->cache && sw->cacheable) {
+            cache_key_t key;
+            cache_key_from_job(job, &key);
+            if (cache_lookup(srv->cache, &key, &slot->results)) {
+                sweep_send_point(slot, 1);
+                continue;
             }
-            ctx->cur_rep = rep;
-            ctx->step = 0;
-
-            /* start pozicia – stred plochy */
-            ctx->x = w / 2;
-            ctx->y = h / 2;
-            pthread_mutex_unlock(&ctx->mtx);
-
-            /* max kmax krokov */
-            for (uint32_t step = 1; step <= kmax && get_running(ctx); step++) {
-                pthread_mutex_lock(&ctx->mtx);
-                if (!ctx->sim_running || ctx->client_fd < 0) {
-                    pthread_mutex_unlock(&ctx->mtx);
-                    break;
-                }
+        }
 
-                ctx->step = step;
+        if (sim_submit(srv->pool, job, &slot->results, sweep_point_done, slot) == 0) return;
+        fprintf(stderr, "[server] session %u: failed to start sweep point %u, skipped\n",
+                (unsigned)run->s->id, (unsigned)slot->index);
+    }
+}
+
+/**
+ * @brief Callback po dokončení bodu prechodu (volá ho vlákno poolu).
+ *
+ * Úplný bod sa uloží do cache a pošle klientovi, zastavený sa zahodí.
+ * Slot potom pokračuje ďalším bodom.
+ *
+ * @param arg Ukazovateľ na sweep_slot_t.
+ */
+static void sweep_point_done(void* arg) {
+    sweep_slot_t* slot = (sweep_slot_t*)arg;
+    sweep_t* sw = slot->sw;
+    cache_t* cache = sw->run->s->srv->cache;
+
+    if (!atomic_load(&slot->job.stop)) {
+        if (cache && sw->cacheable) {
+            cache_key_t key;
+            cache_key_from_job(&slot->job, &key);
+            cache_store(cache, &key, &slot->results);
+        }
+        sweep_send_point(slot, 0);
+    }
+    sweep_launch(slot);
+}
 
-                // TU: pohyb podľa percent
-                step_random(ctx);
+/**
+ * @brief Úloha poolu, ktorá spustí prvý bod slotu.
+ *
+ * sweep_launch hľadá v cache a body z nej hneď posiela, preto
+ * ho sweep_begin nevolá priamo z event slučky.
+ *
+ * @param arg Ukazovateľ na sweep_slot_t.
+ * @param wake Nepoužité.
+ * @return POOL_DONE.
+ */
+static int sweep_slot_task(void* arg, struct timespec* wake) {
+    (void)wake;
+    sweep_launch(arg);
+    return POOL_DONE;
+}
 
-                msg_state_t st;
-                st.rep = rep;
-                st.reps_total = reps;
-                st.step = step;
-                st.x = ctx->x;
-                st.y = ctx->y;
+/**
+ * @brief Spustí prechod mriežkou: naplní sloty prvými bodmi.
+ *
+ * Slotov je SWEEP_INFLIGHT_PER_THREAD na vlákno poolu, aby sa vlákno
+ * nenudilo, kým sa dokončený bod posiela a jeho slot berie ďalší.
+ * Pri menej bodoch než vlákien dostane bod viac shardov.
+ *
+ * @param run Beh s prechodom, ktorý je už zapísaný ako s->run.
+ */
+static void sweep_begin(run_t* run) {
+    session_t* s = run->s;
+    sweep_t* sw = run->sweep;
+    uint32_t threads = pool_threads(s->srv->pool);
+
+    printf("[server] session %u: sweep started (%u points, reps=%u seed=%u boundary=%u crn=%u)\n",
+           (unsigned)s->id, (unsigned)sw->total, (unsigned)sw->reps, (unsigned)sw->seed,
+           (unsigned)sw->boundary, (unsigned)sw->crn);
+    clock_gettime(CLOCK_MONOTONIC, &run->t0);
+
+    uint32_t n = threads * SWEEP_INFLIGHT_PER_THREAD;
+    if (n > sw->total) n = sw->total;
+    sw->threads = (sw->total < threads) ? (threads + sw->total - 1u) / sw->total : 1u;
+
+    sweep_slot_t* slots = calloc(n, sizeof(*slots));
+    if (!slots) {
+        fprintf(stderr, "[server] out of memory, SWEEP not started\n");
+        sweep_finish(run);
+        return;
+    }
+    for (uint32_t i = 0; i < n; i++) slots[i].sw = sw;
+
+    /* active = n, takže prechod neskončí skôr, než sa spustia všetky sloty */
+    pthread_mutex_lock(&sw->mtx);
+    sw->slots = slots;
+    sw->nslots = n;
+    sw->active = n;
+    pthread_mutex_unlock(&sw->mtx);
+    for (uint32_t i = 0; i < n; i++) {
+        if (pool_submit(s->srv->pool, sweep_slot_task, &slots[i]) != 0) {
+            fprintf(stderr, "[server] failed to queue sweep slot, running it here\n");
+            sweep_launch(&slots[i]);
+        }
+    }
+}
 
-                int cfd = ctx->client_fd;
-                pthread_mutex_unlock(&ctx->mtx);
+/**
+ * @brief Zapne checkpointy behu a pri MSG_RESUME načíta posledný checkpoint.
+ *
+ * Checkpointy majú iba behy Monte Carlo s pevným seedom (ako cache), keď
+ * má server dátový priečinok a --checkpoint-ms nie je 0. Pri zázname
+ * trajektórií sa nerobia - pokračovanie by zapísalo iba zvyšok replikácií.
+ * Ak pre RESUME checkpoint nie je, beh začne od začiatku.
+ *
+ * @param run Beh Monte Carlo.
+ * @return Checkpoint na pokračovanie (uvoľniť cez free()), alebo NULL.
+ */
+static sim_checkpoint_t* run_checkpoint_setup(run_t* run) {
+    session_t* s = run->s;
+    server_ctx_t* srv = s->srv;
+    sim_job_t* job = &run->job;
+
+    if (!srv->ckpt_writer || !run->cacheable || run->record) {
+        if (run->resume) {
+            printf("[server] session %u: RESUME needs --data-dir, a fixed seed and no recording, starting from the beginning\n",
+                   (unsigned)s->id);
+        }
+        return NULL;
+    }
 
-                if (proto_send(cfd, MSG_STATE, &st, (uint32_t)sizeof(st)) != 0) {
-                    fprintf(stderr, "[server] failed to send STATE\n");
-                    pthread_mutex_lock(&ctx->mtx);
-                    ctx->sim_running = 0;
-                    pthread_mutex_unlock(&ctx->mtx);
-                    break;
-                }
+    cache_key_from_job(job, &run->ckpt_key);
+    if (ckpt_path(srv->data_dir, &run->ckpt_key, run->ckpt_path, sizeof(run->ckpt_path)) != 0) return NULL;
+    run->ckpt_req.path = run->ckpt_path;
+    run->ckpt_req.key = &run->ckpt_key;
+    run->ckpt_req.done = run_checkpoint_written;
+    run->ckpt_req.done_arg = run;
+    job->ckpt = run_checkpoint;
+    job->ckpt_arg = run;
+    job->ckpt_ms = srv->ckpt_ms;
+    if (!run->resume) return NULL;
+
+    sim_checkpoint_t* ck = ckpt_load(run->ckpt_path, &run->ckpt_key);
+    if (!ck) {
+        printf("[server] session %u: no checkpoint for RESUME, starting from the beginning\n", (unsigned)s->id);
+        return NULL;
+    }
+    uint64_t done = 0;
+    for (uint32_t i = 0; i < ck->n; i++) {
+        done += (uint64_t)ck->shards[i].results.success_count + ck->shards[i].results.fail_count;
+    }
+    printf("[server] session %u: resuming from %s (%llu reps done, %u shards)\n",
+           (unsigned)s->id, run->ckpt_path, (unsigned long long)done, (unsigned)ck->n);
+    return ck;
+}
 
-                /* koniec replikacie: dosiahli sme (0,0) */
-                if (st.x == 0 && st.y == 0) break;
+/**
+ * @brief Spustí beh relácie v poole (vráti sa hneď).
+ *
+ * - Monte Carlo: replikácie sa rozdelia na shardy (sim_submit), priebeh
+ *   (stavy, trajektórie) sa cez fronty posiela odosielacím vláknom behu
+ * - Presný výpočet: pásy riadkov ako úlohy poolu, výsledok posiela exact_task
+ * - Po dokončení sa pošle MSG_DONE (run_finish)
+ *
+ * @param run Beh, ktorý je už zapísaný ako s->run.
+ */
+static void run_begin(run_t* run) {
+    session_t* s = run->s;
+    server_ctx_t* srv = s->srv;
+    sim_job_t* job = &run->job;
+
+    if (run->sweep) {
+        sweep_begin(run);
+        return;
+    }
 
-                nanosleep((const struct timespec[]){{0, 100000000}}, NULL); // 100ms
-            }
+    printf("[server] session %u: simulation started (W=%d H=%d K=%u reps=%u seed=%u) probs U=%u D=%u L=%u R=%u /%u pacing=%u rate=%u threads=%u boundary=%u method=%u target=%u/%g\n",
+           (unsigned)s->id, job->width, job->height, (unsigned)job->k_max, (unsigned)job->reps, (unsigned)job->seed,
+           (unsigned)job->prob_q[0], (unsigned)job->prob_q[1], (unsigned)job->prob_q[2], (unsigned)job->prob_q[3], PROB_ONE,
+           (unsigned)job->pacing, (unsigned)job->rate_hz,
+           (unsigned)sim_job_shards(job), (unsigned)job->boundary, (unsigned)job->method,
+           (unsigned)job->target, job->target_hw);
+
+    if (job->method == METHOD_EXACT || job->method == METHOD_ALL_STARTS) {
+        run->exact = calloc(1, sizeof(*run->exact));
+        if (!run->exact || pool_submit(srv->pool, exact_task, run) != 0) {
+            fprintf(stderr, "[server] failed to queue exact computation\n");
+            run_finish(run);
+        }
+        return;
+    }
 
-            /* po replikácii zaznamenaj výsledok */
-            uint32_t steps_snapshot;
-            int32_t x_snapshot, y_snapshot;
-            pthread_mutex_lock(&ctx->mtx);
-            steps_snapshot = ctx->step;
-            x_snapshot = ctx->x;
-            y_snapshot = ctx->y;
-            pthread_mutex_unlock(&ctx->mtx);
-
-            int success = (x_snapshot == 0 && y_snapshot == 0) ? 1 : 0;
-            results_record_rep(&ctx->results, steps_snapshot, success);
+    clock_gettime(CLOCK_MONOTONIC, &run->t0);
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    run->t_start_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+
+    /* resetni a nastav parametre pre výsledky */
+    results_reset(&run->results);
+    results_set_params(&run->results, job->width, job->height, job->k_max,
+                       run->pct[0], run->pct[1], run->pct[2], run->pct[3],
+                       job->reps);
+    run->shards = sim_job_shards(job);
+
+    /* bez živého výstupu klient čaká len na výsledok - ten môže byť hotový */
+    if (srv->cache && run->cacheable && run->stream == STREAM_NONE && !run->record) {
+        cache_key_t key;
+        cache_key_from_job(job, &key);
+        if (cache_lookup(srv->cache, &key, &run->results)) {
+            run->cached = 1;
+            job->reps_done = run->results.success_count + run->results.fail_count;
+            printf("[server] session %u: result from cache\n", (unsigned)s->id);
+            if (pool_submit(srv->pool, run_done_task, run) != 0) {
+                fprintf(stderr, "[server] failed to queue cached result, finishing here\n");
+                run_done(run);
+            }
+            return;
         }
+    }
+
+    if (run->stream == STREAM_TRAJ) send_traj_info(run);
+    if (run->record) record_open(run);
 
-        /* simulacia hotova -> MSG_DONE */
-        /* simulacia hotova -> vytlač štatistiky a pošli MSG_DONE */
-        results_print(&ctx->results);
-        pthread_mutex_lock(&ctx->mtx);
-        if (ctx->client_fd >= 0) {
-            int cfd = ctx->client_fd;
-            pthread_mutex_unlock(&ctx->mtx);
-            (void)proto_send(cfd, MSG_DONE, NULL, 0);
+    if (job->snap_reps > 0 || job->snap_ms > 0) {
+        job->snap = send_partial;
+        job->snap_arg = run;
+    }
+
+    sim_checkpoint_t* resume = run_checkpoint_setup(run);
+    /* pokračovanie beží so shardmi z checkpointu (threads nie je v kľúči), podľa nich
+     * sa riadia aj fronty odosielania a záznam v denníku */
+    job->resume = resume;
+    run->shards = sim_job_shards(job);
+
+    job->emit = (run->stream != STREAM_NONE) ? emit_state : NULL;
+    if (job->emit) {
+        if (sender_start(&run->snd, s, job, run->ring_policy) != 0) {
+            fprintf(stderr, "[server] failed to start sender, running without live output\n");
+            job->emit = NULL;
         } else {
-            pthread_mutex_unlock(&ctx->mtx);
+            run->has_sender = 1;
+            job->ready = emit_ready;
         }
+    }
 
-        pthread_mutex_lock(&ctx->mtx);
-        ctx->sim_running = 0;
-        pthread_mutex_unlock(&ctx->mtx);
+    int rc = sim_submit(srv->pool, job, &run->results, run_done, run);
+    job->resume = NULL;
+    free(resume);
+    if (rc != 0) {
+        fprintf(stderr, "[server] failed to start simulation\n");
+        job->ckpt = NULL; /* existujúci checkpoint sa nesmie zmazať */
+        run_done(run);
+    }
+}
 
-        printf("[server] simulation finished\n");
+/**
+ * @brief Spracuje MSG_SESSION: nastavenia spojenia, odpovie MSG_SESSION_ACK.
+ *
+ * @param s Relácia.
+ * @param payload Payload (nezarovnaný, v bufferi parsera).
+ * @param len Dĺžka payloadu.
+ */
+static void handle_session(session_t* s, const void* payload, uint32_t len) {
+    if (len != sizeof(msg_session_t)) {
+        printf("[server] invalid MSG_SESSION len=%u\n", (unsigned)len);
+        return;
     }
 
-    return NULL;
+    msg_session_t ss;
+    memcpy(&ss, payload, sizeof(ss));
+
+    /* obmedz na povolený rozsah; server vráti, čo naozaj použije */
+    uint32_t batch = ss.batch_max;
+    uint32_t flush = ss.flush_ms;
+    if (batch == 0) batch = 1;
+    if (batch > STATE_BATCH_MAX) batch = STATE_BATCH_MAX;
+    if (flush == 0) flush = STATE_FLUSH_MS_DEFAULT;
+    if (flush > STATE_FLUSH_MS_MAX) flush = STATE_FLUSH_MS_MAX;
+    uint8_t policy = (ss.net_policy == NET_POLICY_THROUGHPUT) ? NET_POLICY_THROUGHPUT : NET_POLICY_LATENCY;
+    uint32_t fps = ss.max_fps;
+    uint32_t decimate = (ss.decimate == 0) ? 1u : ss.decimate;
+    uint8_t ring_policy = (ss.ring_policy <= RING_COALESCE) ? ss.ring_policy : RING_BLOCK;
+    uint32_t snap_reps = ss.snap_reps;
+    uint32_t snap_ms = ss.snap_ms;
+    if (snap_ms > 0 && snap_ms < SESSION_SNAP_MS_MIN) snap_ms = SESSION_SNAP_MS_MIN;
+    if (fps > SESSION_FPS_MAX) fps = SESSION_FPS_MAX;
+    /* pri obmedzenom fps nemá dávka čakať dlhšie než jeden snímok */
+    if (fps > 0 && flush > 1000u / fps) flush = (1000u / fps > 0) ? 1000u / fps : 1u;
+
+    pthread_mutex_lock(&s->mtx);
+    s->batch_max = batch;
+    s->flush_ms = flush;
+    s->net_policy = policy;
+    s->max_fps = fps;
+    s->decimate = decimate;
+    s->ring_policy = ring_policy;
+    s->snap_reps = snap_reps;
+    s->snap_ms = snap_ms;
+    pthread_mutex_unlock(&s->mtx);
+
+    msg_session_t ack;
+    ack.batch_max = (uint16_t)batch;
+    ack.flush_ms = (uint16_t)flush;
+    ack.net_policy = policy;
+    ack.max_fps = (uint16_t)fps;
+    ack.decimate = (uint16_t)decimate;
+    ack.ring_policy = ring_policy;
+    ack.snap_reps = snap_reps;
+    ack.snap_ms = snap_ms;
+    pthread_mutex_lock(&s->send_mtx);
+    if (net_set_policy(s->fd, policy) != 0) fprintf(stderr, "[server] failed to set socket policy\n");
+    clock_gettime(CLOCK_MONOTONIC, &s->last_flush);
+    pthread_mutex_unlock(&s->send_mtx);
+    int rc = session_send(s, MSG_SESSION_ACK, &ack, (uint32_t)sizeof(ack));
+    session_uncork(s);
+    if (rc != 0) fprintf(stderr, "[server] failed to send SESSION_ACK\n");
+
+    printf("[server] session %u: batch=%u flush=%ums policy=%s fps=%u decimate=%u ring=%u snap=%u reps/%u ms\n",
+           (unsigned)s->id, (unsigned)batch, (unsigned)flush,
+           (policy == NET_POLICY_THROUGHPUT) ? "throughput" : "latency",
+           (unsigned)fps, (unsigned)decimate, (unsigned)ring_policy, (unsigned)snap_reps, (unsigned)snap_ms);
 }
 
 /**
- * @brief Hlavná funkcia servera - inicializuje server a spracováva pripojenia.
+ * @brief Spustí nový beh relácie, alebo ho zaradí za bežiaci.
  *
- * Táto funkcia:
- * - Vytvorí počúvajúci TCP socket na zadanom porte
- * - Inicializuje kontext servera a spustí pomocné vlákna (net_thread, sim_thread)
- * - Prijíma prichádzajúce klientske pripojenia
- * - Vykonáva handshake protokol s klientmi
- * - Podporuje iba jedného aktívneho klienta naraz (nový klient nahradí starý)
- * - Beží až do prijatia MSG_QUIT
+ * Ak relácii ešte beží predchádzajúci beh, zastaví sa a nový začne, keď
+ * dobehne (run_finish); novší beh nahradí ešte nespustený.
  *
- * @param port Číslo portu, na ktorom bude server počúvať.
- * @return 0 pri úspešnom ukončení, 1 pri chybe.
+ * @param s Relácia.
+ * @param run Nový beh.
  */
-int server_run(uint16_t port) {
-    int lfd = net_listen(port, 8);
-    if (lfd < 0) {
-        perror("net_listen");
-        return 1;
+static void run_queue(session_t* s, run_t* run) {
+    pthread_mutex_lock(&s->mtx);
+    run_t* replaced = NULL;
+    int start_now = (s->run == NULL);
+    if (start_now) {
+        s->run = run;
+    } else {
+        run_stop(s->run);
+        replaced = s->pending;
+        s->pending = run;
+    }
+    pthread_mutex_unlock(&s->mtx);
+
+    if (replaced) run_free(replaced);
+    if (start_now) run_begin(run);
+}
+
+/**
+ * @brief Spracuje MSG_START/MSG_RESUME: overí parametre a spustí (alebo zaradí) nový beh.
+ *
+ * @param s Relácia.
+ * @param payload Payload (nezarovnaný, v bufferi parsera).
+ * @param len Dĺžka payloadu.
+ * @param resume 1 pri MSG_RESUME (pokračovať z checkpointu, ak existuje).
+ */
+static void handle_start(session_t* s, const void* payload, uint32_t len, int resume) {
+    if (len != sizeof(msg_start_t)) {
+        printf("[server] invalid MSG_START len=%u\n", (unsigned)len);
+        return;
     }
 
-    server_ctx_t ctx;
-    memset(&ctx, 0, sizeof(ctx));
-    ctx.listen_fd = lfd;
-    ctx.client_fd = -1;
-    ctx.running = 1;
-    ctx.session_active = 0;
-    ctx.sim_running = 0;
-    pthread_mutex_init(&ctx.mtx, NULL);
+    msg_start_t st;
+    memcpy(&st, payload, sizeof(st));
 
-    printf("[server] listening on %u...\n", (unsigned)port);
+    if (st.width < 2 || st.height < 2 || st.k_max == 0 || st.reps == 0) {
+        printf("[server] invalid START params\n");
+        return;
+    }
 
-    pthread_t tnet, tsim;
-    pthread_create(&tnet, NULL, net_thread, &ctx);
-    pthread_create(&tsim, NULL, sim_thread, &ctx);
+    uint32_t q[4];
+    uint8_t pct[4];
+    if (resolve_start_probs(&st, q, pct) != 0) return;
 
-    /* accept loop */
-    while (get_running(&ctx)) {
-        int cfd = net_accept(lfd);
-        if (cfd < 0) {
-            /* accept() failed - pravdepodobne server shutting down */
-            if (!get_running(&ctx)) break;
+    if (st.stream > STREAM_TRAJ) {
+        printf("[server] invalid START stream=%u\n", (unsigned)st.stream);
+        return;
+    }
+
+    if (st.boundary > BOUND_ABSORB) {
+        printf("[server] invalid START boundary=%u\n", (unsigned)st.boundary);
+        return;
+    }
+
+    if (st.method > METHOD_ALL_STARTS) {
+        printf("[server] invalid START method=%u\n", (unsigned)st.method);
+        return;
+    }
+
+    if (st.pacing > PACE_FIXED_HZ ||
+        (st.pacing == PACE_FIXED_HZ && (st.rate_hz == 0 || st.rate_hz > 1000000000u))) {
+        printf("[server] invalid START pacing=%u rate=%u\n", (unsigned)st.pacing, (unsigned)st.rate_hz);
+        return;
+    }
+
+    double target_hw = st.target_hw;
+    if (st.target > TARGET_MEAN_STEPS ||
+        (st.target != TARGET_NONE && !(target_hw > 0.0 && isfinite(target_hw)))) {
+        printf("[server] invalid START target=%u hw=%g\n", (unsigned)st.target, target_hw);
+        return;
+    }
+
+    if (st.record > 1) {
+        printf("[server] invalid START record=%u\n", (unsigned)st.record);
+        return;
+    }
+
+    run_t* run = calloc(1, sizeof(*run));
+    if (!run) {
+        fprintf(stderr, "[server] out of memory, START ignored\n");
+        return;
+    }
+    session_get(s);
+    run->s = s;
+    run->resume = resume;
+    memcpy(run->pct, pct, sizeof(run->pct));
+    run->stream = st.stream;
+
+    sim_job_t* job = &run->job;
+    job->width = st.width;
+    job->height = st.height;
+    job->k_max = st.k_max;
+    job->reps = st.reps;
+    job->seed = (st.seed == 0) ? (uint32_t)time(NULL) : st.seed;
+    memcpy(job->prob_q, q, sizeof(job->prob_q));
+    job->pacing = st.pacing;
+    job->rate_hz = st.rate_hz;
+    job->threads = st.threads;
+    job->boundary = st.boundary;
+    job->method = st.method;
+    job->stream = st.stream;
+    /* presný výpočet nemá čo zastaviť skôr */
+    job->target = (st.method == METHOD_MONTE_CARLO) ? st.target : (uint8_t)TARGET_NONE;
+    job->target_hw = target_hw;
+    atomic_init(&job->stop, 0);
+    /* trajektórie existujú iba pri Monte Carlo */
+    run->record = (st.method == METHOD_MONTE_CARLO && st.record);
+    /* seed 0 = čas, taký beh sa nezopakuje */
+    run->cacheable = (st.method == METHOD_MONTE_CARLO && st.seed != 0);
+
+    pthread_mutex_lock(&s->mtx);
+    job->batch_max = s->batch_max;
+    job->flush_ms = s->flush_ms;
+    job->max_fps = s->max_fps;
+    job->decimate = s->decimate;
+    job->snap_reps = s->snap_reps;
+    job->snap_ms = s->snap_ms;
+    run->ring_policy = s->ring_policy;
+    pthread_mutex_unlock(&s->mtx);
+
+    /* prípadný bežiaci beh sa ukončí, nový sa spustí po jeho MSG_DONE */
+    run_queue(s, run);
+}
+
+/**
+ * @brief Spracuje MSG_SWEEP: rozvinie mriežku a spustí (alebo zaradí) prechod.
+ *
+ * Prechod je pre reláciu jeden beh - nový START ho zastaví rovnako ako
+ * iný beh a MSG_DONE príde po poslednom bode.
+ *
+ * @param s Relácia.
+ * @param payload Payload (nezarovnaný, v bufferi parsera).
+ * @param len Dĺžka payloadu.
+ */
+static void handle_sweep(session_t* s, const void* payload, uint32_t len) {
+    if (len != sizeof(msg_sweep_t)) {
+        printf("[server] invalid MSG_SWEEP len=%u\n", (unsigned)len);
+        return;
+    }
+
+    msg_sweep_t req;
+    memcpy(&req, payload, sizeof(req));
+
+    if (req.reps == 0 || req.boundary > BOUND_ABSORB || req.crn > 1) {
+        printf("[server] invalid SWEEP reps=%u boundary=%u crn=%u\n",
+               (unsigned)req.reps, (unsigned)req.boundary, (unsigned)req.crn);
+        return;
+    }
+
+    sweep_point_t* points;
+    uint32_t total;
+    if (sweep_expand(&req, &points, &total) != 0) return;
+
+    run_t* run = calloc(1, sizeof(*run));
+    sweep_t* sw = calloc(1, sizeof(*sw));
+    if (!run || !sw) {
+        fprintf(stderr, "[server] out of memory, SWEEP ignored\n");
+        free(run);
+        free(sw);
+        free(points);
+        return;
+    }
+    session_get(s);
+    run->s = s;
+    run->sweep = sw;
+    atomic_init(&run->job.stop, 0);
+
+    sw->run = run;
+    sw->points = points;
+    sw->total = total;
+    sw->reps = req.reps;
+    /* seed 0 = čas, ale rozhodne sa raz pre celý prechod (crn potrebuje jeden seed) */
+    sw->seed = (req.seed == 0) ? (uint32_t)time(NULL) : req.seed;
+    sw->boundary = req.boundary;
+    sw->crn = req.crn;
+    sw->cacheable = (req.seed != 0);
+    pthread_mutex_init(&sw->mtx, NULL);
+
+    run_queue(s, run);
+}
+
+/** Najviac udalostí spracovaných jedným epoll_wait(). */
+#define SERVER_MAX_EVENTS 64
+
+/** Dĺžka fronty nevybavených pripojení počúvajúceho socketu. */
+#define SERVER_BACKLOG 128
+
+/**
+ * @brief Stav spojenia v event slučke.
+ */
+typedef enum {
+    CONN_HELLO = 0,          /**< Čaká sa na MSG_HELLO */
+    CONN_READY = 1           /**< Handshake hotový, spojenie má reláciu */
+} conn_state_t;
+
+/**
+ * @brief Jedno klientske spojenie v event slučke.
+ *
+ * Socket ostáva blokujúci, ale číta sa z neho iba cez net_recv_some() a píše
+ * iba bez čakania cez front relácie alebo pozorovateľa. Neúplné správy
+ * drží parser.
+ */
+typedef struct conn {
+    int fd;                  /**< Socket spojenia (-1 po zatvorení) */
+    conn_state_t state;      /**< Fáza handshake */
+    session_t* s;            /**< Relácia po handshake (NULL pred ním) */
+    session_t* watched;      /**< Sledovaná relácia po MSG_SUBSCRIBE (drží referenciu) */
+    fan_sub_t* sub;          /**< Front pozorovateľa v watched->fan */
+    proto_parser_t in;       /**< Prijaté, zatiaľ nespracované bajty */
+    struct conn* prev;       /**< Zoznam otvorených spojení */
+    struct conn* next;       /**< Zoznam otvorených, po zatvorení zoznam na uvoľnenie */
+} conn_t;
+
+/**
+ * @brief Stav event slučky (používa iba hlavné vlákno).
+ */
+typedef struct {
+    server_ctx_t* srv;       /**< Kontext servera */
+    int epfd;                /**< epoll inštancia */
+    conn_t* conns;           /**< Otvorené spojenia */
+    conn_t* dead;            /**< Zatvorené spojenia, uvoľnia sa po spracovaní udalostí */
+} loop_t;
+
+/**
+ * @brief Ukončí reláciu po odpojení klienta.
+ *
+ * Zastaví jej beh, zahodí čakajúci START a odpojí jej pozorovateľov
+ * (ďalší beh už nebude). Socket sa najprv zavrie cez
+ * shutdown() a zatvorí sa až po fan_sub_stop() pod send_mtx, aby nikto
+ * nezapisoval do recyklovaného fd.
+ * Relácia sa uvoľní, keď dobehne aj jej beh.
+ *
+ * @param srv Kontext servera.
+ * @param s Relácia.
+ */
+static void session_close(server_ctx_t* srv, session_t* s) {
+    shutdown(s->fd, SHUT_RDWR);
+    pthread_mutex_lock(&s->send_mtx);
+    pthread_mutex_lock(&s->mtx);
+    fan_sub_stop(&s->out);
+    close(s->fd);
+    s->fd = -1;
+    if (s->run) run_stop(s->run);
+    run_t* pending = s->pending;
+    s->pending = NULL;
+    pthread_mutex_unlock(&s->mtx);
+    pthread_mutex_unlock(&s->send_mtx);
+
+    if (pending) run_free(pending);
+    fan_shutdown(&s->fan);
+
+    pthread_mutex_lock(&srv->mtx);
+    srv->sessions--;
+    if (s->list_prev) s->list_prev->list_next = s->list_next;
+    else srv->list = s->list_next;
+    if (s->list_next) s->list_next->list_prev = s->list_prev;
+    pthread_mutex_unlock(&srv->mtx);
+    session_put(s);
+}
+
+/**
+ * @brief Ukončí sledovanie relácie spojením (ak nejakú sleduje).
+ *
+ * Po fan_remove() už do frontu nikto nepíše, takže sa môže hneď uvoľniť.
+ *
+ * @param c Spojenie.
+ */
+static void conn_unsubscribe(conn_t* c) {
+    if (!c->sub) return;
+    fan_remove(&c->watched->fan, c->sub);
+    printf("[server] session %u: viewer left (dropped %llu buffers)\n",
+           (unsigned)c->watched->id, (unsigned long long)c->sub->dropped);
+    fan_sub_free(c->sub);
+    free(c->sub);
+    session_put(c->watched);
+    c->sub = NULL;
+    c->watched = NULL;
+}
+
+/**
+ * @brief Zatvorí spojenie a odloží ho na uvoľnenie po aktuálnej dávke udalostí.
+ *
+ * @param lp Event slučka.
+ * @param c Spojenie.
+ */
+static void conn_close(loop_t* lp, conn_t* c) {
+    (void)epoll_ctl(lp->epfd, EPOLL_CTL_DEL, c->fd, NULL);
+    conn_unsubscribe(c);
+    if (c->s) {
+        session_close(lp->srv, c->s);
+        c->s = NULL;
+    } else {
+        close(c->fd);
+    }
+    c->fd = -1;
+
+    if (c->prev) c->prev->next = c->next;
+    else lp->conns = c->next;
+    if (c->next) c->next->prev = c->prev;
+    c->next = lp->dead;
+    lp->dead = c;
+}
+
+/**
+ * @brief Dokončí handshake: pošle MSG_HELLO_ACK a vytvorí spojeniu reláciu.
+ *
+ * @param lp Event slučka.
+ * @param c Spojenie, ktoré poslalo MSG_HELLO.
+ * @param payload Payload MSG_HELLO (ľubovoľný text).
+ * @param len Dĺžka payloadu.
+ * @return 0 pri úspechu, -1 ak sa ACK nepodarilo poslať.
+ */
+static int conn_hello(loop_t* lp, conn_t* c, const void* payload, uint32_t len) {
+    server_ctx_t* srv = lp->srv;
+
+    char text[64];
+    uint32_t n = (len < sizeof(text)) ? len : (uint32_t)(sizeof(text) - 1);
+    memcpy(text, payload, n);
+    text[n] = 0;
+    printf("[server] HELLO payload: '%s'\n", text);
+
+    session_t* s = calloc(1, sizeof(*s));
+    if (!s || fan_sub_init(&s->out, c->fd, 1) != 0) {
+        fprintf(stderr, "[server] out of memory, dropping client\n");
+        free(s);
+        return -1;
+    }
+    /* front je zatiaľ prázdny, ACK ide rovno */
+    if (proto_send(c->fd, MSG_HELLO_ACK, NULL, 0) != 0) {
+        fprintf(stderr, "[server] failed to send HELLO_ACK\n");
+        fan_sub_free(&s->out);
+        free(s);
+        return -1;
+    }
+
+    s->srv = srv;
+    s->fd = c->fd;
+    atomic_init(&s->refs, 1);
+    pthread_mutex_init(&s->mtx, NULL);
+    pthread_mutex_init(&s->send_mtx, NULL);
+    fan_init(&s->fan);
+    /* nový klient začína bez dávkovania a bez súhrnov, kým nepošle MSG_SESSION */
+    s->batch_max = 1;
+    s->flush_ms = STATE_FLUSH_MS_DEFAULT;
+    s->net_policy = NET_POLICY_LATENCY;
+    s->max_fps = 0;
+    s->decimate = 1;
+    s->ring_policy = RING_BLOCK;
+    s->snap_reps = 0;
+    s->snap_ms = 0;
+
+    pthread_mutex_lock(&srv->mtx);
+    s->id = ++srv->next_id;
+    srv->sessions++;
+    s->list_next = srv->list;
+    if (srv->list) srv->list->list_prev = s;
+    srv->list = s;
+    uint32_t active = srv->sessions;
+    pthread_mutex_unlock(&srv->mtx);
+
+    c->s = s;
+    c->state = CONN_READY;
+    printf("[server] handshake OK (session %u, %u active)\n", (unsigned)s->id, (unsigned)active);
+    return 0;
+}
+
+/**
+ * @brief Nájde reláciu na sledovanie a pridá na ňu referenciu.
+ *
+ * @param srv Kontext servera.
+ * @param self Relácia žiadateľa (tú sledovať nemôže).
+ * @param id Číslo relácie, 0 = najnovšia s bežiacim behom.
+ * @return Relácia, alebo NULL ak taká nie je.
+ */
+static session_t* session_find(server_ctx_t* srv, session_t* self, uint32_t id) {
+    session_t* found = NULL;
+    pthread_mutex_lock(&srv->mtx);
+    for (session_t* s = srv->list; s && !found; s = s->list_next) {
+        if (s == self) continue;
+        if (id != 0) {
+            if (s->id == id) found = s;
             continue;
         }
+        pthread_mutex_lock(&s->mtx);
+        if (s->run) found = s;
+        pthread_mutex_unlock(&s->mtx);
+    }
+    if (found) session_get(found);
+    pthread_mutex_unlock(&srv->mtx);
+    return found;
+}
 
-        printf("[server] client connected\n");
+/**
+ * @brief Spracuje MSG_SUBSCRIBE: spojenie začne sledovať behy inej relácie.
+ *
+ * Od tejto chvíle sa do socketu píše iba cez front pozorovateľa, preto
+ * vlastná relácia spojenia nesmie mať beh a ďalšie START / MSG_SESSION sa
+ * ignorujú. Nový pozorovateľ dostane MSG_SUBSCRIBE_ACK a ak bežiaci beh
+ * posiela trajektórie, aj jeho MSG_TRAJ_INFO; potom priebeh od aktuálneho
+ * miesta. Opakovaný MSG_SUBSCRIBE zmení sledovanú reláciu.
+ *
+ * @param lp Event slučka.
+ * @param c Spojenie.
+ * @param payload Payload (nezarovnaný, v bufferi parsera).
+ * @param len Dĺžka payloadu.
+ * @return 0 ak spojenie ostáva otvorené, -1 ak sa má zatvoriť.
+ */
+static int conn_subscribe(loop_t* lp, conn_t* c, const void* payload, uint32_t len) {
+    msg_subscribe_t req;
+    if (len != sizeof(req)) {
+        printf("[server] invalid MSG_SUBSCRIBE len=%u\n", (unsigned)len);
+        return 0;
+    }
+    memcpy(&req, payload, sizeof(req));
+
+    session_t* self = c->s;
+    pthread_mutex_lock(&self->mtx);
+    int busy = (self->run != NULL);
+    pthread_mutex_unlock(&self->mtx);
+    /* front pozorovateľa píše do toho istého socketu - vlastný front musí byť prázdny */
+    if (fan_sub_bytes(&self->out) > 0) busy = 1;
+
+    conn_unsubscribe(c);
+    session_t* t = busy ? NULL : session_find(lp->srv, self, req.session);
+    fan_sub_t* sub = t ? malloc(sizeof(*sub)) : NULL;
+    if (sub && fan_sub_init(sub, c->fd, 0) != 0) {
+        free(sub);
+        sub = NULL;
+    }
+    /* pozorovateľov pridáva iba event slučka, takže miesto po kontrole nezmizne */
+    if (!sub || fan_count(&t->fan) >= FAN_MAX_SUBS) {
+        printf("[server] session %u: SUBSCRIBE %u refused\n", (unsigned)self->id, (unsigned)req.session);
+        if (sub) fan_sub_free(sub);
+        free(sub);
+        if (t) session_put(t);
+        msg_subscribe_t ack = { 0 };
+        return session_send(self, MSG_SUBSCRIBE_ACK, &ack, (uint32_t)sizeof(ack));
+    }
+
+    msg_subscribe_t ack;
+    ack.session = t->id;
+    fan_buf_t* b = fan_buf_msg(MSG_SUBSCRIBE_ACK, &ack, (uint32_t)sizeof(ack));
+    if (b) (void)fan_sub_push(sub, b);
+    fan_buf_put(b);
+
+    /* pod mtx sledovanej relácie: MSG_TRAJ_INFO príde práve raz a pred MSG_TRAJ */
+    pthread_mutex_lock(&t->mtx);
+    if (t->run && t->run->traj_sent) {
+        b = fan_buf_msg(MSG_TRAJ_INFO, &t->run->traj_info, (uint32_t)sizeof(t->run->traj_info));
+        if (b) (void)fan_sub_push(sub, b);
+        fan_buf_put(b);
+    }
+    (void)fan_add(&t->fan, sub);
+    pthread_mutex_unlock(&t->mtx);
 
-        /* handshake */
-        msg_type_t t;
-        char payload[64];
-        uint32_t len = 0;
+    c->watched = t;
+    c->sub = sub;
 
-        if (proto_recv(cfd, &t, payload, (uint32_t)sizeof(payload), &len) != 0 || t != MSG_HELLO) {
-            fprintf(stderr, "[server] expected HELLO\n");
-            close(cfd);
-            continue;
+    printf("[server] session %u: watching session %u (%u viewers)\n",
+           (unsigned)self->id, (unsigned)t->id, (unsigned)fan_count(&t->fan));
+    return 0;
+}
+
+/**
+ * @brief Spracuje jednu správu od klienta s reláciou.
+ *
+ * - MSG_SESSION: nastavenia spojenia, odpovie MSG_SESSION_ACK
+ * - MSG_START: overí parametre a spustí beh relácie v poole
+ * - MSG_RESUME: ako MSG_START, ale beh pokračuje z checkpointu
+ * - MSG_QUIT: ukončenie servera, ak je to jediná relácia; inak sa
+ *   odpojí iba tento klient, aby neukončil behy ostatných
+ *
+ * Ostatné typy sa ignorujú.
+ *
+ * @param srv Kontext servera.
+ * @param s Relácia.
+ * @param type Typ správy.
+ * @param payload Payload (nezarovnaný, v bufferi parsera).
+ * @param len Dĺžka payloadu.
+ * @return 0 pri spracovaní, -1 ak sa má spojenie zatvoriť, 1 ak sa má server ukončiť.
+ */
+static int handle_msg(server_ctx_t* srv, session_t* s, msg_type_t type, const void* payload, uint32_t len) {
+    if (type == MSG_QUIT) {
+        pthread_mutex_lock(&srv->mtx);
+        uint32_t others = srv->sessions - 1u;
+        pthread_mutex_unlock(&srv->mtx);
+        if (others > 0) {
+            printf("[server] session %u: MSG_QUIT with %u other sessions -> closing only this one\n",
+                   (unsigned)s->id, (unsigned)others);
+            return -1;
+        }
+        printf("[server] got MSG_QUIT -> shutdown server\n");
+        return 1;
+    }
+
+    if (type == MSG_SESSION) handle_session(s, payload, len);
+    else if (type == MSG_START) handle_start(s, payload, len, 0);
+    else if (type == MSG_RESUME) handle_start(s, payload, len, 1);
+    else if (type == MSG_SWEEP) handle_sweep(s, payload, len);
+    return 0;
+}
+
+/**
+ * @brief Prečíta zo spojenia všetko dostupné a spracuje celé správy.
+ *
+ * Pri edge-triggered epoll treba čítať, kým net_recv_some() nevráti 0;
+ * neúplná správa ostane v parseri do ďalšej udalosti.
+ *
+ * @param lp Event slučka.
+ * @param c Spojenie.
+ * @return 0 ak spojenie ostáva otvorené, -1 ak sa má zatvoriť, 1 pri MSG_QUIT.
+ */
+static int conn_read(loop_t* lp, conn_t* c) {
+    for (;;) {
+        uint32_t room;
+        void* dst = proto_parser_space(&c->in, &room);
+        if (room == 0) return -1;
+
+        int n = net_recv_some(c->fd, dst, room);
+        if (n < 0) return -1;
+        if (n == 0) return 0;
+        proto_parser_commit(&c->in, (uint32_t)n);
+
+        msg_type_t type;
+        const void* payload;
+        uint32_t len;
+        int r;
+        while ((r = proto_parser_next(&c->in, &type, &payload, &len)) == 1) {
+            if (c->state == CONN_HELLO) {
+                if (type != MSG_HELLO) {
+                    fprintf(stderr, "[server] expected HELLO\n");
+                    return -1;
+                }
+                if (conn_hello(lp, c, payload, len) != 0) return -1;
+                continue;
+            }
+            int rc;
+            if (type == MSG_SUBSCRIBE) {
+                rc = conn_subscribe(lp, c, payload, len);
+            } else if (c->sub && (type == MSG_START || type == MSG_RESUME ||
+                                   type == MSG_SWEEP || type == MSG_SESSION)) {
+                printf("[server] session %u: message %u ignored while watching\n",
+                       (unsigned)c->s->id, (unsigned)type);
+                rc = 0;
+            } else {
+                rc = handle_msg(lp->srv, c->s, type, payload, len);
+            }
+            if (rc != 0) return rc;
+        }
+        if (r < 0) {
+            fprintf(stderr, "[server] message too long, closing connection\n");
+            return -1;
         }
+    }
+}
 
-        payload[(len < sizeof(payload)) ? len : (sizeof(payload) - 1)] = 0;
-        printf("[server] HELLO payload: '%s'\n", payload);
+/**
+ * @brief Prijme všetky čakajúce pripojenia a zaregistruje ich v epoll.
+ *
+ * @param lp Event slučka.
+ * @param lfd Neblokujúci počúvajúci socket.
+ */
+static void accept_all(loop_t* lp, int lfd) {
+    for (;;) {
+        int cfd = net_accept(lfd, NET_POLICY_LATENCY);
+        if (cfd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept");
+            return;
+        }
 
-        if (proto_send(cfd, MSG_HELLO_ACK, NULL, 0) != 0) {
-            fprintf(stderr, "[server] failed to send HELLO_ACK\n");
+        conn_t* c = calloc(1, sizeof(*c));
+        if (!c) {
+            fprintf(stderr, "[server] out of memory, dropping client\n");
+            close(cfd);
+            continue;
+        }
+        c->fd = cfd;
+        c->state = CONN_HELLO;
+        proto_parser_init(&c->in);
+
+        /* EPOLLOUT: zvyšok frontu relácie alebo pozorovateľa dopošle slučka */
+        struct epoll_event ev;
+        memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.ptr = c;
+        if (epoll_ctl(lp->epfd, EPOLL_CTL_ADD, cfd, &ev) != 0) {
+            fprintf(stderr, "[server] failed to register client\n");
+            free(c);
             close(cfd);
             continue;
         }
-        printf("[server] handshake OK\n");
+        c->next = lp->conns;
+        if (lp->conns) lp->conns->prev = c;
+        lp->conns = c;
+
+        printf("[server] client connected\n");
+    }
+}
+
+/**
+ * @brief Uvoľní spojenia zatvorené počas dávky udalostí.
+ *
+ * @param lp Event slučka.
+ */
+static void free_dead(loop_t* lp) {
+    while (lp->dead) {
+        conn_t* c = lp->dead;
+        lp->dead = c->next;
+        free(c);
+    }
+}
+
+/**
+ * @brief Hlavná funkcia servera - inicializuje server a spracováva pripojenia.
+ *
+ * Táto funkcia:
+ * - Vytvorí počúvajúci TCP socket na zadanom porte
+ * - Vytvorí pool simulačných vlákien (jedno na jadro), spoločný pre všetky relácie
+ * - V edge-triggered epoll slučke prijíma pripojenia, vykonáva handshake
+ *   a číta správy zo všetkých spojení naraz (pomalé spojenie nikoho neblokuje)
+ * - Každý klient má vlastnú reláciu; behy rôznych klientov bežia súbežne
+ * - Beží až do prijatia MSG_QUIT od jediného pripojeného klienta
+ *
+ * @param port Číslo portu, na ktorom bude server počúvať.
+ * @return 0 pri úspešnom ukončení, 1 pri chybe.
+ */
+int server_run(uint16_t port, const char* data_dir, uint32_t ckpt_ms) {
+    int lfd = net_listen(port, SERVER_BACKLOG);
+    if (lfd < 0) {
+        perror("net_listen");
+        return 1;
+    }
 
-        pthread_mutex_lock(&ctx.mtx);
-        /* ak by bol stary klient, zavri ho */
-        if (ctx.client_fd >= 0) {
-            shutdown(ctx.client_fd, SHUT_RDWR);
-            close(ctx.client_fd);
+    loop_t lp;
+    memset(&lp, 0, sizeof(lp));
+    lp.epfd = epoll_create1(0);
+    struct epoll_event lev;
+    memset(&lev, 0, sizeof(lev));
+    lev.events = EPOLLIN | EPOLLET;
+    lev.data.ptr = NULL; /* NULL = počúvajúci socket */
+    if (net_set_nonblocking(lfd) != 0 || lp.epfd < 0 ||
+        epoll_ctl(lp.epfd, EPOLL_CTL_ADD, lfd, &lev) != 0) {
+        perror("epoll");
+        if (lp.epfd >= 0) close(lp.epfd);
+        close(lfd);
+        return 1;
+    }
+
+    server_ctx_t srv;
+    memset(&srv, 0, sizeof(srv));
+    pthread_mutex_init(&srv.mtx, NULL);
+    pthread_mutex_init(&srv.print_mtx, NULL);
+    srv.pool = pool_create(sim_resolve_threads(0, 0));
+    if (!srv.pool) {
+        fprintf(stderr, "[server] failed to start worker pool\n");
+        pthread_mutex_destroy(&srv.print_mtx);
+        pthread_mutex_destroy(&srv.mtx);
+        close(lp.epfd);
+        close(lfd);
+        return 1;
+    }
+    lp.srv = &srv;
+
+    if (data_dir) {
+        srv.data_dir = data_dir;
+        srv.ckpt_ms = ckpt_ms;
+        char path[4096];
+        if (mkdir(data_dir, 0755) != 0 && errno != EEXIST) {
+            fprintf(stderr, "[server] cannot create data dir %s: %s\n", data_dir, strerror(errno));
+        } else if (snprintf(path, sizeof(path), "%s/%s", data_dir, CACHE_FILE) < (int)sizeof(path)) {
+            srv.cache = cache_open(path);
+            srv.runlog = runlog_open(data_dir);
+            if (ckpt_ms > 0) {
+                srv.ckpt_writer = ckpt_writer_start();
+                if (!srv.ckpt_writer) {
+                    fprintf(stderr, "[server] failed to start checkpoint writer, checkpoints disabled\n");
+                }
+            }
         }
-        ctx.client_fd = cfd;
-        ctx.session_active = 1;
-        ctx.sim_running = 0;
-        pthread_mutex_unlock(&ctx.mtx);
     }
 
-    /* shutdown */
-    pthread_join(tnet, NULL);
-    pthread_join(tsim, NULL);
+    printf("[server] listening on %u (%u pool threads)...\n", (unsigned)port, (unsigned)pool_threads(srv.pool));
+
+    /* event loop */
+    struct epoll_event evs[SERVER_MAX_EVENTS];
+    int quit = 0;
+    while (!quit) {
+        int n = epoll_wait(lp.epfd, evs, SERVER_MAX_EVENTS, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("epoll_wait");
+            break;
+        }
+
+        for (int i = 0; i < n && !quit; i++) {
+            conn_t* c = (conn_t*)evs[i].data.ptr;
+            if (!c) {
+                accept_all(&lp, lfd);
+                continue;
+            }
+            if (c->fd < 0) continue; /* zatvorené v tejto dávke */
+
+            int rc = 0;
+            if ((evs[i].events & EPOLLOUT) && c->s) rc = session_flush(c->s);
+            if (rc == 0 && (evs[i].events & EPOLLOUT) && c->sub) rc = fan_sub_flush(c->sub);
+            if (rc == 0 && (evs[i].events & ~(uint32_t)EPOLLOUT)) rc = conn_read(&lp, c);
+            if (rc > 0) {
+                quit = 1;
+            } else if (rc < 0) {
+                if (c->s) fprintf(stderr, "[server] session %u: client disconnected\n", (unsigned)c->s->id);
+                conn_close(&lp, c);
+            }
+        }
+        free_dead(&lp);
+    }
 
-    pthread_mutex_destroy(&ctx.mtx);
-    if (lfd >= 0) close(lfd);  // moze byt uz zavrety z net_thread
+    /* shutdown: odpojenie zastaví behy, pool počká, kým dobehnú */
+    while (lp.conns) conn_close(&lp, lp.conns);
+    free_dead(&lp);
+    pool_destroy(srv.pool);
+    ckpt_writer_stop(srv.ckpt_writer); /* behy už skončili, ich checkpointy sú zapísané */
+    cache_close(srv.cache);
+    runlog_close(srv.runlog);
+    close(lp.epfd);
+    close(lfd);
+
+    pthread_mutex_destroy(&srv.print_mtx);
+    pthread_mutex_destroy(&srv.mtx);
 
     printf("[server] shutdown\n");
     return 0;
@@ -25,6 +25,8 @@
  * @brief Spustí serverový proces.
  *
  * @param port Číslo portu na počúvanie (napr. 5555).
+ * @param data_dir Priečinok na perzistentné dáta (cache výsledkov); NULL = nič neukladať.
+ * @param ckpt_ms Interval checkpointov behov v ms (0 = bez checkpointov; iba s data_dir).
  * @return 0 pri úspešnom ukončení, 1 pri chybe.
  */
-int server_run(uint16_t port);
\ No newline at end of file
+int server_run(uint16_t port, const char* data_dir, uint32_t ckpt_ms);
\ No newline at end of file
@@ -0,0 +1,1041 @@
+/**
+ * @file simulation.c
+ * @brief Implementácia simulačného jadra s paralelnými replikáciami.
+ */
+
+#include "simulation.h"
+#include "kernel.h"
+#include "rng.h"
+#include "traj.h"
+
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+typedef struct sim_worker sim_worker_t;
+
+/**
+ * @brief Kroková funkcia pre jeden režim okraja (vygenerovaná makrom).
+ *
+ * @return 1 ak chodec opustil svet (BOUND_ABSORB), inak 0.
+ */
+typedef int (*sim_step_fn)(sim_worker_t* w);
+
+/**
+ * @brief Stav časovača krokov simulácie.
+ *
+ * Pri PACE_FIXED_HZ sa drží absolútny deadline nasledujúceho kroku, ktorý sa
+ * posúva vždy o jednu periódu. Oneskorenie jedného kroku (napr. pomalý send)
+ * sa tak nepripočíta k ďalším krokom a frekvencia nedriftuje.
+ */
+typedef struct {
+    uint8_t mode;            /**< Režim časovania (pace_mode_t) */
+    long period_ns;          /**< Perióda jedného kroku v ns (PACE_FIXED_HZ) */
+    struct timespec next;    /**< Absolútny deadline ďalšieho kroku (CLOCK_MONOTONIC) */
+} pacer_t;
+
+typedef struct sim_exec sim_exec_t;
+
+/**
+ * @brief Stav jedného shardu replikácií (úloha v poole).
+ *
+ * Všetko, čo shard počas behu mení, je súkromné - zdieľaný je iba job,
+ * ktorý sa len číta (okrem atomického príznaku stop). Shard sa môže kedykoľvek
+ * prerušiť (koniec časového úseku, čakanie na krok) a pokračovať na inom
+ * vlákne poolu, preto je celý stav rozpracovanej replikácie tu.
+ */
+struct sim_worker {
+    sim_job_t* job;          /**< Spoločný popis behu */
+    sim_exec_t* exec;        /**< Beh, do ktorého shard patrí */
+    uint32_t id;             /**< Index shardu (0..threads-1), pre emit */
+    uint32_t rep_begin;      /**< Prvá replikácia shardu (0-based, vrátane) */
+    uint32_t rep_end;        /**< Koniec shardu (0-based, bez) */
+    uint32_t rep_next;       /**< Ďalšia (alebo rozpracovaná) replikácia */
+    int in_rep;              /**< 1 ak je replikácia rep_next rozpracovaná */
+    int absorbed;            /**< Rozpracovaná replikácia: chodec opustil svet */
+    int started;             /**< 1 po prvom spustení (pacer je inicializovaný) */
+    pacer_t pacer;           /**< Časovač krokov (prežije prerušenie úlohy) */
+    sim_kernel_fn kernel;    /**< Dávkové jadro pre beh bez živého výstupu (NULL = po krokoch) */
+    sim_step_fn step_fn;     /**< Kroková funkcia pre režim okraja behu */
+
+    msg_state_batch_t batch; /**< Rozpracovaná dávka stavov pre emit */
+    uint32_t batch_n;        /**< Počet stavov v rozpracovanej dávke */
+    struct timespec batch_deadline; /**< Najneskorší čas odoslania dávky/rámca (CLOCK_MONOTONIC) */
+
+    uint8_t dir;             /**< Smer posledného kroku (pre STREAM_TRAJ) */
+    msg_traj_seg_t seg;      /**< Hlavička rozpracovaného úseku trajektórie */
+    uint8_t seg_dirs[TRAJ_SEG_STEPS]; /**< Smery rozpracovaného úseku */
+    uint8_t frame[TRAJ_FRAME_MAX]; /**< Rozpracovaný payload MSG_TRAJ */
+    uint32_t frame_len;      /**< Počet bajtov v frame */
+
+    msg_traj_seg_t rec_seg;  /**< Rozpracovaný úsek zápisu do súboru (job->record) */
+    uint8_t rec_dirs[TRAJ_SEG_STEPS]; /**< Smery rozpracovaného úseku zápisu */
+    uint8_t* rec_buf;        /**< Zakódované úseky rozpracovanej replikácie */
+    uint32_t rec_len;        /**< Počet bajtov v rec_buf */
+    uint32_t rec_cap;        /**< Kapacita rec_buf */
+    int rec_failed;          /**< 1 ak sa rozpracovaná replikácia nezapíše (chyba alokácie) */
+
+    rng_stream_t rng;        /**< Náhodný prúd aktuálnej replikácie */
+    int32_t x, y;            /**< Aktuálna pozícia chodca */
+    uint32_t step;           /**< Aktuálny krok v replikácii */
+    results_t results;       /**< Súkromná štatistika shardu */
+    sim_shard_state_t pub;   /**< Kópia stavu z konca posledného úseku (chráni exec->snap_mtx) */
+};
+
+/**
+ * @brief Beh rozdelený na shardy v poole; posledný dokončený shard ho uzavrie.
+ *
+ * S cieľom presnosti posledný shard bloku naplánuje ďalší blok a shardy
+ * znova zaradí.
+ */
+struct sim_exec {
+    sim_job_t* job;          /**< Popis behu */
+    results_t* out;          /**< Výstupná štatistika */
+    pool_t* pool;            /**< Pool (na zaradenie ďalšieho bloku) */
+    sim_worker_t* workers;   /**< Shardy */
+    uint32_t n;              /**< Počet shardov */
+    uint32_t planned;        /**< Koniec naplánovaných replikácií (aktuálneho bloku) */
+    atomic_uint left;        /**< Počet nedokončených shardov (v aktuálnom bloku) */
+    sim_done_fn done;        /**< Callback po dokončení */
+    void* done_arg;          /**< Argument pre done */
+
+    pthread_mutex_t snap_mtx; /**< Chráni pub shardov, planned a termíny súhrnov a checkpointov */
+    results_t snap;          /**< Zlúčená štatistika pre súhrn */
+    uint64_t snap_next_reps; /**< Počet dokončených replikácií pre ďalší súhrn */
+    struct timespec snap_next; /**< Čas ďalšieho súhrnu (CLOCK_MONOTONIC) */
+
+    sim_checkpoint_t* ckpt;  /**< Buffer checkpointu (alokovaný pri štarte, ak job->ckpt) */
+    struct timespec ckpt_next; /**< Čas ďalšieho checkpointu (CLOCK_MONOTONIC) */
+    int finishing;           /**< 1 keď všetky shardy skončili a beh sa uzatvára */
+    int ckpt_final;          /**< 1 keď je posledný checkpoint zastaveného behu odovzdaný */
+};
+
+/**
+ * @brief Pripočíta k časovej značke zadaný počet nanosekúnd.
+ *
+ * @param ts Časová značka na úpravu.
+ * @param ns Počet nanosekúnd (nezáporný).
+ */
+static void timespec_add_ns(struct timespec* ts, long ns) {
+    ts->tv_sec += ns / 1000000000L;
+    ts->tv_nsec += ns % 1000000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec += 1;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * @brief Porovná dve časové značky.
+ *
+ * @return 1 ak a >= b, inak 0.
+ */
+static int timespec_ge(const struct timespec* a, const struct timespec* b) {
+    if (a->tv_sec != b->tv_sec) return a->tv_sec > b->tv_sec;
+    return a->tv_nsec >= b->tv_nsec;
+}
+
+/**
+ * @brief Inicializuje časovač krokov pre novú simuláciu.
+ *
+ * Tempo platí pre celý beh, takže pri viacerých shardoch (iba pokračovanie
+ * z checkpointu, sim_job_shards) má každý shard n-krát dlhšiu periódu.
+ *
+ * @param p Ukazovateľ na časovač.
+ * @param mode Režim časovania (pace_mode_t).
+ * @param rate_hz Frekvencia krokov pre PACE_FIXED_HZ (inak ignorovaná).
+ * @param shards Počet shardov behu.
+ */
+static void pacer_init(pacer_t* p, uint8_t mode, uint32_t rate_hz, uint32_t shards) {
+    p->mode = mode;
+    if (mode == PACE_FIXED_HZ && rate_hz > 0) p->period_ns = (long)(1000000000L / rate_hz) * (long)shards;
+    else if (mode == PACE_LIVE) p->period_ns = SIM_LIVE_PERIOD_NS * (long)shards;
+    else p->period_ns = 0;
+    clock_gettime(CLOCK_MONOTONIC, &p->next);
+}
+
+/**
+ * @brief Určí čas ďalšieho kroku podľa režimu časovania.
+ *
+ * - PACE_LIVE: pevná 100 ms pauza (pôvodné správanie živého dema)
+ * - PACE_UNPACED: nečaká vôbec
+ * - PACE_FIXED_HZ: absolútny deadline posunutý o periódu; ak sme pozadu
+ *   o viac než sekundu (napr. zaseknutý klient), deadline sa resynchronizuje
+ *   na "teraz", aby simulácia potom nedobiehala dávkou krokov bez pauzy.
+ *
+ * Krátku pauzu (do SIM_PACE_YIELD_NS) prespí priamo, pri dlhšej vráti
+ * deadline, aby úloha uvoľnila vlákno poolu ostatným behom.
+ *
+ * @param p Ukazovateľ na časovač.
+ * @param wake Výstup: čas ďalšieho kroku, ak funkcia vráti 1.
+ * @return 1 ak treba počkať do wake (mimo vlákna poolu), inak 0.
+ */
+static int pacer_next(pacer_t* p, struct timespec* wake) {
+    if (p->mode == PACE_UNPACED) return 0;
+
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    if (p->mode != PACE_FIXED_HZ || p->period_ns <= 0) {
+        *wake = now;
+        timespec_add_ns(wake, p->period_ns); // 100ms na shard
+        return 1;
+    }
+
+    timespec_add_ns(&p->next, p->period_ns);
+    if (now.tv_sec > p->next.tv_sec + 1) {
+        p->next = now;
+        return 0;
+    }
+
+    struct timespec yield_at = now;
+    timespec_add_ns(&yield_at, SIM_PACE_YIELD_NS);
+    if (!timespec_ge(&p->next, &yield_at)) {
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &p->next, NULL) == EINTR) {
+            /* prerušené signálom -> spi znovu do rovnakého deadlinu */
+        }
+        return 0;
+    }
+    *wake = p->next;
+    return 1;
+}
+
+/**
+ * @brief Vráti, o koľko ns sa najviac čaká pred ďalším krokom (pacer_next).
+ *
+ * @param p Ukazovateľ na časovač.
+ * @return Dĺžka pauzy v ns (0 pri PACE_UNPACED).
+ */
+static long pacer_sleep_ns(const pacer_t* p) {
+    if (p->mode == PACE_UNPACED) return 0;
+    if (p->mode != PACE_FIXED_HZ || p->period_ns <= 0) return 100000000L;
+    return p->period_ns;
+}
+
+/**
+ * @brief Odošle rozpracovanú dávku stavov cez job->emit (ak nie je prázdna).
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @return 0 pri úspechu, -1 ak emit zlyhal.
+ */
+static int batch_flush(sim_worker_t* w) {
+    const sim_job_t* job = w->job;
+    uint32_t n = w->batch_n;
+    if (n == 0) return 0;
+    w->batch_n = 0;
+
+    /* klient bez dávkovania dostáva stavy po jednom ako MSG_STATE */
+    if (job->batch_max == 1) {
+        return job->emit(job->emit_arg, w->id, MSG_STATE, &w->batch.st[0], (uint32_t)sizeof(w->batch.st[0]));
+    }
+    w->batch.count = n;
+    uint32_t len = (uint32_t)(sizeof(w->batch) - sizeof(w->batch.st)) + n * (uint32_t)sizeof(w->batch.st[0]);
+    return job->emit(job->emit_arg, w->id, MSG_STATE_BATCH, &w->batch, len);
+}
+
+/**
+ * @brief Nastaví deadline odoslania pri prvej položke prázdnej dávky/rámca.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ */
+static void flush_arm(sim_worker_t* w) {
+    if (w->job->flush_ms == 0) return;
+    clock_gettime(CLOCK_MONOTONIC, &w->batch_deadline);
+    timespec_add_ns(&w->batch_deadline, (long)w->job->flush_ms * 1000000L);
+}
+
+/**
+ * @brief Zistí, či treba odoslať neúplnú dávku/rámec kvôli deadlinu.
+ *
+ * Pri časovanom behu sa kontroluje po každom kroku s predstihom o nasledujúcu
+ * pauzu, aby sa stav nezdržal o celú periódu navyše. Pri behu bez časovania
+ * sa dávka plní rýchlo, preto sa hodiny čítajú iba raz za 64 položiek.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @param pacer Časovač krokov shardu.
+ * @param n Počet položiek (stavov alebo krokov) od začiatku dávky.
+ * @return 1 ak deadline vypršal, inak 0.
+ */
+static int flush_due(const sim_worker_t* w, const pacer_t* pacer, uint32_t n) {
+    struct timespec now;
+    if (w->job->flush_ms == 0) return 0;
+    if (pacer->mode == PACE_UNPACED && (n & 63u) != 0) return 0;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    timespec_add_ns(&now, pacer_sleep_ns(pacer));
+    return timespec_ge(&now, &w->batch_deadline);
+}
+
+/**
+ * @brief Pridá stav do dávky a odošle ju, ak je plná alebo jej vyprší čas.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @param st Stav po kroku.
+ * @param pacer Časovač krokov shardu.
+ * @return 0 pri úspechu, -1 ak emit zlyhal.
+ */
+static int batch_push(sim_worker_t* w, const msg_state_t* st, const pacer_t* pacer) {
+    if (w->batch_n == 0) flush_arm(w);
+    w->batch.st[w->batch_n++] = *st;
+
+    if (w->batch_n >= w->job->batch_max) return batch_flush(w);
+    if (flush_due(w, pacer, w->batch_n)) return batch_flush(w);
+    return 0;
+}
+
+/**
+ * @brief Rozhodne, či sa má stav po kroku poslať (decimate a max_fps).
+ *
+ * Simuluje sa každý krok, posiela sa iba vzorka: pri decimate iba kroky
+ * deliteľné decimate, pri max_fps najviac jeden stav za periódu 1/max_fps
+ * zo všetkých shardov spolu. Periódu si shardy delia cez atomický
+ * job->frame_next - stav pošle ten shard, ktorému sa ho podarí posunúť.
+ * Bez časovania sa hodiny čítajú iba raz za 64 krokov. Konce replikácií
+ * rieši volajúci (posielajú sa vždy).
+ *
+ * @param job Popis behu.
+ * @param step Číslo kroku (1-based).
+ * @param pacer Časovač krokov shardu.
+ * @return 1 ak sa má stav poslať, inak 0.
+ */
+static int sample_due(sim_job_t* job, uint32_t step, const pacer_t* pacer) {
+    if (job->decimate > 1 && step % job->decimate != 0) return 0;
+    if (job->max_fps == 0) return 1;
+    if (pacer->mode == PACE_UNPACED && (step & 63u) != 0) return 0;
+
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    long long now = (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    long long next = atomic_load_explicit(&job->frame_next, memory_order_relaxed);
+    if (now < next) return 0;
+
+    long long period = 1000000000LL / job->max_fps;
+    return atomic_compare_exchange_strong(&job->frame_next, &next, now + period);
+}
+
+/**
+ * @brief Odošle rozpracovaný rámec MSG_TRAJ (ak nie je prázdny).
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @return 0 pri úspechu, -1 ak emit zlyhal.
+ */
+static int traj_flush_frame(sim_worker_t* w) {
+    uint32_t len = w->frame_len;
+    if (len == 0) return 0;
+    w->frame_len = 0;
+    return w->job->emit(w->job->emit_arg, w->id, MSG_TRAJ, w->frame, len);
+}
+
+/**
+ * @brief Uzavrie rozpracovaný úsek: zakóduje jeho smery do rámca.
+ *
+ * Ak by sa úsek s najhorším možným kódovaním do rámca nezmestil, rámec
+ * sa najprv odošle.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @return 0 pri úspechu, -1 ak emit zlyhal.
+ */
+static int traj_close_seg(sim_worker_t* w) {
+    if (w->seg.count == 0) return 0;
+
+    if (w->frame_len + sizeof(w->seg) + TRAJ_SEG_BYTES_MAX > TRAJ_FRAME_MAX) {
+        if (traj_flush_frame(w) != 0) return -1;
+    }
+
+    uint8_t* data = w->frame + w->frame_len + sizeof(w->seg);
+    uint8_t codec;
+    uint32_t n = traj_encode(w->seg_dirs, w->seg.count, w->job->prob_q, data, &codec);
+    w->seg.codec = codec;
+    w->seg.nbytes = (uint16_t)n;
+    memcpy(w->frame + w->frame_len, &w->seg, sizeof(w->seg));
+    w->frame_len += (uint32_t)sizeof(w->seg) + n;
+    w->seg.count = 0;
+    return 0;
+}
+
+/**
+ * @brief Pridá krok do trajektórie (STREAM_TRAJ).
+ *
+ * Úsek sa uzavrie na konci replikácie alebo po TRAJ_SEG_STEPS krokoch; rámec
+ * sa odošle, keď je plný alebo mu vyprší čas (vtedy sa uzavrie aj
+ * rozpracovaný úsek a ďalší začne novým kľúčovým snímkom).
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @param rep Replikácia (0-based).
+ * @param step Číslo kroku (1-based).
+ * @param px x-ová pozícia pred krokom.
+ * @param py y-ová pozícia pred krokom.
+ * @param last 1 ak krok ukončil replikáciu.
+ * @param pacer Časovač krokov shardu.
+ * @return 0 pri úspechu, -1 ak emit zlyhal.
+ */
+static int traj_push(sim_worker_t* w, uint32_t rep, uint32_t step, int32_t px, int32_t py,
+                     int last, const pacer_t* pacer) {
+    if (w->seg.count == 0) {
+        if (w->frame_len == 0) flush_arm(w);
+        w->seg.rep = rep + 1;
+        w->seg.step_first = step;
+        w->seg.x = px;
+        w->seg.y = py;
+        w->seg.flags = 0;
+    }
+    w->seg_dirs[w->seg.count++] = w->dir;
+
+    if (last) w->seg.flags = TRAJ_SEG_LAST;
+    if (last || w->seg.count == TRAJ_SEG_STEPS) {
+        if (traj_close_seg(w) != 0) return -1;
+    }
+
+    if (flush_due(w, pacer, step)) {
+        if (traj_close_seg(w) != 0) return -1;
+        return traj_flush_frame(w);
+    }
+    return 0;
+}
+
+/**
+ * @brief Uzavrie rozpracovaný úsek zápisu: zakóduje ho do rec_buf.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @return 0 pri úspechu, -1 pri chybe alokácie.
+ */
+static int rec_close_seg(sim_worker_t* w) {
+    if (w->rec_seg.count == 0) return 0;
+
+    uint32_t need = w->rec_len + (uint32_t)sizeof(w->rec_seg) + TRAJ_SEG_BYTES_MAX;
+    if (need > w->rec_cap) {
+        uint32_t cap = w->rec_cap ? w->rec_cap : 16384u;
+        while (cap < need) cap *= 2u;
+        uint8_t* buf = realloc(w->rec_buf, cap);
+        if (!buf) {
+            w->rec_seg.count = 0;
+            return -1;
+        }
+        w->rec_buf = buf;
+        w->rec_cap = cap;
+    }
+
+    uint8_t* data = w->rec_buf + w->rec_len + sizeof(w->rec_seg);
+    uint8_t codec;
+    uint32_t n = traj_encode(w->rec_dirs, w->rec_seg.count, w->job->prob_q, data, &codec);
+    w->rec_seg.codec = codec;
+    w->rec_seg.nbytes = (uint16_t)n;
+    memcpy(w->rec_buf + w->rec_len, &w->rec_seg, sizeof(w->rec_seg));
+    w->rec_len += (uint32_t)sizeof(w->rec_seg) + n;
+    w->rec_seg.count = 0;
+    return 0;
+}
+
+/**
+ * @brief Pridá krok do zápisu trajektórie (job->record).
+ *
+ * Na rozdiel od živého prenosu sa úseky uzatvárajú iba po TRAJ_SEG_STEPS
+ * krokoch a celá replikácia sa zapíše naraz, keď skončí.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @param rep Replikácia (0-based).
+ * @param step Číslo kroku (1-based).
+ * @param px x-ová pozícia pred krokom.
+ * @param py y-ová pozícia pred krokom.
+ * @param last 1 ak krok ukončil replikáciu.
+ */
+static void rec_push(sim_worker_t* w, uint32_t rep, uint32_t step, int32_t px, int32_t py, int last) {
+    if (step == 1) {
+        w->rec_seg.count = 0;
+        w->rec_len = 0;
+        w->rec_failed = 0;
+    }
+    if (w->rec_seg.count == 0) {
+        w->rec_seg.rep = rep + 1;
+        w->rec_seg.step_first = step;
+        w->rec_seg.x = px;
+        w->rec_seg.y = py;
+        w->rec_seg.flags = 0;
+    }
+    w->rec_dirs[w->rec_seg.count++] = w->dir;
+
+    if (last) w->rec_seg.flags = TRAJ_SEG_LAST;
+    if (last || w->rec_seg.count == TRAJ_SEG_STEPS) {
+        if (rec_close_seg(w) != 0) w->rec_failed = 1;
+    }
+    if (!last || w->rec_failed) return;
+
+    trajfile_rep_t r;
+    memset(&r, 0, sizeof(r));
+    r.rep = rep + 1;
+    r.steps = step;
+    r.x0 = w->job->width / 2;
+    r.y0 = w->job->height / 2;
+    r.outcome = w->absorbed ? (uint8_t)TRAJFILE_ABSORBED
+              : (w->x == 0 && w->y == 0) ? (uint8_t)TRAJFILE_HIT : (uint8_t)TRAJFILE_TIMEOUT;
+    r.bytes = w->rec_len;
+    (void)trajfile_append(w->job->record, &r, w->rec_buf, w->rec_len);
+}
+
+void sim_dir_table_build(sim_dir_table_t* t, const uint32_t q[4]) {
+    const uint32_t cap = PROB_ONE / 4u; /* kapacita jedného stĺpca */
+    uint32_t a[4];
+    int small[4], large[4];
+    int ns = 0, nl = 0;
+
+    for (int i = 0; i < 4; i++) {
+        a[i] = q[i];
+        t->thresh[i] = cap;
+        t->alias[i] = (uint32_t)i;
+        if (a[i] < cap) small[ns++] = i;
+        else large[nl++] = i;
+    }
+
+    /* Vose: menší stĺpec doplní väčší smer; všetko v celých číslach, takže
+     * po skončení majú zvyšné stĺpce presne kapacitu cap */
+    while (ns > 0 && nl > 0) {
+        int l = small[--ns];
+        int g = large[--nl];
+        t->thresh[l] = a[l];
+        t->alias[l] = (uint32_t)g;
+        a[g] -= cap - a[l];
+        if (a[g] < cap) small[ns++] = g;
+        else large[nl++] = g;
+    }
+}
+
+/**
+ * @brief Vykoná jeden krok náhodnej prechádzky podľa konfigurovaných pravdepodobností.
+ *
+ * Spoločné telo pre všetky režimy okraja; mode je v každom vygenerovanom
+ * variante konštanta, takže sa pri kroku nevetví podľa režimu.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @param mode Režim okraja (boundary_mode_t).
+ * @return 1 ak chodec opustil svet (BOUND_ABSORB), inak 0.
+ */
+static inline __attribute__((always_inline)) int step_body(sim_worker_t* w, int mode) {
+    const sim_job_t* job = w->job;
+    int d = sim_pick_dir(&job->dirs, rng_next_u16(&w->rng));
+    w->dir = (uint8_t)d;
+    return sim_move(&w->x, &w->y, d, job->width, job->height, mode);
+}
+
+/** Vygeneruje krokovú funkciu step_<name> pre jeden režim okraja. */
+#define SIM_STEP_VARIANT(name, mode) \
+    static int step_##name(sim_worker_t* w) { return step_body(w, mode); }
+
+SIM_STEP_VARIANT(torus, BOUND_TORUS)
+SIM_STEP_VARIANT(reflect, BOUND_REFLECT)
+SIM_STEP_VARIANT(absorb, BOUND_ABSORB)
+
+/**
+ * @brief Vyberie krokovú funkciu pre režim okraja (raz pri štarte behu).
+ *
+ * @param mode Režim okraja (boundary_mode_t).
+ * @return Ukazovateľ na krokovú funkciu.
+ */
+static sim_step_fn step_select(uint8_t mode) {
+    switch (mode) {
+        case BOUND_REFLECT: return step_reflect;
+        case BOUND_ABSORB:  return step_absorb;
+        default:            return step_torus;
+    }
+}
+
+/**
+ * @brief Zistí, či už uplynul časový úsek úlohy.
+ *
+ * @param end Koniec úseku (CLOCK_MONOTONIC).
+ * @return 1 ak úsek uplynul.
+ */
+static int slice_over(const struct timespec* end) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return timespec_ge(&now, end);
+}
+
+/**
+ * @brief Odloží shard o SIM_BACKOFF_NS, lebo jeho výstup je plný.
+ *
+ * @param wake Výstup: čas pokračovania.
+ * @return POOL_SLEEP.
+ */
+static int shard_backoff(struct timespec* wake) {
+    clock_gettime(CLOCK_MONOTONIC, wake);
+    timespec_add_ns(wake, SIM_BACKOFF_NS);
+    return POOL_SLEEP;
+}
+
+/**
+ * @brief Zistí, či shard môže poslať ďalšie správy bez čakania.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @return 1 ak áno (alebo sa nič neposiela).
+ */
+static int emit_ready(const sim_worker_t* w) {
+    const sim_job_t* job = w->job;
+    return !job->emit || !job->ready || job->ready(job->emit_arg, w->id);
+}
+
+/**
+ * @brief Odsimuluje ďalší kus shardu dávkovým jadrom (beh bez živého výstupu).
+ *
+ * Jadro dostáva úseky po SIM_KERNEL_CHUNK replikácií, medzi nimi sa
+ * kontroluje koniec časového úseku. Jadro počíta do kópie štatistiky,
+ * takže po zastavení obsahuje results iba celé úseky a rep_next je ich koniec.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @param slice_end Koniec časového úseku.
+ * @return POOL_DONE alebo POOL_YIELD.
+ */
+static int shard_kernel(sim_worker_t* w, const struct timespec* slice_end) {
+    sim_job_t* job = w->job;
+    while (w->rep_next < w->rep_end) {
+        if (atomic_load_explicit(&job->stop, memory_order_relaxed)) break;
+
+        uint32_t end = w->rep_end - w->rep_next > SIM_KERNEL_CHUNK ? w->rep_next + SIM_KERNEL_CHUNK : w->rep_end;
+        results_t chunk = w->results;
+        w->kernel(job, w->rep_next, end, &chunk);
+        /* úsek prerušený zastavením sa zahodí celý - pokračovanie z checkpointu ho zopakuje */
+        if (atomic_load_explicit(&job->stop, memory_order_relaxed)) break;
+        w->results = chunk;
+        w->rep_next = end;
+        if (w->rep_next < w->rep_end && slice_over(slice_end)) return POOL_YIELD;
+    }
+    return POOL_DONE;
+}
+
+/**
+ * @brief Odsimuluje ďalší kus shardu po krokoch.
+ *
+ * Každá replikácia začína v strede sveta a končí po k_max krokoch alebo
+ * pri dosiahnutí (0,0). Počas behu sa nezamyká žiadny mutex; zastavenie
+ * sa zisťuje z atomického príznaku job->stop. Úloha sa preruší, keď má
+ * čakať na ďalší krok (časovaný beh), keď je plný jej výstup, alebo po
+ * uplynutí časového úseku; pri ďalšom spustení pokračuje tým istým krokom.
+ *
+ * @param w Ukazovateľ na stav shardu.
+ * @param slice_end Koniec časového úseku.
+ * @param wake Výstup pri POOL_SLEEP.
+ * @return pool_status_t.
+ */
+static int shard_steps(sim_worker_t* w, const struct timespec* slice_end, struct timespec* wake) {
+    sim_job_t* job = w->job;
+
+    if (!w->started) {
+        pacer_init(&w->pacer, job->pacing, job->rate_hz, w->exec->n);
+        w->started = 1;
+    }
+
+    while (w->rep_next < w->rep_end) {
+        uint32_t r = w->rep_next;
+
+        if (!w->in_rep) {
+            if (atomic_load_explicit(&job->stop, memory_order_relaxed)) break;
+
+            /* každá replikácia má vlastný prúd nezávislý od poradia a vlákna */
+            rng_stream_init(&w->rng, job->seed, r, 0);
+
+            /* start pozicia – stred plochy */
+            w->x = job->width / 2;
+            w->y = job->height / 2;
+            w->step = 0;
+            w->absorbed = 0;
+            w->in_rep = 1;
+        }
+
+        while (w->step < job->k_max) {
+            if (atomic_load_explicit(&job->stop, memory_order_relaxed)) break;
+            if (!emit_ready(w)) return shard_backoff(wake);
+
+            int32_t px = w->x, py = w->y;
+            uint32_t step = ++w->step;
+            w->absorbed = w->step_fn(w);
+
+            int last = w->absorbed || (w->x == 0 && w->y == 0) || step == job->k_max;
+            if (job->record) rec_push(w, r, step, px, py, last);
+            if (job->emit && job->stream == STREAM_TRAJ) {
+                if (traj_push(w, r, step, px, py, last, &w->pacer) != 0) {
+                    atomic_store(&job->stop, 1);
+                    break;
+                }
+            } else if (job->emit && (last || sample_due(job, step, &w->pacer))) {
+                msg_state_t st;
+                st.rep = r + 1;
+                st.reps_total = job->reps;
+                st.step = step;
+                st.x = w->x;
+                st.y = w->y;
+                if (batch_push(w, &st, &w->pacer) != 0) {
+                    atomic_store(&job->stop, 1);
+                    break;
+                }
+            }
+
+            /* koniec replikacie: chodec opustil svet alebo dosiahol (0,0) */
+            if (w->absorbed) break;
+            if (w->x == 0 && w->y == 0) break;
+
+            if (pacer_next(&w->pacer, wake)) return POOL_SLEEP;
+            if ((step & 1023u) == 0 && slice_over(slice_end)) return POOL_YIELD;
+        }
+
+        /* zastavená uprostred sa neráta - pokračovanie z checkpointu ju zopakuje celú */
+        if (!w->absorbed && !(w->x == 0 && w->y == 0) && w->step < job->k_max) break;
+
+        /* po replikácii zaznamenaj výsledok (vypršaný limit krokov je neúspech) */
+        int success = (!w->absorbed && w->x == 0 && w->y == 0) ? 1 : 0;
+        results_record_rep(&w->results, w->step, success);
+        w->in_rep = 0;
+        w->rep_next++;
+
+        if (w->rep_next < w->rep_end && slice_over(slice_end)) return POOL_YIELD;
+    }
+
+    /* zvyšok dávky; po zastavení sa už stavy starého behu neposielajú */
+    if (job->emit && !atomic_load_explicit(&job->stop, memory_order_relaxed)) {
+        if (!emit_ready(w)) return shard_backoff(wake);
+        int rc = batch_flush(w);
+        if (rc == 0) rc = traj_close_seg(w);
+        if (rc == 0) rc = traj_flush_frame(w);
+        if (rc != 0) atomic_store(&job->stop, 1);
+    }
+
+    return POOL_DONE;
+}
+
+/**
+ * @brief Rozdelí replikácie [begin, end) na súvislé úseky shardov.
+ *
+ * Prvých ((end - begin) % n) shardov dostane o replikáciu viac; shard
+ * s prázdnym úsekom hneď skončí.
+ *
+ * @param ex Beh.
+ * @param begin Prvá replikácia bloku.
+ * @param end Koniec bloku (bez).
+ */
+static void exec_plan(sim_exec_t* ex, uint32_t begin, uint32_t end) {
+    uint32_t base = (end - begin) / ex->n;
+    uint32_t extra = (end - begin) % ex->n;
+    uint32_t next = begin;
+
+    for (uint32_t i = 0; i < ex->n; i++) {
+        sim_worker_t* w = &ex->workers[i];
+        w->rep_begin = next;
+        w->rep_end = next + base + (i < extra ? 1u : 0u);
+        w->rep_next = w->rep_begin;
+        next = w->rep_end;
+    }
+    ex->planned = end;
+}
+
+/**
+ * @brief Rozhodne o pokračovaní behu s cieľom presnosti po dokončení bloku.
+ *
+ * Ďalší blok sa odhadne z pomeru dosiahnutej a požadovanej polšírky
+ * (polšírka klesá s odmocninou počtu replikácií), najviac sa však počet
+ * replikácií zdvojnásobí a najmenej pribudne SIM_TARGET_BLOCK.
+ *
+ * @param ex Beh (všetky shardy bloku sú hotové).
+ * @return Koniec ďalšieho bloku, alebo 0 ak beh končí.
+ */
+static uint32_t exec_next_block(sim_exec_t* ex) {
+    sim_job_t* job = ex->job;
+    if (job->target == TARGET_NONE || ex->planned >= job->reps) return 0;
+    if (atomic_load_explicit(&job->stop, memory_order_relaxed)) return 0;
+
+    results_t sum;
+    results_reset(&sum);
+    for (uint32_t i = 0; i < ex->n; i++) results_merge(&sum, &ex->workers[i].results);
+    double hw = results_halfwidth(&sum, job->target);
+    if (hw <= job->target_hw) return 0;
+
+    double done = (double)ex->planned;
+    double want = isfinite(hw) ? done * (hw / job->target_hw) * (hw / job->target_hw) : 2.0 * done;
+    if (want > 2.0 * done) want = 2.0 * done;
+    if (want < done + SIM_TARGET_BLOCK) want = done + SIM_TARGET_BLOCK;
+    if (want > (double)job->reps) want = (double)job->reps;
+    return (uint32_t)want;
+}
+
+/**
+ * @brief Odloží stav shardu (úsek, dokončené replikácie, štatistiku) do pub.
+ *
+ * @param w Shard (volajúci drží exec->snap_mtx).
+ */
+static void exec_publish(sim_worker_t* w) {
+    w->pub.rep_begin = w->rep_begin;
+    w->pub.rep_end = w->rep_end;
+    w->pub.rep_next = w->rep_next;
+    w->pub.results = w->results;
+}
+
+/**
+ * @brief Zloží checkpoint z odložených stavov shardov do exec->ckpt.
+ *
+ * @param ex Beh (volajúci drží snap_mtx, alebo už žiadny shard nebeží).
+ */
+static void exec_ckpt_fill(sim_exec_t* ex) {
+    ex->ckpt->n = ex->n;
+    ex->ckpt->planned = ex->planned;
+    for (uint32_t i = 0; i < ex->n; i++) ex->ckpt->shards[i] = ex->workers[i].pub;
+}
+
+/**
+ * @brief Odloží stav shardu a ak je čas, pošle priebežný súhrn alebo zapíše checkpoint.
+ *
+ * Volá sa na konci každého časového úseku shardu, takže súhrn nikdy
+ * nečaká na shard uprostred replikácie - každý shard prispeje tým, čo
+ * mal hotové na konci svojho posledného úseku. Preto ide najviac jeden
+ * súhrn na úsek, aj keď je snap_reps malé.
+ *
+ * Checkpoint sa pod zámkom iba skopíruje do pripraveného bufferu a po
+ * odomknutí sa odovzdá callbacku ckpt; kým ho volaný nevráti
+ * (sim_ckpt_written), ostatné shardy ďalší nezačnú (preskočia ho, nečakajú).
+ *
+ * @param w Shard.
+ */
+static void exec_snapshot(sim_worker_t* w) {
+    sim_exec_t* ex = w->exec;
+    sim_job_t* job = ex->job;
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+
+    pthread_mutex_lock(&ex->snap_mtx);
+    exec_publish(w);
+
+    if (job->snap) {
+        uint64_t done = 0;
+        for (uint32_t i = 0; i < ex->n; i++) {
+            done += (uint64_t)ex->workers[i].pub.results.success_count + ex->workers[i].pub.results.fail_count;
+        }
+        int due = (job->snap_reps > 0 && done >= ex->snap_next_reps) ||
+                  (job->snap_ms > 0 && timespec_ge(&now, &ex->snap_next));
+        if (due) {
+            ex->snap = *ex->out;
+            for (uint32_t i = 0; i < ex->n; i++) results_merge(&ex->snap, &ex->workers[i].pub.results);
+            if (job->snap_reps > 0) ex->snap_next_reps = (done / job->snap_reps + 1u) * job->snap_reps;
+            if (job->snap_ms > 0) {
+                ex->snap_next = now;
+                timespec_add_ns(&ex->snap_next, (long)job->snap_ms * 1000000L);
+            }
+            job->snap(job->snap_arg, &ex->snap);
+        }
+    }
+
+    int ckpt = job->ckpt && !atomic_load(&job->ckpt_busy) && timespec_ge(&now, &ex->ckpt_next);
+    if (ckpt) {
+        exec_ckpt_fill(ex);
+        atomic_store(&job->ckpt_busy, 1);
+        ex->ckpt_next = now;
+        timespec_add_ns(&ex->ckpt_next, (long)job->ckpt_ms * 1000000L);
+    }
+    pthread_mutex_unlock(&ex->snap_mtx);
+
+    if (ckpt) job->ckpt(job->ckpt_arg, ex->ckpt);
+}
+
+/**
+ * @brief Uzavrie beh po poslednom sharde: posledný checkpoint, zlúčenie, done.
+ *
+ * Kým zapisovač drží buffer checkpointu, beh sa odloží o SIM_BACKOFF_NS
+ * (vlákno poolu na disk nečaká). Zastavený beh najprv odovzdá posledný
+ * checkpoint zo skutočného stavu všetkých shardov a skončí až po jeho
+ * zápise, takže done už checkpoint na disku nájde.
+ *
+ * @param ex Beh (všetky shardy skončili).
+ * @param wake Výstup pri POOL_SLEEP.
+ * @return pool_status_t.
+ */
+static int exec_finish(sim_exec_t* ex, struct timespec* wake) {
+    sim_job_t* job = ex->job;
+    if (job->ckpt) {
+        if (atomic_load(&job->ckpt_busy)) return shard_backoff(wake);
+        if (atomic_load(&job->stop) && !ex->ckpt_final) {
+            for (uint32_t i = 0; i < ex->n; i++) exec_publish(&ex->workers[i]);
+            exec_ckpt_fill(ex);
+            ex->ckpt_final = 1;
+            atomic_store(&job->ckpt_busy, 1);
+            job->ckpt(job->ckpt_arg, ex->ckpt);
+            if (atomic_load(&job->ckpt_busy)) return shard_backoff(wake);
+        }
+    }
+
+    for (uint32_t i = 0; i < ex->n; i++) {
+        results_merge(ex->out, &ex->workers[i].results);
+        free(ex->workers[i].rec_buf);
+    }
+    job->reps_done = ex->out->success_count + ex->out->fail_count;
+    if (job->target != TARGET_NONE) ex->out->reps_total = job->reps_done;
+    sim_done_fn done = ex->done;
+    void* done_arg = ex->done_arg;
+    pthread_mutex_destroy(&ex->snap_mtx);
+    free(ex->ckpt);
+    free(ex->workers);
+    free(ex);
+    done(done_arg);
+    return POOL_DONE;
+}
+
+/**
+ * @brief Úloha poolu pre jeden shard.
+ *
+ * Po dokončení posledného shardu behu sa výsledky zlúčia v poradí shardov
+ * (nezávisle od toho, ktoré vlákno čo počítalo) a zavolá sa done zo sim_submit().
+ * Pri behu s cieľom presnosti to platí až po poslednom bloku; dovtedy
+ * posledný shard bloku rozdelí ďalší blok a zaradí ostatné shardy.
+ * Úloha posledného shardu potom beh uzatvára (exec_finish), aj keď musí
+ * počkať na zápis checkpointu.
+ *
+ * @param arg Ukazovateľ na sim_worker_t.
+ * @param wake Výstup pri POOL_SLEEP.
+ * @return pool_status_t.
+ */
+static int shard_task(void* arg, struct timespec* wake) {
+    sim_worker_t* w = (sim_worker_t*)arg;
+    if (w->exec->finishing) return exec_finish(w->exec, wake);
+
+    struct timespec slice_end;
+    clock_gettime(CLOCK_MONOTONIC, &slice_end);
+    timespec_add_ns(&slice_end, SIM_SLICE_NS);
+
+    int rc = w->kernel ? shard_kernel(w, &slice_end) : shard_steps(w, &slice_end, wake);
+    sim_exec_t* ex = w->exec;
+    if (ex->job->snap || ex->job->ckpt) exec_snapshot(w);
+    if (rc != POOL_DONE) return rc;
+
+    /* posledný shard uzavrie blok; ostatné sa už shardov nedotknú */
+    if (atomic_fetch_sub(&ex->left, 1) == 1) {
+        uint32_t next = exec_next_block(ex);
+        if (next > 0) {
+            /* nový blok sa odloží naraz, aby checkpoint nikdy nemiešal dva bloky */
+            pthread_mutex_lock(&ex->snap_mtx);
+            exec_plan(ex, ex->planned, next);
+            for (uint32_t i = 0; i < ex->n; i++) exec_publish(&ex->workers[i]);
+            pthread_mutex_unlock(&ex->snap_mtx);
+            atomic_store(&ex->left, ex->n);
+            for (uint32_t i = 0; i < ex->n; i++) {
+                if (&ex->workers[i] == w) continue;
+                if (pool_submit(ex->pool, shard_task, &ex->workers[i]) != 0) {
+                    /* tento shard sa nespustí - beh sa zastaví a on sa ráta ako hotový */
+                    atomic_store(&ex->job->stop, 1);
+                    atomic_fetch_sub(&ex->left, 1);
+                }
+            }
+            return POOL_YIELD;
+        }
+
+        ex->finishing = 1;
+        return exec_finish(ex, wake);
+    }
+    return POOL_DONE;
+}
+
+void sim_ckpt_written(sim_job_t* job) {
+    atomic_store(&job->ckpt_busy, 0);
+}
+
+uint32_t sim_resolve_threads(uint32_t requested, uint32_t reps) {
+    uint32_t n = requested;
+    if (n == 0) {
+        long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n = (cpus > 0) ? (uint32_t)cpus : 1u;
+    }
+    if (n > SIM_MAX_THREADS) n = SIM_MAX_THREADS;
+    if (reps > 0 && n > reps) n = reps;
+    if (n == 0) n = 1;
+    return n;
+}
+
+uint32_t sim_job_shards(const sim_job_t* job) {
+    if (job->resume) return job->resume->n;
+    if (job->pacing != PACE_UNPACED) return 1u;
+    return sim_resolve_threads(job->threads, job->reps);
+}
+
+int sim_submit(pool_t* pool, sim_job_t* job, results_t* out, sim_done_fn done, void* done_arg) {
+    const sim_checkpoint_t* resume = job->resume;
+    uint32_t n = sim_job_shards(job);
+
+    sim_dir_table_build(&job->dirs, job->prob_q);
+
+    atomic_init(&job->frame_next, 0);
+    atomic_init(&job->ckpt_busy, 0);
+    if (job->batch_max == 0) job->batch_max = 1;
+    if (job->batch_max > STATE_BATCH_MAX) job->batch_max = STATE_BATCH_MAX;
+
+    sim_step_fn step_fn = step_select(job->boundary);
+    sim_kernel_fn kernel = NULL;
+    if (!job->emit && !job->record && job->pacing == PACE_UNPACED) {
+        const char* kname = NULL;
+        kernel = kernel_select(job->boundary, &kname);
+        if (!job->quiet) printf("[server] batch kernel: %s\n", kname);
+    }
+
+    sim_exec_t* ex = calloc(1, sizeof(*ex));
+    sim_worker_t* workers = calloc(n, sizeof(*workers));
+    sim_checkpoint_t* ckpt = job->ckpt ? malloc(SIM_CHECKPOINT_BYTES(n)) : NULL;
+    if (!ex || !workers || (job->ckpt && !ckpt)) {
+        free(ex);
+        free(workers);
+        free(ckpt);
+        return -1;
+    }
+    ex->job = job;
+    ex->out = out;
+    ex->pool = pool;
+    ex->workers = workers;
+    ex->n = n;
+    ex->done = done;
+    ex->done_arg = done_arg;
+    atomic_init(&ex->left, n);
+    pthread_mutex_init(&ex->snap_mtx, NULL);
+    ex->snap_next_reps = job->snap_reps;
+    clock_gettime(CLOCK_MONOTONIC, &ex->snap_next);
+    timespec_add_ns(&ex->snap_next, (long)job->snap_ms * 1000000L);
+    ex->ckpt = ckpt;
+    clock_gettime(CLOCK_MONOTONIC, &ex->ckpt_next);
+    timespec_add_ns(&ex->ckpt_next, (long)job->ckpt_ms * 1000000L);
+
+    for (uint32_t i = 0; i < n; i++) {
+        sim_worker_t* w = &workers[i];
+        w->job = job;
+        w->exec = ex;
+        w->id = i;
+        w->kernel = kernel;
+        w->step_fn = step_fn;
+        results_reset(&w->results);
+    }
+
+    if (resume) {
+        /* shardy pokračujú presne tam, kde checkpoint skončil */
+        for (uint32_t i = 0; i < n; i++) {
+            sim_worker_t* w = &workers[i];
+            w->rep_begin = resume->shards[i].rep_begin;
+            w->rep_end = resume->shards[i].rep_end;
+            w->rep_next = resume->shards[i].rep_next;
+            w->results = resume->shards[i].results;
+        }
+        ex->planned = resume->planned;
+    } else {
+        /* bez cieľa jeden blok cez všetky replikácie, s cieľom najprv malý blok */
+        uint32_t first = job->reps;
+        if (job->target != TARGET_NONE && first > SIM_TARGET_BLOCK) first = SIM_TARGET_BLOCK;
+        exec_plan(ex, 0, first);
+    }
+    for (uint32_t i = 0; i < n; i++) exec_publish(&workers[i]);
+
+    /* od prvého zaradenia beh uzavrie posledný shard; shard, ktorý sa
+     * nepodarilo zaradiť, sa dokončí hneď (job->stop ho nechá prázdny) */
+    for (uint32_t i = 0; i < n; i++) {
+        if (pool_submit(pool, shard_task, &workers[i]) != 0) {
+            fprintf(stderr, "[server] failed to queue simulation shard\n");
+            atomic_store(&job->stop, 1);
+            for (uint32_t j = i; j < n; j++) {
+                struct timespec unused;
+                (void)shard_task(&workers[j], &unused);
+            }
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,285 @@
+/**
+ * @file simulation.h
+ * @brief Simulačné jadro náhodnej prechádzky s paralelnými replikáciami.
+ *
+ * Replikácie jedného behu sa rozdelia na súvislé úseky (shardy). Každý shard
+ * je úloha v spoločnom poole vlákien servera (pool.h) s vlastným stavom chodca
+ * a vlastným results_t, takže počas behu sa nič nezamyká; shardy sa na konci
+ * zlúčia cez results_merge(). Iba pri priebežných súhrnoch (sim_job_t.snap)
+ * a checkpointoch (sim_job_t.ckpt) shard na konci každého časového úseku
+ * krátko zamkne beh a odloží kópiu svojej štatistiky. Shardy sa po krátkych
+ * časových úsekoch striedajú s úlohami ostatných behov, takže súbežné behy
+ * rôznych klientov postupujú rovnomerne.
+ */
+
+#pragma once
+#include "pool.h"
+#include "protocol.h"
+#include "results.h"
+#include "trajfile.h"
+#include "walk.h"
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdint.h>
+#include <time.h>
+
+/** Horná hranica počtu shardov (súbežných úloh) na jeden beh. */
+#define SIM_MAX_THREADS 256
+
+/** Dĺžka časového úseku shardu, po ktorom prenechá vlákno ďalšej úlohe (ns). */
+#define SIM_SLICE_NS 5000000L
+
+/** Počet replikácií, ktoré dostane dávkové jadro naraz (násobok KERNEL_LANES). */
+#define SIM_KERNEL_CHUNK 256u
+
+/** Pauza medzi krokmi živého dema (PACE_LIVE, 10 krokov/s) v ns. */
+#define SIM_LIVE_PERIOD_NS 100000000L
+
+/** Pauza časovaného behu, od ktorej shard uvoľní vlákno namiesto spánku (ns). */
+#define SIM_PACE_YIELD_NS 1000000L
+
+/** Odklad shardu, ktorého výstup je plný (ns). */
+#define SIM_BACKOFF_NS 200000L
+
+/** Verzia výpočtu: zvýšiť pri každej zmene, po ktorej rovnaké parametre a seed
+ *  dajú iný výsledok (RNG, jadrá, okraje) - inak by cache vracala staré výsledky. */
+#define SIM_ENGINE_VERSION 1u
+
+/** Prvý blok replikácií behu s cieľom presnosti; ďalšie sa plánujú podľa odhadu. */
+#define SIM_TARGET_BLOCK 1024u
+
+/**
+ * @brief Alias tabuľka pre výber smeru (Walker/Vose) nad 4 smermi.
+ *
+ * Zostaví sa raz pri START z pravdepodobností v jednotkách 1/PROB_ONE.
+ * Krok potom spotrebuje 16 náhodných bitov: dolné 2 bity vyberú stĺpec,
+ * horných 14 bitov sa porovná s prahom stĺpca. Výber je presný (žiadne
+ * modulo), bez vetvenia podľa pravdepodobností a stojí jedno čítanie z tabuľky.
+ */
+typedef struct {
+    uint32_t thresh[4];      /**< Prah stĺpca v jednotkách 1/(PROB_ONE/4); pod prahom = stĺpec */
+    uint32_t alias[4];       /**< Smer, ktorý sa použije nad prahom */
+} sim_dir_table_t;
+
+/**
+ * @brief Vyberie smer kroku z alias tabuľky.
+ *
+ * @param t Alias tabuľka smerov.
+ * @param r16 16 náhodných bitov (jeden krok z rng_next_u16()).
+ * @return 0=UP, 1=DOWN, 2=LEFT, 3=RIGHT
+ */
+static inline int sim_pick_dir(const sim_dir_table_t* t, uint32_t r16) {
+    uint32_t col = r16 & 3u;
+    uint32_t u = r16 >> 2;   // 0..16383
+    return (int)((u < t->thresh[col]) ? col : t->alias[col]);
+}
+
+/**
+ * @brief Callback pre odoslanie správy s priebehom behu (živé zobrazenie).
+ *
+ * Volá sa z vlákna poolu; volania s rôznym worker môžu prebiehať
+ * súbežne, s rovnakým worker nikdy. Simulácia správu celú pripraví
+ * (MSG_STATE, MSG_STATE_BATCH alebo MSG_TRAJ), callback ju iba odošle
+ * (alebo zaradí na odoslanie) ako jeden celok.
+ *
+ * @param arg Používateľský argument (sim_job_t.emit_arg).
+ * @param worker Index volajúceho shardu (0..sim_resolve_threads()-1).
+ * @param type Typ správy.
+ * @param payload Payload správy.
+ * @param len Dĺžka payloadu v bajtoch.
+ * @return 0 pri úspechu, -1 ak sa má beh zastaviť (napr. klient odpadol).
+ */
+typedef int (*sim_emit_fn)(void* arg, uint32_t worker, msg_type_t type, const void* payload, uint32_t len);
+
+/**
+ * @brief Callback, ktorý zistí, či emit shardu worker prijme ďalšie správy bez čakania.
+ *
+ * Shard sa pred krokom opýta a ak nie, odloží sa o SIM_BACKOFF_NS - vlákno
+ * poolu tak nečaká na pomalého klienta, kým môže počítať iné behy.
+ * Pri jednom kroku treba miesto aspoň na 2 správy.
+ *
+ * @param arg Používateľský argument (sim_job_t.emit_arg).
+ * @param worker Index shardu.
+ * @return 1 ak je miesto, 0 ak treba počkať.
+ */
+typedef int (*sim_ready_fn)(void* arg, uint32_t worker);
+
+/**
+ * @brief Callback pre priebežný súhrn behu (sim_job_t.snap).
+ *
+ * Volá ho vlákno poolu pod zámkom súhrnov behu, takže súhrny idú v poradí
+ * a nikdy nie po done. Callback nesmie čakať (napr. na socket klienta) -
+ * kým beží, stoja všetky shardy behu; súhrn si má iba skopírovať a zaradiť.
+ *
+ * @param arg Používateľský argument (sim_job_t.snap_arg).
+ * @param partial Zlúčená štatistika dokončených replikácií všetkých shardov
+ *        (reps_total je plánovaný počet, dokončené sú success_count + fail_count).
+ */
+typedef void (*sim_snap_fn)(void* arg, const results_t* partial);
+
+/**
+ * @brief Stav jedného shardu v checkpointe.
+ *
+ * Rozpracovaná replikácia sa neukladá - pri pokračovaní sa zopakuje od
+ * začiatku. Keďže každá replikácia má vlastný náhodný prúd daný seedom
+ * a svojím indexom, stav generátora netreba ukladať: stačí rep_next.
+ */
+typedef struct {
+    uint32_t rep_begin;      /**< Prvá replikácia shardu v aktuálnom bloku */
+    uint32_t rep_end;        /**< Koniec shardu v aktuálnom bloku (bez) */
+    uint32_t rep_next;       /**< Prvá nedokončená replikácia shardu */
+    uint32_t reserved;       /**< Nuly */
+    results_t results;       /**< Štatistika replikácií shardu pred rep_next */
+} sim_shard_state_t;
+
+/**
+ * @brief Checkpoint behu Monte Carlo: stav všetkých shardov naraz.
+ *
+ * Zo checkpointu sa beh dá dopočítať s rovnakým výsledkom (bit po bite),
+ * ako keby sa nikdy neprerušil - shardy pokračujú tými istými replikáciami
+ * a zlúčia sa v rovnakom poradí.
+ */
+typedef struct {
+    uint32_t n;              /**< Počet shardov */
+    uint32_t planned;        /**< Koniec aktuálneho bloku replikácií */
+    sim_shard_state_t shards[]; /**< Shardy 0..n-1 */
+} sim_checkpoint_t;
+
+/** Veľkosť checkpointu s n shardmi v bajtoch. */
+#define SIM_CHECKPOINT_BYTES(n) (sizeof(sim_checkpoint_t) + (size_t)(n) * sizeof(sim_shard_state_t))
+
+/**
+ * @brief Callback pre checkpoint behu (sim_job_t.ckpt).
+ *
+ * Volá ho vlákno poolu mimo zámkov behu, najviac jedno naraz; ostatné shardy
+ * medzitým pokračujú. Callback nemá zapisovať sám - checkpoint patrí simulácii,
+ * ale platí, kým ho volaný nevráti cez sim_ckpt_written() (aj z iného vlákna).
+ * Dovtedy sa ďalší checkpoint nezačne a beh neskončí.
+ *
+ * @param arg Používateľský argument (sim_job_t.ckpt_arg).
+ * @param ck Konzistentný stav behu.
+ */
+typedef void (*sim_ckpt_fn)(void* arg, const sim_checkpoint_t* ck);
+
+/**
+ * @brief Callback po dokončení celého behu (volá ho vlákno poolu).
+ *
+ * @param arg Argument zo sim_submit().
+ */
+typedef void (*sim_done_fn)(void* arg);
+
+/**
+ * @brief Popis jedného behu simulácie (parametre + riadenie).
+ *
+ * Parametre sa počas behu nemenia. Príznak stop môže nastaviť ľubovoľné
+ * vlákno - shardy ho kontrolujú po každom kroku.
+ */
+typedef struct {
+    int32_t width, height;   /**< Rozmery sveta */
+    uint32_t k_max;          /**< Maximálny počet krokov v replikácii */
+    uint32_t reps;           /**< Celkový počet replikácií */
+    uint32_t seed;           /**< Seed generátora (už rozhodnutý, nie 0=čas) */
+    uint32_t prob_q[4];      /**< Pravdepodobnosti UP, DOWN, LEFT, RIGHT v 1/PROB_ONE */
+    sim_dir_table_t dirs;    /**< Alias tabuľka (zostaví ju sim_submit z prob_q) */
+    uint8_t pacing;          /**< Režim časovania krokov (pace_mode_t) */
+    uint32_t rate_hz;        /**< Frekvencia krokov pre PACE_FIXED_HZ */
+    uint32_t threads;        /**< Počet shardov (0 = podľa počtu jadier) */
+    uint8_t boundary;        /**< Správanie na okraji sveta (boundary_mode_t) */
+    uint8_t method;          /**< Spôsob výpočtu (method_t) */
+    uint8_t stream;          /**< Čo posielať cez emit (stream_mode_t) */
+    uint8_t target;          /**< Cieľ presnosti (target_metric_t); TARGET_NONE = presne reps */
+    double target_hw;        /**< Požadovaná polšírka 95 % intervalu (pri target) */
+    uint32_t reps_done;      /**< Výstup: počet dokončených replikácií (platí pri done) */
+    uint8_t quiet;           /**< 1 = nevypisovať zvolené jadro (body prechodu MSG_SWEEP) */
+
+    atomic_int stop;         /**< 1 = predčasne ukončiť beh */
+
+    sim_emit_fn emit;        /**< Callback pre priebeh behu (NULL = neposielať) */
+    sim_ready_fn ready;      /**< Spätný tlak emit (NULL = emit nikdy nečaká) */
+    void* emit_arg;          /**< Argument pre emit a ready */
+    uint32_t batch_max;      /**< Najviac stavov v jednej MSG_STATE_BATCH (1 = MSG_STATE) */
+    uint32_t flush_ms;       /**< Najdlhšie zdržanie neúplnej dávky/rámca v ms (0 = len plné) */
+    uint32_t max_fps;        /**< Najviac stavov za sekundu zo všetkých shardov (0 = bez obmedzenia) */
+    uint32_t decimate;       /**< Posielať stav iba v každom decimate-tom kroku (0, 1 = každý) */
+    atomic_llong frame_next; /**< Najskorší čas ďalšieho stavu pri max_fps (ns, CLOCK_MONOTONIC) */
+
+    sim_snap_fn snap;        /**< Callback pre priebežné súhrny (NULL = žiadne) */
+    void* snap_arg;          /**< Argument pre snap */
+    uint32_t snap_reps;      /**< Súhrn vždy po ďalších snap_reps dokončených replikáciách (0 = nie) */
+    uint32_t snap_ms;        /**< Súhrn najneskôr po snap_ms ms (0 = nie) */
+
+    trajfile_t* record;      /**< Súbor, do ktorého sa zapíše trajektória každej replikácie (NULL = nezapisovať) */
+
+    sim_ckpt_fn ckpt;        /**< Callback pre checkpointy (NULL = žiadne) */
+    void* ckpt_arg;          /**< Argument pre ckpt */
+    uint32_t ckpt_ms;        /**< Checkpoint najviac raz za ckpt_ms ms (a vždy pri zastavení) */
+    atomic_int ckpt_busy;    /**< 1 od volania ckpt po sim_ckpt_written() */
+    const sim_checkpoint_t* resume; /**< Checkpoint, od ktorého beh pokračuje (NULL = od začiatku) */
+} sim_job_t;
+
+/**
+ * @brief Zostaví alias tabuľku smerov z pravdepodobností.
+ *
+ * @param t Výstupná tabuľka.
+ * @param q Pravdepodobnosti UP, DOWN, LEFT, RIGHT v 1/PROB_ONE (súčet = PROB_ONE).
+ */
+void sim_dir_table_build(sim_dir_table_t* t, const uint32_t q[4]);
+
+/**
+ * @brief Vráti simulácii checkpoint odovzdaný callbacku ckpt (zápis skončil).
+ *
+ * @param job Beh, ktorého checkpoint sa zapísal.
+ */
+void sim_ckpt_written(sim_job_t* job);
+
+/**
+ * @brief Zistí skutočný počet shardov pre beh.
+ *
+ * Koľko z nich naozaj beží naraz, určuje veľkosť poolu servera.
+ *
+ * @param requested Požadovaný počet (0 = počet online jadier).
+ * @param reps Počet replikácií (viac shardov než replikácií nemá zmysel).
+ * @return Počet shardov v rozsahu [1, SIM_MAX_THREADS].
+ */
+uint32_t sim_resolve_threads(uint32_t requested, uint32_t reps);
+
+/**
+ * @brief Počet shardov, na ktoré sim_submit() rozdelí beh job.
+ *
+ * Časovaný beh (pacing iný než PACE_UNPACED) má vždy jeden shard: tempo
+ * (živé demo 10 krokov/s, rate_hz pri PACE_FIXED_HZ) platí pre celý beh,
+ * nie pre každý shard, a klient sleduje jedného chodca. Pri pokračovaní
+ * z checkpointu (job->resume) je to počet shardov checkpointu - vtedy sa
+ * perióda časovaného behu predĺži tak, aby tempo celého behu ostalo rovnaké.
+ *
+ * @param job Popis behu.
+ * @return Počet shardov v rozsahu [1, SIM_MAX_THREADS].
+ */
+uint32_t sim_job_shards(const sim_job_t* job);
+
+/**
+ * @brief Zaradí všetky replikácie behu do poolu a hneď sa vráti.
+ *
+ * Po dokončení všetkých shardov sa ich výsledky pripočítajú do out (volajúci
+ * ho má mať pripravený cez results_reset + results_set_params) a vlákno
+ * poolu zavolá done(done_arg). Po zastavení cez job->stop sa done zavolá tiež.
+ * job a out musia platiť až do volania done.
+ *
+ * S cieľom presnosti (job->target) sa replikácie počítajú po blokoch
+ * 0..b1, b1..b2, ... (každý blok sa rozdelí medzi shardy). Po bloku sa
+ * zo zlúčených výsledkov skontroluje interval; beh skončí, keď je dosť úzky
+ * alebo keď sa minie reps. Hranice blokov závisia iba od výsledkov, takže
+ * výsledok je rovnaký ako pri behu s reps = job->reps_done bez cieľa.
+ *
+ * S job->resume beh pokračuje z checkpointu (s jeho počtom shardov, job->threads
+ * sa ignoruje); resume stačí platiť počas volania.
+ *
+ * @param pool Pool vlákien servera.
+ * @param job Popis behu.
+ * @param out Výstupná štatistika, do ktorej sa zlúčia shardy.
+ * @param done Callback po dokončení.
+ * @param done_arg Argument pre done.
+ * @return 0 ak je beh zaradený (done sa zavolá), -1 pri chybe alokácie (done sa nezavolá).
+ */
+int sim_submit(pool_t* pool, sim_job_t* job, results_t* out, sim_done_fn done, void* done_arg);
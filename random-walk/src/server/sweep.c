@@ -0,0 +1,150 @@
+/**
+ * @file sweep.c
+ * @brief Implementácia rozvinutia mriežky MSG_SWEEP.
+ */
+
+#include "sweep.h"
+#include "rng.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+/** Mená osí (len na výpis chýb). */
+static const char* const AXIS_NAMES[SWEEP_AXES] = { "width", "height", "k_max", "p_up", "p_down", "p_left" };
+
+/**
+ * @brief Hodnoty jednej osi (zoznam alebo rozsah).
+ *
+ * @param a Os z požiadavky.
+ * @param vals Výstup (kapacita SWEEP_AXIS_MAX).
+ * @param n Výstupný počet hodnôt.
+ * @return 0 pri úspechu, -1 pri neplatnej osi.
+ */
+static int axis_values(const msg_sweep_axis_t* a, uint32_t* vals, uint32_t* n) {
+    if (a->count > 0) {
+        if (a->count > SWEEP_LIST_MAX) return -1;
+        for (uint32_t i = 0; i < a->count; i++) vals[i] = a->list[i];
+        *n = a->count;
+        return 0;
+    }
+    uint32_t first = a->first;
+    uint32_t last = a->last;
+    uint32_t step = a->step;
+    if (step == 0) {
+        vals[0] = first;
+        *n = 1;
+        return 0;
+    }
+    if (last < first || (last - first) / step >= SWEEP_AXIS_MAX) return -1;
+    uint32_t count = (last - first) / step + 1u;
+    for (uint32_t i = 0; i < count; i++) vals[i] = first + i * step;
+    *n = count;
+    return 0;
+}
+
+/**
+ * @brief Overí rozsah hodnoty osi.
+ *
+ * @param axis Os (sweep_axis_t).
+ * @param v Hodnota.
+ * @return 1 ak je hodnota prípustná, inak 0.
+ */
+static int axis_value_ok(uint32_t axis, uint32_t v) {
+    switch (axis) {
+        case SWEEP_WIDTH:
+        case SWEEP_HEIGHT: return v >= 2u && v <= (uint32_t)INT32_MAX;
+        case SWEEP_K_MAX:  return v >= 1u;
+        default:           return v <= 100u;
+    }
+}
+
+int sweep_expand(const msg_sweep_t* req, sweep_point_t** out, uint32_t* total) {
+    uint32_t n[SWEEP_AXES];
+    uint32_t (*v)[SWEEP_AXIS_MAX] = malloc(sizeof(uint32_t) * SWEEP_AXES * SWEEP_AXIS_MAX);
+    if (!v) {
+        fprintf(stderr, "[server] out of memory, SWEEP ignored\n");
+        return -1;
+    }
+
+    for (uint32_t a = 0; a < SWEEP_AXES; a++) {
+        msg_sweep_axis_t axis = req->axis[a];
+        if (axis_values(&axis, v[a], &n[a]) != 0) {
+            printf("[server] invalid SWEEP axis %s\n", AXIS_NAMES[a]);
+            free(v);
+            return -1;
+        }
+        for (uint32_t i = 0; i < n[a]; i++) {
+            if (!axis_value_ok(a, v[a][i])) {
+                printf("[server] invalid SWEEP %s=%u\n", AXIS_NAMES[a], (unsigned)v[a][i]);
+                free(v);
+                return -1;
+            }
+        }
+    }
+
+    /* percentá so súčtom nad 100 sa vynechajú, preto sa kombinácie najprv spočítajú */
+    uint64_t pcts = 0;
+    for (uint32_t u = 0; u < n[SWEEP_P_UP]; u++) {
+        for (uint32_t d = 0; d < n[SWEEP_P_DOWN]; d++) {
+            for (uint32_t l = 0; l < n[SWEEP_P_LEFT]; l++) {
+                if (v[SWEEP_P_UP][u] + v[SWEEP_P_DOWN][d] + v[SWEEP_P_LEFT][l] <= 100u) pcts++;
+            }
+        }
+    }
+    uint64_t count = (uint64_t)n[SWEEP_WIDTH] * n[SWEEP_HEIGHT] * n[SWEEP_K_MAX] * pcts;
+    if (count == 0 || count > SWEEP_POINTS_MAX) {
+        printf("[server] invalid SWEEP: %llu points (1..%u allowed)\n",
+               (unsigned long long)count, (unsigned)SWEEP_POINTS_MAX);
+        free(v);
+        return -1;
+    }
+
+    sweep_point_t* pts = malloc((size_t)count * sizeof(*pts));
+    if (!pts) {
+        fprintf(stderr, "[server] out of memory, SWEEP ignored\n");
+        free(v);
+        return -1;
+    }
+
+    /* posledná os sa mení najrýchlejšie */
+    uint32_t k = 0;
+    for (uint32_t w = 0; w < n[SWEEP_WIDTH]; w++) {
+        for (uint32_t h = 0; h < n[SWEEP_HEIGHT]; h++) {
+            for (uint32_t m = 0; m < n[SWEEP_K_MAX]; m++) {
+                for (uint32_t u = 0; u < n[SWEEP_P_UP]; u++) {
+                    for (uint32_t d = 0; d < n[SWEEP_P_DOWN]; d++) {
+                        for (uint32_t l = 0; l < n[SWEEP_P_LEFT]; l++) {
+                            uint32_t pu = v[SWEEP_P_UP][u];
+                            uint32_t pd = v[SWEEP_P_DOWN][d];
+                            uint32_t pl = v[SWEEP_P_LEFT][l];
+                            if (pu + pd + pl > 100u) continue;
+                            sweep_point_t* p = &pts[k++];
+                            p->width = (int32_t)v[SWEEP_WIDTH][w];
+                            p->height = (int32_t)v[SWEEP_HEIGHT][h];
+                            p->k_max = v[SWEEP_K_MAX][m];
+                            p->pct[0] = (uint8_t)pu;
+                            p->pct[1] = (uint8_t)pd;
+                            p->pct[2] = (uint8_t)pl;
+                            p->pct[3] = (uint8_t)(100u - pu - pd - pl);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    free(v);
+    *out = pts;
+    *total = k;
+    return 0;
+}
+
+uint32_t sweep_point_seed(uint32_t seed, uint32_t index, int crn) {
+    if (crn) return seed;
+    uint32_t key[2];
+    uint32_t ctr[4] = { index, 0u, 0u, 0x53575045u }; /* "SWPE" - iné počítadlá než replikácie */
+    uint32_t out[4];
+    rng_key_from_seed(seed, key);
+    philox4x32_10(ctr, key, out);
+    return (out[0] != 0u) ? out[0] : 1u;
+}
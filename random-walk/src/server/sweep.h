@@ -0,0 +1,48 @@
+/**
+ * @file sweep.h
+ * @brief Rozvinutie mriežky parametrov MSG_SWEEP na jednotlivé body.
+ *
+ * Každá os (msg_sweep_axis_t) dá zoznam hodnôt; body mriežky sú všetky
+ * ich kombinácie, posledná os sa mení najrýchlejšie. Percento RIGHT sa
+ * dopočíta do 100, body so súčtom UP + DOWN + LEFT nad 100 sa vynechajú.
+ * Samotné plánovanie bodov na pool robí server.
+ */
+
+#pragma once
+#include "protocol.h"
+
+#include <stdint.h>
+
+/**
+ * @brief Parametre jedného bodu mriežky.
+ */
+typedef struct {
+    int32_t width, height;   /**< Rozmery sveta */
+    uint32_t k_max;          /**< Maximálny počet krokov */
+    uint8_t pct[4];          /**< Percentá UP, DOWN, LEFT, RIGHT (súčet 100) */
+} sweep_point_t;
+
+/**
+ * @brief Overí MSG_SWEEP a rozvinie jeho mriežku na body.
+ *
+ * @param req Prijatá požiadavka.
+ * @param out Výstupné pole bodov (uvoľniť cez free()).
+ * @param total Výstupný počet bodov (>= 1).
+ * @return 0 pri úspechu, -1 pri neplatnej požiadavke alebo nedostatku pamäte.
+ */
+int sweep_expand(const msg_sweep_t* req, sweep_point_t** out, uint32_t* total);
+
+/**
+ * @brief Seed bodu prechodu.
+ *
+ * Pri crn všetky body zdieľajú seed prechodu, takže replikácia r má
+ * v každom bode rovnaký náhodný prúd. Inak sa seed bodu odvodí z Philox
+ * bloku (seed, index) - prúdy bodov sú nezávislé, ale prechod sa dá
+ * zopakovať a každý bod aj samostatným STARTom s vráteným seedom.
+ *
+ * @param seed Seed prechodu (nie 0).
+ * @param index Poradie bodu.
+ * @param crn 1 = spoločné náhodné prúdy.
+ * @return Seed bodu (nikdy 0).
+ */
+uint32_t sweep_point_seed(uint32_t seed, uint32_t index, int crn);